@@ -0,0 +1,378 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  state estimator benchmark (Linux only)
+
+  compares the extended Kalman filter (PoseEKF, same GPS gating/reset rules as computeRobotState) against
+  the previous complementary filter (GPS position reset, GPS heading fusion, 0.3m jump test):
+
+    session - a seeded simulated mowing session (parallel lines, rotate in place at line ends) for each
+              speed: the robot is steered by the estimate of the filter under test, so the cross-track error
+              of the true pose shows the tracking quality. Odometry has scale error and slip, the IMU a yaw
+              rate bias, GPS (5 Hz) has noise, float periods and single outliers. Timesteps are jittered.
+    replay  - a recorded session (CSV) is fed to both filters: difference between both estimates,
+              rejected GPS positions, CPU time per step
+
+  replay CSV (one line per computeRobotState call, header lines starting with '#' are ignored):
+    millis,leftTicks,rightTicks,imuYaw(rad),gpsSolution(0=invalid,1=float,2=fix, -1=no new solution),posN(m),posE(m)
+
+  usage:  ekfbench [-s SEED] [-t SECONDS] [-c TICKS_PER_CM] [-w WHEEL_BASE_CM] [SESSION.csv]
+
+  the summary is written to stderr.
+*/
+
+#include <string>
+#include <vector>
+#include <random>
+#include <Arduino.h>   // after STL headers (Arduino min/max macros)
+#include "../../sunray/config.h"
+#include "../../sunray/helper.h"
+#include "../../sunray/ekf.h"
+
+
+// one estimator timestep
+struct StepInput {
+  float dt;          // s
+  float distOdo;     // odometry distance (m)
+  float deltaOdo;    // odometry yaw change (rad)
+  float deltaImu;    // IMU yaw change (rad)
+  bool gpsAvail;     // new GPS solution
+  bool gpsFix;       // fix (otherwise float)
+  float gpsX;        // east (m)
+  float gpsY;        // north (m)
+  bool moving;       // robot commanded to move
+  bool rotating;     // robot commanded to rotate (>45 deg/s)
+};
+
+
+class Filter
+{
+  public:
+    float x, y, yaw;
+    int jumps;
+    virtual ~Filter(){}
+    virtual void begin(float x0, float y0, float yaw0) = 0;
+    virtual void step(const StepInput &in) = 0;
+};
+
+
+// previous complementary filter (computeRobotState before EKF)
+class LegacyFilter : public Filter
+{
+  public:
+    float lastPosN, lastPosE, lastPosDelta;
+    bool resetLastPos;
+    void begin(float x0, float y0, float yaw0){
+      x = x0; y = y0; yaw = yaw0;
+      jumps = 0;
+      lastPosN = lastPosE = lastPosDelta = 0;
+      resetLastPos = true;
+    }
+    void step(const StepInput &in){
+      if (!in.moving) resetLastPos = true;
+      if (in.gpsAvail){
+        float posN = in.gpsY;
+        float posE = in.gpsX;
+        float distGPS = sqrt( sq(posN-lastPosN)+sq(posE-lastPosE) );
+        if ((distGPS > 0.3) || (resetLastPos)){
+          if (distGPS > 0.3) jumps++;
+          resetLastPos = false;
+          lastPosN = posN;
+          lastPosE = posE;
+          lastPosDelta = yaw;
+        } else if (distGPS > 0.1) {
+          float diffLastPosDelta = distancePI(yaw, lastPosDelta);
+          if ((fabs(diffLastPosDelta) /PI * 180.0 < 10) && (in.moving) && (!in.rotating)){
+            float deltaGPS = scalePI(atan2(posN-lastPosN, posE-lastPosE));
+            float diffDelta = distancePI(yaw, deltaGPS);
+            if (fabs(diffDelta/PI*180) > 45){
+              yaw = deltaGPS;
+            } else {
+              deltaGPS = scalePIangles(deltaGPS, yaw);
+              yaw = scalePI(fusionPI(0.9, yaw, deltaGPS));
+            }
+          }
+          lastPosN = posN;
+          lastPosE = posE;
+          lastPosDelta = yaw;
+        }
+        x = posE;
+        y = posN;
+      }
+      x += in.distOdo * cos(yaw);
+      y += in.distOdo * sin(yaw);
+      yaw = scalePI(yaw + in.deltaImu);
+    }
+};
+
+
+// extended Kalman filter (same rules as computeRobotState)
+class EkfFilter : public Filter
+{
+  public:
+    PoseEKF ekf;
+    int rejects;
+    bool lastFix;
+    bool fixAfterFloat;
+    void begin(float x0, float y0, float yaw0){
+      ekf.reset(x0, y0, yaw0);
+      x = x0; y = y0; yaw = yaw0;
+      jumps = 0;
+      rejects = 0;
+      lastFix = false;
+      fixAfterFloat = false;
+    }
+    void step(const StepInput &in){
+      ekf.updateGyro(in.deltaImu / in.dt);
+      ekf.updateOdometry(in.distOdo / in.dt, in.deltaOdo / in.dt, EKF_ODO_W_SIGMA_IMU);
+      ekf.predict(in.dt);
+      if (in.gpsAvail){
+        float sigma = (in.gpsFix) ? EKF_GPS_FIX_SIGMA : EKF_GPS_FLOAT_SIGMA;
+        if ((in.gpsFix) && (!lastFix)) fixAfterFloat = true;
+        if (ekf.updatePosition(in.gpsX, in.gpsY, sigma, EKF_GPS_GATE, true)){
+          rejects = 0;
+          if (in.gpsFix) fixAfterFloat = false;
+        } else {
+          rejects++;
+          if (rejects == 1) jumps++;
+          if (rejects >= ((fixAfterFloat) ? 2 : EKF_GPS_GATE_RESETS)){
+            ekf.resetPosition(in.gpsX, in.gpsY, sigma);
+            rejects = 0;
+          }
+        }
+        lastFix = in.gpsFix;
+      }
+      x = ekf.s[EKF_X];
+      y = ekf.s[EKF_Y];
+      yaw = ekf.s[EKF_YAW];
+    }
+};
+
+
+class Stats
+{
+  public:
+    double sum2;
+    double maxVal;
+    long count;
+    Stats(){ sum2 = 0; maxVal = 0; count = 0; }
+    void add(double v){ sum2 += v*v; if (fabs(v) > maxVal) maxVal = fabs(v); count++; }
+    double rms(){ return (count > 0) ? sqrt(sum2 / count) : 0; }
+};
+
+
+class SessionResult
+{
+  public:
+    Stats crossTrack;   // true pose to tracked line (m)
+    Stats posError;     // estimate to true pose (m)
+    Stats posErrorFix;  // estimate to true pose while GPS fix (m)
+    Stats yawError;     // estimate to true heading (deg)
+    int jumps;
+    int lines;
+    double usPerStep;
+};
+
+
+// simulated mowing session: the robot is steered by the estimate of the filter
+SessionResult runSession(Filter &filter, unsigned int seed, float speed, float seconds){
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> gauss(0.0, 1.0);
+  std::uniform_real_distribution<float> uniform(0.0, 1.0);
+  SessionResult res;
+  const float lineLen = 15.0;
+  const float lineDist = 0.2;
+  const float gyroBias = 0.3 / 180.0 * PI;
+  const float odoScale = 1.01;
+  float tx = 0, ty = 0, tyaw = 0;   // true pose
+  filter.begin(0, 0, 0);
+  int line = 0;
+  bool rotating = false;
+  float floatX = 0, floatY = 0;
+  float t = 0;
+  float nextGpsTime = 0;
+  bool gpsFix = true;
+  long steps = 0;
+  double stepTime = 0;
+  while (t < seconds){
+    // current line (alternating direction)
+    float ly = line * lineDist;
+    float dir = (line % 2 == 0) ? 1 : -1;
+    float sx = (dir > 0) ? 0 : lineLen;
+    float ex = (dir > 0) ? lineLen : 0;
+    float targetYaw = (dir > 0) ? 0 : PI;
+    // controller (estimate)
+    float linear = 0;
+    float angular = 0;
+    float alongTrack = (filter.x - sx) * dir;
+    if (rotating){
+      float err = distancePI(filter.yaw, targetYaw);
+      angular = constrain(2.0 * err, -0.8, 0.8);
+      if (fabs(err) < 3.0 / 180.0 * PI) rotating = false;
+    } else {
+      float lateral = (filter.y - ly) * dir;     // left of line > 0
+      float headErr = distancePI(filter.yaw, targetYaw);
+      angular = constrain(headErr - atan2(2.0 * lateral, 0.3), -1.0, 1.0);  // stanley
+      linear = speed;
+      res.crossTrack.add(ty - ly);
+      if (alongTrack > lineLen){
+        line++;
+        rotating = true;
+        res.lines++;
+      }
+    }
+    (void)ex;
+    // true motion
+    float dt = 0.02 + 0.005 * (uniform(rng) - 0.5) * 2;
+    float v = linear * (1.0 + 0.02 * gauss(rng));
+    float w = angular * (1.0 + 0.02 * gauss(rng));
+    tx += v * cos(tyaw) * dt;
+    ty += v * sin(tyaw) * dt;
+    tyaw = scalePI(tyaw + w * dt);
+    // sensors
+    StepInput in;
+    in.dt = dt;
+    in.distOdo = v * dt * odoScale + 0.0005 * gauss(rng);
+    in.deltaOdo = w * dt * 1.05 + 0.002 * gauss(rng);  // wheel slip when turning
+    in.deltaImu = (w + gyroBias) * dt + 0.0005 * gauss(rng);
+    in.moving = (linear > 0);
+    in.rotating = (fabs(angular) > PI / 4);
+    in.gpsAvail = false;
+    if (t >= nextGpsTime){
+      nextGpsTime += 0.2;
+      in.gpsAvail = true;
+      // float solution 10s of every 60s
+      in.gpsFix = (fmod(t, 60.0) < 50.0);
+      gpsFix = in.gpsFix;
+      if (in.gpsFix){
+        floatX = floatY = 0;
+      } else {
+        floatX = constrain(floatX + 0.02 * gauss(rng), -0.5, 0.5);
+        floatY = constrain(floatY + 0.02 * gauss(rng), -0.5, 0.5);
+      }
+      in.gpsX = tx + 0.015 * gauss(rng) + floatX;
+      in.gpsY = ty + 0.015 * gauss(rng) + floatY;
+      // single outlier every 30s
+      if (fmod(t + 15.0, 30.0) < 0.2){
+        in.gpsX += 1.0;
+        in.gpsY -= 1.0;
+      }
+    }
+    unsigned long startTime = micros();
+    filter.step(in);
+    stepTime += micros() - startTime;
+    steps++;
+    res.posError.add(sqrt(sq(filter.x - tx) + sq(filter.y - ty)));
+    if (gpsFix) res.posErrorFix.add(sqrt(sq(filter.x - tx) + sq(filter.y - ty)));
+    res.yawError.add(distancePI(filter.yaw, tyaw) / PI * 180.0);
+    t += dt;
+  }
+  res.jumps = filter.jumps;
+  res.usPerStep = stepTime / max(1L, steps);
+  return res;
+}
+
+
+// recorded session: difference between both filters
+bool replay(const char *fileName, float ticksPerCm, float wheelBaseCm){
+  FILE *f = fopen(fileName, "r");
+  if (f == NULL) return false;
+  LegacyFilter legacy;
+  EkfFilter ekf;
+  legacy.begin(0, 0, 0);
+  ekf.begin(0, 0, 0);
+  Stats diff;
+  char line[256];
+  long lastMs = -1;
+  long lastLeft = 0, lastRight = 0;
+  float lastYaw = 0;
+  double legacyTime = 0, ekfTime = 0;
+  long steps = 0;
+  while (fgets(line, sizeof(line), f) != NULL){
+    if (line[0] == '#') continue;
+    long ms, left, right;
+    float imuYaw, posN, posE;
+    int sol;
+    if (sscanf(line, "%ld,%ld,%ld,%f,%d,%f,%f", &ms, &left, &right, &imuYaw, &sol, &posN, &posE) != 7) continue;
+    if (lastMs < 0){
+      lastMs = ms; lastLeft = left; lastRight = right; lastYaw = imuYaw;
+      continue;
+    }
+    StepInput in;
+    in.dt = max(0.001, (ms - lastMs) / 1000.0);
+    float distLeft = (left - lastLeft) / ticksPerCm;
+    float distRight = (right - lastRight) / ticksPerCm;
+    in.distOdo = (distLeft + distRight) / 2.0 / 100.0;
+    in.deltaOdo = -(distLeft - distRight) / wheelBaseCm;
+    in.deltaImu = -distancePI(imuYaw, lastYaw);
+    in.moving = (fabs(in.distOdo) > 0.0001);
+    in.rotating = (fabs(in.deltaImu / in.dt) > PI / 4);
+    in.gpsAvail = (sol >= 1);
+    in.gpsFix = (sol == 2);
+    in.gpsX = posE;
+    in.gpsY = posN;
+    lastMs = ms; lastLeft = left; lastRight = right; lastYaw = imuYaw;
+    unsigned long startTime = micros();
+    legacy.step(in);
+    legacyTime += micros() - startTime;
+    startTime = micros();
+    ekf.step(in);
+    ekfTime += micros() - startTime;
+    steps++;
+    diff.add(sqrt(sq(legacy.x - ekf.x) + sq(legacy.y - ekf.y)));
+  }
+  fclose(f);
+  fprintf(stderr, "replay: %s  %ld steps\n", fileName, steps);
+  fprintf(stderr, "  position difference legacy/EKF: rms %.3f m  max %.3f m\n", diff.rms(), diff.maxVal);
+  fprintf(stderr, "  GPS jumps: legacy %d  EKF %d\n", legacy.jumps, ekf.jumps);
+  fprintf(stderr, "  CPU: legacy %.2f us/step  EKF %.2f us/step\n", legacyTime / max(1L, steps), ekfTime / max(1L, steps));
+  return true;
+}
+
+
+void printResult(const char *name, SessionResult &res){
+  fprintf(stderr, "  %-7s cross-track rms %.3f m  max %.3f m | position rms %.3f m (fix %.3f m) | heading rms %.2f deg | jumps %d | lines %d | %.2f us/step\n",
+    name, res.crossTrack.rms(), res.crossTrack.maxVal, res.posError.rms(), res.posErrorFix.rms(), res.yawError.rms(), res.jumps, res.lines, res.usPerStep);
+}
+
+
+int main(int argc, char *argv[]){
+  int seed = 1;
+  float seconds = 600;
+  float ticksPerCm = TICKS_PER_REVOLUTION / (PI * WHEEL_DIAMETER / 10.0);
+  float wheelBaseCm = WHEEL_BASE_CM;
+  const char *sessionFile = NULL;
+  for (int i=1; i < argc; i++){
+    std::string arg = argv[i];
+    if ((arg == "-s") && (i+1 < argc)) seed = atoi(argv[++i]);
+      else if ((arg == "-t") && (i+1 < argc)) seconds = atof(argv[++i]);
+      else if ((arg == "-c") && (i+1 < argc)) ticksPerCm = atof(argv[++i]);
+      else if ((arg == "-w") && (i+1 < argc)) wheelBaseCm = atof(argv[++i]);
+      else if (arg[0] != '-') sessionFile = argv[i];
+      else {
+        fprintf(stderr, "usage: ekfbench [-s SEED] [-t SECONDS] [-c TICKS_PER_CM] [-w WHEEL_BASE_CM] [SESSION.csv]\n");
+        return 2;
+      }
+  }
+  if (sessionFile != NULL){
+    if (!replay(sessionFile, ticksPerCm, wheelBaseCm)){
+      fprintf(stderr, "ERROR: cannot read %s\n", sessionFile);
+      return 2;
+    }
+    return 0;
+  }
+  float speeds[] = { 0.3, 0.5, 0.8, 1.0 };
+  for (unsigned int i=0; i < sizeof(speeds)/sizeof(speeds[0]); i++){
+    LegacyFilter legacy;
+    EkfFilter ekf;
+    SessionResult legacyRes = runSession(legacy, seed, speeds[i], seconds);
+    SessionResult ekfRes = runSession(ekf, seed, speeds[i], seconds);
+    fprintf(stderr, "session: speed %.1f m/s  %.0f s  seed %d\n", speeds[i], seconds, seed);
+    printResult("legacy", legacyRes);
+    printResult("EKF", ekfRes);
+  }
+  return 0;
+}
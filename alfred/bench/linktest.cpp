@@ -0,0 +1,183 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  binary MCU link test (Linux only, see ROBOT_BINARY_LINK)
+
+  frames (LinkWriter) and ASCII lines are interleaved on one simulated UART and split again by the
+  receiver (LinkReceiver) as SerialRobotDriver does:
+
+    codes   - one frame for each COBS code byte (first zero byte of the payload at each offset),
+              including the code bytes 10 ('\n') and 13 ('\r')
+    motor   - 'M' responses (MCU time > 2^24 ms, odometry ticks) whose first zero is at offset 9 (code 10)
+    resync  - a frame with lost delimiter, followed by clean frames and lines
+
+  all frames must be decoded (CRC ok, same type and sequence number) and all ASCII lines received unchanged.
+  usage:  linktest    (summary to stderr, exit code 1 on failures)
+*/
+
+#include <string>
+#include <vector>
+#include <Arduino.h>   // after STL headers (Arduino min/max macros)
+#include "../../sunray/config.h"
+#include "../../sunray/src/driver/SerialRobotLink.h"
+
+
+class Received {
+  public:
+    std::vector<std::string> lines;
+    std::vector<char> types;
+    std::vector<uint16_t> seqs;
+    int crcErrors;
+    Received(){ crcErrors = 0; }
+};
+
+static void addFrame(std::vector<uint8_t> &data, LinkWriter &w){
+  uint8_t frame[LINK_MAX_FRAME];
+  int n = w.finish(frame);
+  data.insert(data.end(), frame, frame + n);
+}
+
+static void addLine(std::vector<uint8_t> &data, const char *line){
+  data.insert(data.end(), line, line + strlen(line));
+  data.push_back('\r');
+  data.push_back('\n');
+}
+
+// split as SerialRobotDriver::processComm
+static void receive(const std::vector<uint8_t> &data, Received &rx){
+  LinkReceiver link;
+  std::string cmd;
+  for (size_t i=0; i < data.size(); i++){
+    uint8_t ch = data[i];
+    LinkRxResult res = link.receive(ch);
+    if (res == LINK_RX_FRAME){
+      uint8_t payload[LINK_MAX_FRAME];
+      LinkReader r;
+      if ((link.frameLen > LINK_MAX_FRAME) || (!r.begin(link.frame, link.frameLen, payload))){
+        rx.crcErrors++;
+      } else {
+        rx.types.push_back(r.u8());
+        rx.seqs.push_back(r.u16());
+      }
+    }
+    if (res != LINK_RX_ASCII) continue;
+    if ((ch == '\r') || (ch == '\n')){
+      if (cmd.length() != 0) rx.lines.push_back(cmd);
+      cmd = "";
+    } else cmd += (char)ch;
+  }
+}
+
+// payload: type, seq, nonzero bytes up to offset zeroPos (COBS code byte zeroPos+1), zero, nonzero bytes
+static int makeCodeFrame(LinkWriter &w, uint16_t seq, int zeroPos){
+  w.begin('V', seq);
+  while (w.len < zeroPos) w.u8(0x55);
+  w.u8(0);
+  while (w.len < LINK_MAX_PAYLOAD - 2) w.u8(0x41 + (w.len % 26));
+  return zeroPos + 1;
+}
+
+static int check(const char *name, const Received &rx, int lines, const std::vector<char> &types, const std::vector<uint16_t> &seqs,
+    int crcErrors){
+  bool ok = ((int)rx.lines.size() == lines) && (rx.types == types) && (rx.seqs == seqs) && (rx.crcErrors == crcErrors);
+  for (size_t i=0; i < rx.lines.size(); i++){
+    if (rx.lines[i] != "M,1234,-5678,0") ok = false;
+  }
+  fprintf(stderr, "%-7s %s (lines %d/%d, frames %d/%d, crc errors %d/%d)\n", name, ok ? "ok" : "FAILED",
+    (int)rx.lines.size(), lines, (int)rx.types.size(), (int)types.size(), rx.crcErrors, crcErrors);
+  return ok ? 0 : 1;
+}
+
+// one frame for each code byte, each followed by an ASCII line
+static int testCodes(){
+  std::vector<uint8_t> data;
+  std::vector<char> types;
+  std::vector<uint16_t> seqs;
+  bool codes10and13 = false;
+  int lines = 0;
+  for (int zeroPos=3; zeroPos < LINK_MAX_PAYLOAD - 2; zeroPos++){
+    LinkWriter w;
+    uint16_t seq = 0x0101 + zeroPos;
+    int code = makeCodeFrame(w, seq, zeroPos);
+    size_t start = data.size();
+    addFrame(data, w);
+    if (data[start + 1] != code) fprintf(stderr, "codes: unexpected code byte %d (expected %d)\n", data[start + 1], code);
+    if ((code == '\n') || (code == '\r')) codes10and13 = true;
+    types.push_back('V');
+    seqs.push_back(seq);
+    addLine(data, "M,1234,-5678,0");
+    lines++;
+  }
+  if (!codes10and13) fprintf(stderr, "codes: code bytes 10/13 not tested\n");
+  Received rx;
+  receive(data, rx);
+  return check("codes", rx, lines, types, seqs, 0) + (codes10and13 ? 0 : 1);
+}
+
+// 'M' responses after MCU time passed 2^24 ms: first zero in ticksLeft (offset 9, code byte '\n')
+static int testMotor(){
+  std::vector<uint8_t> data;
+  std::vector<char> types;
+  std::vector<uint16_t> seqs;
+  int lines = 0;
+  for (int i=0; i < 100; i++){
+    LinkWriter w;
+    uint16_t seq = 0x0201 + i;
+    w.begin('M', seq);
+    w.u32(0x01000000 + 0x010101 * (i+1));   // MCU time (ms)
+    w.i32(0x0100 + i + 1);                  // ticksLeft (zero at offset 9)
+    w.i32(-1 - i);                          // ticksRight
+    w.i32(0);                               // ticksMow
+    w.f32(28.5);
+    w.u8(i & 7);
+    size_t start = data.size();
+    addFrame(data, w);
+    if (data[start + 1] != '\n') fprintf(stderr, "motor: unexpected code byte %d\n", data[start + 1]);
+    types.push_back('M');
+    seqs.push_back(seq);
+    if (i % 3 == 0){
+      addLine(data, "M,1234,-5678,0");
+      lines++;
+    }
+  }
+  Received rx;
+  receive(data, rx);
+  return check("motor", rx, lines, types, seqs, 0);
+}
+
+// frame with lost delimiter: it is merged with the next frame (one CRC error), later frames and lines are received
+static int testResync(){
+  std::vector<uint8_t> data;
+  std::vector<char> types;
+  std::vector<uint16_t> seqs;
+  LinkWriter w;
+  makeCodeFrame(w, 0x0301, 9);
+  addFrame(data, w);
+  data.pop_back();  // lost delimiter
+  makeCodeFrame(w, 0x0302, 12);
+  addFrame(data, w);
+  addLine(data, "M,1234,-5678,0");
+  for (int i=0; i < 3; i++){
+    makeCodeFrame(w, 0x0303 + i, 9 + 3*i);
+    addFrame(data, w);
+    types.push_back('V');
+    seqs.push_back(0x0303 + i);
+  }
+  addLine(data, "M,1234,-5678,0");
+  Received rx;
+  receive(data, rx);
+  return check("resync", rx, 2, types, seqs, 1);
+}
+
+
+int main(int argc, char *argv[]){
+  int failures = 0;
+  failures += testCodes();
+  failures += testMotor();
+  failures += testResync();
+  fprintf(stderr, "%s\n", (failures == 0) ? "all tests passed" : "TESTS FAILED");
+  return (failures == 0) ? 0 : 1;
+}
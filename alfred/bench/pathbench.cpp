@@ -0,0 +1,306 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  path finder benchmark (Linux only)
+
+  loads all map files (*.bin) of a directory and runs a fixed (seeded) set of findPath queries on each map:
+    dock  - last dock point to mow points
+    rand  - random point pairs inside perimeter (outside exclusions)
+    obst  - random point pairs with a virtual obstacle in between (replan after obstacle)
+
+  usage:  pathbench MAPDIR [-s SEED] [-n QUERIES] [-r REPEATS] [-o RESULT.csv] [-b BASELINE.csv] [-t TOLERANCE_PERCENT]
+
+  each query is repeated REPEATS times and the fastest run is reported (less timing noise).
+
+  per query results are written as CSV (map,kind,idx,ok,timeout,us,iterations,nodes,length),
+  the summary (p50/p95/p99/max latency etc. per map and kind) is written to stderr (firmware console output goes to stdout).
+  with a baseline CSV (result of a previous run), the run is compared against the baseline and the exit code is 1
+  on regressions (new failures, changed path lengths, latency p95 slower than tolerance).
+*/
+
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <Arduino.h>   // after STL headers (Arduino min/max macros)
+#include "../../sunray/config.h"
+#include "../../sunray/map.h"
+#include "../../sunray/robot.h"
+#include "../../sunray/helper.h"
+
+
+struct BenchResult {
+  std::string map;
+  std::string kind;
+  int idx;
+  bool ok;
+  bool timeout;
+  unsigned long us;
+  int iterations;
+  int nodes;
+  float length;
+};
+
+
+static float pathLength(){
+  float len = 0;
+  for (int i=0; i < maps.freePoints.numPoints-1; i++){
+    Point &p0 = maps.freePoints.points[i];
+    Point &p1 = maps.freePoints.points[i+1];
+    len += distance(p0.x(), p0.y(), p1.x(), p1.y());
+  }
+  return len;
+}
+
+static bool findValidPoint(float minX, float minY, float maxX, float maxY, Point &pt){
+  for (int timeout = 10000; timeout > 0; timeout--){
+    pt.setXY( minX + (maxX-minX) * ((float)random(10000))/10000.0, minY + (maxY-minY) * ((float)random(10000))/10000.0 );
+    if (maps.isInsidePerimeterOutsideExclusions(pt)) return true;
+  }
+  return false;
+}
+
+static int repeats = 3;
+
+static void runQuery(std::vector<BenchResult> &results, const std::string &mapName, const char *kind, int idx, Point &src, Point &dst){
+  BenchResult r;
+  r.map = mapName;
+  r.kind = kind;
+  r.idx = idx;
+  for (int i=0; i < repeats; i++){
+    unsigned long startTime = micros();
+    r.ok = maps.findPath(src, dst);
+    unsigned long us = micros() - startTime;
+    if ((i == 0) || (us < r.us)) r.us = us;
+  }
+  r.timeout = maps.pathFinderTimeout;
+  r.iterations = maps.pathFinderIterations;
+  r.nodes = maps.pathFinderNodes.numNodes;
+  r.length = (r.ok) ? pathLength() : 0;
+  results.push_back(r);
+}
+
+static void benchMap(std::vector<BenchResult> &results, const std::string &mapName, const std::string &fileName, int numQueries){
+  if (!maps.load(fileName.c_str())) {
+    fprintf(stderr, "pathbench: ERROR loading map %s\n", fileName.c_str());
+    return;
+  }
+  maps.clearObstacles();
+  if (maps.perimeterPoints.numPoints == 0) return;
+  float minX = 9999; float minY = 9999; float maxX = -9999; float maxY = -9999;
+  for (int i=0; i < maps.perimeterPoints.numPoints; i++){
+    minX = min(minX, maps.perimeterPoints.points[i].x());
+    minY = min(minY, maps.perimeterPoints.points[i].y());
+    maxX = max(maxX, maps.perimeterPoints.points[i].x());
+    maxY = max(maxY, maps.perimeterPoints.points[i].y());
+  }
+  Point src;
+  Point dst;
+  // dock-to-mow (mow points evenly sampled)
+  if ((maps.dockPoints.numPoints > 0) && (maps.mowPoints.numPoints > 0)){
+    int step = max(1, maps.mowPoints.numPoints / numQueries);
+    int idx = 0;
+    for (int i=0; i < maps.mowPoints.numPoints; i += step){
+      src.assign(maps.dockPoints.points[maps.dockPoints.numPoints-1]);
+      dst.assign(maps.mowPoints.points[i]);
+      runQuery(results, mapName, "dock", idx++, src, dst);
+    }
+  }
+  // random pairs
+  for (int i=0; i < numQueries; i++){
+    if (!findValidPoint(minX, minY, maxX, maxY, src)) break;
+    if (!findValidPoint(minX, minY, maxX, maxY, dst)) break;
+    runQuery(results, mapName, "rand", i, src, dst);
+  }
+  // replan after obstacle (obstacle placed half way in front of robot)
+  for (int i=0; i < numQueries; i++){
+    if (!findValidPoint(minX, minY, maxX, maxY, src)) break;
+    if (!findValidPoint(minX, minY, maxX, maxY, dst)) break;
+    maps.targetPoint.assign(dst);
+    maps.addObstacle((src.x() + dst.x()) / 2, (src.y() + dst.y()) / 2);
+    runQuery(results, mapName, "obst", i, src, dst);
+    maps.clearObstacles();
+  }
+}
+
+static float percentile(std::vector<unsigned long> &values, float p){
+  if (values.size() == 0) return 0;
+  size_t idx = (size_t)(p / 100.0 * (values.size()-1) + 0.5);
+  return values[idx];
+}
+
+// summary for all results matching map and kind ("" matches all)
+static void printSummary(FILE *f, std::vector<BenchResult> &results, const std::string &mapName, const std::string &kind){
+  std::vector<unsigned long> us;
+  long iterations = 0;
+  long nodes = 0;
+  int failed = 0;
+  int timeouts = 0;
+  double length = 0;
+  for (size_t i=0; i < results.size(); i++){
+    BenchResult &r = results[i];
+    if ((mapName != "") && (r.map != mapName)) continue;
+    if ((kind != "") && (r.kind != kind)) continue;
+    us.push_back(r.us);
+    iterations += r.iterations;
+    nodes += r.nodes;
+    length += r.length;
+    if (!r.ok) failed++;
+    if (r.timeout) timeouts++;
+  }
+  if (us.size() == 0) return;
+  std::sort(us.begin(), us.end());
+  int n = us.size();
+  fprintf(f, "summary map=%s kind=%s n=%d failed=%d timeouts=%d p50_us=%.0f p95_us=%.0f p99_us=%.0f max_us=%lu avg_iterations=%.1f avg_nodes=%.1f total_length=%.2f\n",
+    (mapName == "") ? "*" : mapName.c_str(), (kind == "") ? "*" : kind.c_str(), n, failed, timeouts,
+    percentile(us, 50), percentile(us, 95), percentile(us, 99), us[n-1], ((float)iterations)/n, ((float)nodes)/n, length);
+}
+
+static bool writeResults(const char *fileName, std::vector<BenchResult> &results){
+  FILE *f = fopen(fileName, "w");
+  if (f == NULL) {
+    fprintf(stderr, "pathbench: ERROR opening %s for writing\n", fileName);
+    return false;
+  }
+  fprintf(f, "map,kind,idx,ok,timeout,us,iterations,nodes,length\n");
+  for (size_t i=0; i < results.size(); i++){
+    BenchResult &r = results[i];
+    fprintf(f, "%s,%s,%d,%d,%d,%lu,%d,%d,%.3f\n", r.map.c_str(), r.kind.c_str(), r.idx, r.ok, r.timeout, r.us, r.iterations, r.nodes, r.length);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool readResults(const char *fileName, std::vector<BenchResult> &results){
+  FILE *f = fopen(fileName, "r");
+  if (f == NULL) {
+    fprintf(stderr, "pathbench: ERROR opening %s for reading\n", fileName);
+    return false;
+  }
+  char line[512];
+  if (fgets(line, sizeof(line), f) == NULL) { fclose(f); return false; } // header
+  while (fgets(line, sizeof(line), f) != NULL){
+    char mapName[256];
+    char kind[32];
+    int ok = 0;
+    int timeout = 0;
+    BenchResult r;
+    if (sscanf(line, "%255[^,],%31[^,],%d,%d,%d,%lu,%d,%d,%f", mapName, kind, &r.idx, &ok, &timeout, &r.us, &r.iterations, &r.nodes, &r.length) != 9) continue;
+    r.map = mapName;
+    r.kind = kind;
+    r.ok = ok;
+    r.timeout = timeout;
+    results.push_back(r);
+  }
+  fclose(f);
+  return true;
+}
+
+// compare run against baseline (queries matched by map,kind,idx) - returns number of regressions
+static int compareResults(std::vector<BenchResult> &results, std::vector<BenchResult> &baseline, float tolerance){
+  std::map<std::string, BenchResult*> base;
+  for (size_t i=0; i < baseline.size(); i++){
+    BenchResult &r = baseline[i];
+    base[r.map + "," + r.kind + "," + std::to_string(r.idx)] = &r;
+  }
+  int regressions = 0;
+  std::map<std::string, std::vector<unsigned long> > usCurr;
+  std::map<std::string, std::vector<unsigned long> > usBase;
+  for (size_t i=0; i < results.size(); i++){
+    BenchResult &r = results[i];
+    std::string key = r.map + "," + r.kind + "," + std::to_string(r.idx);
+    if (base.count(key) == 0) continue;
+    BenchResult &b = *base[key];
+    if ((b.ok) && (!r.ok)) {
+      fprintf(stderr, "regression query=%s new failure\n", key.c_str());
+      regressions++;
+    } else if ((b.ok) && (r.ok) && (fabs(r.length - b.length) > 0.01 + b.length * 0.01)) {
+      fprintf(stderr, "regression query=%s length=%.3f baseline=%.3f\n", key.c_str(), r.length, b.length);
+      regressions++;
+    }
+    usCurr[r.kind].push_back(r.us);
+    usBase[r.kind].push_back(b.us);
+  }
+  for (std::map<std::string, std::vector<unsigned long> >::iterator it = usCurr.begin(); it != usCurr.end(); ++it){
+    std::vector<unsigned long> &curr = it->second;
+    std::vector<unsigned long> &prev = usBase[it->first];
+    std::sort(curr.begin(), curr.end());
+    std::sort(prev.begin(), prev.end());
+    float p50 = percentile(curr, 50);
+    float p95 = percentile(curr, 95);
+    float baseP50 = percentile(prev, 50);
+    float baseP95 = percentile(prev, 95);
+    float change = (baseP95 > 0) ? (p95 - baseP95) / baseP95 * 100.0 : 0;
+    fprintf(stderr, "compare kind=%s n=%d p50_us=%.0f baseline_p50_us=%.0f p95_us=%.0f baseline_p95_us=%.0f p95_change_percent=%.1f\n",
+      it->first.c_str(), (int)curr.size(), p50, baseP50, p95, baseP95, change);
+    if (change > tolerance) {
+      fprintf(stderr, "regression kind=%s p95 slower than tolerance (%.1f%%)\n", it->first.c_str(), tolerance);
+      regressions++;
+    }
+  }
+  fprintf(stderr, "compare regressions=%d\n", regressions);
+  return regressions;
+}
+
+
+int main(int argc, char **argv){
+  const char *mapDir = NULL;
+  const char *outFile = "pathbench.csv";
+  const char *baselineFile = NULL;
+  unsigned long seed = 1;
+  int numQueries = 50;
+  float tolerance = 20.0;
+  for (int i=1; i < argc; i++){
+    String arg = argv[i];
+    if ((arg == "-s") && (i+1 < argc)) seed = strtoul(argv[++i], NULL, 10);
+    else if ((arg == "-n") && (i+1 < argc)) numQueries = atoi(argv[++i]);
+    else if ((arg == "-r") && (i+1 < argc)) repeats = atoi(argv[++i]);
+    else if ((arg == "-o") && (i+1 < argc)) outFile = argv[++i];
+    else if ((arg == "-b") && (i+1 < argc)) baselineFile = argv[++i];
+    else if ((arg == "-t") && (i+1 < argc)) tolerance = atof(argv[++i]);
+    else mapDir = argv[i];
+  }
+  if ((mapDir == NULL) || (numQueries <= 0) || (repeats <= 0)){
+    fprintf(stderr, "usage: %s MAPDIR [-s SEED] [-n QUERIES] [-r REPEATS] [-o RESULT.csv] [-b BASELINE.csv] [-t TOLERANCE_PERCENT]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<std::string> mapNames;
+  DIR *dir = opendir(mapDir);
+  if (dir == NULL){
+    fprintf(stderr, "pathbench: ERROR opening directory %s\n", mapDir);
+    return 2;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL){
+    std::string name = entry->d_name;
+    if ((name.size() > 4) && (name.compare(name.size()-4, 4, ".bin") == 0)) mapNames.push_back(name);
+  }
+  closedir(dir);
+  std::sort(mapNames.begin(), mapNames.end()); // fixed order for reproducible runs
+
+  std::vector<BenchResult> results;
+  for (size_t i=0; i < mapNames.size(); i++){
+    randomSeed(seed + i);
+    benchMap(results, mapNames[i], std::string(mapDir) + "/" + mapNames[i], numQueries);
+  }
+
+  for (size_t i=0; i < mapNames.size(); i++){
+    printSummary(stderr, results, mapNames[i], "dock");
+    printSummary(stderr, results, mapNames[i], "rand");
+    printSummary(stderr, results, mapNames[i], "obst");
+  }
+  printSummary(stderr, results, "", "");
+  if (!writeResults(outFile, results)) return 2;
+
+  if (baselineFile != NULL){
+    std::vector<BenchResult> baseline;
+    if (!readResults(baselineFile, baseline)) return 2;
+    if (compareResults(results, baseline, tolerance) > 0) return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,464 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  UBX decoder benchmark and fuzz test (Linux only)
+
+  compares the UBLOX frame scanner (bulk buffer, memchr sync search, packed message views) against a
+  reference byte-at-a-time decoder (the previous state machine parser):
+
+    replay  - a .ubx log file (or a seeded synthetic stream of NAV-TIMEUTC/PVT/VELNED/HPPOSLLH/SIG/RELPOSNED
+              and RXM-RTCM frames with noise between frames) is fed in random chunks to both decoders,
+              the decoded state must be bit-identical after each chunk
+    speed   - decoder throughput (MB/s) of both decoders over the same stream
+    fuzz    - corrupted streams (bit flips, dropped/inserted bytes, fake headers with random lengths) are
+              fed to the scanner, followed by clean frames and an idle gap: the scanner must resync and decode
+              the clean frames identically to the reference decoder
+
+  usage:  ubxbench [-s SEED] [-n FRAMES] [-r REPEATS] [-f FUZZ_ROUNDS] [LOG.ubx]
+
+  the summary is written to stderr (firmware console output goes to stdout), the exit code is 1 on mismatches.
+*/
+
+#include <string>
+#include <vector>
+#include <Arduino.h>   // after STL headers (Arduino min/max macros)
+#include "../../sunray/config.h"
+#include "../../sunray/src/ublox/ublox.h"
+
+
+// decoded receiver state compared between both decoders
+struct DecodedState {
+  unsigned long iTOW;
+  int numSV;
+  int numSVdgps;
+  double lon;
+  double lat;
+  double height;
+  float relPosN;
+  float relPosE;
+  float relPosD;
+  float heading;
+  float groundSpeed;
+  float accuracy;
+  float hAccuracy;
+  float vAccuracy;
+  int solution;
+  int year;
+  int month;
+  int day;
+  int hour;
+  int mins;
+  int sec;
+  unsigned long dgpsChecksumErrorCounter;
+  unsigned long dgpsPacketCounter;
+  unsigned long chksumErrorCounter;
+};
+
+
+// start decoder with zero decoded state (same as reference decoder)
+static void beginDecoder(UBLOX &ubx){
+  ubx.begin();
+  ubx.iTOW = 0;
+  ubx.lon = ubx.lat = ubx.height = 0;
+  ubx.relPosN = ubx.relPosE = ubx.relPosD = 0;
+  ubx.heading = ubx.groundSpeed = 0;
+  ubx.hAccuracy = ubx.vAccuracy = 0;
+  ubx.year = ubx.month = ubx.day = ubx.hour = ubx.mins = ubx.sec = 0;
+}
+
+static void snapshot(UBLOX &ubx, DecodedState &st){
+  memset(&st, 0, sizeof(st));
+  st.iTOW = ubx.iTOW;
+  st.numSV = ubx.numSV;
+  st.numSVdgps = ubx.numSVdgps;
+  st.lon = ubx.lon;
+  st.lat = ubx.lat;
+  st.height = ubx.height;
+  st.relPosN = ubx.relPosN;
+  st.relPosE = ubx.relPosE;
+  st.relPosD = ubx.relPosD;
+  st.heading = ubx.heading;
+  st.groundSpeed = ubx.groundSpeed;
+  st.accuracy = ubx.accuracy;
+  st.hAccuracy = ubx.hAccuracy;
+  st.vAccuracy = ubx.vAccuracy;
+  st.solution = ubx.solution;
+  st.year = ubx.year;
+  st.month = ubx.month;
+  st.day = ubx.day;
+  st.hour = ubx.hour;
+  st.mins = ubx.mins;
+  st.sec = ubx.sec;
+  st.dgpsChecksumErrorCounter = ubx.dgpsChecksumErrorCounter;
+  st.dgpsPacketCounter = ubx.dgpsPacketCounter;
+  st.chksumErrorCounter = ubx.chksumErrorCounter;
+}
+
+// compare decoded fields (and optionally counters)
+static bool sameState(const DecodedState &a, const DecodedState &b, bool counters){
+  DecodedState x = a;
+  DecodedState y = b;
+  if (!counters){
+    x.dgpsChecksumErrorCounter = y.dgpsChecksumErrorCounter = 0;
+    x.dgpsPacketCounter = y.dgpsPacketCounter = 0;
+    x.chksumErrorCounter = y.chksumErrorCounter = 0;
+  }
+  return (memcmp(&x, &y, sizeof(x)) == 0);
+}
+
+
+// reference decoder: previous byte-at-a-time UBX state machine
+// (I4/I1 fields read as signed 32/8 bit values - the previous unpack() returned I1 high precision
+//  components unsigned and did not sign extend I4 fields on 64-bit CPUs)
+class RefDecoder {
+  public:
+    DecodedState st;
+    RefDecoder(){
+      memset(&st, 0, sizeof(st));
+      state = 0;
+    }
+    void parse(int b){
+      switch (state){
+        case 0: if (b == 0xB5) state = 1; break;
+        case 1: if (b == 0x62) { state = 2; chka = chkb = 0; } else state = 0; break;
+        case 2: state = 3; msgclass = b; addchk(b); break;
+        case 3: state = 4; msgid = b; addchk(b); break;
+        case 4: state = 5; msglen = b; addchk(b); break;
+        case 5: state = 6; msglen += (b << 8); count = 0; addchk(b); if (msglen == 0) state = 7; break;
+        case 6:
+          addchk(b);
+          if (count < (int)sizeof(payload)) payload[count] = b;
+          count++;
+          if (count >= msglen) state = 7;
+          break;
+        case 7:
+          if (b == chka) state = 8;
+            else { st.chksumErrorCounter++; state = 0; }
+          break;
+        case 8:
+          if (b == chkb) dispatch();
+            else st.chksumErrorCounter++;
+          state = 0;
+          break;
+      }
+    }
+  protected:
+    int state;
+    int msgclass;
+    int msgid;
+    int msglen;
+    int count;
+    int chka;
+    int chkb;
+    byte payload[2000];
+    void addchk(int b){
+      chka = (chka + b) & 0xFF;
+      chkb = (chkb + chka) & 0xFF;
+    }
+    unsigned long u(int offset, int size){
+      unsigned long value = 0;
+      for (int k=0; k < size; k++){
+        value <<= 8;
+        value |= payload[offset+size-k-1];
+      }
+      return value;
+    }
+    int32_t i4(int offset){ return (int32_t)u(offset, 4); }
+    int8_t i1(int offset){ return (int8_t)u(offset, 1); }
+    void dispatch(){
+      if (msgclass == 0x01){
+        switch (msgid){
+          case 0x21:
+            st.iTOW = u(0, 4);
+            st.year = u(12, 2);
+            st.month = u(14, 1);
+            st.day = u(15, 1);
+            st.hour = u(16, 1);
+            st.mins = u(17, 1);
+            st.sec = u(18, 1);
+            break;
+          case 0x07:
+            st.iTOW = u(0, 4);
+            break;
+          case 0x12:
+            st.iTOW = u(0, 4);
+            st.groundSpeed = ((double)u(20, 4)) / 100.0;
+            st.heading = ((double)i4(24)) * 1e-5 / 180.0 * PI;
+            break;
+          case 0x14:
+            st.iTOW = u(4, 4);
+            st.lon = (1e-7  * (i4(8)   +  (i1(24) * 1e-2)));
+            st.lat = (1e-7  * (i4(12)  +  (i1(25) * 1e-2)));
+            st.height = (1e-3 * (i4(16) +  (i1(26) * 1e-2)));
+            st.hAccuracy = ((double)u(28, 4)) * 0.1 / 1000.0;
+            st.vAccuracy = ((double)u(32, 4)) * 0.1 / 1000.0;
+            st.accuracy = sqrt(sq(st.hAccuracy) + sq(st.vAccuracy));
+            break;
+          case 0x43:
+            {
+              st.iTOW = u(0, 4);
+              int numSigs = u(5, 1);
+              int crcnt = 0;
+              int healthycnt = 0;
+              for (int i=0; i < numSigs; i++){
+                int sigFlags = u(18+16*i, 2);
+                bool prUsed = ((sigFlags & 8) != 0);
+                bool crCorrUsed = ((sigFlags & 128) != 0);
+                bool health = ((sigFlags & 3) == 1);
+                if ((health) && (prUsed)){
+                  healthycnt++;
+                  if (crCorrUsed) crcnt++;
+                }
+              }
+              st.numSVdgps = crcnt;
+              st.numSV = healthycnt;
+            }
+            break;
+          case 0x3C:
+            st.iTOW = u(4, 4);
+            st.relPosN = ((float)i4(8))/100.0;
+            st.relPosE = ((float)i4(12))/100.0;
+            st.relPosD = ((float)i4(16))/100.0;
+            st.solution = (u(60, 4) >> 3) & 3;
+            break;
+        }
+      } else if ((msgclass == 0x02) && (msgid == 0x32)){
+        if ((u(1, 1) & 1) != 0) st.dgpsChecksumErrorCounter++;
+        st.dgpsPacketCounter++;
+      }
+    }
+};
+
+
+// ---- synthetic stream ------------------------------------------------------------------
+
+struct FrameType {
+  int msgclass;
+  int msgid;
+  int len;
+};
+
+static const FrameType frameTypes[] = {
+  { 0x01, 0x21, 20 },   // NAV-TIMEUTC
+  { 0x01, 0x07, 92 },   // NAV-PVT
+  { 0x01, 0x12, 36 },   // NAV-VELNED
+  { 0x01, 0x14, 36 },   // NAV-HPPOSLLH
+  { 0x01, 0x43, 0 },    // NAV-SIG (8 + 16 * numSigs)
+  { 0x01, 0x3C, 64 },   // NAV-RELPOSNED
+  { 0x02, 0x32, 8 },    // RXM-RTCM
+};
+#define FRAME_TYPES (sizeof(frameTypes) / sizeof(FrameType))
+
+
+static void appendFrame(std::vector<byte> &out, int typeIdx){
+  const FrameType &t = frameTypes[typeIdx];
+  std::vector<byte> payload;
+  int numSigs = 0;
+  int len = t.len;
+  if (t.msgid == 0x43){
+    numSigs = random(0, 60);
+    len = 8 + 16 * numSigs;
+  }
+  for (int i=0; i < len; i++) payload.push_back(random(0, 256));
+  if (t.msgid == 0x43) payload[5] = numSigs;
+  byte hdr[4] = { (byte)t.msgclass, (byte)t.msgid, (byte)(len & 0xFF), (byte)(len >> 8) };
+  byte chka = 0;
+  byte chkb = 0;
+  out.push_back(0xB5);
+  out.push_back(0x62);
+  for (int i=0; i < 4; i++){
+    out.push_back(hdr[i]);
+    chka += hdr[i];
+    chkb += chka;
+  }
+  for (int i=0; i < len; i++){
+    out.push_back(payload[i]);
+    chka += payload[i];
+    chkb += chka;
+  }
+  out.push_back(chka);
+  out.push_back(chkb);
+}
+
+// frames of random types with some noise (no sync char) between frames
+static void makeStream(std::vector<byte> &out, int frames, bool noise){
+  for (int i=0; i < frames; i++){
+    appendFrame(out, random(0, FRAME_TYPES));
+    if ((noise) && (random(0, 10) == 0)){
+      int n = random(1, 16);
+      for (int k=0; k < n; k++){
+        byte b = random(0, 256);
+        if (b == 0xB5) b = 0;
+        out.push_back(b);
+      }
+    }
+  }
+}
+
+// clean frames of all types (each type at least once at the end)
+static void makeTail(std::vector<byte> &out){
+  makeStream(out, 16, false);
+  for (int i=0; i < (int)FRAME_TYPES; i++) appendFrame(out, i);
+}
+
+static void corrupt(std::vector<byte> &data){
+  int mutations = random(1, 8);
+  for (int m=0; m < mutations; m++){
+    if (data.size() < 2) break;
+    int pos = random(0, data.size());
+    switch (random(0, 4)){
+      case 0:   // bit flip
+        data[pos] ^= (1 << random(0, 8));
+        break;
+      case 1:   // dropped byte
+        data.erase(data.begin() + pos);
+        break;
+      case 2:   // inserted byte (often a sync char)
+        data.insert(data.begin() + pos, (random(0, 2) == 0) ? 0xB5 : random(0, 256));
+        break;
+      case 3:   // fake header with random length
+        {
+          byte hdr[6] = { 0xB5, 0x62, (byte)random(0, 256), (byte)random(0, 256), (byte)random(0, 256), (byte)random(0, 256) };
+          data.insert(data.begin() + pos, hdr, hdr + 6);
+        }
+        break;
+    }
+  }
+  // truncated stream
+  if (random(0, 4) == 0) data.resize(random(0, data.size()));
+}
+
+
+static bool loadFile(const char *fileName, std::vector<byte> &data){
+  FILE *f = fopen(fileName, "rb");
+  if (f == NULL) return false;
+  byte buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+
+// feed stream in random chunks to both decoders, compare decoded state after each chunk
+static int replay(const std::vector<byte> &data){
+  UBLOX ubx;
+  beginDecoder(ubx);
+  RefDecoder ref;
+  int mismatches = 0;
+  int pos = 0;
+  while (pos < (int)data.size()){
+    int n = random(1, 600);
+    n = min((int)data.size() - pos, n);
+    ubx.parse(&data[pos], n);
+    for (int i=0; i < n; i++) ref.parse(data[pos+i]);
+    pos += n;
+    DecodedState st;
+    snapshot(ubx, st);
+    if (!sameState(st, ref.st, true)){
+      if (mismatches == 0) fprintf(stderr, "replay mismatch at byte %d\n", pos);
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+static void speed(const std::vector<byte> &data, int repeats, double &refMBs, double &scanMBs){
+  unsigned long refUs = 0xFFFFFFFF;
+  unsigned long scanUs = 0xFFFFFFFF;
+  for (int r=0; r < repeats; r++){
+    RefDecoder *ref = new RefDecoder();
+    unsigned long t = micros();
+    for (size_t i=0; i < data.size(); i++) ref->parse(data[i]);
+    t = micros() - t;
+    refUs = min(refUs, t);
+    delete ref;
+    UBLOX *ubx = new UBLOX();
+    beginDecoder(*ubx);
+    t = micros();
+    for (size_t i=0; i < data.size(); i += 1024) ubx->parse(&data[i], min((size_t)1024, data.size() - i));
+    t = micros() - t;
+    scanUs = min(scanUs, t);
+    delete ubx;
+  }
+  refMBs = ((double)data.size()) / max(1UL, refUs);
+  scanMBs = ((double)data.size()) / max(1UL, scanUs);
+}
+
+// corrupted data followed by clean frames: scanner must resync and decode the clean frames
+static int fuzz(int rounds){
+  UBLOX ubx;
+  beginDecoder(ubx);
+  int failures = 0;
+  for (int r=0; r < rounds; r++){
+    std::vector<byte> data;
+    makeStream(data, random(1, 30), true);
+    corrupt(data);
+    std::vector<byte> tail;
+    makeTail(tail);
+    RefDecoder ref;
+    for (size_t i=0; i < tail.size(); i++) ref.parse(tail[i]);
+    data.insert(data.end(), tail.begin(), tail.end());
+    // idle gap (completes a pending fake frame that waits for its remaining bytes)
+    data.insert(data.end(), UBX_RX_BUFFER_SIZE, 0);
+    int pos = 0;
+    while (pos < (int)data.size()){
+      int n = random(1, 600);
+      n = min((int)data.size() - pos, n);
+      ubx.parse(&data[pos], n);
+      pos += n;
+    }
+    DecodedState st;
+    snapshot(ubx, st);
+    if (!sameState(st, ref.st, false)){
+      if (failures == 0) fprintf(stderr, "fuzz: no resync in round %d\n", r);
+      failures++;
+    }
+  }
+  return failures;
+}
+
+
+int main(int argc, char *argv[]){
+  int seed = 1;
+  int frames = 100000;
+  int repeats = 3;
+  int fuzzRounds = 2000;
+  const char *logFile = NULL;
+  for (int i=1; i < argc; i++){
+    std::string arg = argv[i];
+    if ((arg == "-s") && (i+1 < argc)) seed = atoi(argv[++i]);
+      else if ((arg == "-n") && (i+1 < argc)) frames = atoi(argv[++i]);
+      else if ((arg == "-r") && (i+1 < argc)) repeats = atoi(argv[++i]);
+      else if ((arg == "-f") && (i+1 < argc)) fuzzRounds = atoi(argv[++i]);
+      else if (arg[0] != '-') logFile = argv[i];
+      else {
+        fprintf(stderr, "usage: ubxbench [-s SEED] [-n FRAMES] [-r REPEATS] [-f FUZZ_ROUNDS] [LOG.ubx]\n");
+        return 2;
+      }
+  }
+  randomSeed(seed);
+
+  std::vector<byte> data;
+  if (logFile != NULL){
+    if (!loadFile(logFile, data)){
+      fprintf(stderr, "ERROR: cannot read %s\n", logFile);
+      return 2;
+    }
+  } else makeStream(data, frames, true);
+
+  int replayMismatches = replay(data);
+  double refMBs = 0;
+  double scanMBs = 0;
+  speed(data, repeats, refMBs, scanMBs);
+  int fuzzFailures = fuzz(fuzzRounds);
+
+  fprintf(stderr, "stream: %s  %d bytes\n", (logFile != NULL) ? logFile : "synthetic", (int)data.size());
+  fprintf(stderr, "replay: %s (%d mismatches)\n", (replayMismatches == 0) ? "bit-identical" : "MISMATCH", replayMismatches);
+  fprintf(stderr, "speed:  reference %.1f MB/s  scanner %.1f MB/s  (x%.1f)\n", refMBs, scanMBs, scanMBs / max(1e-9, refMBs));
+  fprintf(stderr, "fuzz:   %d rounds, %d resync failures\n", fuzzRounds, fuzzFailures);
+  return ((replayMismatches == 0) && (fuzzFailures == 0)) ? 0 : 1;
+}
@@ -75,6 +75,9 @@
   protocol examples:
     request protocol version:  AT+V,0x16
 
+  binary protocol (optional, sunray ROBOT_BINARY_LINK): COBS framed requests/responses with sequence numbers, 
+    MCU timestamps and CRC-16 (see sunray/src/driver/SerialRobotLink.h)
+
 */
 
 #include <IWatchdog.h>
@@ -83,7 +86,7 @@
 
 //#define DEBUG 1
 
-#define VER "RM18,1.1.16"
+#define VER "RM18,1.1.18"
 
 #define pinSwdCLK          PA14
 #define pinSwdSDA          PA13
@@ -771,6 +774,172 @@ void processCmd(bool checkCrc){
 }
 
 
+// ------ binary link (see sunray/src/driver/SerialRobotLink.h) -------------------
+
+#define LINK_FRAME_START  0x01 // frame start marker
+#define LINK_MAX_PAYLOAD  60
+#define LINK_MAX_FRAME    (LINK_MAX_PAYLOAD + 3)  // start marker, COBS overhead, 0x00 delimiter
+
+uint8_t linkTx[LINK_MAX_PAYLOAD];
+int linkTxLen = 0;
+uint8_t linkRx[2][LINK_MAX_FRAME];   // per port
+int linkRxLen[2] = {0, 0};
+bool linkRxBinary[2] = {false, false};
+
+// CRC-16/CCITT-FALSE
+uint16_t linkCrc16(const uint8_t *data, int len){
+  uint16_t crc = 0xFFFF;
+  for (int i=0; i < len; i++){
+    crc ^= ((uint16_t)data[i]) << 8;
+    for (int j=0; j < 8; j++){
+      if (crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+        else crc <<= 1;
+    }
+  }
+  return crc;
+}
+
+int cobsEncode(const uint8_t *src, int len, uint8_t *dst){
+  int codeIdx = 0;
+  int out = 1;
+  uint8_t code = 1;
+  for (int i=0; i < len; i++){
+    if (src[i] == 0){
+      dst[codeIdx] = code;
+      codeIdx = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      code++;
+    }
+  }
+  dst[codeIdx] = code;
+  return out;
+}
+
+int cobsDecode(const uint8_t *src, int len, uint8_t *dst){
+  int in = 0;
+  int out = 0;
+  while (in < len){
+    uint8_t code = src[in++];
+    if (code == 0) return -1;
+    for (int i=1; i < code; i++){
+      if (in >= len) return -1;
+      dst[out++] = src[in++];
+    }
+    if ((code < 0xFF) && (in < len)) dst[out++] = 0;
+  }
+  return out;
+}
+
+void linkU8(uint8_t v){
+  if (linkTxLen < LINK_MAX_PAYLOAD - 2) linkTx[linkTxLen++] = v;
+}
+
+void linkU16(uint16_t v){
+  linkU8(v & 0xFF);
+  linkU8(v >> 8);
+}
+
+void linkU32(uint32_t v){
+  linkU16(v & 0xFFFF);
+  linkU16(v >> 16);
+}
+
+void linkF32(float v){
+  uint32_t u;
+  memcpy(&u, &v, 4);
+  linkU32(u);
+}
+
+// response header: type, sequence number of request, MCU time
+void linkBegin(char type, uint16_t seq){
+  linkTxLen = 0;
+  linkU8(type);
+  linkU16(seq);
+  linkU32(millis());
+}
+
+void linkSend(Stream &port){
+  uint8_t frame[LINK_MAX_FRAME];
+  uint16_t crc = linkCrc16(linkTx, linkTxLen);
+  linkTx[linkTxLen++] = crc & 0xFF;
+  linkTx[linkTxLen++] = crc >> 8;
+  frame[0] = LINK_FRAME_START;
+  int n = 1 + cobsEncode(linkTx, linkTxLen, frame + 1);
+  frame[n++] = 0;
+  port.write(frame, n);
+}
+
+// process binary request frame (without 0x00 delimiter)
+void processFrame(Stream &port, const uint8_t *frame, int len){
+  uint8_t p[LINK_MAX_FRAME];
+  if (len > LINK_MAX_FRAME) return;
+  int n = cobsDecode(frame, len, p);
+  if (n < 5) return;
+  uint16_t crc = p[n-2] | (p[n-1] << 8);
+  n -= 2;
+  if (linkCrc16(p, n) != crc){
+#ifdef DEBUG
+    CONSOLE.println("FRAME CRC ERROR");
+#endif
+    return;
+  }
+  char type = p[0];
+  uint16_t seq = p[1] | (p[2] << 8);
+  if (type == 'M'){
+    if (n < 9) return;
+    leftSpeedSet = (int16_t)(p[3] | (p[4] << 8));
+    rightSpeedSet = (int16_t)(p[5] | (p[6] << 8));
+    mowSpeedSet = (int16_t)(p[7] | (p[8] << 8));
+    motorTimeout = millis() + 3000;
+    linkBegin('M', seq);
+    linkU32(odomTicksLeft);
+    linkU32(odomTicksRight);
+    linkU32(odomTicksMow);
+    linkF32(chgVoltage);
+    linkU8( int(bumper) | (int(lift) << 1) | (int(stopButton) << 2) );
+  } else if (type == 'S'){
+    linkBegin('S', seq);
+    linkF32(batVoltage);
+    linkF32(chgVoltage);
+    linkF32(chgCurrentLP);
+    linkU8( int(lift) | (int(bumper) << 1) | (int(raining) << 2) | (int(motorOverload) << 3) );
+    linkF32(mowCurrLP);
+    linkF32(motorLeftCurrLP);
+    linkF32(motorRightCurrLP);
+    linkF32(batteryTemp);
+  } else if (type == 'V'){
+    linkBegin('V', seq);
+    const char *ver = VER;
+    while (*ver) linkU8(*ver++);
+  } else return;
+  linkSend(port);
+}
+
+// returns true if character belongs to a binary frame
+// (frames: start marker, COBS encoded payload, 0x00 delimiter - the marker never occurs in ASCII requests)
+bool processBinary(int portIdx, Stream &port, char ch){
+  if (linkRxBinary[portIdx]){
+    if (ch == 0){
+      processFrame(port, linkRx[portIdx], linkRxLen[portIdx]);
+      linkRxBinary[portIdx] = false;
+    } else if (linkRxLen[portIdx] < LINK_MAX_FRAME){
+      linkRx[portIdx][linkRxLen[portIdx]++] = ch;
+    } else {
+      linkRxLen[portIdx] = LINK_MAX_FRAME + 1;  // overflow
+    }
+    return true;
+  }
+  if (ch == LINK_FRAME_START){
+    linkRxBinary[portIdx] = true;
+    linkRxLen[portIdx] = 0;
+    return true;
+  }
+  return (ch == 0);
+}
+
+
 // process console input
 void processConsole(){
   char ch;
@@ -779,6 +948,7 @@ void processConsole(){
     //battery.resetIdle();  
     while ( (CONSOLE.available()) && (millis() < timeout) ){               
       ch = CONSOLE.read();          
+      if (processBinary(0, CONSOLE, ch)) continue;
       if ((ch == '\r') || (ch == '\n')) {        
 #ifdef DEBUG        
         CONSOLE.println(cmd);
@@ -796,6 +966,7 @@ void processConsole(){
     //battery.resetIdle();  
     while ( (CONSOLE2.available()) && (millis() < timeout) ){               
       ch = CONSOLE2.read();          
+      if (processBinary(1, CONSOLE2, ch)) continue;
       if ((ch == '\r') || (ch == '\n')) {        
 #ifdef DEBUG        
         CONSOLE2.println(cmd);
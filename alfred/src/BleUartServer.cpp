@@ -234,18 +234,29 @@ static void destroy_packet_cb(void *user_data){
 
 
 size_t BleUartServer::write(uint8_t c){
+	return write(&c, 1);
+}
+
+// copies block into ring buffer (one lock), notifies once if block contains a newline
+size_t BleUartServer::write(const uint8_t *buffer, size_t size){
+	size_t n = 0;
+	bool newline = false;
 	pthread_mutex_lock( &txMutex );
-	if ( ((txWritePos +1) % BLE_BUF_SZ) == txReadPos){
-		::printf("BLE: txBuf overflow!\n");
-		return 0;
-	}			
-	txBuf[txWritePos] = c;                          // push it to the ring buffer  
-	txWritePos = (txWritePos + 1) % BLE_BUF_SZ;	 			
+	while (n < size){
+		if ( ((txWritePos +1) % BLE_BUF_SZ) == txReadPos){
+			::printf("BLE: txBuf overflow!\n");
+			break;
+		}
+		txBuf[txWritePos] = buffer[n];                  // push it to the ring buffer
+		txWritePos = (txWritePos + 1) % BLE_BUF_SZ;
+		if (char(buffer[n]) == '\n') newline = true;
+		n++;
+	}
 	pthread_mutex_unlock( &txMutex );
-	if (char(c) == '\n'){
+	if (newline){
 	  notify();
 	}
-	return 1;
+	return n;
 }
 
 void BleUartServer::notify(){	  
@@ -78,6 +78,7 @@ class BleUartServer: public HardwareSerial{
     virtual void flush();
 
     virtual size_t write(const uint8_t c) override;
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
     
     using Print::write; // pull in write(str) and write(buf, size) from Print
     operator bool() { return true; }
@@ -24,6 +24,9 @@
 #include <netdb.h>
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
 #include "BridgeClient.h"
 #include "BridgeServer.h"
 #include "Console.h"
@@ -83,6 +86,47 @@ int BridgeClient::connect(const char *host, uint16_t port){
   return connect(IPAddress((const uint8_t *)(server->h_addr)), port);
 }
 
+int BridgeClient::connectAsync(IPAddress ip, uint16_t port){
+  sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0){
+    Serial.println("client connect error - no socket");            
+    return 0;
+  }
+  fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+  uint32_t ip_addr = ip;
+  struct sockaddr_in serveraddr;
+  bzero((char *) &serveraddr, sizeof(serveraddr));
+  serveraddr.sin_family = AF_INET;
+  bcopy((const void *)(&ip_addr), (void *)&serveraddr.sin_addr.s_addr, 4);
+  serveraddr.sin_port = htons(port);
+  if ((sock_connect(sockfd, (struct sockaddr*)&serveraddr, sizeof(serveraddr)) < 0) && (errno != EINPROGRESS)){
+    Serial.println("client connect error");        
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+int BridgeClient::connectPoll(){
+  if (sockfd < 0) return -1;
+  if (_connected) return 1;
+  struct pollfd pfd;
+  pfd.fd = sockfd;
+  pfd.events = POLLOUT;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, 0) == 0) return 0;
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if ((getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) || (err != 0)){
+    Serial.printf("client connect error %d\n", err);
+    stop();
+    return -1;
+  }
+  Serial.printf("client connected fd=%d\n", sockfd);            
+  _connected = true;
+  return 1;
+}
+
 int BridgeClient::setSocketOption(int option, char* value, size_t len){
   return setsockopt(sockfd, SOL_SOCKET, option, value, len);
 }
@@ -177,6 +221,18 @@ int BridgeClient::available(){
   return count;
 }
 
+int BridgeClient::availableForWrite(){
+  if (sockfd < 0) return 0;
+  int sndbuf = 0;
+  socklen_t len = sizeof(sndbuf);
+  if (getsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) < 0) return 0;
+  int queued = 0;
+  ioctl(sockfd, TIOCOUTQ, &queued);
+  // kernel doubles SO_SNDBUF for bookkeeping overhead
+  int free = sndbuf / 2 - queued;
+  return (free > 0) ? free : 0;
+}
+
 void BridgeClient::stop(){
   if(sockfd >= 0){
     close(sockfd);
@@ -29,9 +29,14 @@ class BridgeClient : public Client {
     ~BridgeClient();
     virtual int connect(IPAddress ip, uint16_t port);
     virtual int connect(const char *host, uint16_t port);
+    // non-blocking connect: returns 1 if connection is in progress (see connectPoll), 0 on error
+    int connectAsync(IPAddress ip, uint16_t port);
+    // state of non-blocking connect: 1 connected, 0 in progress, -1 failed
+    int connectPoll();
     virtual size_t write(uint8_t data);
     virtual size_t write(const uint8_t *buf, size_t size);
     virtual int available();
+    int availableForWrite();   // free space in socket send buffer
     virtual int read();
     virtual int read(uint8_t *buf, size_t size);
     virtual int peek(){return 0;}
@@ -64,8 +64,11 @@ size_t LinuxConsole::write(uint8_t c){
     //if(idemonitor_connected())
     //    idemonitor_write((char*)&c, 1);
     //console_write(c);
-    ::printf("%c",c);
-    return 1;
+    return (fputc(c, stdout) == EOF) ? 0 : 1;
+}
+
+size_t LinuxConsole::write(const uint8_t *buffer, size_t size){
+    return fwrite(buffer, 1, size, stdout);
 }
 
 
@@ -21,6 +21,7 @@ class LinuxConsole : public Stream{
     virtual void flush();
 
     virtual size_t write(const uint8_t c) override;
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
     
     using Print::write; // pull in write(str) and write(buf, size) from Print
     operator bool() { return true; }
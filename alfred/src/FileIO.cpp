@@ -95,7 +95,7 @@ size_t File::write(uint8_t c) {
     ::printf("file write error: file not open!\n");
     return 0;
   }    
-  return write(&c, 1);
+  return (fputc(c, _file) == EOF) ? 0 : 1;
 }
 
 void File::flush() {
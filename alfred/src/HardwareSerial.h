@@ -17,6 +17,7 @@ class HardwareSerial : public Stream {
     virtual int available(void) { return 0; }
     virtual int peek(void) { return 0; }
     virtual int read(void) { return 0; }
+    using Stream::read; // pull in read(buffer, size) from Stream
     virtual void flush(void) {}
     virtual size_t write(uint8_t) { return 0; }
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
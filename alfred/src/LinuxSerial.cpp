@@ -107,6 +107,13 @@ int LinuxSerial::read(){
     return buffer;
 }
 
+// one system call for all requested bytes (non-blocking)
+int LinuxSerial::read(uint8_t *buffer, size_t size){
+    int j = ::read(_stream, buffer, size);
+    if (j < 0) return 0;   // EAGAIN or error
+    return j;
+}
+
 void LinuxSerial::flush(){
     //console_flush();
 }
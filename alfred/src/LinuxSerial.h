@@ -33,6 +33,7 @@ class LinuxSerial : public HardwareSerial{
 
     virtual int available() override;
     virtual int read() override;
+    virtual int read(uint8_t *buffer, size_t size) override;
     virtual int peek() override;
     virtual void flush() override;
 
@@ -43,10 +43,11 @@ size_t Print::printf(const char *format, ...) {
     va_list arg;
     va_start(arg, format);
     char temp[4096];
-    size_t len = vsnprintf(temp, 4096, format, arg);
-    len = print(temp);
+    int len = vsnprintf(temp, sizeof(temp), format, arg);
     va_end(arg);
-    return len;
+    if (len <= 0) return 0;
+    if (len >= (int)sizeof(temp)) len = sizeof(temp) - 1;  // truncated
+    return write((const uint8_t *)temp, len);
 }
 
 size_t Print::print(const String &s){
@@ -74,18 +75,7 @@ size_t Print::print(unsigned int n, int base){
 }
 
 size_t Print::print(long n, int base){
-    if (base == 0) {
-        return write(n);
-    } else if (base == 10) {
-        if (n < 0) {
-            int t = print('-');
-            n = -n;
-            return printNumber(n, 10) + t;
-        }
-        return printNumber(n, 10);
-    } else {
-        return printNumber(n, base);
-    }
+    return printSigned(n, base, false);
 }
 
 size_t Print::print(unsigned long n, int base){
@@ -102,64 +92,51 @@ size_t Print::print(const Printable& x){
 }
 
 size_t Print::println(void){
-    size_t n = print('\r');
-    n += print('\n');
-    return n;
+    return write("\r\n", 2);
 }
 
 size_t Print::println(const String &s){
-    size_t n = print(s);
-    n += println();
-    return n;
+    return printLine(s.c_str(), s.length());
 }
 
 size_t Print::println(const char *s){
-    size_t n = print(s);
-    n += println();
-    return n;
+    if (s == NULL) return println();
+    return printLine(s, strlen(s));
 }
 
 size_t Print::println(char c){
-    size_t n = print(c);
-    n += println();
-    return n;
+    char buf[3] = { c, '\r', '\n' };
+    return write(buf, 3);
 }
 
 size_t Print::println(unsigned char b, int base){
-    size_t n = print(b, base);
-    n += println();
-    return n;
+    return println((unsigned long) b, base);
 }
 
 size_t Print::println(int num, int base){
-    size_t n = print(num, base);
-    n += println();
-    return n;
+    return println((long) num, base);
 }
 
 size_t Print::println(unsigned int num, int base){
-    size_t n = print(num, base);
-    n += println();
-    return n;
+    return println((unsigned long) num, base);
 }
 
 size_t Print::println(long num, int base)
 {
-    size_t n = print(num, base);
-    n += println();
-    return n;
+    return printSigned(num, base, true);
 }
 
 size_t Print::println(unsigned long num, int base){
-    size_t n = print(num, base);
-    n += println();
-    return n;
+    if (base == 0) {
+        size_t n = write(num);
+        n += println();
+        return n;
+    }
+    return printNumber(num, base, false, true);
 }
 
 size_t Print::println(double num, int digits){
-    size_t n = print(num, digits);
-    n += println();
-    return n;
+    return printFloat(num, digits, true);
 }
 
 size_t Print::println(const Printable& x){
@@ -169,12 +146,43 @@ size_t Print::println(const Printable& x){
 }
 
 // Private Methods /////////////////////////////////////////////////////////////
+// numbers and lines are formatted into a stack buffer and passed to write() once
+
+// text and CR LF with one write (if short)
+size_t Print::printLine(const char *s, size_t len){
+    char buf[128];
+    if (len > sizeof(buf) - 2) {
+        size_t n = write(s, len);
+        n += println();
+        return n;
+    }
+    memcpy(buf, s, len);
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    return write(buf, len);
+}
 
-size_t Print::printNumber(unsigned long n, uint8_t base) {
-    char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-    char *str = &buf[sizeof(buf) - 1];
+size_t Print::printSigned(long n, int base, bool newline){
+    if (base == 0) {
+        size_t t = write(n);
+        if (newline) t += println();
+        return t;
+    } else if ((base == 10) && (n < 0)) {
+        return printNumber(0UL - (unsigned long)n, 10, true, newline);
+    } else {
+        return printNumber(n, base, false, newline);
+    }
+}
 
-    *str = '\0';
+size_t Print::printNumber(unsigned long n, uint8_t base, bool negative, bool newline) {
+    char buf[8 * sizeof(long) + 4]; // Assumes 8-bit chars plus sign, CR LF
+    char *end = &buf[sizeof(buf)];
+    char *str = end;
+
+    if (newline) {
+        *--str = '\n';
+        *--str = '\r';
+    }
 
     // prevent crash if called with base == 1
     if (base < 2) base = 10;
@@ -186,47 +194,57 @@ size_t Print::printNumber(unsigned long n, uint8_t base) {
         *--str = c < 10 ? c + '0' : c + 'A' - 10;
     } while(n);
 
-    return write(str);
+    if (negative) *--str = '-';
+
+    return write(str, end - str);
 }
 
-size_t Print::printFloat(double number, uint8_t digits) { 
-    size_t n = 0;
+size_t Print::printFloat(double number, uint8_t digits, bool newline) { 
+    char buf[64];
+    size_t len = 0;
 
-    if (isnan(number)) return print("nan");
-    if (isinf(number)) return print("inf");
-    if (number > 4294967040.0) return print ("ovf");  // constant determined empirically
-    if (number <-4294967040.0) return print ("ovf");  // constant determined empirically
+    if (isnan(number)) len = sprintf(buf, "nan");
+    else if (isinf(number)) len = sprintf(buf, "inf");
+    else if (number > 4294967040.0) len = sprintf(buf, "ovf");  // constant determined empirically
+    else if (number <-4294967040.0) len = sprintf(buf, "ovf");  // constant determined empirically
+    else {
+        if (digits > sizeof(buf) - 16) digits = sizeof(buf) - 16;
 
-    // Handle negative numbers
-    if (number < 0.0){
-        n += print('-');
-        number = -number;
-    }
+        // Handle negative numbers
+        if (number < 0.0){
+            buf[len++] = '-';
+            number = -number;
+        }
 
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    double rounding = 0.5;
-    for (uint8_t i=0; i<digits; ++i)
-        rounding /= 10.0;
+        // Round correctly so that print(1.999, 2) prints as "2.00"
+        double rounding = 0.5;
+        for (uint8_t i=0; i<digits; ++i)
+            rounding /= 10.0;
 
-    number += rounding;
+        number += rounding;
 
-    // Extract the integer part of the number and print it
-    unsigned long int_part = (unsigned long)number;
-    double remainder = number - (double)int_part;
-    n += print(int_part);
+        // Extract the integer part of the number and print it
+        unsigned long int_part = (unsigned long)number;
+        double remainder = number - (double)int_part;
+        len += sprintf(buf + len, "%lu", int_part);
 
-    // Print the decimal point, but only if there are digits beyond
-    if (digits > 0) {
-        n += print(".");
-    }
+        // Print the decimal point, but only if there are digits beyond
+        if (digits > 0) {
+            buf[len++] = '.';
+        }
 
-    // Extract digits from the remainder one at a time
-    while (digits-- > 0){
-        remainder *= 10.0;
-        int toPrint = int(remainder);
-        n += print(toPrint);
-        remainder -= toPrint;
+        // Extract digits from the remainder one at a time
+        while (digits-- > 0){
+            remainder *= 10.0;
+            int toPrint = int(remainder);
+            buf[len++] = '0' + toPrint;
+            remainder -= toPrint;
+        }
     }
 
-    return n;
+    if (newline) {
+        buf[len++] = '\r';
+        buf[len++] = '\n';
+    }
+    return write(buf, len);
 }
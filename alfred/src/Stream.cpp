@@ -221,6 +221,18 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore)
         return value;
 }
 
+// read already received bytes into buffer (does not wait)
+int Stream::read(uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+    while ((count < size) && (available() > 0)) {
+        int c = read();
+        if (c < 0) break;
+        buffer[count++] = (uint8_t)c;
+    }
+    return count;
+}
+
 // read characters from stream into buffer
 // terminates if length characters have been read, or timeout (see setTimeout)
 // returns the number of characters placed in the buffer
@@ -29,6 +29,9 @@ class Stream : public Print{
   public:
     virtual int available() = 0;
     virtual int read() = 0;
+    // reads up to size received bytes without waiting, returns number of bytes read
+    // (default: byte by byte, streams with a device/socket override it with one system call)
+    virtual int read(uint8_t *buffer, size_t size);
     virtual int peek() = 0;
     virtual void flush() = 0;
 
@@ -38,6 +38,11 @@ String::String(const String &value){
     *this = value;
 }
 
+String::String(String &&rval){
+    init();
+    move(rval);
+}
+
 String::String(char c){
     init();
     char buf[2];
@@ -94,7 +99,7 @@ String::String(double value, unsigned char decimalPlaces) {
 }
 
 String::~String(){
-    if(buffer) {
+    if (buffer && buffer != sso) {
         free(buffer);
     }
     init();
@@ -104,6 +109,8 @@ String::~String(){
 /*  Memory Management                        */
 /*********************************************/
 
+unsigned long String::allocations = 0;
+
 inline void String::init(void){
     buffer = NULL;
     capacity = 0;
@@ -111,7 +118,7 @@ inline void String::init(void){
 }
 
 void String::invalidate(void){
-    if (buffer) free(buffer);
+    if (buffer && buffer != sso) free(buffer);
     buffer = NULL;
     capacity = len = 0;
 }
@@ -125,11 +132,26 @@ unsigned char String::reserve(unsigned int size){
     return 0;
 }
 
+// short strings use the inline buffer, the heap buffer grows geometrically (1.5x)
 unsigned char String::changeBuffer(unsigned int maxStrLen){
-    char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+    if ((buffer == NULL || buffer == sso) && maxStrLen < STRING_SSO_SIZE) {
+        buffer = sso;
+        capacity = STRING_SSO_SIZE - 1;
+        return 1;
+    }
+    unsigned int newCapacity = maxStrLen;
+    if (buffer && newCapacity < capacity + capacity / 2) newCapacity = capacity + capacity / 2;
+    char *newbuffer;
+    if (buffer == sso) {
+        newbuffer = (char *)malloc(newCapacity + 1);
+        if (newbuffer) memcpy(newbuffer, sso, len + 1);
+    } else {
+        newbuffer = (char *)realloc(buffer, newCapacity + 1);
+    }
     if (newbuffer) {
+        __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
         buffer = newbuffer;
-        capacity = maxStrLen;
+        capacity = newCapacity;
         return 1;
     }
     return 0;
@@ -145,10 +167,31 @@ String & String::copy(const char *cstr, unsigned int length){
         return *this;
     }
     len = length;
-    strcpy(buffer, cstr);
+    memmove(buffer, cstr, length);  // cstr may point into buffer
+    buffer[len] = 0;
     return *this;
 }
 
+// takes over heap buffer of rhs (inline buffer is copied), rhs is left empty
+void String::move(String &rhs){
+    if (rhs.buffer == NULL) {
+        invalidate();
+        return;
+    }
+    if (rhs.buffer == rhs.sso) {
+        copy(rhs.sso, rhs.len);
+    } else {
+        if (buffer && buffer != sso) free(buffer);
+        buffer = rhs.buffer;
+        capacity = rhs.capacity;
+        len = rhs.len;
+    }
+    rhs.buffer = rhs.sso;
+    rhs.capacity = STRING_SSO_SIZE - 1;
+    rhs.len = 0;
+    rhs.sso[0] = 0;
+}
+
 String & String::operator = (const String &rhs){
     if (this == &rhs) return *this;
 
@@ -158,6 +201,11 @@ String & String::operator = (const String &rhs){
     return *this;
 }
 
+String & String::operator = (String &&rval){
+    if (this != &rval) move(rval);
+    return *this;
+}
+
 String & String::operator = (const char *cstr){
     if (cstr) copy(cstr, strlen(cstr));
     else invalidate();
@@ -177,9 +225,15 @@ unsigned char String::concat(const char *cstr, unsigned int length){
     unsigned int newlen = len + length;
     if (!cstr) return 0;
     if (length == 0) return 1;
-    if (!reserve(newlen)) return 0;
-    strcpy(buffer + len, cstr);
-    len = strlen(buffer);
+    if (buffer && cstr >= buffer && cstr <= buffer + len) {
+        // self concatenation: buffer may move
+        unsigned int offset = cstr - buffer;
+        if (!reserve(newlen)) return 0;
+        cstr = buffer + offset;
+    } else if (!reserve(newlen)) return 0;
+    memmove(buffer + len, cstr, length);
+    len = newlen;
+    buffer[len] = 0;
     return 1;
 }
 
@@ -580,7 +634,7 @@ void String::remove(unsigned int index, unsigned int count){
     if (index + count > len) { count = len - index; }
     char *writeTo = buffer + index;
     len = len - count;
-    strncpy(writeTo, buffer + index + count,len - index);
+    memmove(writeTo, buffer + index + count, len - index);
     buffer[len] = 0;
 }
 
@@ -608,7 +662,7 @@ void String::trim(void)
     char *end = buffer + len - 1;
     while (isspace(*end) && end >= begin) end--;
     len = end + 1 - begin;
-    if (begin > buffer) memcpy(buffer, begin, len);
+    if (begin > buffer) memmove(buffer, begin, len);
     buffer[len] = 0;
 }
 
@@ -11,6 +11,11 @@
 #include <ctype.h>
 #include <stdlib_noniso.h>
 
+// inline storage for short strings (no heap allocation), including the '\0'
+#ifndef STRING_SSO_SIZE
+  #define STRING_SSO_SIZE 24
+#endif
+
 // An inherited class for holding the result of a concatenation.  These
 // result objects are assumed to be writable by subsequent concatenations.
 class StringSumHelper;
@@ -32,6 +37,7 @@ public:
   // be false).
   String(const char *cstr = "");
   String(const String &str);
+  String(String &&rval);
   
   explicit String(char c);
   explicit String(unsigned char, unsigned char base = 10);
@@ -57,6 +63,7 @@ public:
   // marked as invalid ("if (s)" will be false).
   String & operator = (const String &rhs);
   String & operator = (const char *cstr);
+  String & operator = (String &&rval);
   
   // concatenate (works w/ built-in types)
 
@@ -158,10 +165,14 @@ public:
   float toFloat(void) const;
   double toDouble(void) const;
 
+  // heap allocations (malloc/realloc) of all Strings, for benchmarking
+  static unsigned long allocations;
+
 protected:
   char *buffer;          // the actual char array
   unsigned int capacity;  // the array length minus one (for the '\0')
   unsigned int len;       // the String length (not counting the '\0')
+  char sso[STRING_SSO_SIZE];  // buffer points here for short strings
 protected:
   void init(void);
   void invalidate(void);
@@ -170,6 +181,7 @@ protected:
 
   // copy and move
   String & copy(const char *cstr, unsigned int length);
+  void move(String &rhs);
 };
 
 class StringSumHelper : public String
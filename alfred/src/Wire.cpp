@@ -49,8 +49,15 @@ uint8_t TwoWire::txBuffer[BUFFER_LENGTH];
 uint8_t TwoWire::txBufferIndex = 0;
 uint8_t TwoWire::txBufferLength = 0;
 
+bool TwoWire::txPending = false;
+uint8_t TwoWire::pendingError = 0;
+
 uint8_t TwoWire::busAddress = 0;
 int TwoWire::busFd = -1;
+bool TwoWire::busRdwr = true;
+int TwoWire::slaveAddress = -1;
+
+WireStats TwoWire::stats[128];
 
 bool WireDebug = false;
 
@@ -70,33 +77,169 @@ void TwoWire::setClock(uint32_t frequency){
   //BSC1DIV = BSCF2DIV(frequency);
 }
 
+// I2C_SLAVE only if address changed (SMBus emulation)
+bool TwoWire::setSlave(uint8_t address){
+  if (slaveAddress == address) return true;
+  if (ioctl(busFd, I2C_SLAVE, address) < 0) {
+		perror("error: I2C ioctl failed");
+    slaveAddress = -1;
+    return false;
+  }
+  slaveAddress = address;
+  return true;
+}
+
+static int smbusAccess(int fd, char readWrite, uint8_t command, int size, union i2c_smbus_data *data){
+  struct i2c_smbus_ioctl_data args;
+  args.read_write = readWrite;
+  args.command = command;
+  args.size = size;
+  args.data = data;
+  return ioctl(fd, I2C_SMBUS, &args);
+}
+
+// adapters without I2C_RDWR (SMBus only, e.g. i2c-stub): register reads (1 byte write + read) are
+// mapped to SMBus byte/block data reads, writes to SMBus byte/byte data/block writes
+int TwoWire::smbusTransfer(WireMsg *msgs, int count){
+  union i2c_smbus_data data;
+  int i = 0;
+  while (i < count){
+    WireMsg &m = msgs[i];
+    if (!setSlave(m.address)) return -1;
+    if ((m.flags & WIRE_READ) == 0 && (m.len == 1) && (i + 1 < count)
+        && (msgs[i+1].flags & WIRE_READ) && (msgs[i+1].address == m.address)){
+      WireMsg &r = msgs[i+1];
+      if (r.len == 1){
+        if (smbusAccess(busFd, I2C_SMBUS_READ, m.buf[0], I2C_SMBUS_BYTE_DATA, &data) < 0) return -1;
+        r.buf[0] = data.byte;
+      } else {
+        if (r.len > I2C_SMBUS_BLOCK_MAX) { errno = EINVAL; return -1; }
+        data.block[0] = r.len;
+        if (smbusAccess(busFd, I2C_SMBUS_READ, m.buf[0], I2C_SMBUS_I2C_BLOCK_DATA, &data) < 0) return -1;
+        memcpy(r.buf, data.block + 1, r.len);
+      }
+      i += 2;
+      continue;
+    }
+    if (m.flags & WIRE_READ){
+      if (m.len == 1){
+        if (smbusAccess(busFd, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data) < 0) return -1;
+        m.buf[0] = data.byte;
+      } else if (::read(busFd, m.buf, m.len) != m.len) return -1;
+    } else if (m.len == 0){
+      if (smbusAccess(busFd, I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK, NULL) < 0) return -1;
+    } else if (m.len == 1){
+      if (smbusAccess(busFd, I2C_SMBUS_WRITE, m.buf[0], I2C_SMBUS_BYTE, NULL) < 0) return -1;
+    } else if (m.len == 2){
+      data.byte = m.buf[1];
+      if (smbusAccess(busFd, I2C_SMBUS_WRITE, m.buf[0], I2C_SMBUS_BYTE_DATA, &data) < 0) return -1;
+    } else {
+      if (m.len - 1 > I2C_SMBUS_BLOCK_MAX) { errno = EINVAL; return -1; }
+      data.block[0] = m.len - 1;
+      memcpy(data.block + 1, m.buf + 1, m.len - 1);
+      if (smbusAccess(busFd, I2C_SMBUS_WRITE, m.buf[0], I2C_SMBUS_I2C_BLOCK_DATA, &data) < 0) return -1;
+    }
+    i++;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::transfer(WireMsg *msgs, int count){
+  if (busFd < 0) {
+		perror("transfer error: no such I2C bus");
+    return 4; // other error;
+  }
+  if ((count < 1) || (count > WIRE_MAX_MSGS)) return 4;
+  int res;
+  if (busRdwr){
+    // all messages in one ioctl (repeated start in between)
+    struct i2c_msg m[WIRE_MAX_MSGS];
+    for (int i=0; i < count; i++){
+      m[i].addr = msgs[i].address;
+      m[i].flags = (msgs[i].flags & WIRE_READ) ? I2C_M_RD : 0;
+      m[i].len = msgs[i].len;
+      m[i].buf = msgs[i].buf;
+    }
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = m;
+    data.nmsgs = count;
+    res = (ioctl(busFd, I2C_RDWR, &data) == count) ? 0 : -1;
+  } else {
+    res = smbusTransfer(msgs, count);
+  }
+  WireStats &st = stats[msgs[0].address & 0x7F];
+  st.transfers++;
+  uint8_t ret = 0;
+  if (res < 0){
+    st.errors++;
+    ret = ((errno == ENXIO) || (errno == EREMOTEIO)) ? 2 : 4;  // 2: NACK on address
+  } else {
+    for (int i=0; i < count; i++) st.bytes += msgs[i].len;
+  }
+  if (WireDebug) ::printf("TwoWire transfer addr=%x msgs=%d ret=%d\n", msgs[0].address, count, ret);
+  return ret;
+}
+
+uint8_t TwoWire::writeRead(uint8_t address, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen){
+  WireMsg msgs[2];
+  msgs[0].address = address;
+  msgs[0].flags = 0;
+  msgs[0].len = wlen;
+  msgs[0].buf = (uint8_t*)wbuf;
+  msgs[1].address = address;
+  msgs[1].flags = WIRE_READ;
+  msgs[1].len = rlen;
+  msgs[1].buf = rbuf;
+  return transfer(msgs, 2);
+}
+
+void TwoWire::clearStats(){
+  memset(stats, 0, sizeof(stats));
+}
+
+// write of endTransmission(false) not followed by requestFrom
+void TwoWire::sendPending(){
+  if (!txPending) return;
+  txPending = false;
+  WireMsg msg = { txAddress, 0, txBufferLength, txBuffer };
+  uint8_t ret = transfer(&msg, 1);
+  if ((ret != 0) && (pendingError == 0)) pendingError = ret;
+  txBufferIndex = 0;
+  txBufferLength = 0;
+}
+
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop){
   if (busFd < 0) {
 		perror("requestFrom error: no such I2C bus");
     return 4; // other error;
   }
-  if (txBufferLength != 0){
+  if ((!txPending) && (txBufferLength != 0)){
     ::printf("WARN: I2C misorder - requestFrom in between transmission!");
   }
   if(quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
-  if (ioctl(busFd, I2C_SLAVE, address) < 0) {
-		perror("error: I2C ioctl failed");
-    return 0;
+  uint8_t ret;
+  if ((txPending) && (txAddress == address)){
+    // register write + read with repeated start (one transaction)
+    txPending = false;
+    ret = writeRead(address, txBuffer, txBufferLength, rxBuffer, quantity);
+  } else {
+    sendPending();
+    WireMsg msg = { address, WIRE_READ, quantity, rxBuffer };
+    ret = transfer(&msg, 1);
   }
-  uint8_t ret = ::read(busFd, rxBuffer, quantity);
-  if (WireDebug) ::printf("TwoWire read addr=%x, len=%d ret=%d\n", address, quantity, quantity);  
-  //uint8_t ret = twi_readFrom(address, rxBuffer, quantity, sendStop);
+  if ((ret == 0) && (pendingError != 0)) ret = pendingError;  // previous write failed
+  pendingError = 0;
+  if (WireDebug) ::printf("TwoWire read addr=%x, len=%d ret=%d\n", address, quantity, ret);  
+  txBufferIndex = 0;
+  txBufferLength = 0;
   rxBufferIndex = 0;
-  rxBufferLength = (ret == quantity)?quantity:0;
+  rxBufferLength = (ret == 0)?quantity:0;
   return rxBufferLength;
 }
 
 void TwoWire::beginTransmission(uint8_t address){
   if (WireDebug) ::printf("TwoWire beginTransmission addr=%x\n", address);    
-  if (ioctl(busFd, I2C_SLAVE, address) < 0) {
-		perror("error: I2C ioctl failed");
-    return;
-  }
+  sendPending();
   txAddress = address;
   txBufferIndex = 0;
   txBufferLength = 0;  
@@ -107,13 +250,21 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop){
 		perror("endTransmission error: no such I2C bus");
     return 4; // other error;
   }
-  uint8_t ret = ::write(busFd, txBuffer, txBufferLength);
+  if (!sendStop){
+    // no stop: write is combined with the following requestFrom (returns error of a previous pending write)
+    txPending = true;
+    uint8_t ret = pendingError;
+    pendingError = 0;
+    return ret;
+  }
+  WireMsg msg = { txAddress, 0, txBufferLength, txBuffer };
+  uint8_t ret = transfer(&msg, 1);
+  if ((ret == 0) && (pendingError != 0)) ret = pendingError;  // previous write failed
+  pendingError = 0;
   if (WireDebug) ::printf("TwoWire write len: %d, ret=%d\n", txBufferLength, ret);  
-  //uint8_t ret = twi_writeTo(txAddress, txBuffer, txBufferLength, 0, sendStop);
   txBufferIndex = 0;
   txBufferLength = 0;
-  if (ret < 0) return 4; // other error
-  return 0; // success
+  return ret;
 }
 
 uint8_t TwoWire::endTransmission(void){
@@ -172,7 +323,10 @@ void TwoWire::begin(uint8_t address){
   
   //pinMode(2, ALT0);
   //pinMode(3, ALT0);
+  txPending = false;
+  pendingError = 0;
   busAddress = address; 
+  slaveAddress = -1;
 
 	// Open the given I2C bus filename.
  	char filename[50];
@@ -180,7 +334,11 @@ void TwoWire::begin(uint8_t address){
 	busFd = open(filename, O_RDWR);
 	if (busFd < 0) {
 		perror("error: no such I2C bus");
+		return;
 	}
+	unsigned long funcs = 0;
+	busRdwr = (ioctl(busFd, I2C_FUNCS, &funcs) < 0) || ((funcs & I2C_FUNC_I2C) != 0);
+	if (!busRdwr) ::printf("TwoWire: no I2C_RDWR on bus %d - using SMBus\n", busAddress);
 }
 
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity){
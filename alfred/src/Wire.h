@@ -19,6 +19,23 @@ extern "C"{
 #include "Stream.h"
 
 #define BUFFER_LENGTH 32
+#define WIRE_MAX_MSGS 8     // messages per transfer()
+#define WIRE_READ     1     // WireMsg flag
+
+// one message of a combined transfer (repeated start between messages, stop after last)
+struct WireMsg {
+  uint8_t address;
+  uint8_t flags;    // WIRE_READ: read len bytes into buf, else write buf
+  uint8_t len;
+  uint8_t *buf;
+};
+
+// per slave address statistics
+struct WireStats {
+  unsigned long transfers;
+  unsigned long errors;
+  unsigned long bytes;
+};
 
 class TwoWire : public Stream {
   private:
@@ -33,8 +50,17 @@ class TwoWire : public Stream {
     static uint8_t txBufferIndex;
     static uint8_t txBufferLength;
 
+    static bool txPending;       // endTransmission(false): write is sent with next requestFrom
+    static uint8_t pendingError; // error of a pending write sent on its own (returned by next requestFrom/endTransmission)
+
     static uint8_t busAddress;
     static int busFd;
+    static bool busRdwr;         // adapter supports I2C_RDWR (else SMBus emulation)
+    static int slaveAddress;     // current I2C_SLAVE address (SMBus emulation)
+
+    bool setSlave(uint8_t);
+    int smbusTransfer(WireMsg *, int);
+    void sendPending();
     
   public:
     TwoWire();
@@ -47,6 +73,12 @@ class TwoWire : public Stream {
     uint8_t endTransmission(uint8_t);
     uint8_t requestFrom(uint8_t, uint8_t);
     uint8_t requestFrom(uint8_t, uint8_t, uint8_t);
+    // write wlen bytes (e.g. register), repeated start, read rlen bytes - returns 0 on success (like endTransmission)
+    uint8_t writeRead(uint8_t address, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen);
+    // batch of messages as one bus transaction - returns 0 on success (like endTransmission)
+    uint8_t transfer(WireMsg *msgs, int count);
+    static WireStats stats[128];
+    void clearStats();
     virtual size_t write(uint8_t);
     virtual size_t write(const uint8_t *, size_t);
     virtual int available(void);
@@ -10,6 +10,7 @@
 #include "helper.h"
 #include "pid.h"
 #include "src/op/op.h"
+#include "logger.h"
 
 
 //PID pidLine(0.2, 0.01, 0); // not used
@@ -73,11 +74,9 @@ void trackLine(bool runControl){
     //angleToTargetFits = true;
   }
 
-  if (!angleToTargetFits) CONSOLE.println("!angleToTargetFits");
-
   if (!angleToTargetFits){
     // angular control (if angle to far away, rotate to next waypoint)
-    CONSOLE.println("trackLine(): !angleToTargetFits linear-> 0");
+    LOG_RATE(LOG_DEBUG, 1000, "trackLine(): !angleToTargetFits linear-> 0");
     linear = 0;
     angular = 29.0 / 180.0 * PI; //  29 degree/s (0.5 rad/s);               
      // decide for one rotation direction (and keep it)
@@ -112,36 +111,46 @@ void trackLine(bool runControl){
         }
     }
 
+    // mowing lines use look-ahead speed profile instead of slowing down at each curve
+    bool useSpeedProfile = (SPEED_PROFILE && (maps.wayMode == WAY_MOW));
+
     if (maps.trackSlow && trackslow_allowed) {
       // planner forces slow tracking (e.g. docking etc)
-      CONSOLE.println("trackLine(): maps.trackSlow && trackslow_allowed linear-> 0.1");
+      LOG_RATE(LOG_DEBUG, 1000, "trackLine(): maps.trackSlow && trackslow_allowed linear-> 0.1");
       linear = 0.1;           
-    } else if (     ((setSpeed > 0.2) && (maps.distanceToTargetPoint(stateX, stateY) < 0.5) && (!straight))   // approaching
+    } else if (     ((!useSpeedProfile) && (setSpeed > 0.2) && (maps.distanceToTargetPoint(stateX, stateY) < 0.5) && (!straight))   // approaching
           || ((linearMotionStartTime != 0) && (millis() < linearMotionStartTime + 3000))                      // leaving  
        ) 
     {
-      CONSOLE.println("trackLine(): approaching/leaving linear-> 0.1");
+      LOG_RATE(LOG_DEBUG, 1000, "trackLine(): approaching/leaving linear-> 0.1");
       linear = 0.1; // reduce speed when approaching/leaving waypoints          
       //CONSOLE.println("SLOW: approach")
     } 
     else {
       if (gps.solution == SOL_FLOAT) {
         linear = min(setSpeed, 0.1); // reduce speed for float solution
-        CONSOLE.print("trackLine(): float linear-> "); CONSOLE.println(linear);
+        LOG_RATE(LOG_DEBUG, 1000, "trackLine(): float linear-> %.2f", linear);
       }
       else {
         linear = setSpeed;         // desired speed
-        CONSOLE.print("trackLine(): normal linear-> "); CONSOLE.println(linear);
+        if (useSpeedProfile) {
+          // limit speed to upcoming curves (and allow robot to accelerate at motor acceleration limit only)
+          float minLinear = min(setSpeed, 0.1);
+          linear = maps.speedProfileSpeed(stateX, stateY, min(setSpeed, MOTOR_MAX_SPEED), minLinear);
+          float maxLinear = fabs(motor.linearSpeedSet) + SPEED_PROFILE_MAX_ACCEL * stateDt;
+          linear = max(minLinear, min(linear, maxLinear));
+        }
+        LOG_RATE(LOG_DEBUG, 1000, "trackLine(): normal linear-> %.2f", linear);
       }
       if (sonar.nearObstacle()) {
         linear = 0.1; // slow down near obstacles
-        CONSOLE.print("trackLine(): sonar.nearObstacle() linear-> "); CONSOLE.println(linear);
+        LOG_RATE(LOG_DEBUG, 1000, "trackLine(): sonar.nearObstacle() linear-> %.2f", linear);
       }
     }      
     // slow down speed in case of overload and overwrite all prior speed 
     if ( (motor.motorLeftOverload) || (motor.motorRightOverload) || (motor.motorMowOverload) ){
       if (!printmotoroverload) {
-          CONSOLE.println("motor overload detected: reduce linear speed to 0.1");
+          LOG(LOG_INFO, "motor overload detected: reduce linear speed to 0.1");
       }
       printmotoroverload = true;
       linear = 0.1;  
@@ -186,8 +195,8 @@ void trackLine(bool runControl){
         // if in linear motion and not enough ground speed => obstacle
         //if ( (GPS_SPEED_DETECTION) && (!maps.isUndocking()) ) { 
         if (GPS_SPEED_DETECTION) {         
-          CONSOLE.println("gps no speed => obstacle!");
-	  CONSOLE.print("mw linear= "); CONSOLE.print(linear); CONSOLE.print("  t= "); CONSOLE.print(t); CONSOLE.print("  linearMotionStartTime + 5000= "); CONSOLE.print(linearMotionStartTime + 5000); CONSOLE.print("  stateGroundSpeed= "); CONSOLE.println(stateGroundSpeed);
+          LOG(LOG_WARN, "gps no speed => obstacle!");
+          LOG(LOG_INFO, "mw linear= %.2f  t= %lu  linearMotionStartTime + 5000= %lu  stateGroundSpeed= %.2f", linear, t, linearMotionStartTime + 5000, stateGroundSpeed);
           triggerObstacle();
           return;
         }
@@ -196,7 +205,7 @@ void trackLine(bool runControl){
   } else {
     // no gps solution
     if (REQUIRE_VALID_GPS){
-      CONSOLE.println("WARN: no gps solution!");
+      LOG_RATE(LOG_WARN, 1000, "WARN: no gps solution!");
       activeOp->onGpsNoSignal();
     }
   }
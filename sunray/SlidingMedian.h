@@ -0,0 +1,82 @@
+// sliding median filter (incremental)
+//
+// the window is kept sorted: each add() removes the oldest value and inserts the new one
+// at its binary-searched position (no re-sort), the median is read without any sorting
+//
+// usage:
+//   SlidingMedian<unsigned int,9> myMedian;
+//   myMedian.add(value);
+//   if (myMedian.getMedian(_median) == myMedian.OK) ...
+
+
+#ifndef SlidingMedian_h
+#define SlidingMedian_h
+
+#include <inttypes.h>
+
+template <typename T, int N> class SlidingMedian {
+
+public:
+
+    enum STATUS {OK = 0, NOK = 1};
+
+    SlidingMedian() {
+        clear();
+    }
+
+    void clear() {
+        _cnt = 0;
+        _idx = 0;
+    }
+
+    void add(T value) {
+        int pos;
+        if (_cnt < N) {
+            // window not full yet: make room at insert position
+            pos = lowerBound(value, 0, _cnt);
+            for (int i = _cnt; i > pos; i--) _as[i] = _as[i-1];
+            _cnt++;
+        } else {
+            // window full: move values between position of oldest value and insert position
+            int old = lowerBound(_ar[_idx], 0, _cnt);
+            pos = lowerBound(value, 0, _cnt);
+            if (pos > old) {
+                pos--;
+                for (int i = old; i < pos; i++) _as[i] = _as[i+1];
+            } else {
+                for (int i = old; i > pos; i--) _as[i] = _as[i-1];
+            }
+        }
+        _as[pos] = value;
+        _ar[_idx] = value;
+        _idx = (_idx + 1) % N;
+    }
+
+    STATUS getMedian(T &value) {
+        if (_cnt == 0) return NOK;
+        value = _as[_cnt / 2];
+        return OK;
+    }
+
+    int getCount() {
+        return _cnt;
+    }
+
+protected:
+    T _ar[N];   // values in order of arrival (ring buffer)
+    T _as[N];   // same values sorted
+    int _cnt;
+    int _idx;   // next ring buffer position (= oldest value if window is full)
+
+    // first position in _as[lo..hi) not less than value
+    int lowerBound(T value, int lo, int hi) {
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (_as[mid] < value) lo = mid + 1;
+                else hi = mid;
+        }
+        return lo;
+    }
+};
+
+#endif
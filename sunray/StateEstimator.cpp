@@ -12,6 +12,10 @@
 #include "Stats.h"
 #include "helper.h"
 #include "i2c.h"
+#include "ekf.h"
+#include "latency.h"
+#include "logger.h"
+#include "i2cworker.h"
 
 
 float stateX = 0;  // position-east (m)
@@ -19,17 +23,12 @@ float stateY = 0;  // position-north (m)
 float stateDelta = 0;  // direction (rad)
 float stateRoll = 0;
 float statePitch = 0;
-float stateDeltaGPS = 0;
 float stateDeltaIMU = 0;
 float stateGroundSpeed = 0; // m/s
 
 unsigned long stateLeftTicks = 0;
 unsigned long stateRightTicks = 0;
 
-float lastPosN = 0;
-float lastPosE = 0;
-float lastPosDelta = 0;
-
 float stateDeltaLast = 0;
 float stateDeltaSpeed = 0;
 float stateDeltaSpeedLP = 0;
@@ -39,7 +38,6 @@ float diffIMUWheelYawSpeed = 0;
 float diffIMUWheelYawSpeedLP = 0;
 
 bool gpsJump = false;
-bool resetLastPos = true;
 
 float lastIMUYaw = 0; 
 float lateralError = 0; // lateral error
@@ -49,6 +47,38 @@ bool imuIsCalibrating = false;
 int imuCalibrationSeconds = 0;
 unsigned long nextImuCalibrationSecond = 0;
 unsigned long nextDumpTime = 0;
+int stateGpsLatency = 0; // ms
+float stateDt = 0.02; // s
+
+PoseEKF ekf;
+unsigned long lastStateTime = 0;
+unsigned long imuSampleTime = 0;      // millis of last IMU sample (stateDeltaIMU)
+unsigned long lastImuSampleTime = 0;  // millis of last IMU sample used
+int gpsRejects = 0;  // GPS positions rejected in a row
+SolType lastGpsSolution = SOL_INVALID;
+bool gpsFixAfterFloat = false;  // fix solution after float solution (not fused yet)
+
+// odometry history for GPS latency compensation: odometry-only position (never corrected by GPS), one sample per timestep
+#define ODO_HISTORY_SIZE 32   // 20ms timestep => 640ms
+#define GPS_TOW_WINDOW 16     // number of GPS solutions to find fastest solution transfer
+
+class OdoSample
+{
+  public:
+    unsigned long time;  // millis
+    float x;
+    float y;
+};
+
+OdoSample odoHistory[ODO_HISTORY_SIZE];
+int odoHistoryIdx = 0;  // next sample
+int odoHistoryCount = 0;
+float odoX = 0;
+float odoY = 0;
+long gpsTowOffsets[GPS_TOW_WINDOW];  // receive time minus receiver time of last GPS solutions (ms)
+int gpsTowOffsetsIdx = 0;
+int gpsTowOffsetsCount = 0;
+unsigned long lastSolutionTOW = 0;
 
 
 // https://learn.sparkfun.com/tutorials/9dof-razor-imu-m0-hookup-guide#using-the-mpu-9250-dmp-arduino-library
@@ -58,15 +88,19 @@ bool startIMU(bool forceIMU){
   uint8_t data = 0;
   int counter = 0;  
   while ((forceIMU) || (counter < 1)){          
+     i2cWorker.lock();  // IMU has bus priority over I2C worker
      imuDriver.detect();
+     i2cWorker.unlock();
      if (imuDriver.imuFound){
        break;
      }
+     i2cWorker.lock();
      I2Creset();  
      Wire.begin();    
      #ifdef I2C_SPEED
        Wire.setClock(I2C_SPEED);   
      #endif
+     i2cWorker.unlock();
      counter++;
      if (counter > 5){    
        // no I2C recovery possible - this should not happen (I2C module error)
@@ -82,7 +116,10 @@ bool startIMU(bool forceIMU){
   if (!imuDriver.imuFound) return false;  
   counter = 0;  
   while (true){    
-    if (imuDriver.begin()) break;
+    i2cWorker.lock();
+    bool started = imuDriver.begin();
+    i2cWorker.unlock();
+    if (started) break;
     CONSOLE.print("Unable to communicate with IMU.");
     CONSOLE.print("Check connections, and try again.");
     CONSOLE.println();
@@ -129,8 +166,10 @@ void dumpImuTilt(){
 void readIMU(){
   if (!imuDriver.imuFound) return;
   // Check for new data in the FIFO  
+  i2cWorker.lock();  // IMU has bus priority over I2C worker (waiting for a running worker transaction is not an I2C hang)
   unsigned long startTime = millis();
   bool avail = (imuDriver.isDataAvail());
+  i2cWorker.unlock();
   // check time for I2C access : if too long, there's an I2C issue and we need to restart I2C bus...
   unsigned long duration = millis() - startTime;    
   if (avail) imuDataTimeout = millis() + 10000; // reset IMU data timeout, if IMU data available
@@ -138,13 +177,9 @@ void readIMU(){
   //CONSOLE.println(duration);  
   if ((duration > 60) || (millis() > imuDataTimeout)) {
     if (millis() > imuDataTimeout){
-      CONSOLE.print("ERROR IMU data timeout: ");
-      CONSOLE.print(millis()-imuDataTimeout);
-      CONSOLE.println(" (check RTC battery if problem persists)");  
+      LOG(LOG_ERROR, "ERROR IMU data timeout: %lu (check RTC battery if problem persists)", millis()-imuDataTimeout);
     } else {
-      CONSOLE.print("ERROR IMU timeout: ");
-      CONSOLE.print(duration);     
-      CONSOLE.println(" (check RTC battery if problem persists)");          
+      LOG(LOG_ERROR, "ERROR IMU timeout: %lu (check RTC battery if problem persists)", duration);
     }
     stateSensor = SENS_IMU_TIMEOUT;
     motor.stopImmediately(true);    
@@ -156,37 +191,45 @@ void readIMU(){
   } 
   
   if (avail) {        
-    //CONSOLE.println("fifoAvailable");
-    // Use dmpUpdateFifo to update the ax, gx, mx, etc. values
     #ifdef ENABLE_TILT_DETECTION
-      rollChange += (imuDriver.roll-stateRoll);
-      pitchChange += (imuDriver.pitch-statePitch);               
-      rollChange = 0.95 * rollChange;
-      pitchChange = 0.95 * pitchChange;
-      statePitch = imuDriver.pitch;
-      stateRoll = imuDriver.roll;        
-      //CONSOLE.print(rollChange/PI*180.0);
-      //CONSOLE.print(",");
-      //CONSOLE.println(pitchChange/PI*180.0);
-      if ( (fabs(scalePI(imuDriver.roll)) > 60.0/180.0*PI) || (fabs(scalePI(imuDriver.pitch)) > 100.0/180.0*PI)
-            || (fabs(rollChange) > 30.0/180.0*PI) || (fabs(pitchChange) > 60.0/180.0*PI)   )  {
-        dumpImuTilt();
-        activeOp->onImuTilt();
-        //stateSensor = SENS_IMU_TILT;
-        //setOperation(OP_ERROR);
-      }           
+      bool tilt = false;
     #endif
+    // all samples of the FIFO burst (oldest first)
+    for (int i=0; i < imuDriver.sampleCount; i++){
+      ImuSample &sample = imuDriver.samples[i];
+      #ifdef ENABLE_TILT_DETECTION
+        rollChange += (sample.roll-stateRoll);
+        pitchChange += (sample.pitch-statePitch);               
+        rollChange = 0.95 * rollChange;
+        pitchChange = 0.95 * pitchChange;
+        statePitch = sample.pitch;
+        stateRoll = sample.roll;        
+        //CONSOLE.print(rollChange/PI*180.0);
+        //CONSOLE.print(",");
+        //CONSOLE.println(pitchChange/PI*180.0);
+        if ( (fabs(scalePI(sample.roll)) > 60.0/180.0*PI) || (fabs(scalePI(sample.pitch)) > 100.0/180.0*PI)
+              || (fabs(rollChange) > 30.0/180.0*PI) || (fabs(pitchChange) > 60.0/180.0*PI)   )  {
+          if (!tilt){
+            tilt = true;
+            dumpImuTilt();
+            activeOp->onImuTilt();
+          }
+          //stateSensor = SENS_IMU_TILT;
+          //setOperation(OP_ERROR);
+        }           
+      #endif
+      sample.yaw = scalePI(sample.yaw);
+      lastIMUYaw = scalePI(lastIMUYaw);
+      lastIMUYaw = scalePIangles(lastIMUYaw, sample.yaw);
+      stateDeltaIMU += -scalePI ( distancePI(sample.yaw, lastIMUYaw) );  // summed until used by computeRobotState
+      imuSampleTime = sample.time;
+      lastIMUYaw = sample.yaw;      
+    }
     motor.robotPitch = scalePI(imuDriver.pitch);
     imuDriver.yaw = scalePI(imuDriver.yaw);
     //CONSOLE.println(imuDriver.yaw / PI * 180.0);
-    lastIMUYaw = scalePI(lastIMUYaw);
-    lastIMUYaw = scalePIangles(lastIMUYaw, imuDriver.yaw);
-    stateDeltaIMU = -scalePI ( distancePI(imuDriver.yaw, lastIMUYaw) );  
-    //CONSOLE.print(imuDriver.yaw);
-    //CONSOLE.print(",");
     //CONSOLE.print(stateDeltaIMU/PI*180.0);
     //CONSOLE.println();
-    lastIMUYaw = imuDriver.yaw;      
     imuDataTimeout = millis() + 10000;         
   }     
 }
@@ -197,12 +240,87 @@ void resetImuTimeout(){
 }
 
 
+void addOdometrySample(){
+  OdoSample &sample = odoHistory[odoHistoryIdx];
+  sample.time = millis();
+  sample.x = odoX;
+  sample.y = odoY;
+  odoHistoryIdx = (odoHistoryIdx + 1) % ODO_HISTORY_SIZE;
+  if (odoHistoryCount < ODO_HISTORY_SIZE) odoHistoryCount++;
+}
+
+// odometry-only position at given time (interpolated, clamped to oldest sample)
+bool odometryAt(unsigned long time, float &x, float &y){
+  if (odoHistoryCount == 0) return false;
+  OdoSample *newer = NULL;
+  int idx = odoHistoryIdx;
+  for (int i=0; i < odoHistoryCount; i++){
+    idx = (idx + ODO_HISTORY_SIZE - 1) % ODO_HISTORY_SIZE;
+    OdoSample &sample = odoHistory[idx];
+    if ((long)(time - sample.time) >= 0){
+      if ((newer == NULL) || (newer->time == sample.time)){
+        x = sample.x;
+        y = sample.y;
+      } else {
+        float w = ((float)(time - sample.time)) / ((float)(newer->time - sample.time));
+        x = sample.x + (newer->x - sample.x) * w;
+        y = sample.y + (newer->y - sample.y) * w;
+      }
+      return true;
+    }
+    newer = &sample;
+  }
+  x = newer->x;
+  y = newer->y;
+  return true;
+}
+
+// transfer delay (ms) of current GPS solution compared to the fastest of the last solutions
+// (receive time minus receiver time, so loop polling and UART delays are measured per solution)
+long gpsTransferDelay(){
+  if ((gps.solutionTOW == 0) || (gps.solutionTOW == lastSolutionTOW)) return 0;
+  lastSolutionTOW = gps.solutionTOW;
+  long offset = (long)(gps.solutionTime - gps.solutionTOW);
+  if (gpsTowOffsetsCount > 0){
+    long lastOffset = gpsTowOffsets[(gpsTowOffsetsIdx + GPS_TOW_WINDOW - 1) % GPS_TOW_WINDOW];
+    if (abs(offset - lastOffset) > 1000) gpsTowOffsetsCount = 0; // receiver time wrap or receiver reboot
+  }
+  gpsTowOffsets[gpsTowOffsetsIdx] = offset;
+  gpsTowOffsetsIdx = (gpsTowOffsetsIdx + 1) % GPS_TOW_WINDOW;
+  if (gpsTowOffsetsCount < GPS_TOW_WINDOW) gpsTowOffsetsCount++;
+  long minOffset = offset;
+  for (int i=0; i < gpsTowOffsetsCount; i++){
+    int idx = (gpsTowOffsetsIdx + GPS_TOW_WINDOW - 1 - i) % GPS_TOW_WINDOW;
+    if (gpsTowOffsets[idx] < minOffset) minOffset = gpsTowOffsets[idx];
+  }
+  return offset - minOffset;
+}
+
+// move GPS solution forward to current time by the odometry distance driven since the solution was valid
+void compensateGpsLatency(float &posN, float &posE){
+  unsigned long validTime = gps.solutionTime - GPS_LATENCY_MS - gpsTransferDelay();
+  stateGpsLatency = (int)(millis() - validTime);
+  float x = 0;
+  float y = 0;
+  if (!odometryAt(validTime, x, y)) return;
+  posE += odoX - x;
+  posN += odoY - y;
+}
+
 // compute robot state (x,y,delta)
-// uses complementary filter ( https://gunjanpatel.wordpress.com/2016/07/07/complementary-filter-design/ )
-// to fusion GPS heading (long-term) and IMU heading (short-term)
-// with IMU: heading (stateDelta) is computed by gyro (stateDeltaIMU)
-// without IMU: heading (stateDelta) is computed by odometry (deltaOdometry)
+// uses an extended Kalman filter (see ekf.h) with measured timestep: odometry and IMU yaw rate move the pose forward,
+// GPS positions (noise depending on solution type) correct position and heading - GPS positions failing the
+// innovation gate are rejected as 'GPS jump'
 void computeRobotState(){  
+  LATENCY_SCOPE(LAT_STATE);
+  unsigned long now = millis();
+  float dt = 0.02;
+  if (lastStateTime != 0) dt = ((float)(now - lastStateTime)) / 1000.0;
+  lastStateTime = now;
+  if (dt < 0.001) dt = 0.001;
+  if (dt > 0.2) dt = 0.2;
+  stateDt = dt;
+
   long leftDelta = motor.motorLeftTicks-stateLeftTicks;
   long rightDelta = motor.motorRightTicks-stateRightTicks;  
   stateLeftTicks = motor.motorLeftTicks;
@@ -221,92 +339,87 @@ void computeRobotState(){
     posN = gps.relPosN;  
     posE = gps.relPosE;     
   }   
-  
-  if (fabs(motor.linearSpeedSet) < 0.001){       
-    resetLastPos = true;
+
+  // pose may have been set from outside (e.g. simulation commands)
+  ekf.s[EKF_X] = stateX;
+  ekf.s[EKF_Y] = stateY;
+  ekf.s[EKF_YAW] = stateDelta;
+
+  // IMU yaw rate (over time since last used IMU sample)
+  bool imuRateAvail = false;
+  float imuRate = 0;
+  if ((imuDriver.imuFound) && (imuSampleTime != lastImuSampleTime)){
+    float imuDt = ((float)(imuSampleTime - lastImuSampleTime)) / 1000.0;
+    if ((lastImuSampleTime != 0) && (imuDt < 0.2)){
+      imuRate = stateDeltaIMU / imuDt;
+      imuRateAvail = true;
+    }
+    lastImuSampleTime = imuSampleTime;
   }
-  
+  stateDeltaIMU = 0;
+
+  // odometry and IMU (measurements of the elapsed timestep), then move pose forward
+  if ((imuDriver.imuFound) && (maps.useIMU)) {
+    // IMU available and should be used by planner
+    if (imuRateAvail) ekf.updateGyro(imuRate);
+    ekf.updateOdometry(distOdometry/100.0/dt, deltaOdometry/dt, EKF_ODO_W_SIGMA_IMU);
+  } else {
+    ekf.updateOdometry(distOdometry/100.0/dt, deltaOdometry/dt, EKF_ODO_W_SIGMA);
+  }
+  odoX += distOdometry/100.0 * cos(stateDelta);
+  odoY += distOdometry/100.0 * sin(stateDelta);
+  addOdometrySample();
+  ekf.predict(dt);
+  if (stateOp == OP_MOW) statMowDistanceTraveled += distOdometry/100.0;
+
   if ((gps.solutionAvail) 
       && ((gps.solution == SOL_FIXED) || (gps.solution == SOL_FLOAT))  )
   {
     gps.solutionAvail = false;        
+    if (GPS_LATENCY_COMPENSATION) compensateGpsLatency(posN, posE);
     stateGroundSpeed = 0.9 * stateGroundSpeed + 0.1 * abs(gps.groundSpeed);    
     //CONSOLE.println(stateGroundSpeed);
-    float distGPS = sqrt( sq(posN-lastPosN)+sq(posE-lastPosE) );
-    if ((distGPS > 0.3) || (resetLastPos)){
-      if (distGPS > 0.3) {
-        gpsJump = true;
-        statGPSJumps++;
-        CONSOLE.print("GPS jump: ");
-        CONSOLE.println(distGPS);
-      }
-      resetLastPos = false;
-      lastPosN = posN;
-      lastPosE = posE;
-      lastPosDelta = stateDelta;
-    } else if (distGPS > 0.1) {       
-      float diffLastPosDelta = distancePI(stateDelta, lastPosDelta);                 
-      if (fabs(diffLastPosDelta) /PI * 180.0 < 10){  // robot sensors indicate it is not turning
-        if ( (fabs(motor.linearSpeedSet) > 0) && (fabs(motor.angularSpeedSet) /PI *180.0 < 45) ) {  
-          stateDeltaGPS = scalePI(atan2(posN-lastPosN, posE-lastPosE));    
-          if (motor.linearSpeedSet < 0) stateDeltaGPS = scalePI(stateDeltaGPS + PI); // consider if driving reverse
-          //stateDeltaGPS = scalePI(2*PI-gps.heading+PI/2);
-          float diffDelta = distancePI(stateDelta, stateDeltaGPS);                 
-          if (    ((gps.solution == SOL_FIXED) && (maps.useGPSfixForDeltaEstimation ))
-              || ((gps.solution == SOL_FLOAT) && (maps.useGPSfloatForDeltaEstimation)) )
-          {   // allows planner to use float solution?         
-            if (fabs(diffDelta/PI*180) > 45){ // IMU-based heading too far away => use GPS heading
-              stateDelta = stateDeltaGPS;
-              stateDeltaIMU = 0;
-            } else {
-              // delta fusion (complementary filter, see above comment)
-              stateDeltaGPS = scalePIangles(stateDeltaGPS, stateDelta);
-              stateDelta = scalePI(fusionPI(0.9, stateDelta, stateDeltaGPS));               
-            }            
-          }
+    bool fix = (gps.solution == SOL_FIXED);
+    if (fix) lastFixTime = millis();
+    bool usePos = (fix) ? maps.useGPSfixForPosEstimation : maps.useGPSfloatForPosEstimation; // allows planner to use float solution?
+    bool useDelta = (fix) ? maps.useGPSfixForDeltaEstimation : maps.useGPSfloatForDeltaEstimation;
+    if ((fix) && (lastGpsSolution == SOL_FLOAT)) gpsFixAfterFloat = true;
+    if (usePos){
+      float sigma = (fix) ? EKF_GPS_FIX_SIGMA : EKF_GPS_FLOAT_SIGMA;
+      if (ekf.updatePosition(posE, posN, sigma, EKF_GPS_GATE, useDelta)){
+        gpsRejects = 0;
+        if (fix) gpsFixAfterFloat = false;
+      } else {
+        gpsRejects++;
+        if (gpsRejects == 1){
+          gpsJump = true;
+          statGPSJumps++;
+        }
+        LOG_RATE(LOG_WARN, 1000, "GPS jump: %.2f innovation=%.2f latency=%.2f",
+          sqrt( sq(posE-ekf.s[EKF_X]) + sq(posN-ekf.s[EKF_Y]) ), ekf.gpsInnovation, stateGpsLatency);
+        // reset position to GPS if GPS keeps being rejected (sooner if solution became fix)
+        if (gpsRejects >= ((gpsFixAfterFloat) ? 2 : EKF_GPS_GATE_RESETS)){
+          LOG(LOG_INFO, "GPS position reset");
+          ekf.resetPosition(posE, posN, sigma);
+          gpsRejects = 0;
         }
-      }
-      lastPosN = posN;
-      lastPosE = posE;
-      lastPosDelta = stateDelta;
-    } 
-    if (gps.solution == SOL_FIXED) {
-      // fix
-      lastFixTime = millis();
-      if (maps.useGPSfixForPosEstimation) {
-        stateX = posE;
-        stateY = posN;
-      }        
-    } else {
-      // float
-      if (maps.useGPSfloatForPosEstimation){ // allows planner to use float solution?
-        stateX = posE;
-        stateY = posN;              
       }
     }
+    lastGpsSolution = gps.solution;
   } 
-  
-  // odometry
-  stateX += distOdometry/100.0 * cos(stateDelta);
-  stateY += distOdometry/100.0 * sin(stateDelta);        
-  if (stateOp == OP_MOW) statMowDistanceTraveled += distOdometry/100.0;
-  
-  if ((imuDriver.imuFound) && (maps.useIMU)) {
-    // IMU available and should be used by planner
-    stateDelta = scalePI(stateDelta + stateDeltaIMU );          
-  } else {
-    // odometry
-    stateDelta = scalePI(stateDelta + deltaOdometry);  
-  }
-  if (imuDriver.imuFound){
-    stateDeltaSpeedIMU = 0.99 * stateDeltaSpeedIMU + 0.01 * stateDeltaIMU / 0.02; // IMU yaw rotation speed (20ms timestep)
+
+  stateX = ekf.s[EKF_X];
+  stateY = ekf.s[EKF_Y];
+  stateDelta = scalePI(ekf.s[EKF_YAW]);
+
+  if (imuRateAvail){
+    stateDeltaSpeedIMU = 0.99 * stateDeltaSpeedIMU + 0.01 * imuRate; // IMU yaw rotation speed
   }
-  stateDeltaSpeedWheels = 0.99 * stateDeltaSpeedWheels + 0.01 * deltaOdometry / 0.02; // wheels yaw rotation speed (20ms timestep) 
+  stateDeltaSpeedWheels = 0.99 * stateDeltaSpeedWheels + 0.01 * deltaOdometry / dt; // wheels yaw rotation speed
   //CONSOLE.println(stateDelta / PI * 180.0);
-  stateDeltaIMU = 0;
 
   // compute yaw rotation speed (delta speed)
-  stateDeltaSpeed = (stateDelta - stateDeltaLast) / 0.02;  // 20ms timestep
+  stateDeltaSpeed = scalePI(stateDelta - stateDeltaLast) / dt;
   stateDeltaSpeedLP = stateDeltaSpeedLP * 0.95 + fabs(stateDeltaSpeed) * 0.05;     
   stateDeltaLast = stateDelta;
   //CONSOLE.println(stateDeltaSpeedLP/PI*180.0);
@@ -321,5 +434,3 @@ void computeRobotState(){
     //CONSOLE.println(stateDeltaSpeedWheels/PI*180.0);
   }
 }
-
-
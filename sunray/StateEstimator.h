@@ -16,7 +16,6 @@ extern float stateY;  // position-north (m)
 extern float stateDelta;  // direction (rad)
 extern float stateRoll;
 extern float statePitch;
-extern float stateDeltaGPS;
 extern float stateDeltaIMU;
 extern float stateGroundSpeed; // m/s
 extern float lateralError; // lateral error
@@ -30,6 +29,8 @@ extern float diffIMUWheelYawSpeed;
 extern float diffIMUWheelYawSpeedLP;
 
 extern bool gpsJump;
+extern int stateGpsLatency; // age (ms) of last fused GPS solution
+extern float stateDt; // measured control cycle time (s)
 
 extern bool imuIsCalibrating;
 extern unsigned long imuDataTimeout;
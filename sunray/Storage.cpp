@@ -10,6 +10,7 @@
 #include "map.h"
 #include "config.h"
 #include "reset.h"
+#include "latency.h"
 #include <Arduino.h>
 
 
@@ -17,12 +18,19 @@ File stateFile;
 double stateCRC = 0;
 
 
+// mowing progress of stored maps (other than active map)
+long storedMapsProgress(){
+  long progress = 0;
+  for (int i=0; i < MAX_STORED_MAPS; i++) progress += (i+1) * maps.storedMaps[i].mowPointsIdx;
+  return progress;
+}
+
 double calcStateCRC(){
  return (stateOp *10 + maps.mowPointsIdx + maps.dockPointsIdx + maps.freePointsIdx + ((byte)maps.wayMode) 
    + sonar.enabled + fixTimeout + setSpeed + ((byte)sonar.enabled)
    + ((byte)absolutePosSource) + absolutePosSourceLon + absolutePosSourceLat + motor.pwmMaxMow 
    + ((byte)finishAndRestart) + ((byte)motor.motorMowForwardSet) + ((byte)battery.docked)
-   + timetable.crc() );
+   + timetable.crc() + maps.activeMapSlot + storedMapsProgress() );
 }
 
 
@@ -36,6 +44,8 @@ void dumpState(){
   CONSOLE.print(stateDelta);
   CONSOLE.print(" mapCRC=");
   CONSOLE.print(maps.mapCRC);
+  CONSOLE.print(" activeMapSlot=");
+  CONSOLE.print(maps.activeMapSlot);
   CONSOLE.print(" mowPointsIdx=");
   CONSOLE.print(maps.mowPointsIdx);
   CONSOLE.print(" dockPointsIdx=");
@@ -122,7 +132,7 @@ bool loadState(){
   }
   uint32_t marker = 0;
   stateFile.read((uint8_t*)&marker, sizeof(marker));
-  if (marker != 0x10001007){
+  if (marker != 0x10001008){
     CONSOLE.print("ERROR: invalid marker: ");
     CONSOLE.println(marker, HEX);
     return false;
@@ -158,6 +168,9 @@ bool loadState(){
   res &= (stateFile.read((uint8_t*)&motor.motorMowForwardSet, sizeof(motor.motorMowForwardSet)) != 0); 
   res &= (stateFile.read((uint8_t*)&timetable.timetable, sizeof(timetable.timetable)) != 0);
   res &= (stateFile.read((uint8_t*)&battery.docked, sizeof(battery.docked)) != 0);  
+  for (int i=0; i < MAX_STORED_MAPS; i++){
+    res &= (stateFile.read((uint8_t*)&maps.storedMaps[i].mowPointsIdx, sizeof(maps.storedMaps[i].mowPointsIdx)) != 0);
+  }
   stateFile.close();  
   CONSOLE.println("ok");
   stateCRC = calcStateCRC();
@@ -174,6 +187,7 @@ bool loadState(){
 
 
 bool saveState(){   
+  LATENCY_SCOPE(LAT_SAVE_STATE);
   bool res = true;
 #if defined(ENABLE_SD_RESUME)
   double crc = calcStateCRC();
@@ -190,7 +204,7 @@ bool saveState(){
     CONSOLE.println("ERROR opening file for writing");
     return false;
   }
-  uint32_t marker = 0x10001007;
+  uint32_t marker = 0x10001008;
   res &= (stateFile.write((uint8_t*)&marker, sizeof(marker)) != 0); 
   res &= (stateFile.write((uint8_t*)&maps.mapCRC, sizeof(maps.mapCRC)) != 0); 
 
@@ -214,6 +228,9 @@ bool saveState(){
   res &= (stateFile.write((uint8_t*)&motor.motorMowForwardSet, sizeof(motor.motorMowForwardSet)) != 0);
   res &= (stateFile.write((uint8_t*)&timetable.timetable, sizeof(timetable.timetable)) != 0);  
   res &= (stateFile.write((uint8_t*)&battery.docked, sizeof(battery.docked)) != 0);  
+  for (int i=0; i < MAX_STORED_MAPS; i++){
+    res &= (stateFile.write((uint8_t*)&maps.storedMaps[i].mowPointsIdx, sizeof(maps.storedMaps[i].mowPointsIdx)) != 0);
+  }
   if (res){
     CONSOLE.println("ok");
   } else {
@@ -226,4 +243,87 @@ bool saveState(){
 }
 
 
+bool loadMotorTuning(){
+#if defined(ENABLE_SD)
+  if (!SD.exists("motor.bin")) return false;
+  CONSOLE.print("motor tuning load... ");
+  File tuningFile = SD.open("motor.bin", FILE_READ);
+  if (!tuningFile){        
+    CONSOLE.println("ERROR opening file for reading");
+    return false;
+  }
+  uint32_t marker = 0;
+  tuningFile.read((uint8_t*)&marker, sizeof(marker));
+  if (marker != 0x10001001){
+    CONSOLE.print("ERROR: invalid marker: ");
+    CONSOLE.println(marker, HEX);
+    tuningFile.close();
+    return false;
+  }
+  float kp, ki, kd, ffGainLeft, ffGainRight, ffOffset;
+  bool res = true;
+  res &= (tuningFile.read((uint8_t*)&kp, sizeof(kp)) != 0);
+  res &= (tuningFile.read((uint8_t*)&ki, sizeof(ki)) != 0);
+  res &= (tuningFile.read((uint8_t*)&kd, sizeof(kd)) != 0);
+  res &= (tuningFile.read((uint8_t*)&ffGainLeft, sizeof(ffGainLeft)) != 0);
+  res &= (tuningFile.read((uint8_t*)&ffGainRight, sizeof(ffGainRight)) != 0);
+  res &= (tuningFile.read((uint8_t*)&ffOffset, sizeof(ffOffset)) != 0);
+  tuningFile.close();
+  if (!res){
+    CONSOLE.println("ERROR reading file");
+    return false;
+  }
+  motor.speedKp = kp;
+  motor.speedKi = ki;
+  motor.speedKd = kd;
+  motor.ffGainLeft = ffGainLeft;
+  motor.ffGainRight = ffGainRight;
+  motor.ffOffset = ffOffset;
+  CONSOLE.print("ok KP=");
+  CONSOLE.print(kp, 3);
+  CONSOLE.print(" KI=");
+  CONSOLE.print(ki, 3);
+  CONSOLE.print(" KD=");
+  CONSOLE.print(kd, 3);
+  CONSOLE.print(" ffGain=");
+  CONSOLE.print(ffGainLeft, 3);
+  CONSOLE.print(",");
+  CONSOLE.print(ffGainRight, 3);
+  CONSOLE.print(" ffOffset=");
+  CONSOLE.println(ffOffset, 1);
+  return true;
+#else
+  return false;
+#endif
+}
+
 
+bool saveMotorTuning(){
+  bool res = true;
+#if defined(ENABLE_SD)
+  CONSOLE.print("motor tuning save... ");
+  File tuningFile = SD.open("motor.bin", FILE_CREATE); // O_WRITE | O_CREAT);
+  if (!tuningFile){        
+    CONSOLE.println("ERROR opening file for writing");
+    return false;
+  }
+  uint32_t marker = 0x10001001;
+  res &= (tuningFile.write((uint8_t*)&marker, sizeof(marker)) != 0); 
+  res &= (tuningFile.write((uint8_t*)&motor.speedKp, sizeof(motor.speedKp)) != 0);
+  res &= (tuningFile.write((uint8_t*)&motor.speedKi, sizeof(motor.speedKi)) != 0);
+  res &= (tuningFile.write((uint8_t*)&motor.speedKd, sizeof(motor.speedKd)) != 0);
+  res &= (tuningFile.write((uint8_t*)&motor.ffGainLeft, sizeof(motor.ffGainLeft)) != 0);
+  res &= (tuningFile.write((uint8_t*)&motor.ffGainRight, sizeof(motor.ffGainRight)) != 0);
+  res &= (tuningFile.write((uint8_t*)&motor.ffOffset, sizeof(motor.ffOffset)) != 0);
+  if (res){
+    CONSOLE.println("ok");
+  } else {
+    CONSOLE.println("ERROR saving motor tuning");
+  }
+  tuningFile.flush();
+  tuningFile.close();
+#else
+  CONSOLE.println("motor tuning not saved (ENABLE_SD not activated)");
+#endif
+  return res; 
+}
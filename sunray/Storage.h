@@ -14,6 +14,9 @@
 
 bool loadState();
 bool saveState();
+// motor auto-tune results (speed control coefficients, feed-forward)
+bool loadMotorTuning();
+bool saveMotorTuning();
 
 
 #endif
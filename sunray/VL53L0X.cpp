@@ -831,6 +831,19 @@ uint16_t VL53L0X::readRangeContinuousMillimeters(void)
   return range;
 }
 
+// Non-blocking version of readRangeContinuousMillimeters(): returns false
+// (without waiting) if no new measurement is ready yet
+bool VL53L0X::readRangeAvailable(uint16_t &range)
+{
+  if ((readReg(RESULT_INTERRUPT_STATUS) & 0x07) == 0) return false;
+
+  range = readReg16Bit(RESULT_RANGE_STATUS + 10);
+
+  writeReg(SYSTEM_INTERRUPT_CLEAR, 0x01);
+
+  return true;
+}
+
 // Performs a single-shot range measurement and returns the reading in
 // millimeters
 // based on VL53L0X_PerformSingleRangingMeasurement()
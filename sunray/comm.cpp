@@ -15,11 +15,17 @@
   #include <Process.h>
   #include <WiFi.h>
   #include <sys/resource.h>
+  #include <Wire.h>
 #else
   #include "src/esp/WiFiEsp.h"
 #endif
 #include "timetable.h"
 #include "Storage.h"
+#include "latency.h"
+#include "mapupload.h"
+#include "relayclient.h"
+#include "logger.h"
+#include "i2cworker.h"
 
 
 //#define VERBOSE 1
@@ -37,6 +43,7 @@ int simFaultConnCounter = 0;
 
 String cmd;
 String cmdResponse;
+bool cmdResponseCoverageRaster = false;
 
 float statControlCycleTime = 0; 
 float statMaxControlCycleTime = 0; 
@@ -120,7 +127,7 @@ void cmdControl(){
       } else if (counter == 2){
           if (intValue >= 0) op = intValue;
       } else if (counter == 3){
-          if (floatValue >= 0) setSpeed = floatValue;
+          if (floatValue >= 0) setSpeed = min(floatValue, (float)MOTOR_MAX_SPEED);
       } else if (counter == 4){
           if (intValue >= 0) fixTimeout = intValue;
       } else if (counter == 5){
@@ -188,6 +195,7 @@ void cmdMotor(){
   CONSOLE.print(linear);
   CONSOLE.print(" angular=");
   CONSOLE.println(angular);*/
+  linear = max(-(float)MOTOR_MAX_SPEED, min(linear, (float)MOTOR_MAX_SPEED));
   motor.setLinearAngularSpeed(linear, angular, false);
   String s = F("M");
   cmdAnswer(s);
@@ -199,6 +207,26 @@ void cmdMotorTest(){
   motor.test();
 }
 
+// motor auto-tune (wheels must turn freely)
+// E2,result,KP,KI,ffGainLeft,ffGainRight,ffOffset
+void cmdMotorAutoTune(){
+  String s = F("E2,");
+  bool res = motor.autoTune();
+  if (res) saveMotorTuning();
+  s += res;
+  s += ",";
+  s += motor.speedKp;
+  s += ",";
+  s += motor.speedKi;
+  s += ",";
+  s += motor.ffGainLeft;
+  s += ",";
+  s += motor.ffGainRight;
+  s += ",";
+  s += motor.ffOffset;
+  cmdAnswer(s);
+}
+
 void cmdMotorPlot(){
   String s = F("Q");
   cmdAnswer(s);
@@ -308,6 +336,30 @@ void cmdWaypoint(){
 }
 
 
+// binary waypoint upload (see mapupload.h)
+// WB,0,count        -> WB,0
+// WB,1,frame        -> WB,nextIdx
+void cmdWaypointBulk(){
+  if (cmd.length()<8) return;
+  char op = cmd[6];
+  bool success = true;
+  String s = F("WB,");
+  if (op == '0'){
+    success = mapUpload.begin(cmd.substring(8).toInt());
+    s += "0";
+  } else if (op == '1'){
+    mapUpload.frame(cmd.c_str() + 8, cmd.length() - 8);
+    s += mapUpload.nextIdx;
+  } else return;
+  cmdAnswer(s);
+
+  if (!success){
+    stateSensor = SENS_MEM_OVERFLOW;
+    setOperation(OP_ERROR);
+  }
+}
+
+
 // request waypoints count
 // N,#peri,#excl,#dock,#mow,#free
 void cmdWayCount(){
@@ -342,6 +394,59 @@ void cmdWayCount(){
 }
 
 
+// map store (several named maps, e.g. front and back yard)
+// A                           list stored maps:  A,success,activeslot,slot,name,crc,slot,name,crc,...
+// A1,slot,name                store current map into slot
+// A2,slot                     switch to stored map (robot idle or charging only)
+// A3,slot                     delete stored map
+// A4,slot,slot,...(24x)       stored map per timetable hour (-1: keep current map)
+void cmdMapStore(){
+  bool success = true;
+  char op = (cmd.length() > 4) ? cmd[4] : '0';
+  int slot = -1;
+  String name = "";
+  int counter = 0;
+  int lastCommaIdx = 0;
+  for (int idx=0; idx < cmd.length(); idx++){
+    char ch = cmd[idx];
+    if ((ch == ',') || (idx == cmd.length()-1)){            
+      String value = cmd.substring(lastCommaIdx+1, ch==',' ? idx : idx+1);
+      if (counter == 1){
+        slot = value.toInt();
+      } else if ((counter == 2) && (op == '1')){
+        name = value;
+      }
+      if ((counter >= 1) && (op == '4')){
+        if (!timetable.setMapSlot(counter-1, value.toInt())) success = false;
+      }
+      counter++;
+      lastCommaIdx = idx;
+    }
+  }
+  if (op == '1') success = maps.storeMap(slot, name);
+  else if (op == '2') success = ((stateOp == OP_IDLE) || (stateOp == OP_CHARGE)) && (maps.selectMap(slot));
+  else if (op == '3') success = maps.deleteStoredMap(slot);
+  else if (op == '4') {
+    timetable.dump();
+    if (success) saveState();
+  }
+  String s = F("A,");
+  s += (success) ? 1 : 0;
+  s += ",";
+  s += maps.activeMapSlot;
+  for (int i=0; i < MAX_STORED_MAPS; i++){
+    if (!maps.storedMaps[i].used) continue;
+    s += ",";
+    s += i;
+    s += ",";
+    s += maps.storedMaps[i].name;
+    s += ",";
+    s += maps.storedMaps[i].mapCRC;
+  }
+  cmdAnswer(s);
+}
+
+
 // request exclusion count
 // X,startidx,cnt,cnt,cnt,cnt,...
 void cmdExclusionCount(){
@@ -510,6 +615,22 @@ void cmdSwitchOffRobot(){
   battery.switchOff();
 }
 
+// console log level (AT+D: request, AT+D,level: set)
+// level,records,dropped,suppressed
+void cmdLogLevel(){
+  int idx = cmd.indexOf(',');
+  if (idx > 0) logger.level = cmd.substring(idx+1).toInt();
+  String s = F("D,");
+  s += logger.level;
+  s += ",";
+  s += (unsigned long)logger.records;
+  s += ",";
+  s += (unsigned long)logger.dropped;
+  s += ",";
+  s += (unsigned long)logger.suppressed;
+  cmdAnswer(s);
+}
+
 // kidnap test (kidnap detection should trigger)
 void cmdKidnap(){
   String s = F("K");
@@ -527,6 +648,7 @@ void cmdToggleGPSSolution(){
   switch (gps.solution){
     case SOL_INVALID:  
       gps.solutionAvail = true;
+      gps.solutionTime = millis();
       gps.solution = SOL_FLOAT;
       gps.relPosN = stateY - 2.0;  // simulate pos. solution jump
       gps.relPosE = stateX - 2.0;
@@ -535,6 +657,7 @@ void cmdToggleGPSSolution(){
       break;
     case SOL_FLOAT:  
       gps.solutionAvail = true;
+      gps.solutionTime = millis();
       gps.solution = SOL_FIXED;
       stateGroundSpeed = 0.1;
       gps.relPosN = stateY + 2.0;  // simulate undo pos. solution jump
@@ -542,6 +665,7 @@ void cmdToggleGPSSolution(){
       break;
     case SOL_FIXED:  
       gps.solutionAvail = true;
+      gps.solutionTime = millis();
       gps.solution = SOL_INVALID;
       break;
   }
@@ -566,9 +690,49 @@ void cmdObstacles(){
   cmdAnswer(s);
 }
 
-// request summary
-void cmdSummary(){
-  String s = F("S,");
+// request mowed area coverage (percent covered, gaps)
+void cmdCoverage(){
+  if (stateOp != OP_MOW) coverage.findGaps();
+  String s = F("S3,");
+  s += coverage.percentCovered();
+  s += ",";
+  s += coverage.mowableCells * coverage.cellSize * coverage.cellSize;
+  s += ",";
+  s += coverage.coveredCells * coverage.cellSize * coverage.cellSize;
+  s += ",";
+  s += coverage.gapsCount;
+  for (int i=0; i < coverage.gapsCount; i++){
+    s += ",";
+    s += coverage.gaps[i].center.x();
+    s += ",";
+    s += coverage.gaps[i].center.y();
+    s += ",";
+    s += coverage.gaps[i].cells * coverage.cellSize * coverage.cellSize;
+  }
+  cmdAnswer(s);
+}
+
+// request mowed area coverage raster (binary raster follows response for HTTP clients)
+void cmdCoverageRaster(){
+  String s = F("S4,");
+  s += coverage.cols;
+  s += ",";
+  s += coverage.rows;
+  s += ",";
+  s += coverage.cellSize;
+  s += ",";
+  s += coverage.minX;
+  s += ",";
+  s += coverage.minY;
+  s += ",";
+  s += coverage.rasterBytes;
+  cmdAnswer(s);
+  cmdResponseCoverageRaster = (coverage.covered != NULL);
+}
+
+// summary record (also used for telemetry stream)
+void summaryRecord(String &s){
+  s += F("S,");
   s += battery.batteryVoltage;
   s += ",";
   s += stateX;
@@ -619,6 +783,12 @@ void cmdSummary(){
   } else {
     s += "-1,0";
   }
+}
+
+// request summary
+void cmdSummary(){
+  String s;
+  summaryRecord(s);
   cmdAnswer(s);  
 }
 
@@ -678,6 +848,224 @@ void cmdStats(){
   cmdAnswer(s);
 }
 
+// request NTRIP statistics
+void cmdNtripStats(){
+  String s = F("T2");
+  #ifdef ENABLE_NTRIP
+    s += ",";
+    s += ntrip.state;
+    s += ",";
+    s += ntrip.correctionAge();
+    s += ",";
+    s += ntrip.rxBytes;
+    s += ",";
+    s += ntrip.rtcmFrames;
+    s += ",";
+    s += ntrip.rtcmCrcErrors;
+    s += ",";
+    s += ntrip.discardedBytes;
+    s += ",";
+    s += ntrip.gaps;
+    s += ",";
+    s += ntrip.maxGap;
+    s += ",";
+    s += ntrip.reconnects;
+    s += ",";
+    s += ntrip.uartDroppedBytes;
+    s += ",";
+    s += ntrip.maxUartWriteTime;
+    // message type, count, average interval (ms)
+    for (int i=0; i < ntrip.typesCount; i++){
+      s += ",";
+      s += ntrip.types[i].type;
+      s += ",";
+      s += ntrip.types[i].count;
+      s += ",";
+      s += (int)ntrip.types[i].interval;
+    }
+  #endif
+  cmdAnswer(s);
+}
+
+// request ranging (sonar, ToF) statistics
+void cmdRangeStats(){
+  String s = F("T3,");
+  s += sonar.distanceLeft;
+  s += ",";
+  s += sonar.distanceCenter;
+  s += ",";
+  s += sonar.distanceRight;
+  s += ",";
+  s += sonar.distanceToF;
+  s += ",";
+  s += sonar.pings;
+  s += ",";
+  s += sonar.echoTimeouts;
+  s += ",";
+  s += sonar.tofReadings;
+  s += ",";
+  s += sonar.obstacleLatency;
+  s += ",";
+  s += sonar.maxObstacleLatency;
+  cmdAnswer(s);
+}
+
+// request MCU link statistics (serial robot)
+// type,requests,responses,lost,reordered,avgRtt(us),maxRtt(us),maxMcuGap(ms) per message type
+void cmdRobotLinkStats(){
+  String s = F("T4");
+  #ifdef DRV_SERIAL_ROBOT
+    s += ",";
+    s += (int)robotDriver.binaryLink;
+    s += ",";
+    s += robotDriver.linkCrcErrors;
+    LinkStats *stats[3] = {&robotDriver.motorLink, &robotDriver.summaryLink, &robotDriver.versionLink};
+    const char types[3] = {'M', 'S', 'V'};
+    for (int i=0; i < 3; i++){
+      s += ",";
+      s += types[i];
+      s += ",";
+      s += stats[i]->requests;
+      s += ",";
+      s += stats[i]->responses;
+      s += ",";
+      s += stats[i]->lost;
+      s += ",";
+      s += stats[i]->reordered;
+      s += ",";
+      s += stats[i]->avgRtt;
+      s += ",";
+      s += stats[i]->maxRtt;
+      s += ",";
+      s += stats[i]->maxMcuGap;
+    }
+  #endif
+  cmdAnswer(s);
+}
+
+// request relay client statistics
+// state,connects,failures,disconnects,idleReconnects,requests,rxOverflows,txDropped,health,backoff(ms)
+void cmdRelayStats(){
+  String s = F("T5,");
+  s += (int)relayClient.state;
+  s += ",";
+  s += relayClient.connects;
+  s += ",";
+  s += relayClient.failures;
+  s += ",";
+  s += relayClient.disconnects;
+  s += ",";
+  s += relayClient.idleReconnects;
+  s += ",";
+  s += relayClient.requests;
+  s += ",";
+  s += relayClient.rxOverflows;
+  s += ",";
+  s += relayClient.txDropped;
+  s += ",";
+  s += relayClient.health;
+  s += ",";
+  s += relayClient.backoff;
+  cmdAnswer(s);
+}
+
+// request MQTT statistics
+// connects,connectFailures,connectTime(ms),maxConnectTime(ms),published,skipped,dropped,txBytes,avgPublishLatency(us),maxPublishLatency(us)
+void cmdMqttStats(){
+  String s = F("T6,");
+  s += mqttConnects;
+  s += ",";
+  s += mqttConnectFailures;
+  s += ",";
+  s += mqttConnectTime;
+  s += ",";
+  s += mqttMaxConnectTime;
+  s += ",";
+  s += mqttPublished;
+  s += ",";
+  s += mqttSkipped;
+  s += ",";
+  s += mqttDropped;
+  s += ",";
+  s += mqttTxBytes;
+  s += ",";
+  s += mqttAvgPublishLatency;
+  s += ",";
+  s += mqttMaxPublishLatency;
+  cmdAnswer(s);
+}
+
+// request I2C statistics
+// worker: jobs,writes,coalesced,errors,maxJobTime(us),maxImuWait(us)
+// then for each used slave address (Linux): address,transfers,errors,bytes
+void cmdI2cStats(){
+  String s = F("T7,");
+  s += i2cWorker.jobs;
+  s += ",";
+  s += i2cWorker.writes;
+  s += ",";
+  s += i2cWorker.coalesced;
+  s += ",";
+  s += i2cWorker.errors;
+  s += ",";
+  s += i2cWorker.maxJobTime;
+  s += ",";
+  s += i2cWorker.maxImuWait;
+  #ifdef __linux__
+    for (int addr=0; addr < 128; addr++){
+      const WireStats &st = Wire.stats[addr];
+      if (st.transfers == 0) continue;
+      s += ",";
+      s += addr;
+      s += ",";
+      s += st.transfers;
+      s += ",";
+      s += st.errors;
+      s += ",";
+      s += st.bytes;
+    }
+  #endif
+  cmdAnswer(s);
+}
+
+// request scheduler task statistics
+void cmdSchedulerStats(){
+  String s = F("S5");
+  // name, period (ms), priority, runs, average (us), max (us), budget (us), overruns, deferrals, max. late (ms)
+  for (int i=0; i < scheduler.tasksCount; i++){
+    SchedulerTask &task = scheduler.tasks[i];
+    s += ",";
+    s += task.name;
+    s += ",";
+    s += task.period;
+    s += ",";
+    s += (int)task.priority;
+    s += ",";
+    s += task.runs;
+    s += ",";
+    s += (int)task.avgTime;
+    s += ",";
+    s += task.maxTime;
+    s += ",";
+    s += task.budget;
+    s += ",";
+    s += task.overruns;
+    s += ",";
+    s += task.deferrals;
+    s += ",";
+    s += task.maxLate;
+  }
+  cmdAnswer(s);
+}
+
+// request latency histograms
+void cmdLatencyStats(){
+  String s = F("S6");
+  // name, count, max (us), p50 (us), p99 (us), number of buckets, buckets (2^i us)
+  latenciesToCsv(s);
+  cmdAnswer(s);
+}
+
 // clear statistics
 void cmdClearStats(){
   String s = F("L");
@@ -697,6 +1085,24 @@ void cmdClearStats(){
   statTempMax = -9999;
   gps.chksumErrorCounter = 0;
   gps.dgpsChecksumErrorCounter = 0;
+  #ifdef ENABLE_NTRIP
+    ntrip.clearStats();
+  #endif
+  scheduler.clearStats();
+  i2cWorker.clearStats();
+  #ifdef __linux__
+    i2cWorker.lock();  // stats are updated by bus transfers
+    Wire.clearStats();
+    i2cWorker.unlock();
+  #endif
+  sonar.clearStats();
+  #ifdef DRV_SERIAL_ROBOT
+    robotDriver.clearLinkStats();
+  #endif
+  relayClient.clearStats();
+  mqttClearStats();
+  logger.clearStats();
+  clearLatencies();
   statMaxControlCycleTime = 0;
   statMowObstacles = 0;
   statMowBumperCounter = 0; 
@@ -805,6 +1211,7 @@ void cmdFirmwareUpdate(){
 // process request
 void processCmd(bool checkCrc, bool decrypt){
   cmdResponse = "";      
+  cmdResponseCoverageRaster = false;
   if (cmd.length() < 4) return;
 #ifdef ENABLE_PASS
   if (decrypt){
@@ -865,6 +1272,10 @@ void processCmd(bool checkCrc, bool decrypt){
       cmdSummary(); 
     } else {
       if (cmd[4] == '2') cmdObstacles();      
+      if (cmd[4] == '3') cmdCoverage();
+      if (cmd[4] == '4') cmdCoverageRaster();
+      if (cmd[4] == '5') cmdSchedulerStats();
+      if (cmd[4] == '6') cmdLatencyStats();
     }
   }
   if (cmd[3] == 'M') cmdMotor();
@@ -872,17 +1283,30 @@ void processCmd(bool checkCrc, bool decrypt){
     if ((cmd.length() > 4) && (cmd[4] == 'T')) cmdTuneParam();
     else cmdControl();
   }
-  if (cmd[3] == 'W') cmdWaypoint();
+  if (cmd[3] == 'W'){
+    if ((cmd.length() > 4) && (cmd[4] == 'B')) cmdWaypointBulk();
+    else cmdWaypoint();
+  }
   if (cmd[3] == 'N') cmdWayCount();
   if (cmd[3] == 'X') cmdExclusionCount();
+  if (cmd[3] == 'A') cmdMapStore();
   if (cmd[3] == 'V') cmdVersion();  
   if (cmd[3] == 'P') cmdPosMode();  
   if (cmd[3] == 'T'){ 
     if ((cmd.length() > 4) && (cmd[4] == 'T')) cmdTimetable();
+    else if ((cmd.length() > 4) && (cmd[4] == '2')) cmdNtripStats();
+    else if ((cmd.length() > 4) && (cmd[4] == '3')) cmdRangeStats();
+    else if ((cmd.length() > 4) && (cmd[4] == '4')) cmdRobotLinkStats();
+    else if ((cmd.length() > 4) && (cmd[4] == '5')) cmdRelayStats();
+    else if ((cmd.length() > 4) && (cmd[4] == '6')) cmdMqttStats();
+    else if ((cmd.length() > 4) && (cmd[4] == '7')) cmdI2cStats();
     else cmdStats();
   }
   if (cmd[3] == 'L') cmdClearStats();
-  if (cmd[3] == 'E') cmdMotorTest();  
+  if (cmd[3] == 'E'){
+    if ((cmd.length() > 4) && (cmd[4] == '2')) cmdMotorAutoTune();
+    else cmdMotorTest();  
+  }
   if (cmd[3] == 'Q') cmdMotorPlot();  
   if (cmd[3] == 'O'){
     if (cmd.length() <= 4){
@@ -902,6 +1326,7 @@ void processCmd(bool checkCrc, bool decrypt){
     if ((cmd.length() > 4) && (cmd[4] == '1')) cmdFirmwareUpdate();
   }
   if (cmd[3] == 'G') cmdToggleGPSSolution();   // for developers
+  if (cmd[3] == 'D') cmdLogLevel();
   if (cmd[3] == 'K') cmdKidnap();   // for developers
   if (cmd[3] == 'Z') cmdStressTest();   // for developers
   if (cmd[3] == 'Y') {
@@ -936,8 +1361,11 @@ void processConsole(){
 
 
 void processComm(){
-  processConsole();     
-  processBLE();     
+  {
+    LATENCY_SCOPE(LAT_CONSOLE);
+    processConsole();     
+    processBLE();     
+  }
   if (!bleConnected){
     processWifiAppServer();
     processWifiRelayClient();
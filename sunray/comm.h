@@ -16,10 +16,13 @@ void outputConsole();
 void processCmd(bool checkCrc, bool decrypt);
 void processConsole();
 void cmdSwitchOffRobot();
+// appends summary record (S,...) without CRC
+void summaryRecord(String &s);
 
 
 extern String cmd;
 extern String cmdResponse;
+extern bool cmdResponseCoverageRaster; // coverage raster (binary) should follow cmdResponse
 
 extern bool bleConnected;
 
@@ -160,10 +160,16 @@ Also, you may choose the serial port below for serial monitor output (CONSOLE).
 #define USE_LINEAR_SPEED_RAMP  false      // do not use a speed ramp 
 
 // motor speed control (PID coefficients) - these values are tuned for Ardumower motors
+// pwm = feed-forward + PID (positional, error in rpm), the PID gains are derived from the tuned coefficients below (see Motor::begin)
+// motor auto-tune (AT+E2, lift robot so that the wheels can turn freely) identifies the motors,
+// computes feed-forward and PID coefficients and stores them on SD card (ENABLE_SD) - these replace the values below
 // general information about PID controllers: https://wiki.ardumower.de/index.php?title=PID_control
 #define MOTOR_PID_KP     2.0    // do not change 2.0 (for non-Ardumower motors or if the motor speed control is too fast you may try: KP=1.0, KI=0, KD=0)
 #define MOTOR_PID_KI     0.03   // do not change 0.03
 #define MOTOR_PID_KD     0.03   // do not change 0.03
+#define MOTOR_PID_KB     10.0   // anti wind-up back-calculation gain (1/s)
+#define MOTOR_FF_GAIN    0.0    // feed-forward pwm per rpm (0: no feed-forward, set by motor auto-tune)
+#define MOTOR_FF_OFFSET  0.0    // feed-forward pwm to overcome static friction (set by motor auto-tune)
 
 //#define MOTOR_LEFT_SWAP_DIRECTION 1  // uncomment to swap left motor direction
 //#define MOTOR_RIGHT_SWAP_DIRECTION 1  // uncomment to swap right motor direction
@@ -251,6 +257,7 @@ Also, you may choose the serial port below for serial monitor output (CONSOLE).
 #define MQTT_PORT  1883
 #define MQTT_USER "user"
 #define MQTT_PASS "pass"
+//#define MQTT_JSON_STATE  1                          // publish all values as one JSON object (robot1/state) instead of single topics
 
 // ------ ultrasonic sensor -----------------------------
 // see Wiki on how to install the ultrasonic sensors: 
@@ -346,6 +353,19 @@ Also, you may choose the serial port below for serial monitor output (CONSOLE).
 #define CPG_CONFIG_FILTER_NCNOTHRS 10   // C/N0 Threshold #SVs: 10 (robust), 6 (less robust)
 #define CPG_CONFIG_FILTER_CNOTHRS  30   // 30 dbHz (robust), 13 dbHz (less robust)
 
+// GPS latency compensation: each GPS solution is some time old when it arrives (receiver processing, UART transfer, loop polling).
+// The solution is moved forward by the odometry distance driven since then before it is fused (reduces tracking error at speed and false 'GPS jumps')
+#define GPS_LATENCY_COMPENSATION true
+//#define GPS_LATENCY_COMPENSATION false
+#define GPS_LATENCY_MS 50     // receiver processing + UART transfer time (ms) of the fastest solution - transfer/polling delays above that are measured via iTOW
+
+// state estimator (extended Kalman filter): GPS position noise depends on solution type, GPS positions too far away
+// from the estimated position are rejected ('GPS jump') - after some rejected solutions in a row the position is reset to GPS
+#define EKF_GPS_FIX_SIGMA  0.05     // GPS position standard deviation for fix solution (m)
+#define EKF_GPS_FLOAT_SIGMA  0.5    // GPS position standard deviation for float solution (m)
+#define EKF_GPS_GATE  16.0          // innovation gate (squared Mahalanobis distance, 16 = 4 sigma)
+#define EKF_GPS_GATE_RESETS  5      // number of rejected GPS solutions in a row before position is reset to GPS
+
 
 // ------ obstacle detection and avoidance  -------------------------
 
@@ -360,6 +380,18 @@ Also, you may choose the serial port below for serial monitor output (CONSOLE).
 #define OBSTACLE_AVOIDANCE true   // try to find a way around obstacle
 //#define OBSTACLE_AVOIDANCE false  // stop robot on obstacle
 #define OBSTACLE_DIAMETER 1.2   // choose diameter of obstacles placed in front of robot (m) for obstacle avoidance
+#define LEARN_OBSTACLES true    // remember obstacles over mowing sessions (obstacles.bin), so that path planner avoids them right from the start 
+#define LEARNED_OBSTACLE_DIAMETER 0.6   // diameter of a learned obstacle (m) for a single collision
+#define LEARNED_OBSTACLE_MAX_DIAMETER 2.0   // max. diameter of merged learned obstacles (m)
+#define LEARNED_OBSTACLE_MIN_HITS 2    // collisions required before a learned obstacle is used by the path planner
+#define LEARNED_OBSTACLE_DECAY_SESSIONS 5   // a learned obstacle loses one collision for each number of mowing sessions without collision
+
+// mowed area coverage raster (percent covered, uncovered gaps - request via AT+S3, raster via AT+S4)
+#define COVERAGE_MAP true      // track mowed area?
+#define COVERAGE_CELL_SIZE 0.1   // raster cell size (m) - increased automatically if the map does not fit into COVERAGE_MAX_BYTES
+#define COVERAGE_MAX_BYTES 16384   // max. memory used by coverage raster (bytes)
+#define COVERAGE_CUT_WIDTH 0.18   // mowing blade cutting width (m)
+#define COVERAGE_GAP_SIZE 0.5    // min. size (m) of an uncovered area to be reported as gap
 #define DISABLE_MOW_MOTOR_AT_OBSTACLE true // switch off mow motor while escape at detected obstacle; set false if mow motor shall not be stopped at detected obstacles
 
 // detect robot being kidnapped? robot will try GPS recovery if distance to tracked path is greater than a certain value
@@ -400,6 +432,14 @@ Also, you may choose the serial port below for serial monitor output (CONSOLE).
 #define STANLEY_CONTROL_P_SLOW    3.0   // 3.0 for path tracking control (angular gain) when docking tracking
 #define STANLEY_CONTROL_K_SLOW    0.1   // 0.1 for path tracking control (lateral gain) when docking tracking
 
+// look-ahead speed profile for mowing lines: robot slows down only as much as required by upcoming curves 
+// (instead of slowing down at each waypoint that is not straight)
+#define SPEED_PROFILE true      // use look-ahead speed profile (recommended)
+//#define SPEED_PROFILE false   // slow down (0.1 m/s) when approaching each non-straight waypoint
+#define MOTOR_MAX_SPEED 0.5                  // max. linear speed (m/s) the speed profile, app and AT commands may request
+#define SPEED_PROFILE_MAX_LATERAL_ACCEL 0.3  // max. lateral acceleration (m/s^2) in curves
+#define SPEED_PROFILE_MAX_ACCEL 0.3          // max. linear acceleration/deceleration (m/s^2) of the traction motors
+
 
 // ----- other options --------------------------------------------
 
@@ -451,11 +491,13 @@ Also, you may choose the serial port below for serial monitor output (CONSOLE).
 // ------- serial ports and baudrates---------------------------------
 #define CONSOLE_BAUDRATE    115200    // baudrate used for console
 //#define CONSOLE_BAUDRATE    921600  // baudrate used for console
+#define LOG_LEVEL  2                  // console log level: 0=error, 1=warn, 2=info, 3=debug (at runtime: AT+D,level)
 #define BLE_BAUDRATE    115200        // baudrate used for BLE
 #define BLE_NAME      "Ardumower"     // name for BLE module
 #define GPS_BAUDRATE  115200          // baudrate for GPS RTK module
 #define WIFI_BAUDRATE 115200          // baudrate for WIFI module
 #define ROBOT_BAUDRATE 115200         // baudrate for Linux serial robot (non-Ardumower)
+//#define ROBOT_BINARY_LINK 1          // binary framed link to robot MCU (requires rm18 firmware >= 1.1.18), motor requests at 100 Hz if baudrate >= 57600
 
 #ifdef __SAM3X8E__                 // Arduino Due
   #define WIFI Serial1
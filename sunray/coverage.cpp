@@ -0,0 +1,246 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "coverage.h"
+#include "config.h"
+#include "robot.h"
+
+
+CoverageMap::CoverageMap(){
+  covered = NULL;
+  mowable = NULL;
+  rasterBytes = 0;
+  cols = rows = 0;
+  minX = minY = 0;
+  cellSize = COVERAGE_CELL_SIZE;
+  mowableCells = coveredCells = 0;
+  gapsCount = 0;
+  hasLastPos = false;
+}
+
+void CoverageMap::free(){
+  if (covered != NULL) delete[] covered;
+  if (mowable != NULL) delete[] mowable;
+  covered = NULL;
+  mowable = NULL;
+  rasterBytes = 0;
+  cols = rows = 0;
+  mowableCells = coveredCells = 0;
+  gapsCount = 0;
+}
+
+bool CoverageMap::getBit(byte *bitmap, long idx){
+  return ((bitmap[idx >> 3] >> (idx & 7)) & 1);
+}
+
+void CoverageMap::setBit(byte *bitmap, long idx, bool value){
+  if (value) bitmap[idx >> 3] |= (1 << (idx & 7));
+    else bitmap[idx >> 3] &= ~(1 << (idx & 7));
+}
+
+void CoverageMap::begin(){
+  free();
+  if (!COVERAGE_MAP) return;
+  Polygon &perimeter = maps.perimeterPoints;
+  if (perimeter.numPoints < 3) return;
+  float maxX = -9999;
+  float maxY = -9999;
+  minX = 9999;
+  minY = 9999;
+  for (int i=0; i < perimeter.numPoints; i++){
+    minX = min(minX, perimeter.points[i].x());
+    minY = min(minY, perimeter.points[i].y());
+    maxX = max(maxX, perimeter.points[i].x());
+    maxY = max(maxY, perimeter.points[i].y());
+  }
+  // increase cell size until both bitmaps fit into memory limit
+  cellSize = COVERAGE_CELL_SIZE;
+  while (true){
+    cols = ((int)((maxX - minX) / cellSize)) + 1;
+    rows = ((int)((maxY - minY) / cellSize)) + 1;
+    rasterBytes = (((long)cols) * rows + 7) / 8;
+    if (rasterBytes * 2 <= COVERAGE_MAX_BYTES) break;
+    cellSize *= 2;
+  }
+  covered = new byte[rasterBytes];
+  mowable = new byte[rasterBytes];
+  if ((covered == NULL) || (mowable == NULL)){
+    CONSOLE.println("ERROR coverage: out of memory");
+    free();
+    return;
+  }
+  memset(mowable, 0, rasterBytes);
+  fillPolygon(perimeter, true);
+  for (int i=0; i < maps.exclusions.numPolygons; i++){
+    fillPolygon(maps.exclusions.polygons[i], false);
+  }
+  mowableCells = 0;
+  for (int i=0; i < rasterBytes; i++){
+    for (byte b = mowable[i]; b != 0; b &= b-1) mowableCells++;
+  }
+  clear();
+  dump();
+}
+
+// set (or clear) all cells whose center is inside polygon (scanline fill)
+void CoverageMap::fillPolygon(Polygon &poly, bool value){
+  if (poly.numPoints < 3) return;
+  float *xs = new float[poly.numPoints];
+  if (xs == NULL) return;
+  for (int r=0; r < rows; r++){
+    float y = minY + (((float)r) + 0.5) * cellSize;
+    // edge crossings of scanline (sorted)
+    int num = 0;
+    int j = poly.numPoints-1;
+    for (int i=0; i < poly.numPoints; i++){
+      float yi = poly.points[i].y();
+      float yj = poly.points[j].y();
+      if ((yi > y) != (yj > y)){
+        float xi = poly.points[i].x();
+        float xj = poly.points[j].x();
+        float x = xi + (y - yi) * (xj - xi) / (yj - yi);
+        int k = num;
+        while ((k > 0) && (xs[k-1] > x)) {
+          xs[k] = xs[k-1];
+          k--;
+        }
+        xs[k] = x;
+        num++;
+      }
+      j = i;
+    }
+    for (int k=0; k+1 < num; k += 2){
+      int colStart = max(0, (int)ceil((xs[k] - minX) / cellSize - 0.5));
+      int colEnd = min(cols-1, (int)floor((xs[k+1] - minX) / cellSize - 0.5));
+      long idx = ((long)r) * cols;
+      for (int c=colStart; c <= colEnd; c++) setBit(mowable, idx + c, value);
+    }
+  }
+  delete[] xs;
+}
+
+void CoverageMap::clear(){
+  if (covered != NULL) memset(covered, 0, rasterBytes);
+  coveredCells = 0;
+  gapsCount = 0;
+  hasLastPos = false;
+}
+
+void CoverageMap::resetTrack(){
+  hasLastPos = false;
+}
+
+// mark all cells within cutting width around position as mowed
+void CoverageMap::stamp(float x, float y){
+  float radius = COVERAGE_CUT_WIDTH / 2.0;
+  int rc = ((int)(radius / cellSize)) + 1;
+  int col = (int)((x - minX) / cellSize);
+  int row = (int)((y - minY) / cellSize);
+  for (int r = max(0, row-rc); r <= min(rows-1, row+rc); r++){
+    float dy = minY + (((float)r) + 0.5) * cellSize - y;
+    for (int c = max(0, col-rc); c <= min(cols-1, col+rc); c++){
+      float dx = minX + (((float)c) + 0.5) * cellSize - x;
+      if (dx*dx + dy*dy > radius*radius) continue;
+      long idx = ((long)r) * cols + c;
+      if ((getBit(mowable, idx)) && (!getBit(covered, idx))){
+        setBit(covered, idx, true);
+        coveredCells++;
+      }
+    }
+  }
+}
+
+void CoverageMap::update(float x, float y){
+  if (covered == NULL) return;
+  if (!hasLastPos){
+    stamp(x, y);
+  } else {
+    float d = sqrt( sq(x - lastX) + sq(y - lastY) );
+    if (d < cellSize / 2) return;
+    if (d > 1.0) {
+      // position jump - do not connect positions
+      stamp(x, y);
+    } else {
+      // connect last position with current position (bounded number of stamps)
+      int steps = ((int)(d / (COVERAGE_CUT_WIDTH / 4.0))) + 1;
+      for (int i=1; i <= steps; i++){
+        float t = ((float)i) / ((float)steps);
+        stamp(lastX + (x - lastX) * t, lastY + (y - lastY) * t);
+      }
+    }
+  }
+  lastX = x;
+  lastY = y;
+  hasLastPos = true;
+}
+
+int CoverageMap::percentCovered(){
+  if (mowableCells == 0) return 0;
+  return (int)(((float)coveredCells) / ((float)mowableCells) * 100.0);
+}
+
+// a gap is a block (COVERAGE_GAP_SIZE x COVERAGE_GAP_SIZE) with at least half of its cells mowable but not covered
+int CoverageMap::findGaps(){
+  gapsCount = 0;
+  if (covered == NULL) return 0;
+  int b = max(1, (int)(COVERAGE_GAP_SIZE / cellSize + 0.5));
+  int minCells = max(1, b * b / 2);
+  for (int br=0; br < rows; br += b){
+    for (int bc=0; bc < cols; bc += b){
+      int cells = 0;
+      float sumX = 0;
+      float sumY = 0;
+      for (int r=br; r < min(rows, br+b); r++){
+        for (int c=bc; c < min(cols, bc+b); c++){
+          long idx = ((long)r) * cols + c;
+          if ((getBit(mowable, idx)) && (!getBit(covered, idx))){
+            cells++;
+            sumX += c;
+            sumY += r;
+          }
+        }
+      }
+      if (cells < minCells) continue;
+      // insert into gaps (sorted by size, largest first)
+      int k = min(gapsCount, COVERAGE_MAX_GAPS-1);
+      if ((k == COVERAGE_MAX_GAPS-1) && (gaps[k].cells >= cells)) continue;
+      while ((k > 0) && (gaps[k-1].cells < cells)) {
+        gaps[k] = gaps[k-1];
+        k--;
+      }
+      gaps[k].center.setXY(minX + (sumX / cells + 0.5) * cellSize, minY + (sumY / cells + 0.5) * cellSize);
+      gaps[k].cells = cells;
+      if (gapsCount < COVERAGE_MAX_GAPS) gapsCount++;
+    }
+  }
+  return gapsCount;
+}
+
+void CoverageMap::dump(){
+  CONSOLE.print("coverage cols=");
+  CONSOLE.print(cols);
+  CONSOLE.print(" rows=");
+  CONSOLE.print(rows);
+  CONSOLE.print(" cellSize=");
+  CONSOLE.print(cellSize);
+  CONSOLE.print(" bytes=");
+  CONSOLE.print(rasterBytes * 2);
+  CONSOLE.print(" mowable=");
+  CONSOLE.print(mowableCells);
+  CONSOLE.print(" covered=");
+  CONSOLE.print(coveredCells);
+  CONSOLE.print(" (");
+  CONSOLE.print(percentCovered());
+  CONSOLE.print("%) gaps=");
+  CONSOLE.println(gapsCount);
+  for (int i=0; i < gapsCount; i++){
+    CONSOLE.print("  gap ");
+    CONSOLE.print(gaps[i].center.x());
+    CONSOLE.print(",");
+    CONSOLE.print(gaps[i].center.y());
+    CONSOLE.print(" area=");
+    CONSOLE.println(gaps[i].cells * cellSize * cellSize);
+  }
+}
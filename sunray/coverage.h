@@ -0,0 +1,72 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  mowed area coverage raster
+
+  bitmap over the perimeter bounding box (one bit per cell), updated from the robot position while the mowing
+  motor is on (GPS fix only). A second bitmap marks the cells that should be mowed (inside perimeter, outside exclusions).
+  bit order: cell index i = row * cols + col, bit (i % 8) of byte (i / 8)
+*/
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <Arduino.h>
+#include "map.h"
+
+#define COVERAGE_MAX_GAPS 20
+
+
+// uncovered area found after mowing
+class CoverageGap
+{
+  public:
+    Point center;
+    short cells;  // number of uncovered cells
+};
+
+
+class CoverageMap
+{
+  public:
+    float minX;       // raster origin (m)
+    float minY;
+    float cellSize;   // cell size (m)
+    int cols;
+    int rows;
+    int rasterBytes;  // size of each bitmap (bytes)
+    byte *covered;    // mowed cells
+    byte *mowable;    // cells inside perimeter (outside exclusions)
+    long mowableCells;
+    long coveredCells;
+    CoverageGap gaps[COVERAGE_MAX_GAPS];  // largest gaps first
+    int gapsCount;
+    CoverageMap();
+    // allocate raster for current map
+    void begin();
+    // new mowing session (clear mowed cells)
+    void clear();
+    // robot position while mowing - O(1) per call
+    void update(float x, float y);
+    // robot position not valid (e.g. GPS float) - do not connect next position with last position
+    void resetTrack();
+    int percentCovered();
+    // find uncovered gaps (largest first) - returns number of gaps
+    int findGaps();
+    void dump();
+  protected:
+    bool hasLastPos;
+    float lastX;
+    float lastY;
+    void free();
+    void stamp(float x, float y);
+    void fillPolygon(Polygon &poly, bool value);
+    bool getBit(byte *bitmap, long idx);
+    void setBit(byte *bitmap, long idx, bool value);
+};
+
+
+#endif
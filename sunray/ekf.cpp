@@ -0,0 +1,194 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "ekf.h"
+#include "helper.h"
+
+// process noise
+#define EKF_Q_POS    0.0025   // position (m^2 per m driven) - wheel slip
+#define EKF_Q_YAW    0.0001   // heading (rad^2/s)
+#define EKF_Q_V      1.0      // linear speed ((m/s)^2/s) - acceleration
+#define EKF_Q_W      10.0     // yaw rate ((rad/s)^2/s) - angular acceleration
+#define EKF_Q_BIAS   0.000001 // IMU yaw rate bias ((rad/s)^2/s)
+
+// measurement noise
+#define EKF_ODO_V_SIGMA   0.02   // odometry linear speed (m/s)
+#define EKF_GYRO_SIGMA    0.02   // IMU yaw rate (rad/s)
+#define EKF_RESET_YAW_SIGMA 0.5  // heading uncertainty after position reset (rad)
+
+
+PoseEKF::PoseEKF(){
+  reset(0, 0, 0);
+}
+
+void PoseEKF::reset(float x, float y, float yaw){
+  for (int i=0; i < EKF_N; i++){
+    s[i] = 0;
+    for (int j=0; j < EKF_N; j++) P[i][j] = 0;
+  }
+  s[EKF_X] = x;
+  s[EKF_Y] = y;
+  s[EKF_YAW] = yaw;
+  P[EKF_X][EKF_X] = 100;
+  P[EKF_Y][EKF_Y] = 100;
+  P[EKF_YAW][EKF_YAW] = PI * PI;
+  P[EKF_V][EKF_V] = 1;
+  P[EKF_W][EKF_W] = 1;
+  P[EKF_BIAS][EKF_BIAS] = 0.01;
+  gpsInnovation = 0;
+}
+
+void PoseEKF::predict(float dt){
+  float c = cos(s[EKF_YAW]);
+  float sn = sin(s[EKF_YAW]);
+  float v = s[EKF_V];
+  s[EKF_X] += v * c * dt;
+  s[EKF_Y] += v * sn * dt;
+  s[EKF_YAW] = scalePI(s[EKF_YAW] + s[EKF_W] * dt);
+  // P = F * P * F^T + Q  (F = identity plus the entries below - applied to rows, then to columns)
+  float fxYaw = -v * sn * dt;
+  float fxV = c * dt;
+  float fyYaw = v * c * dt;
+  float fyV = sn * dt;
+  for (int j=0; j < EKF_N; j++){
+    float px = P[EKF_X][j] + fxYaw * P[EKF_YAW][j] + fxV * P[EKF_V][j];
+    float py = P[EKF_Y][j] + fyYaw * P[EKF_YAW][j] + fyV * P[EKF_V][j];
+    P[EKF_YAW][j] += dt * P[EKF_W][j];
+    P[EKF_X][j] = px;
+    P[EKF_Y][j] = py;
+  }
+  for (int i=0; i < EKF_N; i++){
+    float px = P[i][EKF_X] + fxYaw * P[i][EKF_YAW] + fxV * P[i][EKF_V];
+    float py = P[i][EKF_Y] + fyYaw * P[i][EKF_YAW] + fyV * P[i][EKF_V];
+    P[i][EKF_YAW] += dt * P[i][EKF_W];
+    P[i][EKF_X] = px;
+    P[i][EKF_Y] = py;
+  }
+  P[EKF_X][EKF_X] += EKF_Q_POS * fabs(v) * dt;
+  P[EKF_Y][EKF_Y] += EKF_Q_POS * fabs(v) * dt;
+  P[EKF_YAW][EKF_YAW] += EKF_Q_YAW * dt;
+  P[EKF_V][EKF_V] += EKF_Q_V * dt;
+  P[EKF_W][EKF_W] += EKF_Q_W * dt;
+  P[EKF_BIAS][EKF_BIAS] += EKF_Q_BIAS * dt;
+}
+
+// scalar measurement z = H * s (variance r)
+void PoseEKF::updateScalar(const float H[EKF_N], float z, float r){
+  float PH[EKF_N];
+  float S = r;
+  float y = z;
+  for (int i=0; i < EKF_N; i++){
+    float sum = 0;
+    for (int j=0; j < EKF_N; j++) sum += P[i][j] * H[j];
+    PH[i] = sum;
+    S += H[i] * sum;
+    y -= H[i] * s[i];
+  }
+  // K = P * H^T / S,  P = P - K * S * K^T
+  for (int i=0; i < EKF_N; i++){
+    s[i] += PH[i] / S * y;
+    for (int j=0; j < EKF_N; j++) P[i][j] -= PH[i] * PH[j] / S;
+  }
+  s[EKF_YAW] = scalePI(s[EKF_YAW]);
+}
+
+void PoseEKF::updateOdometry(float v, float w, float wSigma){
+  float Hv[EKF_N] = { 0, 0, 0, 1, 0, 0 };
+  float Hw[EKF_N] = { 0, 0, 0, 0, 1, 0 };
+  updateScalar(Hv, v, EKF_ODO_V_SIGMA * EKF_ODO_V_SIGMA);
+  updateScalar(Hw, w, wSigma * wSigma);
+}
+
+void PoseEKF::updateGyro(float w){
+  // IMU measures yaw rate plus bias
+  float H[EKF_N] = { 0, 0, 0, 0, 1, 1 };
+  updateScalar(H, w, EKF_GYRO_SIGMA * EKF_GYRO_SIGMA);
+}
+
+// covariance update for a (non-optimal) position gain K (Joseph form):
+// P = (I - K*H) * P * (I - K*H)^T + K * R * K^T
+void PoseEKF::updateJoseph(float K[EKF_N][2], float r){
+  float A[EKF_N][EKF_N];
+  for (int i=0; i < EKF_N; i++){
+    for (int j=0; j < EKF_N; j++) A[i][j] = (i == j) ? 1 : 0;
+    A[i][EKF_X] -= K[i][0];
+    A[i][EKF_Y] -= K[i][1];
+  }
+  float AP[EKF_N][EKF_N];
+  for (int i=0; i < EKF_N; i++){
+    for (int j=0; j < EKF_N; j++){
+      float sum = 0;
+      for (int k=0; k < EKF_N; k++) sum += A[i][k] * P[k][j];
+      AP[i][j] = sum;
+    }
+  }
+  for (int i=0; i < EKF_N; i++){
+    for (int j=i; j < EKF_N; j++){
+      float sum = r * (K[i][0] * K[j][0] + K[i][1] * K[j][1]);
+      for (int k=0; k < EKF_N; k++) sum += AP[i][k] * A[j][k];
+      P[i][j] = sum;
+      P[j][i] = sum;
+    }
+  }
+}
+
+bool PoseEKF::updatePosition(float x, float y, float sigma, float gate, bool estimateYaw){
+  float r = sigma * sigma;
+  float S00 = P[EKF_X][EKF_X] + r;
+  float S01 = P[EKF_X][EKF_Y];
+  float S11 = P[EKF_Y][EKF_Y] + r;
+  float det = S00 * S11 - S01 * S01;
+  if (det <= 0) return false;
+  float I00 = S11 / det;
+  float I01 = -S01 / det;
+  float I11 = S00 / det;
+  float dx = x - s[EKF_X];
+  float dy = y - s[EKF_Y];
+  // innovation gate (squared Mahalanobis distance)
+  gpsInnovation = dx * (I00 * dx + I01 * dy) + dy * (I01 * dx + I11 * dy);
+  if (gpsInnovation > gate) return false;
+  // K = P * H^T * S^-1  (H selects x and y)
+  float K[EKF_N][2];
+  float Px[EKF_N];
+  float Py[EKF_N];
+  for (int i=0; i < EKF_N; i++){
+    Px[i] = P[EKF_X][i];
+    Py[i] = P[EKF_Y][i];
+    K[i][0] = Px[i] * I00 + Py[i] * I01;
+    K[i][1] = Px[i] * I01 + Py[i] * I11;
+  }
+  if (estimateYaw){
+    // P = P - K * H * P
+    for (int i=0; i < EKF_N; i++){
+      for (int j=i; j < EKF_N; j++){
+        P[i][j] -= K[i][0] * Px[j] + K[i][1] * Py[j];
+        P[j][i] = P[i][j];
+      }
+    }
+  } else {
+    // position only: reduced gain (heading, speeds and bias not corrected)
+    for (int i=EKF_YAW; i < EKF_N; i++){
+      K[i][0] = 0;
+      K[i][1] = 0;
+    }
+    updateJoseph(K, r);
+  }
+  for (int i=0; i < EKF_N; i++) s[i] += K[i][0] * dx + K[i][1] * dy;
+  s[EKF_YAW] = scalePI(s[EKF_YAW]);
+  return true;
+}
+
+void PoseEKF::resetPosition(float x, float y, float sigma){
+  s[EKF_X] = x;
+  s[EKF_Y] = y;
+  for (int i=0; i < EKF_N; i++){
+    P[EKF_X][i] = P[i][EKF_X] = 0;
+    P[EKF_Y][i] = P[i][EKF_Y] = 0;
+  }
+  P[EKF_X][EKF_X] = sigma * sigma;
+  P[EKF_Y][EKF_Y] = sigma * sigma;
+  float yawVar = EKF_RESET_YAW_SIGMA * EKF_RESET_YAW_SIGMA;
+  if (P[EKF_YAW][EKF_YAW] < yawVar) P[EKF_YAW][EKF_YAW] = yawVar;
+}
@@ -0,0 +1,61 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#ifndef EKF_H
+#define EKF_H
+
+#include <Arduino.h>
+
+/*
+  extended Kalman filter for the robot pose (fixed size, no heap)
+
+  state: position-east x (m), position-north y (m), heading yaw (rad), linear speed v (m/s),
+         yaw rate w (rad/s), IMU yaw rate bias (rad/s)
+  motion model: x += v*cos(yaw)*dt, y += v*sin(yaw)*dt, yaw += w*dt (speeds and bias: random walk)
+  measurements: odometry (v, w), IMU yaw rate (w + bias), GPS position (x, y)
+*/
+
+#define EKF_N 6
+
+#define EKF_ODO_W_SIGMA      0.05   // odometry yaw rate noise (rad/s) without IMU
+#define EKF_ODO_W_SIGMA_IMU  1.0    // odometry yaw rate noise (rad/s) with IMU (wheel slip - IMU yaw rate is preferred)
+
+enum {
+  EKF_X,
+  EKF_Y,
+  EKF_YAW,
+  EKF_V,
+  EKF_W,
+  EKF_BIAS,
+};
+
+
+class PoseEKF
+{
+  public:
+    float s[EKF_N];          // state
+    float P[EKF_N][EKF_N];   // state covariance
+    float gpsInnovation;     // normalized squared innovation (Mahalanobis distance) of last GPS position
+    PoseEKF();
+    // start with unknown pose
+    void reset(float x, float y, float yaw);
+    // move state forward by dt (s)
+    void predict(float dt);
+    // wheel odometry speeds (m/s, rad/s), wSigma: yaw rate noise (rad/s)
+    void updateOdometry(float v, float w, float wSigma);
+    // IMU yaw rate (rad/s)
+    void updateGyro(float w);
+    // GPS position (m) with standard deviation sigma (m) - returns false if rejected by innovation gate
+    // estimateYaw=false: correct position only (heading, speeds and bias are not changed)
+    bool updatePosition(float x, float y, float sigma, float gate, bool estimateYaw);
+    // set position (e.g. after GPS jump), heading becomes unknown
+    void resetPosition(float x, float y, float sigma);
+  protected:
+    void updateScalar(const float H[EKF_N], float z, float r);
+    void updateJoseph(float K[EKF_N][2], float r);
+};
+
+
+#endif
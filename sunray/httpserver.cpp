@@ -18,12 +18,11 @@
 #endif
 #include "RingBuffer.h"
 #include "timetable.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "relayclient.h"
 
 
-// wifi client
-WiFiEspClient wifiClient;
-unsigned long nextWifiClientCheckTime = 0;
-
 // use a ring buffer to increase speed and reduce memory allocation
 ERingBuffer buf(8);
 int reqCount = 0;                // number of requests received
@@ -34,67 +33,17 @@ unsigned long stopClientTime = 0;
 // process WIFI input (relay client)
 // a relay server allows to access the robot via the Internet by transferring data from app to robot and vice versa
 // client (app) --->  relay server  <--- client (robot)
+// all network I/O is done by relayClient (non-blocking), here we only exchange commands and responses
 void processWifiRelayClient(){
+  LATENCY_SCOPE(LAT_RELAY);
   if (!wifiFound) return;
   if (!ENABLE_RELAY) return;
-  if (!wifiClient.connected() || (wifiClient.available() == 0)){
-    if (millis() > nextWifiClientCheckTime){   
-      wifiClient.stop();
-      CONSOLE.println("WIF: connecting..." RELAY_HOST);    
-      if (!wifiClient.connect(RELAY_HOST, RELAY_PORT)) {
-        CONSOLE.println("WIF: connection failed");
-        nextWifiClientCheckTime = millis() + 10000;
-        return;
-      }
-      CONSOLE.println("WIF: connected!");   
-      String s = "GET / HTTP/1.1\r\n";
-      s += "Host: " RELAY_USER "." RELAY_MACHINE "." RELAY_HOST ":";        
-      s += String(RELAY_PORT) + "\r\n";
-      s += "Content-Length: 0\r\n";
-      s += "\r\n\r\n";
-      wifiClient.print(s);
-    } else return;
-  }
-  nextWifiClientCheckTime = millis() + 10000;     
-  
-  buf.init();                               // initialize the circular buffer   
-  unsigned long timeout = millis() + 500;
-    
-  while (millis() < timeout) {              // loop while the client's connected    
-    if (wifiClient.available()) {               // if there's bytes to read from the client,        
-      char c = wifiClient.read();               // read a byte, then
-      timeout = millis() + 200;
-      buf.push(c);                          // push it to the ring buffer
-      // you got two newline characters in a row
-      // that's the end of the HTTP request, so send a response
-      if (buf.endsWith("\r\n\r\n")) {
-        cmd = "";
-        while ((wifiClient.connected()) && (wifiClient.available()) && (millis() < timeout)) {
-          char ch = wifiClient.read();
-          timeout = millis() + 200;
-          cmd = cmd + ch;
-          gps.run();
-        }
-        CONSOLE.print("WIF:");
-        CONSOLE.println(cmd);
-        if (wifiClient.connected()) {
-          processCmd(true,true);
-          String s = "HTTP/1.1 200 OK\r\n";
-            s += "Host: " RELAY_USER "." RELAY_MACHINE "." RELAY_HOST ":";        
-            s += String(RELAY_PORT) + "\r\n";
-            s += "Access-Control-Allow-Origin: *\r\n";              
-            s += "Content-Type: text/html\r\n";              
-            s += "Connection: close\r\n";  // the connection will be closed after completion of the response
-            // "Refresh: 1\r\n"        // refresh the page automatically every 20 sec                                    
-            s += "Content-length: ";
-            s += String(cmdResponse.length());
-            s += "\r\n\r\n";  
-            s += cmdResponse;                      
-            wifiClient.print(s);                                   
-        }
-        break;
-      }
-    }
+  relayClient.run();
+  if (relayClient.receive(cmd)){
+    CONSOLE.print("WIF:");
+    CONSOLE.println(cmd);
+    processCmd(true,true);
+    relayClient.respond(cmdResponse);
   }
 }
 
@@ -104,6 +53,7 @@ void processWifiRelayClient(){
 // client (app) --->  server (robot)
 void processWifiAppServer()
 {
+  LATENCY_SCOPE(LAT_APP_SERVER);
   if (!wifiFound) return;
   if (!ENABLE_SERVER) return;
   // listen for incoming clients    
@@ -129,12 +79,15 @@ void processWifiAppServer()
     #endif
     battery.resetIdle();
     buf.init();                               // initialize the circular buffer
+    char request[32];                         // start of request line (method and path)
+    int requestLen = 0;
     unsigned long timeout = millis() + 50;
     while ( (client.connected()) && (millis() < timeout) ) {              // loop while the client's connected
       if (client.available()) {               // if there's bytes to read from the client,        
         char c = client.read();               // read a byte, then
         timeout = millis() + 50;
         buf.push(c);                          // push it to the ring buffer
+        if (requestLen < (int)sizeof(request) - 1) request[requestLen++] = c;
         // you got two newline characters in a row
         // that's the end of the HTTP request, so send a response
         if (buf.endsWith("\r\n\r\n")) {
@@ -149,19 +102,59 @@ void processWifiAppServer()
             CONSOLE.print("WIF:");
             CONSOLE.println(cmd);
           #endif
-          if (client.connected()) {
-            processCmd(true,true);
+          request[requestLen] = 0;
+          #ifdef __linux__
+            if ((client.connected()) && (strncmp(request, "GET /events", 11) == 0)) {
+              // telemetry stream: connection is taken over by telemetry (not closed here)
+              const char *rate = strstr(request, "rate=");
+              if (telemetry.subscribe(client, (rate != NULL) ? atoi(rate + 5) : 5)){
+                client = WiFiEspClient();
+                return;
+              }
+            }
+          #endif
+          if ((client.connected()) && (strncmp(request, "GET /latency", 12) == 0)) {
+            // latency histograms (JSON)
+            String json;
+            latenciesToJson(json);
             client.print(
               "HTTP/1.1 200 OK\r\n"
-              "Access-Control-Allow-Origin: *\r\n"              
-              "Content-Type: text/html\r\n"              
-              "Connection: close\r\n"  // the connection will be closed after completion of the response
-              // "Refresh: 1\r\n"        // refresh the page automatically every 20 sec                        
+              "Access-Control-Allow-Origin: *\r\n"
+              "Content-Type: application/json\r\n"
+              "Connection: close\r\n"
               );
             client.print("Content-length: ");
-            client.print(cmdResponse.length());
-            client.print("\r\n\r\n");                        
-            client.print(cmdResponse);                                   
+            client.print(json.length());
+            client.print("\r\n\r\n");
+            client.print(json);
+          } else if (client.connected()) {
+            processCmd(true,true);
+            if (cmdResponseCoverageRaster){
+              // coverage raster: response line followed by binary raster
+              client.print(
+                "HTTP/1.1 200 OK\r\n"
+                "Access-Control-Allow-Origin: *\r\n"              
+                "Content-Type: application/octet-stream\r\n"              
+                "Connection: close\r\n"
+                );
+              client.print("Content-length: ");
+              client.print(cmdResponse.length() + coverage.rasterBytes);
+              client.print("\r\n\r\n");                        
+              client.print(cmdResponse);
+              client.write(coverage.covered, coverage.rasterBytes);
+            } else {
+              client.print(
+                "HTTP/1.1 200 OK\r\n"
+                "Access-Control-Allow-Origin: *\r\n"              
+                "Content-Type: text/html\r\n"              
+                "Connection: close\r\n"  // the connection will be closed after completion of the response
+                // "Refresh: 1\r\n"        // refresh the page automatically every 20 sec                        
+                );
+              client.print("Content-length: ");
+              client.print(cmdResponse.length());
+              client.print("\r\n\r\n");                        
+              client.print(cmdResponse);                                   
+            }
           }
           break;
         }
@@ -138,7 +138,7 @@ int I2CreadFrom(uint8_t device, uint8_t address, uint8_t num, uint8_t buff[], in
     i=0;
     Wire.beginTransmission(device); //start transmission to device 
     Wire.write(address);        //sends address to read from
-    Wire.endTransmission(); //end transmission
+    Wire.endTransmission(false); //repeated start (register write and read in one transaction)
   
     //Wire.beginTransmission(device); //start transmission to device (initiate again)
     Wire.requestFrom(device, num);    // request 6 bytes from device
@@ -0,0 +1,341 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "i2cworker.h"
+#include "ioboard.h"
+#include "logger.h"
+#include "config.h"
+#include <Wire.h>
+
+
+I2cWorker i2cWorker;
+
+
+I2cWorker::I2cWorker(){
+  started = false;
+  imuWaiting = 0;
+  portCount = 0;
+  adcCount = 0;
+  adcActive = -1;
+  adcReadTime = 0;
+  clearStats();
+}
+
+void I2cWorker::clearStats(){
+  jobs = 0;
+  writes = 0;
+  coalesced = 0;
+  errors = 0;
+  maxJobTime = 0;
+  maxImuWait = 0;
+}
+
+void I2cWorker::begin(){
+  #ifdef __linux__
+    if (started) return;
+    started = true;
+    pthread_t t = thread_create(workerThread, this);
+    if (t == 0){
+      started = false;
+      CONSOLE.println("ERROR: I2C worker thread");
+      return;
+    }
+    thread_set_name(t, "sunray-i2c");
+    CONSOLE.println("I2C worker started");
+  #endif
+}
+
+#ifdef __linux__
+void *I2cWorker::workerThread(void *arg){
+  I2cWorker *worker = (I2cWorker*)arg;
+  while (true){
+    if (!worker->runJob()) delay(2);
+  }
+  return NULL;
+}
+#endif
+
+// --- locking ----------------------------------------------------------------------
+
+void I2cWorker::lock(){
+  #ifdef __linux__
+    if (!started) return;
+    unsigned long startTime = micros();
+    __atomic_add_fetch(&imuWaiting, 1, __ATOMIC_SEQ_CST);
+    thread_lock(I2C_BUS_LOCK);
+    __atomic_sub_fetch(&imuWaiting, 1, __ATOMIC_SEQ_CST);
+    unsigned long wait = micros() - startTime;
+    if (wait > maxImuWait) maxImuWait = wait;
+  #endif
+}
+
+void I2cWorker::unlock(){
+  #ifdef __linux__
+    if (started) thread_unlock(I2C_BUS_LOCK);
+  #endif
+}
+
+// worker side: a waiting IMU access goes first
+void I2cWorker::lockBus(){
+  #ifdef __linux__
+    if (!started) return;
+    while (imuWaiting > 0) delay(1);
+    thread_lock(I2C_BUS_LOCK);
+  #endif
+}
+
+void I2cWorker::unlockBus(){
+  #ifdef __linux__
+    if (started) thread_unlock(I2C_BUS_LOCK);
+  #endif
+}
+
+void I2cWorker::lockCache(){
+  #ifdef __linux__
+    thread_lock(I2C_CACHE_LOCK);
+  #endif
+}
+
+void I2cWorker::unlockCache(){
+  #ifdef __linux__
+    thread_unlock(I2C_CACHE_LOCK);
+  #endif
+}
+
+// --- expander shadow registers ----------------------------------------------------
+
+// updates shadow registers (cache lock held), returns port index (-1: no free port)
+int I2cWorker::shadowPin(uint8_t addr, uint8_t port, uint8_t pin, bool level, I2cPriority prio){
+  int idx = 0;
+  while ((idx < portCount) && ((ports[idx].addr != addr) || (ports[idx].port != port))) idx++;
+  if (idx == portCount){
+    if (portCount == I2C_MAX_PORTS) return -1;
+    I2cExpanderPort &p = ports[portCount++];
+    memset(&p, 0, sizeof(p));
+    p.addr = addr;
+    p.port = port;
+    p.prio = prio;
+  }
+  I2cExpanderPort &p = ports[idx];
+  uint8_t mask = (1 << pin);
+  uint8_t wantOut = level ? (p.wantOut | mask) : (p.wantOut & ~mask);
+  // request repeats the last requested level (LED/fan states set every loop)
+  if ((p.mask & mask) && (wantOut == p.wantOut)) coalesced++;
+  p.mask |= mask;
+  p.wantOut = wantOut;
+  bool changed = (!p.known) || (((p.out ^ p.wantOut) & p.mask) != 0) || ((p.cfg & p.mask) != 0);
+  if (changed){
+    if ((!p.dirty) || (prio < p.prio)) p.prio = prio;
+    p.dirty = true;
+  }
+  return idx;
+}
+
+// register read/write of port (PCA9555), each a single bus transaction
+bool I2cWorker::readReg(uint8_t addr, uint8_t reg, uint8_t &value){
+  lockBus();
+  bool ok = (Wire.writeRead(addr, &reg, 1, &value, 1) == 0);
+  unlockBus();
+  return ok;
+}
+
+bool I2cWorker::writeReg(uint8_t addr, uint8_t reg, uint8_t value){
+  lockBus();
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  Wire.write(value);
+  bool ok = (Wire.endTransmission() == 0);
+  unlockBus();
+  return ok;
+}
+
+// writes changed registers of port (output register 2+port, configuration register 6+port),
+// the bus is released between the transactions
+bool I2cWorker::writePort(I2cExpanderPort &p){
+  if (!p.known){
+    if (!readReg(p.addr, 2 + p.port, p.out)) return false;
+    if (!readReg(p.addr, 6 + p.port, p.cfg)) return false;
+    p.known = true;
+  }
+  uint8_t out = (p.out & ~p.mask) | (p.wantOut & p.mask);
+  uint8_t cfg = p.cfg & ~p.mask;   // our pins are outputs
+  if (out != p.out){
+    if (!writeReg(p.addr, 2 + p.port, out)) return false;
+    p.out = out;
+    writes++;
+  }
+  if (cfg != p.cfg){
+    if (!writeReg(p.addr, 6 + p.port, cfg)) return false;
+    p.cfg = cfg;
+    writes++;
+  }
+  return true;
+}
+
+// writes shadow registers of port to device (no lock held by caller)
+bool I2cWorker::flushPort(int idx){
+  lockCache();
+  I2cExpanderPort p = ports[idx];
+  ports[idx].dirty = false;
+  unlockCache();
+  bool ok = writePort(p);
+  lockCache();
+  I2cExpanderPort &s = ports[idx];
+  s.out = p.out;
+  s.cfg = p.cfg;
+  s.known = p.known;
+  s.failed = !ok;
+  // requests during the write
+  if ((ok) && ((((s.out ^ s.wantOut) & s.mask) != 0) || ((s.cfg & s.mask) != 0))) s.dirty = true;
+  unlockCache();
+  if (!ok){
+    errors++;
+    LOG_RATE(LOG_WARN, 10000, "WARN: I2C expander 0x%x port %d write failed", p.addr, p.port);
+  }
+  return ok;
+}
+
+bool I2cWorker::expanderOut(uint8_t addr, uint8_t port, uint8_t pin, bool level, I2cPriority prio){
+  lockCache();
+  int idx = shadowPin(addr, port, pin, level, prio);
+  bool failed = (idx >= 0) ? ports[idx].failed : true;
+  bool dirty = (idx >= 0) ? ports[idx].dirty : false;
+  unlockCache();
+  if (idx < 0) return false;
+  if (started) return !failed;   // written by worker
+  if (!dirty) return !failed;
+  return flushPort(idx);
+}
+
+// --- ADC ----------------------------------------------------------------------------
+
+bool I2cWorker::adcSchedule(uint8_t channel, unsigned long interval){
+  lockCache();
+  bool ok = false;
+  if (adcCount < I2C_MAX_ADC){
+    I2cAdcChannel &adc = adcs[adcCount];
+    memset(&adc, 0, sizeof(adc));
+    adc.channel = channel;
+    adc.interval = interval;
+    adc.nextTime = millis();
+    adcCount++;
+    ok = true;
+  }
+  unlockCache();
+  return ok;
+}
+
+bool I2cWorker::adcValue(uint8_t channel, I2cValue &val){
+  bool found = false;
+  lockCache();
+  for (int i=0; i < adcCount; i++){
+    if (adcs[i].channel != channel) continue;
+    val = adcs[i].val;
+    found = (val.version != 0);
+    break;
+  }
+  unlockCache();
+  return found;
+}
+
+// select ADC mux (DG408) channel and trigger conversion (MCP3421)
+bool I2cWorker::adcStart(uint8_t channel){
+  int idx = channel - 1;
+  lockCache();
+  shadowPin(EX1_I2C_ADDR, EX1_ADC_MUX_A0_PORT, EX1_ADC_MUX_A0_PIN, (idx & 1) != 0, I2C_PRIO_ADC);
+  shadowPin(EX1_I2C_ADDR, EX1_ADC_MUX_A1_PORT, EX1_ADC_MUX_A1_PIN, (idx & 2) != 0, I2C_PRIO_ADC);
+  shadowPin(EX1_I2C_ADDR, EX1_ADC_MUX_A2_PORT, EX1_ADC_MUX_A2_PIN, (idx & 4) != 0, I2C_PRIO_ADC);
+  int port = shadowPin(EX1_I2C_ADDR, EX1_ADC_MUX_EN_PORT, EX1_ADC_MUX_EN_PIN, true, I2C_PRIO_ADC);
+  bool dirty = (port >= 0) && (ports[port].dirty);
+  unlockCache();
+  if (port < 0) return false;
+  if ((dirty) && (!flushPort(port))) return false;
+  lockBus();
+  bool ok = ioAdcTrigger(ADC_I2C_ADDR);
+  unlockBus();
+  return ok;
+}
+
+// read conversion result (value < 0: error)
+float I2cWorker::adcRead(){
+  lockBus();
+  float v = ioAdc(ADC_I2C_ADDR);
+  unlockBus();
+  if (v < 0){
+    errors++;
+    lockBus();
+    ioAdcStart(ADC_I2C_ADDR, false, true);  // reset ADC
+    unlockBus();
+  }
+  return v;
+}
+
+float I2cWorker::adcMeasure(uint8_t channel){
+  if (!adcStart(channel)) return -1;
+  delay(I2C_ADC_CONVERSION_TIME);
+  return adcRead();
+}
+
+// --- worker -------------------------------------------------------------------------
+
+// executes the most important pending job, returns false if there was nothing to do
+bool I2cWorker::runJob(){
+  unsigned long now = millis();
+  int port = -1;
+  int prio = 255;
+  int adc = -1;
+  bool adcFinish = false;
+  lockCache();
+  for (int i=0; i < portCount; i++){
+    if ((ports[i].dirty) && (ports[i].prio < prio)){
+      port = i;
+      prio = ports[i].prio;
+    }
+  }
+  if (prio > I2C_PRIO_ADC){
+    if (adcActive >= 0){
+      if ((long)(now - adcReadTime) >= 0){
+        adc = adcActive;
+        adcFinish = true;
+      }
+    } else {
+      for (int i=0; i < adcCount; i++){
+        if ((long)(now - adcs[i].nextTime) >= 0){
+          adc = i;
+          break;
+        }
+      }
+    }
+  }
+  unlockCache();
+  if ((port < 0) && (adc < 0)) return false;
+  unsigned long startTime = micros();
+  if (adc >= 0){
+    I2cAdcChannel &ch = adcs[adc];
+    if (!adcFinish){
+      ch.nextTime = now + ch.interval;
+      if (adcStart(ch.channel)){
+        adcActive = adc;
+        adcReadTime = millis() + I2C_ADC_CONVERSION_TIME;
+      } else {
+        errors++;
+      }
+    } else {
+      adcActive = -1;
+      float v = adcRead();
+      lockCache();
+      ch.val.value = v;
+      ch.val.time = millis();
+      ch.val.version++;
+      unlockCache();
+    }
+  } else {
+    flushPort(port);
+  }
+  jobs++;
+  unsigned long duration = micros() - startTime;
+  if (duration > maxJobTime) maxJobTime = duration;
+  return true;
+}
@@ -0,0 +1,125 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  I2C bus worker for the slow I/O board peripherals (Alfred): port expanders (PCA9555) and ADC (MCP3421)
+
+  once started (Linux), a worker thread owns these devices and executes their transactions by priority
+  (buzzer, power, ADC, LEDs), so a slow or NAKing device never stalls the control loop:
+  - expander outputs are written into shadow registers, the worker only writes ports whose value changed
+    (unchanged LED/fan states are coalesced)
+  - ADC channels are measured periodically (mux, trigger, conversion wait, read), results are published
+    into a versioned latest-value cache that drivers read without blocking
+  the IMU (read by the control loop) has the highest priority: the worker takes the bus for each single transaction
+  (register read or write, ADC trigger or read) and releases it in between, a waiting IMU access goes first
+  (lock/unlock around IMU access, the IMU hang detection starts timing after lock).
+  before begin() (and without threads) all requests are executed immediately by the caller.
+*/
+
+#ifndef I2C_WORKER_H
+#define I2C_WORKER_H
+
+#include <Arduino.h>
+
+#define I2C_BUS_LOCK      1      // thread_lock index for Wire (Linux)
+#define I2C_CACHE_LOCK    2      // thread_lock index for shadow registers and value cache (Linux)
+#define I2C_MAX_PORTS     8      // shadowed expander ports
+#define I2C_MAX_ADC       8      // scheduled ADC channels
+#define I2C_ADC_CONVERSION_TIME  5   // ms (MCP3421, 12 bit)
+
+enum I2cPriority {
+  I2C_PRIO_BUZZER,
+  I2C_PRIO_POWER,
+  I2C_PRIO_ADC,
+  I2C_PRIO_LED,
+};
+
+// latest-value cache entry
+class I2cValue {
+  public:
+    float value;
+    unsigned long version;   // incremented with each measurement (0: no measurement yet)
+    unsigned long time;      // measurement time (millis)
+};
+
+// expander port (PCA9555) shadow registers
+class I2cExpanderPort {
+  public:
+    uint8_t addr;
+    uint8_t port;
+    uint8_t prio;       // of pending write
+    uint8_t mask;       // pins set by us (outputs)
+    uint8_t wantOut;    // requested levels
+    uint8_t out;        // output register on device
+    uint8_t cfg;        // configuration register on device (0: output)
+    bool known;         // registers read from device
+    bool dirty;         // want != written
+    bool failed;        // last transaction failed
+};
+
+class I2cAdcChannel {
+  public:
+    uint8_t channel;
+    unsigned long interval;
+    unsigned long nextTime;
+    I2cValue val;
+};
+
+
+class I2cWorker
+{
+  public:
+    // statistics
+    unsigned long jobs;          // executed jobs
+    unsigned long writes;        // expander port writes
+    unsigned long coalesced;     // expander requests without change
+    unsigned long errors;        // failed jobs
+    unsigned long maxJobTime;    // us
+    unsigned long maxImuWait;    // us
+    I2cWorker();
+    // starts worker thread (Linux)
+    void begin();
+    bool running(){ return started; }
+    // bus access of other users (IMU): waits for running transaction, then has priority
+    void lock();
+    void unlock();
+    // set expander (PCA9555) pin as output with level, returns false if the last transaction of that port failed
+    bool expanderOut(uint8_t addr, uint8_t port, uint8_t pin, bool level, I2cPriority prio);
+    // measure ADC (DG408 mux channel 1-8) every interval (ms)
+    bool adcSchedule(uint8_t channel, unsigned long interval);
+    // latest measurement of scheduled ADC channel (value < 0: read error)
+    bool adcValue(uint8_t channel, I2cValue &val);
+    // immediate ADC measurement (before begin)
+    float adcMeasure(uint8_t channel);
+    void clearStats();
+  protected:
+    bool started;
+    volatile int imuWaiting;
+    I2cExpanderPort ports[I2C_MAX_PORTS];
+    int portCount;
+    I2cAdcChannel adcs[I2C_MAX_ADC];
+    int adcCount;
+    int adcActive;                 // channel index with conversion in progress (-1: none)
+    unsigned long adcReadTime;     // conversion complete
+    #ifdef __linux__
+      static void *workerThread(void *arg);
+    #endif
+    void lockBus();
+    void unlockBus();
+    void lockCache();
+    void unlockCache();
+    int shadowPin(uint8_t addr, uint8_t port, uint8_t pin, bool level, I2cPriority prio);
+    bool readReg(uint8_t addr, uint8_t reg, uint8_t &value);
+    bool writeReg(uint8_t addr, uint8_t reg, uint8_t value);
+    bool writePort(I2cExpanderPort &p);
+    bool flushPort(int idx);
+    bool adcStart(uint8_t channel);
+    float adcRead();
+    bool runJob();
+};
+
+extern I2cWorker i2cWorker;
+
+#endif
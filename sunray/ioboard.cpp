@@ -28,7 +28,7 @@ bool ioExpanderOut(uint8_t addr, uint8_t port, uint8_t pin, bool level){
   byte mask = (1 << pin);
   Wire.beginTransmission(addr); // PCA9555 address 
   Wire.write(6+port);    // configuration port    
-  if (Wire.endTransmission() != 0) return false;
+  Wire.endTransmission(false);  // repeated start (write is sent and checked by requestFrom)
   if (Wire.requestFrom(addr, (uint8_t)1) != 1) return false;  
   uint8_t state = Wire.read();   // get current configuration port
 
@@ -39,7 +39,7 @@ bool ioExpanderOut(uint8_t addr, uint8_t port, uint8_t pin, bool level){
   
   Wire.beginTransmission(addr); // PCA9555 address 
   Wire.write(2+port);    // output port    
-  if (Wire.endTransmission() != 0) return false;
+  Wire.endTransmission(false);  // repeated start (write is sent and checked by requestFrom)
   if (Wire.requestFrom(addr, (uint8_t)1) != 1) return false;  
   state = Wire.read();   // get current output port
 
@@ -61,7 +61,7 @@ bool ioExpanderIn(uint8_t addr, uint8_t port, uint8_t pin){
   byte mask = (1 << pin);
   Wire.beginTransmission(addr); // PCA9555 address 
   Wire.write(6+port);    // configuration port    
-  if (Wire.endTransmission() != 0) return false;
+  Wire.endTransmission(false);  // repeated start (write is sent and checked by requestFrom)
   if (Wire.requestFrom(addr, (uint8_t)1) != 1) return false;  
   uint8_t state = Wire.read();   // get current configuration port
 
@@ -72,7 +72,7 @@ bool ioExpanderIn(uint8_t addr, uint8_t port, uint8_t pin){
 
   Wire.beginTransmission(addr); // PCA9555 address 
   Wire.write(0+port);    // input port    
-  if (Wire.endTransmission() != 0) return false;
+  Wire.endTransmission(false);  // repeated start (write is sent and checked by requestFrom)
   if (Wire.requestFrom(addr, (uint8_t)1) != 1) return false;  
   state = Wire.read();   // get current output port
   return ((state & mask) != 0); 
@@ -172,7 +172,7 @@ byte ioEepromReadByte( uint8_t addr, unsigned int eeaddress ) {
   Wire.beginTransmission(addr);
   Wire.write((int)(eeaddress >> 8)); // MSB
   Wire.write((int)(eeaddress & 0xFF)); // LSB
-  if (Wire.endTransmission() != 0) return rdata;
+  Wire.endTransmission(false);  // repeated start (write is sent and checked by requestFrom)
   if (Wire.requestFrom(addr,(uint8_t)1) != 1) return rdata;
   if (Wire.available()) rdata = Wire.read();
   return rdata;
@@ -0,0 +1,118 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "latency.h"
+
+
+LatencyHistogram latencies[LAT_COUNT];
+
+const char *latencyNames[LAT_COUNT] = {
+  "loop",
+  "sensors",
+  "imu",
+  "gps",
+  "control",
+  "state",
+  "findPath",
+  "ntrip",
+  "console",
+  "appServer",
+  "relay",
+  "mqtt",
+  "saveState",
+};
+
+
+void LatencyHistogram::clear(){
+  count = 0;
+  maxTime = 0;
+  for (int i=0; i < LATENCY_BUCKETS; i++) buckets[i] = 0;
+}
+
+void LatencyHistogram::add(unsigned long duration){
+  int idx = 0;
+  for (unsigned long d = duration; (d > 1) && (idx < LATENCY_BUCKETS-1); d >>= 1) idx++;
+  buckets[idx]++;
+  count++;
+  if (duration > maxTime) maxTime = duration;
+}
+
+unsigned long LatencyHistogram::percentile(int percent){
+  if (count == 0) return 0;
+  unsigned long limit = (count * percent + 99) / 100;
+  unsigned long sum = 0;
+  for (int i=0; i < LATENCY_BUCKETS-1; i++){
+    sum += buckets[i];
+    if (sum >= limit){
+      unsigned long upper = (2UL << i) - 1;
+      return (upper < maxTime) ? upper : maxTime;
+    }
+  }
+  return maxTime;
+}
+
+
+LatencyTimer::LatencyTimer(LatencyId id){
+  this->id = id;
+  startTime = micros();
+}
+
+LatencyTimer::~LatencyTimer(){
+  latencies[id].add(micros() - startTime);
+}
+
+
+void clearLatencies(){
+  for (int i=0; i < LAT_COUNT; i++) latencies[i].clear();
+}
+
+void latenciesToCsv(String &s){
+  for (int i=0; i < LAT_COUNT; i++){
+    LatencyHistogram &h = latencies[i];
+    int num = LATENCY_BUCKETS;
+    while ((num > 0) && (h.buckets[num-1] == 0)) num--;
+    s += ",";
+    s += latencyNames[i];
+    s += ",";
+    s += h.count;
+    s += ",";
+    s += h.maxTime;
+    s += ",";
+    s += h.percentile(50);
+    s += ",";
+    s += h.percentile(99);
+    s += ",";
+    s += num;
+    for (int j=0; j < num; j++){
+      s += ",";
+      s += h.buckets[j];
+    }
+  }
+}
+
+void latenciesToJson(String &s){
+  s += "{";
+  for (int i=0; i < LAT_COUNT; i++){
+    LatencyHistogram &h = latencies[i];
+    if (i > 0) s += ",";
+    s += "\"";
+    s += latencyNames[i];
+    s += "\":{\"count\":";
+    s += h.count;
+    s += ",\"max\":";
+    s += h.maxTime;
+    s += ",\"p50\":";
+    s += h.percentile(50);
+    s += ",\"p99\":";
+    s += h.percentile(99);
+    s += ",\"buckets\":[";
+    for (int j=0; j < LATENCY_BUCKETS; j++){
+      if (j > 0) s += ",";
+      s += h.buckets[j];
+    }
+    s += "]}";
+  }
+  s += "}";
+}
@@ -0,0 +1,75 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  per-subsystem latency histograms (fixed memory, no allocation)
+
+  a scoped timer (LATENCY_SCOPE) measures the execution time of a block with micros() and adds it to
+  a log-bucketed histogram: bucket 0 = 0..1 us, bucket i = 2^i .. 2^(i+1)-1 us, last bucket = everything above.
+  request via AT+S6, HTTP GET /latency (JSON) or MQTT (/latency/<name>/p99, /latency/<name>/max)
+*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+
+#define LATENCY_BUCKETS 21   // last bucket: >= 2^20 us (1 s)
+
+
+enum LatencyId {
+  LAT_LOOP,          // complete robot loop
+  LAT_SENSORS,       // drivers and sensors
+  LAT_IMU,           // readIMU
+  LAT_GPS,           // GPS receiver
+  LAT_CONTROL,       // control task
+  LAT_STATE,         // computeRobotState
+  LAT_FIND_PATH,     // path finder
+  LAT_NTRIP,         // NTRIP relay
+  LAT_CONSOLE,       // console and BLE commands
+  LAT_APP_SERVER,    // processWifiAppServer
+  LAT_RELAY,         // processWifiRelayClient
+  LAT_MQTT,          // processWifiMqttClient
+  LAT_SAVE_STATE,    // saveState
+  LAT_COUNT
+};
+
+
+class LatencyHistogram
+{
+  public:
+    unsigned long count;
+    unsigned long maxTime;   // us
+    unsigned long buckets[LATENCY_BUCKETS];
+    void clear();
+    void add(unsigned long duration);
+    // upper bound (us) of the bucket containing the given percentile (0..100)
+    unsigned long percentile(int percent);
+};
+
+
+// measures execution time of its scope
+class LatencyTimer
+{
+  public:
+    LatencyTimer(LatencyId id);
+    ~LatencyTimer();
+  protected:
+    LatencyId id;
+    unsigned long startTime;
+};
+
+#define LATENCY_SCOPE(ID) LatencyTimer latencyTimer(ID)
+
+extern LatencyHistogram latencies[LAT_COUNT];
+extern const char *latencyNames[LAT_COUNT];
+
+void clearLatencies();
+// name,count,max,p50,p99,number of buckets,buckets... (trailing empty buckets omitted)
+void latenciesToCsv(String &s);
+void latenciesToJson(String &s);
+
+
+#endif
@@ -0,0 +1,238 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "logger.h"
+#include "config.h"
+#if defined(ENABLE_SD_LOG)
+  #include "sdserial.h"
+#elif defined(ENABLE_UDP)
+  #include "udpserial.h"
+#endif
+
+#ifdef __linux__
+  #include <stdio.h>
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+#endif
+
+#ifndef LOG_LEVEL
+  #define LOG_LEVEL LOG_INFO
+#endif
+
+
+Logger logger;
+
+
+Logger::Logger(){
+  level = LOG_LEVEL;
+  #ifdef __linux__
+    for (unsigned i=0; i < LOG_QUEUE; i++) queue[i].seq.store(i);
+    enqueuePos.store(0);
+    dequeuePos = 0;
+  #endif
+  clearStats();
+}
+
+void Logger::clearStats(){
+  records = 0;
+  dropped = 0;
+  suppressed = 0;
+}
+
+void Logger::begin(){
+  #ifdef __linux__
+    char *env = getenv("SUNRAY_LOG_LEVEL");
+    if (env != NULL) level = atoi(env);
+    pthread_t t = thread_create(logThread, this);
+    if (t == 0){
+      CONSOLE.println("ERROR: logger thread");
+      return;
+    }
+    thread_set_name(t, "sunray-log");
+  #endif
+  CONSOLE.print("logger: level=");
+  CONSOLE.println(level);
+}
+
+
+#ifdef __linux__
+
+void *Logger::logThread(void *arg){
+  Logger *log = (Logger*)arg;
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 10);  // low priority (nice)
+  while (true){
+    if (!log->writeQueued()) delay(5);
+  }
+  return NULL;
+}
+
+// multi-producer queue (bounded, lock-free): each cell has a sequence number telling if it is free or filled
+LogRecord *Logger::claim(unsigned &pos){
+  pos = enqueuePos.load(std::memory_order_relaxed);
+  while (true){
+    LogRecord *rec = &queue[pos % LOG_QUEUE];
+    unsigned seq = rec->seq.load(std::memory_order_acquire);
+    int diff = (int)(seq - pos);
+    if (diff == 0){
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return rec;
+    } else if (diff < 0){
+      return NULL;  // full
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::commit(LogRecord *rec, unsigned pos){
+  count(records);
+  rec->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::writeQueued(){
+  int len = 0;
+  while (true){
+    LogRecord *rec = &queue[dequeuePos % LOG_QUEUE];
+    bool filled = (rec->seq.load(std::memory_order_acquire) == dequeuePos + 1);
+    if ((!filled) || (len > LOG_BLOCK_SIZE - LOG_LINE_SIZE)){
+      if (len == 0) return false;
+      CONSOLE.write((const uint8_t*)block, len);
+      fflush(stdout);
+      return true;
+    }
+    len += format(rec, block + len, LOG_BLOCK_SIZE - len);
+    rec->seq.store(dequeuePos + LOG_QUEUE, std::memory_order_release);
+    dequeuePos++;
+  }
+}
+
+#else
+
+LogRecord *Logger::claim(unsigned &pos){
+  pos = 0;
+  return &rec;
+}
+
+// no log thread: write immediately
+void Logger::commit(LogRecord *rec, unsigned pos){
+  count(records);
+  char line[LOG_LINE_SIZE];
+  int len = format(rec, line, sizeof(line));
+  CONSOLE.write((const uint8_t*)line, len);
+}
+
+bool Logger::writeQueued(){
+  return false;
+}
+
+#endif
+
+
+LogArg *Logger::nextArg(LogRecord *rec){
+  if (rec->argc >= LOG_MAX_ARGS) return NULL;
+  return &rec->args[rec->argc++];
+}
+
+void Logger::addArg(LogRecord *rec, long long v){
+  LogArg *arg = nextArg(rec);
+  if (arg == NULL) return;
+  arg->type = 'i';
+  arg->i = v;
+}
+
+void Logger::addArg(LogRecord *rec, unsigned long long v){
+  LogArg *arg = nextArg(rec);
+  if (arg == NULL) return;
+  arg->type = 'u';
+  arg->u = v;
+}
+
+void Logger::addArg(LogRecord *rec, double v){
+  LogArg *arg = nextArg(rec);
+  if (arg == NULL) return;
+  arg->type = 'f';
+  arg->f = v;
+}
+
+void Logger::addArg(LogRecord *rec, const char *v){
+  LogArg *arg = nextArg(rec);
+  if (arg == NULL) return;
+  arg->type = 's';
+  arg->s = rec->textLen;
+  if (v == NULL) v = "(null)";
+  // copy string (truncated if record text is full)
+  int len = strlen(v);
+  int space = LOG_TEXT_SIZE - 1 - rec->textLen;
+  if (len > space) len = space;
+  memcpy(rec->text + rec->textLen, v, len);
+  rec->textLen += len;
+  rec->text[rec->textLen++] = '\0';
+  if (rec->textLen >= LOG_TEXT_SIZE) rec->textLen = LOG_TEXT_SIZE - 1;
+}
+
+// printf style formatting of record: conversions are matched to the stored argument types
+// (length modifiers in the format are ignored)
+int Logger::format(const LogRecord *rec, char *out, int size){
+  int len = 0;
+  int argIdx = 0;
+  size -= 2;  // newline, terminator
+  const char *p = rec->fmt;
+  while ((*p) && (len < size)){
+    if (*p != '%'){
+      out[len++] = *p++;
+      continue;
+    }
+    p++;
+    if (*p == '%'){
+      out[len++] = *p++;
+      continue;
+    }
+    // %[flags][width][.precision][length]conversion
+    char spec[24];
+    int specLen = 0;
+    spec[specLen++] = '%';
+    while ((*p) && (strchr("-+ #0123456789.", *p)) && (specLen < 16)) spec[specLen++] = *p++;
+    while ((*p) && (strchr("hlLqjzt", *p))) p++;
+    char conv = *p;
+    if (conv == 0) break;
+    p++;
+    const LogArg *arg = (argIdx < rec->argc) ? &rec->args[argIdx++] : NULL;
+    int res = 0;
+    if (arg == NULL){
+      res = snprintf(out + len, size - len, "?");
+    } else if (strchr("fFeEgGaA", conv)){
+      spec[specLen++] = conv;
+      spec[specLen] = '\0';
+      double v = (arg->type == 'f') ? arg->f : (arg->type == 'i') ? (double)arg->i : (double)arg->u;
+      res = snprintf(out + len, size - len, spec, v);
+    } else if (conv == 's'){
+      spec[specLen++] = 's';
+      spec[specLen] = '\0';
+      if (arg->type == 's') res = snprintf(out + len, size - len, spec, rec->text + arg->s);
+        else res = snprintf(out + len, size - len, "?");
+    } else if (conv == 'c'){
+      spec[specLen++] = 'c';
+      spec[specLen] = '\0';
+      res = snprintf(out + len, size - len, spec, (int)arg->i);
+    } else {
+      // integer conversions (d, i, u, x, X, o)
+      spec[specLen++] = 'l';
+      spec[specLen++] = 'l';
+      spec[specLen++] = conv;
+      spec[specLen] = '\0';
+      long long v = (arg->type == 'f') ? (long long)arg->f : arg->i;
+      res = snprintf(out + len, size - len, spec, v);
+    }
+    if (res < 0) res = 0;
+    len += res;
+    if (len > size) len = size;
+  }
+  if ((rec->suppressed > 0) && (len < size)){
+    len += snprintf(out + len, size - len, " (%lu suppressed)", rec->suppressed);
+    if (len > size) len = size;
+  }
+  out[len++] = '\n';
+  out[len] = '\0';
+  return len;
+}
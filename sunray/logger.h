@@ -0,0 +1,170 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  console logger with levels and per call site rate limiting
+
+    LOG(LOG_WARN, "WARN: motor ticks reset");
+    LOG_RATE(LOG_DEBUG, 1000, "trackLine(): normal linear-> %.2f", linear);   // max. one record per second
+
+  the caller only copies format pointer and arguments (numbers, strings) into a record of a lock-free queue,
+  a low priority thread formats the records and writes them in blocks to CONSOLE (stdout, SDSerial or UdpSerial).
+  records above the log level (LOG_LEVEL, at runtime: AT+D,level or env SUNRAY_LOG_LEVEL) are dropped by the caller.
+  records suppressed by rate limiting are counted and reported with the next record of that call site.
+  without threads (Arduino Due etc.) records are formatted and written by the caller.
+*/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#ifdef __linux__
+  #include <atomic>
+#endif
+
+enum LogLevel {
+  LOG_ERROR,
+  LOG_WARN,
+  LOG_INFO,
+  LOG_DEBUG,
+};
+
+#define LOG_MAX_ARGS    8
+#define LOG_TEXT_SIZE   64      // copied string arguments per record
+#define LOG_QUEUE       256     // records (power of 2)
+#define LOG_BLOCK_SIZE  4096    // formatted output per sink write
+#define LOG_LINE_SIZE   256     // max. formatted record
+#define CONSOLE_LOCK    0       // thread_lock index for SDSerial/UdpSerial writes (Linux)
+
+#ifdef __linux__
+  typedef std::atomic<unsigned long> LogCounter;   // incremented by all logging threads
+#else
+  typedef unsigned long LogCounter;
+#endif
+
+
+// log statement state (one per call site)
+class LogSite {
+  public:
+    unsigned long interval;    // min. time between records (ms), 0: no limit
+    unsigned long lastTime;
+    unsigned long suppressed;  // since last record
+    LogSite(unsigned long anInterval) : interval(anInterval), lastTime(0), suppressed(0) {}
+};
+
+class LogArg {
+  public:
+    char type;   // 'i' integer, 'u' unsigned, 'f' floating point, 's' string (offset into record text)
+    union {
+      long long i;
+      unsigned long long u;
+      double f;
+      int s;
+    };
+};
+
+class LogRecord {
+  public:
+    const char *fmt;
+    unsigned long suppressed;
+    uint8_t level;
+    uint8_t argc;
+    uint8_t textLen;
+    LogArg args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_SIZE];
+    #ifdef __linux__
+      std::atomic<unsigned> seq;  // queue cell sequence
+    #endif
+};
+
+
+class Logger
+{
+  public:
+    int level;
+    // statistics
+    LogCounter records;     // records queued
+    LogCounter dropped;     // records dropped (queue full)
+    LogCounter suppressed;  // records suppressed by rate limiting
+    Logger();
+    void begin();
+    void clearStats();
+    template<typename... Args> void log(LogSite &site, int lvl, const char *fmt, Args... args){
+      if (lvl > level) return;
+      unsigned long now = millis();
+      if ((site.interval != 0) && (site.lastTime != 0) && (now - site.lastTime < site.interval)){
+        site.suppressed++;
+        count(suppressed);
+        return;
+      }
+      site.lastTime = now;
+      unsigned pos;
+      LogRecord *rec = claim(pos);
+      if (rec == NULL){
+        count(dropped);
+        return;
+      }
+      rec->fmt = fmt;
+      rec->level = lvl;
+      rec->suppressed = site.suppressed;
+      rec->argc = 0;
+      rec->textLen = 0;
+      site.suppressed = 0;
+      addArgs(rec, args...);
+      commit(rec, pos);
+    }
+    // formats record into out (incl. newline), returns length
+    static int format(const LogRecord *rec, char *out, int size);
+    // formats and writes queued records (log thread)
+    bool writeQueued();
+  protected:
+    #ifdef __linux__
+      LogRecord queue[LOG_QUEUE];
+      std::atomic<unsigned> enqueuePos;
+      unsigned dequeuePos;
+      char block[LOG_BLOCK_SIZE];
+      static void *logThread(void *arg);
+    #else
+      LogRecord rec;
+    #endif
+    void count(LogCounter &counter){
+      #ifdef __linux__
+        counter.fetch_add(1, std::memory_order_relaxed);
+      #else
+        counter++;
+      #endif
+    }
+    LogRecord *claim(unsigned &pos);
+    void commit(LogRecord *rec, unsigned pos);
+    void addArgs(LogRecord *rec){}
+    template<typename T, typename... Rest> void addArgs(LogRecord *rec, T v, Rest... rest){
+      addArg(rec, v);
+      addArgs(rec, rest...);
+    }
+    LogArg *nextArg(LogRecord *rec);
+    void addArg(LogRecord *rec, int v){ addArg(rec, (long long)v); }
+    void addArg(LogRecord *rec, long v){ addArg(rec, (long long)v); }
+    void addArg(LogRecord *rec, long long v);
+    void addArg(LogRecord *rec, unsigned int v){ addArg(rec, (unsigned long long)v); }
+    void addArg(LogRecord *rec, unsigned long v){ addArg(rec, (unsigned long long)v); }
+    void addArg(LogRecord *rec, unsigned long long v);
+    void addArg(LogRecord *rec, double v);
+    void addArg(LogRecord *rec, const char *v);
+    void addArg(LogRecord *rec, const String &v){ addArg(rec, v.c_str()); }
+};
+
+extern Logger logger;
+
+#define LOG(LEVEL, ...) do { \
+    static LogSite logSite(0); \
+    logger.log(logSite, LEVEL, __VA_ARGS__); \
+  } while (0)
+
+#define LOG_RATE(LEVEL, INTERVAL, ...) do { \
+    static LogSite logSite(INTERVAL); \
+    logger.log(logSite, LEVEL, __VA_ARGS__); \
+  } while (0)
+
+#endif
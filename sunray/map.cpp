@@ -6,6 +6,7 @@
 #include "robot.h"
 #include "config.h"
 #include "StateEstimator.h"
+#include "latency.h"
 #include <Arduino.h>
 
 
@@ -326,6 +327,63 @@ bool PolygonList::write(File &file){
 }
 
 
+// -----------------------------------
+
+StoredMap::StoredMap(){
+  init();
+}
+
+void StoredMap::init(){
+  used = false;
+  name[0] = 0;
+  mapCRC = 0;
+  mowPointsIdx = 0;
+}
+
+
+// -----------------------------------
+
+LearnedObstacle::LearnedObstacle(){
+  init();
+}
+
+void LearnedObstacle::init(){
+  center.init();
+  radius = 0;
+  hits = 0;
+  sessions = 0;
+}
+
+bool LearnedObstacle::read(File &file){
+  byte marker = file.read();
+  if (marker != 0xDD){
+    CONSOLE.println("ERROR reading learned obstacle: invalid marker");
+    return false;
+  }
+  bool res = center.read(file);
+  res &= (file.read((uint8_t*)&radius, sizeof(radius)) != 0);
+  res &= (file.read((uint8_t*)&hits, sizeof(hits)) != 0);
+  res &= (file.read((uint8_t*)&sessions, sizeof(sessions)) != 0);
+  if (!res) {
+    CONSOLE.println("ERROR reading learned obstacle");
+  }
+  return res;
+}
+
+bool LearnedObstacle::write(File &file){
+  bool res = true;
+  res &= (file.write(0xDD) != 0);
+  res &= center.write(file);
+  res &= (file.write((uint8_t*)&radius, sizeof(radius)) != 0);
+  res &= (file.write((uint8_t*)&hits, sizeof(hits)) != 0);
+  res &= (file.write((uint8_t*)&sessions, sizeof(sessions)) != 0);
+  if (!res) {
+    CONSOLE.println("ERROR writing learned obstacle");
+  }
+  return res;
+}
+
+
 // -----------------------------------
 
 Node::Node(){
@@ -488,9 +546,25 @@ void Map::begin(){
   shouldRetryDock = false; 
   shouldMow = false;         
   mapCRC = 0;  
+  speedProfileNumPoints = 0;
+  speedProfileMowPointsIdx = -1;
+  learnedObstaclesCount = 0;
+  learnedObstaclePolygons = 0;
+  learnedObstaclesMapCRC = 0;
+  pathFinderIterations = 0;
+  pathFinderTimeout = false;
+  activeMapSlot = -1;
   CONSOLE.print("sizeof Point=");
   CONSOLE.println(sizeof(Point));  
-  load();
+  loadMapIndex();
+  if (activeMapSlot >= 0){
+    if (!load(storedMapFileName("map", activeMapSlot).c_str())){
+      activeMapSlot = -1;
+      load();
+    }
+  } else load();
+  loadLearnedObstacles();
+  clearObstacles();
   dump();
 }
 
@@ -528,6 +602,8 @@ void Map::dump(){
   }
   CONSOLE.print("free pts: ");
   CONSOLE.println(freePoints.numPoints);  
+  CONSOLE.print("learned obstacles: ");
+  CONSOLE.println(learnedObstaclesCount);  
   CONSOLE.print("mowPointsIdx=");
   CONSOLE.print(mowPointsIdx);
   CONSOLE.print(" dockPointsIdx=");
@@ -554,15 +630,15 @@ void Map::checkMemoryErrors(){
 }
 
 
-bool Map::load(){
+bool Map::load(const char *fileName){
   bool res = true;
 #if defined(ENABLE_SD_RESUME)  
   CONSOLE.print("map load... ");
-  if (!SD.exists("map.bin")) {
+  if (!SD.exists(fileName)) {
     CONSOLE.println("no map file!");
     return false;
   }
-  mapFile = SD.open("map.bin", FILE_READ);
+  mapFile = SD.open(fileName, FILE_READ);
   if (!mapFile){        
     CONSOLE.println("ERROR opening file for reading");
     return false;
@@ -601,11 +677,11 @@ bool Map::load(){
 }
 
 
-bool Map::save(){
+bool Map::save(const char *fileName){
   bool res = true;
 #if defined(ENABLE_SD_RESUME)  
   CONSOLE.print("map save... ");
-  mapFile = SD.open("map.bin", FILE_CREATE); // O_WRITE | O_CREAT);
+  mapFile = SD.open(fileName, FILE_CREATE); // O_WRITE | O_CREAT);
   if (!mapFile){        
     CONSOLE.println("ERROR opening file for writing");
     return false;
@@ -635,6 +711,11 @@ bool Map::save(){
 
 void Map::finishedUploadingMap(){
   CONSOLE.println("finishedUploadingMap");
+  if (activeMapSlot >= 0){
+    // uploaded map is not stored yet (use storeMap)
+    activeMapSlot = -1;
+    saveMapIndex();
+  }
   #ifdef DRV_SIM_ROBOT
     float x;
     float y;
@@ -652,8 +733,15 @@ void Map::finishedUploadingMap(){
     }
   #endif
   mapCRC = calcMapCRC();
+  if (mapCRC != learnedObstaclesMapCRC){
+    // learned obstacles belong to another map
+    clearLearnedObstacles();
+    saveLearnedObstacles();
+  }
+  clearObstacles();
   dump();
   save();
+  coverage.begin();
 }
  
    
@@ -666,8 +754,10 @@ void Map::clearMap(){
   mowPoints.dealloc();    
   freePoints.dealloc();
   obstacles.dealloc();
+  learnedObstaclePolygons = 0;
   pathFinderObstacles.dealloc();
   pathFinderNodes.dealloc();
+  speedProfileMowPointsIdx = -1;
 }
 
  
@@ -694,6 +784,30 @@ bool Map::setPoint(int idx, float x, float y){
 }
 
 
+// bulk upload: clear map and preallocate points (no reallocation per point)
+bool Map::beginPoints(int count){
+  if ((memoryCorruptions != 0) || (memoryAllocErrors != 0)){
+    CONSOLE.println("ERROR beginPoints: memory errors");
+    return false; 
+  }  
+  clearMap();
+  if (freeMemory () < 20000 + count * (int)sizeof(Point)){
+    CONSOLE.println("OUT OF MEMORY");
+    return false;
+  }
+  return points.alloc(count);
+}
+
+
+// set preallocated point
+bool Map::setPointCm(int idx, short px, short py){
+  if ((idx < 0) || (idx >= points.numPoints)) return false;
+  points.points[idx].px = px;
+  points.points[idx].py = py;
+  return true;
+}
+
+
 // set number points for point type
 bool Map::setWayCount(WayType type, int count){
   if ((memoryCorruptions != 0) || (memoryAllocErrors != 0)){
@@ -737,6 +851,7 @@ bool Map::setWayCount(WayType type, int count){
   mowPointsIdx = 0;
   dockPointsIdx = 0;
   freePointsIdx = 0;  
+  speedProfileMowPointsIdx = -1;
   return true;
 }
 
@@ -887,6 +1002,71 @@ bool Map::nextPointIsStraight(){
 }
 
 
+// compute look-ahead speed profile for upcoming mowing points:
+// 1. each mowing point gets a corner speed - curves the robot can drive through are limited by the max. lateral 
+//    acceleration (v=sqrt(a*r)), sharp curves (robot will stop and rotate) are passed with min. speed 
+// 2. a backward pass limits each corner speed so that the robot can decelerate (max. acceleration) to the next corner
+void Map::calcSpeedProfile(float maxSpeed, float minSpeed){
+  speedProfileMowPointsIdx = mowPointsIdx;
+  speedProfileLastTargetPoint.assign(lastTargetPoint);
+  speedProfileMaxSpeed = maxSpeed;
+  speedProfileNumPoints = min(SPEED_PROFILE_POINTS, mowPoints.numPoints - mowPointsIdx);
+  if (speedProfileNumPoints <= 0) {
+    speedProfileNumPoints = 0;
+    return;
+  }
+  // curves above this angle are not driven but the robot stops and rotates (see trackLine)
+  float rotateAngle = SMOOTH_CURVES ? 120.0 : 20.0;
+  float segmentLen[SPEED_PROFILE_POINTS];
+  Point prevPt;
+  prevPt.assign(lastTargetPoint);
+  for (int k=0; k < speedProfileNumPoints; k++){
+    Point &pt = mowPoints.points[mowPointsIdx + k];
+    segmentLen[k] = distance(prevPt, pt);  // segment length from previous point to this point
+    float v = minSpeed;
+    if (mowPointsIdx + k + 1 < mowPoints.numPoints){
+      Point &nextPt = mowPoints.points[mowPointsIdx + k + 1];
+      float angleCurr = pointsAngle(prevPt.x(), prevPt.y(), pt.x(), pt.y());
+      float angleNext = pointsAngle(pt.x(), pt.y(), nextPt.x(), nextPt.y());
+      angleNext = scalePIangles(angleNext, angleCurr);
+      float diffDelta = fabs(distancePI(angleCurr, angleNext));
+      if (diffDelta/PI*180.0 < rotateAngle){
+        // approximate curve by circle arc using half of shorter neighbor segment         
+        float arcLen = 0.5 * min(segmentLen[k], distance(pt, nextPt));
+        float radius = arcLen / max(diffDelta, 0.001);
+        v = sqrt(SPEED_PROFILE_MAX_LATERAL_ACCEL * radius);
+      }
+    }
+    speedProfile[k] = max(minSpeed, min(maxSpeed, v));
+    prevPt.assign(pt);
+  }
+  // points beyond look-ahead are unknown - robot must be able to slow down after last profile point
+  int last = speedProfileNumPoints-1;
+  if (mowPointsIdx + speedProfileNumPoints < mowPoints.numPoints){
+    speedProfile[last] = minSpeed;
+  }
+  // backward pass (deceleration limit)
+  for (int k=last-1; k >= 0; k--){
+    float v = sqrt( sq(speedProfile[k+1]) + 2.0 * SPEED_PROFILE_MAX_ACCEL * segmentLen[k+1] );
+    speedProfile[k] = min(speedProfile[k], v);
+  }
+}
+
+
+// get max. allowed linear speed at robot position (robot must be able to decelerate to speed profile at target point)
+float Map::speedProfileSpeed(float stateX, float stateY, float maxSpeed, float minSpeed){
+  if (wayMode != WAY_MOW) return minSpeed;
+  if ( (speedProfileMowPointsIdx != mowPointsIdx) || (speedProfileMaxSpeed != maxSpeed)
+        || (speedProfileLastTargetPoint.px != lastTargetPoint.px) || (speedProfileLastTargetPoint.py != lastTargetPoint.py) ){
+    calcSpeedProfile(maxSpeed, minSpeed);
+  }
+  if (speedProfileNumPoints == 0) return minSpeed;
+  float targetDist = distanceToTargetPoint(stateX, stateY);
+  float v = sqrt( sq(speedProfile[0]) + 2.0 * SPEED_PROFILE_MAX_ACCEL * targetDist );
+  return max(minSpeed, min(maxSpeed, v));
+}
+
+
 // get docking position and orientation (x,y,delta)
 bool Map::getDockingPos(float &x, float &y, float &delta){
   if (dockPoints.numPoints < 2) return false;
@@ -1036,11 +1216,37 @@ bool Map::startMowing(float stateX, float stateY){
 void Map::clearObstacles(){  
   CONSOLE.println("clearObstacles");
   obstacles.dealloc();  
+  learnedObstaclePolygons = 0;
+  // learned obstacles are always known to the path planner
+  for (int i=0; i < learnedObstaclesCount; i++){
+    LearnedObstacle &obst = learnedObstacles[i];
+    if (obst.hits < LEARNED_OBSTACLE_MIN_HITS) continue;
+    if (!addOctagonObstacle(obst.center.x(), obst.center.y(), ((float)obst.radius) * 2.0 / 100.0)) break;
+    learnedObstaclePolygons++;
+  }
+}
+
+// add octagon obstacle (center x,y and diameter in meter)
+bool Map::addOctagonObstacle(float x, float y, float diameter){
+  float d1 = diameter / 6.0;   // distance from center to nearest octagon edges
+  float d2 = diameter / 2.0;  // distance from center to farest octagon edges
+  int idx = obstacles.numPolygons;
+  if (!obstacles.alloc(idx+1)) return false;
+  if (!obstacles.polygons[idx].alloc(8)) return false;
+  
+  obstacles.polygons[idx].points[0].setXY(x-d2, y-d1);
+  obstacles.polygons[idx].points[1].setXY(x-d1, y-d2);
+  obstacles.polygons[idx].points[2].setXY(x+d1, y-d2);
+  obstacles.polygons[idx].points[3].setXY(x+d2, y-d1);
+  obstacles.polygons[idx].points[4].setXY(x+d2, y+d1);
+  obstacles.polygons[idx].points[5].setXY(x+d1, y+d2);
+  obstacles.polygons[idx].points[6].setXY(x-d1, y+d2);
+  obstacles.polygons[idx].points[7].setXY(x-d2, y+d1);         
+  return true;
 }
 
 // add dynamic octagon obstacle in front of robot on line going from robot to target point
 bool Map::addObstacle(float stateX, float stateY){     
-  float d1 = OBSTACLE_DIAMETER / 6.0;   // distance from center to nearest octagon edges
   float d2 = OBSTACLE_DIAMETER / 2.0;  // distance from center to farest octagon edges
   
   float angleCurr = pointsAngle(stateX, stateY, targetPoint.x(), targetPoint.y());
@@ -1052,25 +1258,365 @@ bool Map::addObstacle(float stateX, float stateY){
   CONSOLE.print(x);
   CONSOLE.print(",");
   CONSOLE.println(y);
-  if (obstacles.numPolygons > 50){
+  if (obstacles.numPolygons - learnedObstaclePolygons > 50){
     CONSOLE.println("error: too many obstacles");
     return false;
   }
-  int idx = obstacles.numPolygons;
-  if (!obstacles.alloc(idx+1)) return false;
-  if (!obstacles.polygons[idx].alloc(8)) return false;
-  
-  obstacles.polygons[idx].points[0].setXY(x-d2, y-d1);
-  obstacles.polygons[idx].points[1].setXY(x-d1, y-d2);
-  obstacles.polygons[idx].points[2].setXY(x+d1, y-d2);
-  obstacles.polygons[idx].points[3].setXY(x+d2, y-d1);
-  obstacles.polygons[idx].points[4].setXY(x+d2, y+d1);
-  obstacles.polygons[idx].points[5].setXY(x+d1, y+d2);
-  obstacles.polygons[idx].points[6].setXY(x-d1, y+d2);
-  obstacles.polygons[idx].points[7].setXY(x-d2, y+d1);         
+  return addOctagonObstacle(x, y, OBSTACLE_DIAMETER);
+}
+
+
+void Map::clearLearnedObstacles(){
+  CONSOLE.println("clearLearnedObstacles");
+  for (int i=0; i < MAX_LEARNED_OBSTACLES; i++) learnedObstacles[i].init();
+  learnedObstaclesCount = 0;
+  learnedObstaclesMapCRC = mapCRC;
+}
+
+// learn obstacle in front of robot on line going from robot to target point
+bool Map::learnObstacle(float stateX, float stateY){
+  if (!LEARN_OBSTACLES) return false;
+  float d2 = LEARNED_OBSTACLE_DIAMETER / 2.0;
+  float angleCurr = pointsAngle(stateX, stateY, targetPoint.x(), targetPoint.y());
+  float r = d2 + 0.05;
+  Point pt;
+  pt.setXY(stateX + cos(angleCurr) * r, stateY + sin(angleCurr) * r);
+  CONSOLE.print("learnObstacle ");
+  CONSOLE.print(pt.x());
+  CONSOLE.print(",");
+  CONSOLE.println(pt.y());
+  if (learnedObstaclesMapCRC != mapCRC) clearLearnedObstacles();
+  int idx = learnedObstaclesCount;
+  if (idx >= MAX_LEARNED_OBSTACLES){
+    // replace the least confirmed obstacle
+    idx = 0;
+    for (int i=1; i < learnedObstaclesCount; i++){
+      if ( (learnedObstacles[i].hits < learnedObstacles[idx].hits) || 
+           ((learnedObstacles[i].hits == learnedObstacles[idx].hits) && (learnedObstacles[i].sessions > learnedObstacles[idx].sessions)) ) idx = i;
+    }
+  } else learnedObstaclesCount++;
+  learnedObstacles[idx].init();
+  learnedObstacles[idx].center.assign(pt);
+  learnedObstacles[idx].radius = d2 * 100.0;
+  learnedObstacles[idx].hits = 1;
+  mergeLearnedObstacles();
+  return saveLearnedObstacles();
+}
+
+// merge overlapping learned obstacles into one obstacle (smallest circle enclosing both)
+void Map::mergeLearnedObstacles(){
+  float maxRadius = LEARNED_OBSTACLE_MAX_DIAMETER / 2.0 * 100.0;
+  bool merged = true;
+  while (merged){
+    merged = false;
+    for (int i=0; i < learnedObstaclesCount; i++){
+      for (int j=i+1; j < learnedObstaclesCount; j++){
+        LearnedObstacle &a = learnedObstacles[i];
+        LearnedObstacle &b = learnedObstacles[j];
+        float dx = b.center.px - a.center.px;
+        float dy = b.center.py - a.center.py;
+        float d = sqrt( sq(dx) + sq(dy) );
+        if (d > a.radius + b.radius) continue;  // no overlap
+        if (d + b.radius <= a.radius) {
+          // a encloses b
+        } else if (d + a.radius <= b.radius) {
+          // b encloses a
+          a.center.assign(b.center);
+          a.radius = b.radius;
+        } else {
+          float radius = (d + a.radius + b.radius) / 2.0;
+          float t = (radius - a.radius) / d;
+          a.center.px = a.center.px + dx * t;
+          a.center.py = a.center.py + dy * t;
+          a.radius = min(maxRadius, radius);
+        }
+        a.hits = min(1000, a.hits + b.hits);
+        a.sessions = min(a.sessions, b.sessions);
+        // remove b
+        learnedObstacles[j] = learnedObstacles[learnedObstaclesCount-1];
+        learnedObstacles[learnedObstaclesCount-1].init();
+        learnedObstaclesCount--;
+        merged = true;
+      }
+    }
+  }
+}
+
+// new mowing session: each obstacle not hit for LEARNED_OBSTACLE_DECAY_SESSIONS sessions loses one hit  
+// (and is forgotten if there are no more hits)
+void Map::startLearnedObstaclesSession(){
+  if (!LEARN_OBSTACLES) return;
+  if (learnedObstaclesMapCRC != mapCRC) clearLearnedObstacles();
+  int i = 0;
+  while (i < learnedObstaclesCount){
+    LearnedObstacle &obst = learnedObstacles[i];
+    obst.sessions++;
+    if (obst.sessions % LEARNED_OBSTACLE_DECAY_SESSIONS == 0) obst.hits--;
+    if (obst.hits <= 0){
+      learnedObstacles[i] = learnedObstacles[learnedObstaclesCount-1];
+      learnedObstacles[learnedObstaclesCount-1].init();
+      learnedObstaclesCount--;
+    } else i++;
+  }
+  CONSOLE.print("startLearnedObstaclesSession learned obstacles=");
+  CONSOLE.println(learnedObstaclesCount);
+  saveLearnedObstacles();
+}
+
+bool Map::loadLearnedObstacles(){
+  bool res = true;
+#if defined(ENABLE_SD_RESUME)  
+  CONSOLE.print("learned obstacles load... ");
+  String fileName = (activeMapSlot < 0) ? String("obstacles.bin") : storedMapFileName("obst", activeMapSlot);
+  if (!SD.exists(fileName.c_str())) {
+    CONSOLE.println("no learned obstacles file!");
+    return false;
+  }
+  File obstFile = SD.open(fileName.c_str(), FILE_READ);
+  if (!obstFile){        
+    CONSOLE.println("ERROR opening file for reading");
+    return false;
+  }
+  uint32_t marker = 0;
+  obstFile.read((uint8_t*)&marker, sizeof(marker));
+  if (marker != 0x00002000){
+    CONSOLE.print("ERROR: invalid marker: ");
+    CONSOLE.println(marker, HEX);
+    obstFile.close();
+    return false;
+  }
+  long crc = 0;
+  short num = 0;
+  res &= (obstFile.read((uint8_t*)&crc, sizeof(crc)) != 0); 
+  res &= (obstFile.read((uint8_t*)&num, sizeof(num)) != 0); 
+  if ((crc != mapCRC) || (num < 0) || (num > MAX_LEARNED_OBSTACLES)) {
+    CONSOLE.println("learned obstacles do not belong to map");
+    res = false;
+  }
+  if (res){
+    for (int i=0; i < num; i++){
+      res &= learnedObstacles[i].read(obstFile);
+      if (!res) break;
+    }
+  }
+  obstFile.close();  
+  if (res){
+    learnedObstaclesCount = num;
+    learnedObstaclesMapCRC = crc;
+    CONSOLE.print("ok learned obstacles=");
+    CONSOLE.println(learnedObstaclesCount);
+  } else {
+    CONSOLE.println("ERROR loading learned obstacles");
+    clearLearnedObstacles(); 
+  }
+#endif
+  return res;
+}
+
+bool Map::saveLearnedObstacles(){
+  bool res = true;
+#if defined(ENABLE_SD_RESUME)  
+  CONSOLE.print("learned obstacles save... ");
+  String fileName = (activeMapSlot < 0) ? String("obstacles.bin") : storedMapFileName("obst", activeMapSlot);
+  File obstFile = SD.open(fileName.c_str(), FILE_CREATE); 
+  if (!obstFile){        
+    CONSOLE.println("ERROR opening file for writing");
+    return false;
+  }
+  uint32_t marker = 0x00002000;
+  short num = learnedObstaclesCount;
+  res &= (obstFile.write((uint8_t*)&marker, sizeof(marker)) != 0);
+  res &= (obstFile.write((uint8_t*)&learnedObstaclesMapCRC, sizeof(learnedObstaclesMapCRC)) != 0);
+  res &= (obstFile.write((uint8_t*)&num, sizeof(num)) != 0);
+  for (int i=0; i < learnedObstaclesCount; i++){
+    if (!res) break;
+    res &= learnedObstacles[i].write(obstFile);
+  }
+  if (res){
+    CONSOLE.println("ok");
+  } else {
+    CONSOLE.println("ERROR saving learned obstacles");
+  }
+  obstFile.flush();
+  obstFile.close();
+#endif
+  return res;    
+}
+
+
+String Map::storedMapFileName(const char *prefix, int slot){
+  String s = prefix;
+  s += slot;
+  s += ".bin";
+  return s;
+}
+
+// store current map into map store slot (and make it the active map)
+bool Map::storeMap(int slot, String name){
+  if ((slot < 0) || (slot >= MAX_STORED_MAPS)) {
+    CONSOLE.println("ERROR storeMap: invalid slot");
+    return false;
+  }
+  if (perimeterPoints.numPoints == 0) {
+    CONSOLE.println("ERROR storeMap: no map");
+    return false;
+  }
+  CONSOLE.print("storeMap slot=");
+  CONSOLE.print(slot);
+  CONSOLE.print(" name=");
+  CONSOLE.println(name);
+  if (!save(storedMapFileName("map", slot).c_str())) return false;
+  StoredMap &entry = storedMaps[slot];
+  entry.used = true;
+  name.replace(",", " ");
+  strncpy(entry.name, name.c_str(), STORED_MAP_NAME_LEN-1);
+  entry.name[STORED_MAP_NAME_LEN-1] = 0;
+  entry.mapCRC = mapCRC;
+  entry.mowPointsIdx = mowPointsIdx;
+  activeMapSlot = slot;
+  if (learnedObstaclesMapCRC != mapCRC) clearLearnedObstacles();
+  saveLearnedObstacles();
+  return saveMapIndex();
+}
+
+// switch to stored map (only this map is loaded, mowing progress of each map is kept)
+bool Map::selectMap(int slot){
+  if ((slot < 0) || (slot >= MAX_STORED_MAPS) || (!storedMaps[slot].used)) {
+    CONSOLE.println("ERROR selectMap: invalid slot");
+    return false;
+  }
+  if (slot == activeMapSlot) return true;
+  unsigned long startTime = millis();
+  CONSOLE.print("selectMap slot=");
+  CONSOLE.print(slot);
+  CONSOLE.print(" name=");
+  CONSOLE.println(storedMaps[slot].name);
+  if (activeMapSlot >= 0) storedMaps[activeMapSlot].mowPointsIdx = mowPointsIdx;
+  StoredMap &entry = storedMaps[slot];
+  bool ok = load(storedMapFileName("map", slot).c_str());
+  if ((ok) && (entry.mapCRC != mapCRC)){
+    // map file changed since it was stored (map index keeps stored CRC)
+    CONSOLE.print("ERROR selectMap: map CRC mismatch:");
+    CONSOLE.print(mapCRC);
+    CONSOLE.print(" expected:");
+    CONSOLE.println(entry.mapCRC);
+    ok = false;
+  }
+  if (!ok){
+    // restore previous map
+    if (activeMapSlot >= 0) load(storedMapFileName("map", activeMapSlot).c_str());
+      else load();
+    return false;
+  }
+  activeMapSlot = slot;
+  mowPointsIdx = (entry.mowPointsIdx < mowPoints.numPoints) ? entry.mowPointsIdx : 0;
+  dockPointsIdx = 0;
+  freePointsIdx = 0;
+  speedProfileMowPointsIdx = -1;
+  clearLearnedObstacles();
+  loadLearnedObstacles();
+  clearObstacles();
+  coverage.begin();
+  saveMapIndex();
+  CONSOLE.print("selectMap duration=");
+  CONSOLE.println(millis() - startTime);
   return true;
 }
 
+bool Map::deleteStoredMap(int slot){
+  if ((slot < 0) || (slot >= MAX_STORED_MAPS)) return false;
+  CONSOLE.print("deleteStoredMap slot=");
+  CONSOLE.println(slot);
+#if defined(ENABLE_SD_RESUME)  
+  SD.remove(storedMapFileName("map", slot).c_str());
+  SD.remove(storedMapFileName("obst", slot).c_str());
+#endif
+  storedMaps[slot].init();
+  if (slot == activeMapSlot){
+    // keep loaded map as (unnamed) uploaded map
+    activeMapSlot = -1;
+    save();
+    saveLearnedObstacles();
+  }
+  return saveMapIndex();
+}
+
+bool Map::loadMapIndex(){
+  bool res = true;
+  for (int i=0; i < MAX_STORED_MAPS; i++) storedMaps[i].init();
+  activeMapSlot = -1;
+#if defined(ENABLE_SD_RESUME)  
+  CONSOLE.print("map index load... ");
+  if (!SD.exists("mapidx.bin")) {
+    CONSOLE.println("no map index file!");
+    return false;
+  }
+  File idxFile = SD.open("mapidx.bin", FILE_READ);
+  if (!idxFile){        
+    CONSOLE.println("ERROR opening file for reading");
+    return false;
+  }
+  uint32_t marker = 0;
+  idxFile.read((uint8_t*)&marker, sizeof(marker));
+  if (marker != 0x00003000){
+    CONSOLE.print("ERROR: invalid marker: ");
+    CONSOLE.println(marker, HEX);
+    idxFile.close();
+    return false;
+  }
+  short slot = -1;
+  res &= (idxFile.read((uint8_t*)&slot, sizeof(slot)) != 0);
+  for (int i=0; i < MAX_STORED_MAPS; i++){
+    StoredMap &entry = storedMaps[i];
+    res &= (idxFile.read((uint8_t*)&entry.used, sizeof(entry.used)) != 0);
+    res &= (idxFile.read((uint8_t*)entry.name, sizeof(entry.name)) != 0);
+    res &= (idxFile.read((uint8_t*)&entry.mapCRC, sizeof(entry.mapCRC)) != 0);
+    entry.name[STORED_MAP_NAME_LEN-1] = 0;
+    if (!res) break;
+  }
+  idxFile.close();
+  if ((res) && (slot >= 0) && (slot < MAX_STORED_MAPS) && (storedMaps[slot].used)) activeMapSlot = slot;
+  if (res){
+    CONSOLE.print("ok active slot=");
+    CONSOLE.println(activeMapSlot);
+  } else {
+    CONSOLE.println("ERROR loading map index");
+    for (int i=0; i < MAX_STORED_MAPS; i++) storedMaps[i].init();
+  }
+#endif
+  return res;
+}
+
+bool Map::saveMapIndex(){
+  bool res = true;
+#if defined(ENABLE_SD_RESUME)  
+  CONSOLE.print("map index save... ");
+  File idxFile = SD.open("mapidx.bin", FILE_CREATE); 
+  if (!idxFile){        
+    CONSOLE.println("ERROR opening file for writing");
+    return false;
+  }
+  uint32_t marker = 0x00003000;
+  short slot = activeMapSlot;
+  res &= (idxFile.write((uint8_t*)&marker, sizeof(marker)) != 0);
+  res &= (idxFile.write((uint8_t*)&slot, sizeof(slot)) != 0);
+  for (int i=0; i < MAX_STORED_MAPS; i++){
+    StoredMap &entry = storedMaps[i];
+    res &= (idxFile.write((uint8_t*)&entry.used, sizeof(entry.used)) != 0);
+    res &= (idxFile.write((uint8_t*)entry.name, sizeof(entry.name)) != 0);
+    res &= (idxFile.write((uint8_t*)&entry.mapCRC, sizeof(entry.mapCRC)) != 0);
+  }
+  if (res){
+    CONSOLE.println("ok");
+  } else {
+    CONSOLE.println("ERROR saving map index");
+  }
+  idxFile.flush();
+  idxFile.close();
+#endif
+  return res;    
+}
+
 
 // check if given point is inside perimeter (and outside exclusions) of current map 
 bool Map::isInsidePerimeterOutsideExclusions(Point &pt){
@@ -1785,6 +2331,7 @@ int Map::findNextNeighbor(NodeList &nodes, PolygonList &obstacles, Node &node, i
 // astar path finder 
 // https://briangrinstead.com/blog/astar-search-algorithm-in-javascript/
 bool Map::findPath(Point &src, Point &dst){
+  LATENCY_SCOPE(LAT_FIND_PATH);
   if ((memoryCorruptions != 0) || (memoryAllocErrors != 0)){
     CONSOLE.println("ERROR findPath: memory errors");
     return false; 
@@ -1792,6 +2339,8 @@ bool Map::findPath(Point &src, Point &dst){
   
   unsigned long nextProgressTime = 0;
   unsigned long startTime = millis();
+  pathFinderIterations = 0;
+  pathFinderTimeout = false;
   CONSOLE.print("findPath (");
   CONSOLE.print(src.x());
   CONSOLE.print(",");
@@ -1911,8 +2460,10 @@ bool Map::findPath(Point &src, Point &dst){
       timeout--;            
       if (timeout == 0){
         CONSOLE.println("timeout");
+        pathFinderTimeout = true;
         break;
       }
+      pathFinderIterations++;
       // Grab the lowest f(x) to process next
       int lowInd = -1;
       //CONSOLE.println("finding lowest cost node...");
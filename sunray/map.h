@@ -11,6 +11,14 @@
 #include <SD.h>
 
 
+// number of upcoming mowing points considered by the speed profile
+#define SPEED_PROFILE_POINTS 16
+
+// max. number of learned (persistent) obstacles
+#define MAX_LEARNED_OBSTACLES 64
+#define MAX_STORED_MAPS 8
+#define STORED_MAP_NAME_LEN 16
+
 // waypoint type
 enum WayType {WAY_PERIMETER, WAY_EXCLUSION, WAY_DOCK, WAY_MOW, WAY_FREE};
 typedef enum WayType WayType;
@@ -71,6 +79,32 @@ class PolygonList // owns polygons!
      bool write(File &file);
 };
 
+// a named map in the map store (file mapN.bin)
+class StoredMap
+{
+  public:
+    bool used;
+    char name[STORED_MAP_NAME_LEN];
+    long mapCRC;
+    int mowPointsIdx;  // mowing progress of this map (kept in state file)
+    StoredMap();
+    void init();
+};
+
+// an obstacle learned from collisions (kept over mowing sessions)
+class LearnedObstacle
+{
+  public:
+    Point center;    
+    short radius;   // cm
+    short hits;     // number of collisions
+    short sessions; // mowing sessions since last collision
+    LearnedObstacle();
+    void init();
+    bool read(File &file);
+    bool write(File &file);
+};
+
 class Node   // nodes just hold references to points and other nodes
 {
   public:
@@ -145,7 +179,7 @@ class Map
     Polygon dockPoints;
     Polygon freePoints;
     PolygonList exclusions;     
-    PolygonList obstacles;     
+    PolygonList obstacles;     // learned obstacles (first) and virtual obstacles
     PolygonList pathFinderObstacles;
     NodeList pathFinderNodes;
     File mapFile;
@@ -156,6 +190,17 @@ class Map
     bool shouldMow;  // start mowing?       
     
     long mapCRC;  // map data CRC
+
+    LearnedObstacle learnedObstacles[MAX_LEARNED_OBSTACLES];
+    int learnedObstaclesCount;
+    int learnedObstaclePolygons; // number of learned obstacles at start of obstacles list
+    long learnedObstaclesMapCRC; // map CRC the learned obstacles belong to
+
+    StoredMap storedMaps[MAX_STORED_MAPS];
+    int activeMapSlot;  // stored map currently loaded (-1: uploaded map, not stored)
+
+    int pathFinderIterations;  // A* iterations of last findPath
+    bool pathFinderTimeout;    // last findPath stopped by iteration limit
         
     void begin();    
     void run();    
@@ -163,14 +208,18 @@ class Map
     // --------mapping ----------------------------------
     // set point coordinate
     bool setPoint(int idx, float x, float y);    
+    // bulk upload: clear map and preallocate points
+    bool beginPoints(int count);
+    // set preallocated point coordinate (cm)
+    bool setPointCm(int idx, short px, short py);
     // set number points for waytype
     bool setWayCount(WayType type, int count);
     // set number points for exclusion 
     bool setExclusionLength(int idx, int len);
     void clearMap();
     void dump();    
-    bool load();
-    bool save();
+    bool load(const char *fileName = "map.bin");
+    bool save(const char *fileName = "map.bin");
     void stressTest();
     long calcMapCRC();
 
@@ -197,6 +246,8 @@ class Map
     bool nextPoint(bool sim,float stateX, float stateY);
     // next point is straight and not a sharp curve?   
     bool nextPointIsStraight();
+    // max. allowed linear speed (m/s) at robot position computed from look-ahead speed profile of upcoming mowing points
+    float speedProfileSpeed(float stateX, float stateY, float maxSpeed, float minSpeed);
     // get docking position and orientation
     bool getDockingPos(float &x, float &y, float &delta);
     
@@ -214,7 +265,23 @@ class Map
     
     // -----virtual obstacles----------------------------------
     bool addObstacle(float stateX, float stateY);    
+    // clear virtual obstacles (learned obstacles are kept)
     void clearObstacles();
+
+    // -----learned obstacles----------------------------------
+    // remember obstacle in front of robot (merged with overlapping learned obstacles)
+    bool learnObstacle(float stateX, float stateY);
+    // new mowing session started: age learned obstacles (and forget obstacles not hit for a long time)
+    void startLearnedObstaclesSession();
+    void clearLearnedObstacles();
+    bool loadLearnedObstacles();
+    bool saveLearnedObstacles();
+    // map store (several named maps, only the active one is loaded)
+    bool storeMap(int slot, String name);
+    bool selectMap(int slot);
+    bool deleteStoredMap(int slot);
+    bool loadMapIndex();
+    bool saveMapIndex();
     
     // -----misc-----------------------------------------------
     bool pointIsInsidePolygon( Polygon &polygon, Point &pt);
@@ -246,6 +313,16 @@ class Map
     bool isPointInBoundingBox(Point &pt, Point &A, Point &B);
     int linePolygonIntersectionCount(Point &src, Point &dst, Polygon &poly);
     void testIntegerCalcs();
+    bool addOctagonObstacle(float x, float y, float diameter);
+    String storedMapFileName(const char *prefix, int slot);
+    void mergeLearnedObstacles();
+    // speed profile: max. allowed speed (m/s) when passing upcoming mowing points (index 0 is target point)
+    float speedProfile[SPEED_PROFILE_POINTS];
+    int speedProfileNumPoints;
+    int speedProfileMowPointsIdx;  
+    Point speedProfileLastTargetPoint;
+    float speedProfileMaxSpeed;
+    void calcSpeedProfile(float maxSpeed, float minSpeed);
 };
 
 
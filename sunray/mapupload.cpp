@@ -0,0 +1,135 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "mapupload.h"
+#include "robot.h"
+
+
+MapUpload mapUpload;
+
+
+// CRC-32 (IEEE 802.3, as zlib.crc32)
+uint32_t crc32(const uint8_t *data, int len){
+  uint32_t crc = 0xFFFFFFFF;
+  for (int i=0; i < len; i++){
+    crc ^= data[i];
+    for (int j=0; j < 8; j++){
+      if (crc & 1) crc = (crc >> 1) ^ 0xEDB88320;
+        else crc >>= 1;
+    }
+  }
+  return ~crc;
+}
+
+static int base64Value(char ch){
+  if ((ch >= 'A') && (ch <= 'Z')) return ch - 'A';
+  if ((ch >= 'a') && (ch <= 'z')) return ch - 'a' + 26;
+  if ((ch >= '0') && (ch <= '9')) return ch - '0' + 52;
+  if (ch == '+') return 62;
+  if (ch == '/') return 63;
+  return -1;
+}
+
+int base64Decode(const char *src, int len, uint8_t *dst, int maxLen){
+  uint32_t bits = 0;
+  int bitCount = 0;
+  int out = 0;
+  for (int i=0; i < len; i++){
+    if (src[i] == '=') break;
+    int v = base64Value(src[i]);
+    if (v < 0) return -1;
+    bits = (bits << 6) | v;
+    bitCount += 6;
+    if (bitCount >= 8){
+      bitCount -= 8;
+      if (out >= maxLen) return -1;
+      dst[out++] = (bits >> bitCount) & 0xFF;
+    }
+  }
+  return out;
+}
+
+static bool readVarint(const uint8_t *buf, int len, int &pos, uint32_t &value){
+  value = 0;
+  for (int shift=0; shift < 32; shift += 7){
+    if (pos >= len) return false;
+    uint8_t b = buf[pos++];
+    value |= ((uint32_t)(b & 0x7F)) << shift;
+    if ((b & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+static bool readZigzag(const uint8_t *buf, int len, int &pos, int32_t &value){
+  uint32_t u;
+  if (!readVarint(buf, len, pos, u)) return false;
+  value = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+  return true;
+}
+
+
+// ---------------------------------------------------------------------
+
+MapUpload::MapUpload(){
+  count = 0;
+  nextIdx = 0;
+  frames = 0;
+  frameErrors = 0;
+}
+
+bool MapUpload::begin(int aCount){
+  count = 0;
+  nextIdx = 0;
+  frames = 0;
+  frameErrors = 0;
+  if (!maps.beginPoints(aCount)) return false;
+  count = aCount;
+  return true;
+}
+
+bool MapUpload::frame(const char *base64, int len){
+  uint8_t buf[MAP_FRAME_SIZE];
+  int n = base64Decode(base64, len, buf, MAP_FRAME_SIZE);
+  if (n < 6){
+    frameErrors++;
+    return false;
+  }
+  n -= 4;
+  uint32_t crc = buf[n] | (buf[n+1] << 8) | (buf[n+2] << 16) | ((uint32_t)buf[n+3] << 24);
+  if (crc32(buf, n) != crc){
+    CONSOLE.println("MapUpload: CRC ERROR");
+    frameErrors++;
+    return false;
+  }
+  int pos = 0;
+  uint32_t startIdx;
+  uint32_t num;
+  if ((!readVarint(buf, n, pos, startIdx)) || (!readVarint(buf, n, pos, num))){
+    frameErrors++;
+    return false;
+  }
+  if ((startIdx != (uint32_t)nextIdx) || (startIdx + num > (uint32_t)count)){
+    // lost or reordered frame: sender goes back to acknowledged index
+    frameErrors++;
+    return false;
+  }
+  int32_t px = 0;
+  int32_t py = 0;
+  for (uint32_t i=0; i < num; i++){
+    int32_t dx;
+    int32_t dy;
+    if ((!readZigzag(buf, n, pos, dx)) || (!readZigzag(buf, n, pos, dy))){
+      // keep points decoded so far (they are overwritten when the frame is resent)
+      frameErrors++;
+      return false;
+    }
+    px += dx;
+    py += dy;
+    maps.setPointCm(startIdx + i, px, py);
+  }
+  nextIdx += num;
+  frames++;
+  return true;
+}
@@ -0,0 +1,50 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  binary waypoint upload (AT+WB) - compact alternative to one ASCII AT+W line per few points
+
+  WB,0,count      begin upload: clear map and preallocate count points            answer: WB,0
+  WB,1,frame      points frame (base64, max MAP_FRAME_SIZE bytes decoded):         answer: WB,nextIdx
+                    varint startIdx, varint count,
+                    zig-zag varint px, py (cm) of first point, zig-zag varint deltas (cm) to previous point for the others,
+                    CRC32 (little endian) of all preceding bytes
+  after the last frame, continue with AT+N and AT+X (same as for AT+W uploads)
+
+  acknowledgements are cumulative (nextIdx = number of points received without gaps): the sender may send several
+  frames without waiting (window), frames not starting at nextIdx (lost, reordered, CRC error) are dropped and the
+  sender resends from the acknowledged index (go-back-N)
+  reference encoder: tools/mapupload.py
+*/
+
+#ifndef MAP_UPLOAD_H
+#define MAP_UPLOAD_H
+
+#include <Arduino.h>
+
+#define MAP_FRAME_SIZE 320    // max. decoded frame size (base64 line fits into 500 bytes command buffer)
+
+
+class MapUpload
+{
+  public:
+    int count;                 // points to upload
+    int nextIdx;               // next expected point
+    unsigned long frames;
+    unsigned long frameErrors; // CRC/format errors and out-of-order frames
+    MapUpload();
+    bool begin(int aCount);
+    // decodes frame into map points, returns false if frame was dropped
+    bool frame(const char *base64, int len);
+};
+
+extern MapUpload mapUpload;
+
+uint32_t crc32(const uint8_t *data, int len);
+// returns decoded length or -1 on error
+int base64Decode(const char *src, int len, uint8_t *dst, int maxLen);
+
+
+#endif
@@ -30,13 +30,18 @@ void Motor::begin() {
   wheelDiameter = WHEEL_DIAMETER; // wheel diameter (mm)
   ticksPerCm         = ((float)ticksPerRevolution) / (((float)wheelDiameter)/10.0) / 3.1415;    // computes encoder ticks per cm (do not change)  
 
-  motorLeftPID.Kp       = MOTOR_PID_KP;  // 2.0;  
-  motorLeftPID.Ki       = MOTOR_PID_KI;  // 0.03; 
-  motorLeftPID.Kd       = MOTOR_PID_KD;  // 0.03;
+  // speed control (may be replaced by motor auto-tune values, see loadMotorTuning)
+  // MOTOR_PID_KP/KI/KD are the tuned gains of the former incremental controller (pwm += KP*e + KI*Ta*sum(e) + KD/Ta*de,
+  // Ta = 20 ms control cycle): there KD/Ta acts as proportional and KP/Ta as integral gain of the positional PID
+  // (the small KI double integral term has no positional equivalent and is dropped)
+  speedKp = MOTOR_PID_KD / 0.02;
+  speedKi = MOTOR_PID_KP / 0.02;
+  speedKd = 0;
+  ffGainLeft = ffGainRight = MOTOR_FF_GAIN;
+  ffOffset = MOTOR_FF_OFFSET;
+  motorLeftPID.Kb = MOTOR_PID_KB;
   motorLeftPID.reset(); 
-  motorRightPID.Kp       = motorLeftPID.Kp;
-  motorRightPID.Ki       = motorLeftPID.Ki;
-  motorRightPID.Kd       = motorLeftPID.Kd;
+  motorRightPID.Kb = MOTOR_PID_KB;
   motorRightPID.reset();		 
 
   robotPitch = 0;
@@ -182,6 +187,10 @@ void Motor::enableTractionMotors(bool enable){
 }
 
 
+bool Motor::mowMotorOn(){
+  return (motorMowPWMSet != 0);
+}
+
 void Motor::setMowState(bool switchOn){
   //CONSOLE.print("Motor::setMowState ");
   //CONSOLE.println(switchOn);
@@ -507,28 +516,33 @@ void Motor::control(){
   //########################  Calculate PWM for left driving motor ############################
 
   motorLeftPID.TaMax = 0.1;
+  motorLeftPID.Kp = speedKp;
+  motorLeftPID.Ki = speedKi;
+  motorLeftPID.Kd = speedKd;
   motorLeftPID.x = motorLeftRpmCurr;
   motorLeftPID.w  = motorLeftRpmSet;
-  motorLeftPID.y_min = -pwmMax;
-  motorLeftPID.y_max = pwmMax;
+  motorLeftPID.ff = feedForward(motorLeftRpmSet, ffGainLeft);
+  // output restricted to set direction (anti wind-up knows the limits)
+  motorLeftPID.y_min = (motorLeftRpmSet >= 0) ? 0 : -pwmMax;     
+  motorLeftPID.y_max = (motorLeftRpmSet >= 0) ? pwmMax : 0;   
   motorLeftPID.max_output = pwmMax;
   motorLeftPID.compute();
-  motorLeftPWMCurr = motorLeftPWMCurr + motorLeftPID.y;
-  if (motorLeftRpmSet >= 0) motorLeftPWMCurr = min( max(0, (int)motorLeftPWMCurr), pwmMax); // 0.. pwmMax
-  if (motorLeftRpmSet < 0) motorLeftPWMCurr = max(-pwmMax, min(0, (int)motorLeftPWMCurr));  // -pwmMax..0
+  motorLeftPWMCurr = motorLeftPID.y;
 
   //########################  Calculate PWM for right driving motor ############################
   
   motorRightPID.TaMax = 0.1;
+  motorRightPID.Kp = speedKp;
+  motorRightPID.Ki = speedKi;
+  motorRightPID.Kd = speedKd;
   motorRightPID.x = motorRightRpmCurr;
   motorRightPID.w = motorRightRpmSet;
-  motorRightPID.y_min = -pwmMax;
-  motorRightPID.y_max = pwmMax;
+  motorRightPID.ff = feedForward(motorRightRpmSet, ffGainRight);
+  motorRightPID.y_min = (motorRightRpmSet >= 0) ? 0 : -pwmMax;
+  motorRightPID.y_max = (motorRightRpmSet >= 0) ? pwmMax : 0;
   motorRightPID.max_output = pwmMax;
   motorRightPID.compute();
-  motorRightPWMCurr = motorRightPWMCurr + motorRightPID.y;
-  if (motorRightRpmSet >= 0) motorRightPWMCurr = min( max(0, (int)motorRightPWMCurr), pwmMax);  // 0.. pwmMax
-  if (motorRightRpmSet < 0) motorRightPWMCurr = max(-pwmMax, min(0, (int)motorRightPWMCurr));   // -pwmMax..0  
+  motorRightPWMCurr = motorRightPID.y;
 
   if ((abs(motorLeftRpmSet) < 0.01) && (motorLeftPWMCurr < 30)) motorLeftPWMCurr = 0;
   if ((abs(motorRightRpmSet) < 0.01) && (motorRightPWMCurr < 30)) motorRightPWMCurr = 0;
@@ -577,6 +591,14 @@ void Motor::control(){
 }
 
 
+// feed-forward pwm for given rpm (static friction offset + linear gain)
+float Motor::feedForward(float rpm, float gain){
+  if ((gain <= 0) || (abs(rpm) < 0.01)) return 0;
+  if (rpm > 0) return ffOffset + gain * rpm;
+  return -ffOffset + gain * rpm;
+}
+
+
 void Motor::dumpOdoTicks(int seconds){
   int ticksLeft=0;
   int ticksRight=0;
@@ -726,3 +748,120 @@ void Motor::plot(){
   speedPWM(0, 0, 0);
   CONSOLE.println("motor plot done - please ignore any IMU/GPS errors");
 }
+
+
+// apply pwm step to both wheels for given duration (ms): measures ticks, time of first tick (ms after step) 
+// and steady-state rpm (last 500 ms)
+void Motor::stepResponse(int pwm, unsigned long duration, long &ticksLeft, long &ticksRight, 
+    unsigned long &firstTickLeft, unsigned long &firstTickRight, float &rpmLeft, float &rpmRight){
+  ticksLeft = ticksRight = 0;
+  firstTickLeft = firstTickRight = 0;
+  long windowTicksLeft = 0;
+  long windowTicksRight = 0;
+  unsigned long startTime = millis();
+  unsigned long windowTime = startTime + duration - 500;
+  unsigned long stopTime = startTime + duration;
+  unsigned long nextControlTime = 0;
+  speedPWM(pwm, pwm, 0);
+  while (millis() < stopTime){
+    if (millis() >= nextControlTime){
+      nextControlTime = millis() + 10;
+      int left = 0;
+      int right = 0;
+      int mow = 0;
+      motorDriver.getMotorEncoderTicks(left, right, mow);
+      unsigned long t = millis() - startTime;
+      if ((firstTickLeft == 0) && (ticksLeft == 0) && (left != 0)) firstTickLeft = max(t, 1UL);
+      if ((firstTickRight == 0) && (ticksRight == 0) && (right != 0)) firstTickRight = max(t, 1UL);
+      ticksLeft += left;
+      ticksRight += right;
+      if (millis() >= windowTime){
+        windowTicksLeft += left;
+        windowTicksRight += right;
+      }
+      speedPWM(pwm, pwm, 0);
+    }
+    watchdogReset();     
+    robotDriver.run();
+  }
+  rpmLeft = 60.0 * ((float)windowTicksLeft) / ((float)ticksPerRevolution) / 0.5;
+  rpmRight = 60.0 * ((float)windowTicksRight) / ((float)ticksPerRevolution) / 0.5;
+}
+
+
+// motor auto-tune (wheels must turn freely):
+// 1. two pwm steps identify static gain K (rpm per pwm) and friction offset (pwm) => feed-forward 
+// 2. the area above the first step response gives average residence time Tar = T + L (time constant + dead time), 
+//    the time of the first encoder tick separates dead time L
+// 3. IMC rule (closed loop time constant = T): KP = T / (K * (T + L)), KI = KP / T
+bool Motor::autoTune(){
+  CONSOLE.println("motor auto-tune - NOTE: lift robot so that the wheels can turn freely");
+  int pwm1 = pwmMax * 4 / 10;
+  int pwm2 = pwmMax * 8 / 10;
+  unsigned long duration = 2000;
+  long ticksLeft, ticksRight, ticks2Left, ticks2Right;
+  unsigned long firstTickLeft, firstTickRight, first2Left, first2Right;
+  float rpm1Left, rpm1Right, rpm2Left, rpm2Right;
+  // wait for standstill
+  stepResponse(0, 1000, ticksLeft, ticksRight, firstTickLeft, firstTickRight, rpm1Left, rpm1Right);
+  stepResponse(pwm1, duration, ticksLeft, ticksRight, firstTickLeft, firstTickRight, rpm1Left, rpm1Right);
+  stepResponse(pwm2, duration, ticks2Left, ticks2Right, first2Left, first2Right, rpm2Left, rpm2Right);
+  speedPWM(0, 0, 0);
+  stopImmediately(false);
+
+  float Kp[2], Ki[2], ffGain[2], offset[2];
+  long ticks[2] = {ticksLeft, ticksRight};
+  unsigned long firstTick[2] = {firstTickLeft, firstTickRight};
+  float rpm1[2] = {rpm1Left, rpm1Right};
+  float rpm2[2] = {rpm2Left, rpm2Right};
+  for (int i=0; i < 2; i++){
+    CONSOLE.print((i == 0) ? "left: " : "right: ");
+    CONSOLE.print("rpm1=");
+    CONSOLE.print(rpm1[i]);
+    CONSOLE.print(" rpm2=");
+    CONSOLE.print(rpm2[i]);
+    if ((rpm1[i] < 1.0) || (rpm2[i] <= rpm1[i]) || (firstTick[i] == 0)){
+      CONSOLE.println(" ERROR: no valid step response (check odometry)");
+      return false;
+    }
+    float K = (rpm2[i] - rpm1[i]) / ((float)(pwm2 - pwm1));   // rpm per pwm
+    offset[i] = max(0.0f, pwm1 - rpm1[i] / K);
+    float Tar = ((float)duration) / 1000.0 - (60.0 * ((float)ticks[i]) / ((float)ticksPerRevolution)) / rpm1[i];
+    // dead time: first tick minus time the (first order) motor needs for one tick
+    float T = Tar;
+    float L = 0;
+    for (int iter=0; iter < 5; iter++){
+      L = max(0.0f, ((float)firstTick[i]) / 1000.0f - sqrt(2.0 * T * 60.0 / (rpm1[i] * ticksPerRevolution)));
+      T = max(0.01f, Tar - L);
+    }
+    ffGain[i] = 1.0 / K;
+    Kp[i] = T / (K * (T + L));
+    Ki[i] = Kp[i] / T;
+    CONSOLE.print(" K=");
+    CONSOLE.print(K, 4);
+    CONSOLE.print(" offset=");
+    CONSOLE.print(offset[i]);
+    CONSOLE.print(" T=");
+    CONSOLE.print(T, 3);
+    CONSOLE.print(" L=");
+    CONSOLE.println(L, 3);
+  }
+  speedKp = (Kp[0] + Kp[1]) / 2;
+  speedKi = (Ki[0] + Ki[1]) / 2;
+  speedKd = 0;
+  ffGainLeft = ffGain[0];
+  ffGainRight = ffGain[1];
+  ffOffset = (offset[0] + offset[1]) / 2;
+  CONSOLE.print("motor auto-tune done: KP=");
+  CONSOLE.print(speedKp, 3);
+  CONSOLE.print(" KI=");
+  CONSOLE.print(speedKi, 3);
+  CONSOLE.print(" ffGain=");
+  CONSOLE.print(ffGainLeft, 3);
+  CONSOLE.print(",");
+  CONSOLE.print(ffGainRight, 3);
+  CONSOLE.print(" ffOffset=");
+  CONSOLE.println(ffOffset, 1);
+  CONSOLE.println("please ignore any IMU/GPS errors");
+  return true;
+}
@@ -56,13 +56,22 @@ class Motor {
     float motorRightSenseLPNorm;
     unsigned long motorMowSpinUpTime;
     bool motorRecoveryState;    
+    float speedKp;  // speed control PID coefficients (pwm per rpm...)
+    float speedKi;
+    float speedKd;
+    float ffGainLeft;  // feed-forward (pwm per rpm)
+    float ffGainRight;
+    float ffOffset;    // feed-forward pwm to overcome static friction
     void begin();
     void run();      
     void test();
     void plot();
+    // identify motors (step response) and compute feed-forward and speed control coefficients
+    bool autoTune();
     void enableTractionMotors(bool enable);
     void setLinearAngularSpeed(float linear, float angular, bool useLinearRamp = true);
     void setMowState(bool switchOn);   
+    bool mowMotorOn();  // mowing motor switched on?
     void setMowMaxPwm( int val );
     void stopImmediately(bool includeMowerMotor);
   protected: 
@@ -104,6 +113,9 @@ class Motor {
     bool checkCurrentTooLowError();
     void sense();
     void dumpOdoTicks(int seconds);    
+    float feedForward(float rpm, float gain);
+    void stepResponse(int pwm, unsigned long duration, long &ticksLeft, long &ticksRight, 
+      unsigned long &firstTickLeft, unsigned long &firstTickRight, float &rpmLeft, float &rpmRight);
 };
 
 
@@ -7,14 +7,87 @@
 #include "src/op/op.h"
 #include "reset.h"
 #include "timetable.h"
+#include "latency.h"
+
+#ifdef __linux__
+  #include <netdb.h>
+  #include <arpa/inet.h>
+#endif
 
 // mqtt
 #define MSG_BUFFER_SIZE	(50)
+#define MQTT_PUBLISH_INTERVAL   20000   // check values for changes (ms)
+#define MQTT_REFRESH_INTERVAL   300000  // publish all values, changed or not (ms)
+#define MQTT_CONNECT_TIMEOUT    5000    // TCP connect (ms)
+#define MQTT_BACKOFF_MIN        1000    // reconnect delay (ms), doubled on each failure
+#define MQTT_BACKOFF_MAX        60000
+#define MQTT_TX_SIZE            4096    // outbound queue (bytes)
+
 char mqttMsg[MSG_BUFFER_SIZE];
 unsigned long nextMQTTPublishTime = 0;
+unsigned long nextMQTTRefreshTime = 0;
 unsigned long nextMQTTLoopTime = 0;
+unsigned long nextMQTTConnectTime = 0;
+unsigned long mqttBackoff = MQTT_BACKOFF_MIN;
+bool mqttRefresh = false;
+
+// outbound queue: complete MQTT publish packets, each prefixed by length (uint16) and enqueue time (micros, uint32)
+uint8_t mqttTx[MQTT_TX_SIZE];
+int mqttTxHead = 0;
+int mqttTxLen = 0;
+
+#ifdef MQTT_JSON_STATE
+  String mqttJson;
+  bool mqttJsonChanged = false;
+#endif
+
+// statistics
+unsigned long mqttConnects = 0;
+unsigned long mqttConnectFailures = 0;
+unsigned long mqttConnectTime = 0;       // last connect (TCP + CONNACK) duration (ms)
+unsigned long mqttMaxConnectTime = 0;    // ms
+unsigned long mqttPublished = 0;         // packets sent
+unsigned long mqttSkipped = 0;           // values not sent (unchanged or within deadband)
+unsigned long mqttDropped = 0;           // packets dropped (outbound queue full)
+unsigned long mqttTxBytes = 0;
+unsigned long mqttAvgPublishLatency = 0; // enqueue to socket (us)
+unsigned long mqttMaxPublishLatency = 0; // us
+
+#ifdef __linux__
+  enum MqttConnState {
+    MQTT_CONN_IDLE,
+    MQTT_CONN_RESOLVING,    // host name resolution (background thread)
+    MQTT_CONN_CONNECTING,   // non-blocking TCP connect in progress
+  };
+  MqttConnState mqttConnState = MQTT_CONN_IDLE;
+  unsigned long mqttConnectStartTime = 0;
+  volatile int mqttResolveState = 0;  // 0: none, 1: running, 2: resolved, 3: failed
+  volatile uint32_t mqttServerIp = 0;
+#endif
 
 
+// last published value per topic (change detection)
+class MqttTopicState {
+  public:
+    bool valid;
+    double value;
+    uint32_t hash;   // hash of published text
+    MqttTopicState() : valid(false), value(0), hash(0) {}
+};
+
+
+void mqttClearStats(){
+  mqttConnects = 0;
+  mqttConnectFailures = 0;
+  mqttMaxConnectTime = 0;
+  mqttPublished = 0;
+  mqttSkipped = 0;
+  mqttDropped = 0;
+  mqttTxBytes = 0;
+  mqttAvgPublishLatency = 0;
+  mqttMaxPublishLatency = 0;
+}
+
 
 void mqttReconnect() {
   // Loop until we're reconnected
@@ -29,6 +102,7 @@ void mqttReconnect() {
     if (mqttClient.connect(clientId.c_str())) {
 #endif
       CONSOLE.println("MQTT: connected");
+      mqttConnects++;
       // Once connected, publish an announcement...
       //mqttClient.publish("outTopic", "hello world");
       // ... and resubscribe
@@ -36,7 +110,7 @@ void mqttReconnect() {
       mqttClient.subscribe(MQTT_TOPIC_PREFIX "/cmd");
     } else {
       CONSOLE.print("MQTT: failed, rc=");
-      CONSOLE.print(mqttClient.state());
+      CONSOLE.println(mqttClient.state());
     }
   }
 }
@@ -60,79 +134,356 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
   }
 }
 
-// define a macro so avoid repetitive code lines for sending single values via MQTT
-#define MQTT_PUBLISH(VALUE, FORMAT, TOPIC) \
+
+#ifdef __linux__
+// resolves MQTT_SERVER (getaddrinfo may block for seconds)
+void *mqttResolveThread(void *arg){
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if ((getaddrinfo(MQTT_SERVER, NULL, &hints, &res) == 0) && (res != NULL)){
+    mqttServerIp = ((struct sockaddr_in*)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    mqttResolveState = 2;
+  } else {
+    mqttResolveState = 3;
+  }
+  return NULL;
+}
+#endif
+
+// connect with backoff (Linux: background host name resolution and non-blocking TCP connect,
+// only the CONNACK wait is synchronous)
+void mqttConnect(){
+  if ((long)(millis() - nextMQTTConnectTime) < 0) return;
+  #ifdef __linux__
+    if (mqttConnState == MQTT_CONN_IDLE){
+      mqttConnectStartTime = millis();
+      if (mqttResolveState == 0){
+        struct in_addr addr;
+        if (inet_aton(MQTT_SERVER, &addr)){
+          mqttServerIp = addr.s_addr;
+          mqttResolveState = 2;
+        } else {
+          mqttResolveState = 1;
+          pthread_t t = thread_create(mqttResolveThread, NULL);
+          if (t == 0) mqttResolveState = 0;
+        }
+      }
+      if (mqttResolveState == 1) mqttConnState = MQTT_CONN_RESOLVING;
+    }
+    if (mqttConnState == MQTT_CONN_RESOLVING){
+      // connect once the address is cached (a late thread result is picked up by the next attempt)
+      if ((mqttResolveState == 1) && (millis() - mqttConnectStartTime < MQTT_CONNECT_TIMEOUT)) return;
+      mqttConnState = MQTT_CONN_IDLE;
+    }
+    if (mqttConnState == MQTT_CONN_IDLE){
+      espClient.stop();
+      if ((mqttResolveState == 2) && (espClient.connectAsync(IPAddress((uint32_t)mqttServerIp), MQTT_PORT))){
+        mqttConnectStartTime = millis();
+        mqttConnState = MQTT_CONN_CONNECTING;
+        return;
+      }
+    } else {
+      int res = espClient.connectPoll();
+      if ((res == 0) && (millis() - mqttConnectStartTime < MQTT_CONNECT_TIMEOUT)) return;
+      mqttConnState = MQTT_CONN_IDLE;
+      if (res > 0) mqttReconnect();   // TCP connected: PubSubClient sends CONNECT
+    }
+    unsigned long startTime = mqttConnectStartTime;
+  #else
+    unsigned long startTime = millis();
+    mqttReconnect();
+  #endif
+  if (mqttClient.connected()){
+    mqttConnectTime = millis() - startTime;
+    if (mqttConnectTime > mqttMaxConnectTime) mqttMaxConnectTime = mqttConnectTime;
+    mqttBackoff = MQTT_BACKOFF_MIN;
+    mqttTxHead = 0;
+    mqttTxLen = 0;
+    nextMQTTPublishTime = millis();
+    nextMQTTRefreshTime = millis();
+  } else {
+    mqttConnectFailures++;
+    espClient.stop();
+    #ifdef __linux__
+      if (mqttResolveState != 1) mqttResolveState = 0;  // resolve again (address may have changed)
+    #endif
+    CONSOLE.print("MQTT: retry in ");
+    CONSOLE.print(mqttBackoff);
+    CONSOLE.println(" ms");
+    nextMQTTConnectTime = millis() + mqttBackoff;
+    mqttBackoff *= 2;
+    if (mqttBackoff > MQTT_BACKOFF_MAX) mqttBackoff = MQTT_BACKOFF_MAX;
+  }
+}
+
+
+// encodes a QoS 0 publish packet into outbound queue (all or nothing)
+bool mqttEnqueue(const char *topic, const char *payload, int payloadLen){
+  int topicLen = strlen(topic);
+  unsigned long remaining = 2 + topicLen + payloadLen;
+  uint8_t header[8];
+  int headerLen = 0;
+  header[headerLen++] = MQTTPUBLISH;
+  unsigned long v = remaining;
+  do {
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    if (v > 0) b |= 0x80;
+    header[headerLen++] = b;
+  } while (v > 0);
+  header[headerLen++] = topicLen >> 8;
+  header[headerLen++] = topicLen & 0xFF;
+  int len = headerLen + topicLen + payloadLen;
+  if (6 + len > MQTT_TX_SIZE - mqttTxLen){
+    mqttDropped++;
+    return false;
+  }
+  uint8_t prefix[6];
+  unsigned long t = micros();
+  prefix[0] = len & 0xFF;
+  prefix[1] = len >> 8;
+  memcpy(prefix + 2, &t, 4);
+  const uint8_t *parts[4] = {prefix, header, (const uint8_t*)topic, (const uint8_t*)payload};
+  const int partLens[4] = {6, headerLen, topicLen, payloadLen};
+  int pos = (mqttTxHead + mqttTxLen) % MQTT_TX_SIZE;
+  for (int i=0; i < 4; i++){
+    for (int j=0; j < partLens[i]; j++){
+      mqttTx[pos] = parts[i][j];
+      pos++;
+      if (pos == MQTT_TX_SIZE) pos = 0;
+    }
+  }
+  mqttTxLen += 6 + len;
+  return true;
+}
+
+// sends queued packets (only complete packets, so PubSubClient packets never interleave with them)
+void mqttFlush(){
+  while (mqttTxLen > 0){
+    uint8_t prefix[6];
+    for (int i=0; i < 6; i++) prefix[i] = mqttTx[(mqttTxHead + i) % MQTT_TX_SIZE];
+    int len = prefix[0] | (prefix[1] << 8);
+    unsigned long t;
+    memcpy(&t, prefix + 2, 4);
+    #ifdef __linux__
+      if (espClient.availableForWrite() < len) return;
+    #endif
+    // packet may wrap around end of ring
+    int pos = (mqttTxHead + 6) % MQTT_TX_SIZE;
+    int len1 = (pos + len > MQTT_TX_SIZE) ? MQTT_TX_SIZE - pos : len;
+    int res = espClient.write(mqttTx + pos, len1);
+    if (len1 < len) res += espClient.write(mqttTx, len - len1);
+    if (res != len) {
+      // connection lost
+      mqttTxHead = 0;
+      mqttTxLen = 0;
+      return;
+    }
+    mqttTxHead = (mqttTxHead + 6 + len) % MQTT_TX_SIZE;
+    mqttTxLen -= 6 + len;
+    mqttPublished++;
+    mqttTxBytes += len;
+    unsigned long latency = micros() - t;
+    if (mqttAvgPublishLatency == 0) mqttAvgPublishLatency = latency;
+      else mqttAvgPublishLatency = (mqttAvgPublishLatency * 15 + latency) / 16;
+    if (latency > mqttMaxPublishLatency) mqttMaxPublishLatency = latency;
+  }
+}
+
+uint32_t mqttHash(const char *s){
+  // FNV-1a
+  uint32_t h = 2166136261UL;
+  while (*s) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+#ifdef MQTT_JSON_STATE
+// appends text as JSON string
+void mqttJsonAddText(const char *s){
+  mqttJson += "\"";
+  for (; *s; s++){
+    uint8_t ch = *s;
+    if ((ch == '"') || (ch == '\\')){
+      mqttJson += '\\';
+      mqttJson += (char)ch;
+    } else if (ch < 0x20){
+      char esc[8];
+      snprintf(esc, sizeof(esc), "\\u%04x", ch);
+      mqttJson += esc;
+    } else mqttJson += (char)ch;
+  }
+  mqttJson += "\"";
+}
+#endif
+
+// publishes text (mqttMsg) if value changed by at least deadband (deadband 0: if text changed)
+void mqttPublishValue(MqttTopicState &st, const char *topic, double deadband, bool isText){
+  uint32_t hash = mqttHash(mqttMsg);
+  double value = isText ? 0 : atof(mqttMsg);
+  bool finite = isfinite(value);
+  bool changed;
+  if (!st.valid) changed = true;
+    else if ((deadband > 0) && (finite) && (isfinite(st.value))) changed = (fabs(value - st.value) >= deadband);
+    else changed = (hash != st.hash);
+  #ifdef MQTT_JSON_STATE
+    // key: topic without prefix
+    const char *key = topic + strlen(MQTT_TOPIC_PREFIX "/");
+    if (mqttJson.length() > 1) mqttJson += ",";
+    mqttJsonAddText(key);
+    mqttJson += ":";
+    if (isText) mqttJsonAddText(mqttMsg);
+      else if (!finite) mqttJson += "null";   // nan/inf (e.g. no GPS fix yet) are not valid JSON
+      else mqttJson += mqttMsg;
+    if (changed) mqttJsonChanged = true;
+    else mqttSkipped++;
+  #else
+    if (!changed && !mqttRefresh){
+      mqttSkipped++;
+      return;
+    }
+    if (!mqttEnqueue(topic, mqttMsg, strlen(mqttMsg))) return;
+  #endif
+  if (changed){
+    st.valid = true;
+    st.value = value;
+    st.hash = hash;
+  }
+}
+
+// define macros so avoid repetitive code lines for sending single values via MQTT
+// each call site keeps its last published value
+#define MQTT_PUBLISH(VALUE, FORMAT, TOPIC, DEADBAND) { \
+      static MqttTopicState st; \
       snprintf (mqttMsg, MSG_BUFFER_SIZE, FORMAT, VALUE); \
-      mqttClient.publish(MQTT_TOPIC_PREFIX TOPIC, mqttMsg);    
+      mqttPublishValue(st, MQTT_TOPIC_PREFIX TOPIC, DEADBAND, false); }
+
+#define MQTT_PUBLISH_TEXT(VALUE, TOPIC) { \
+      static MqttTopicState st; \
+      snprintf (mqttMsg, MSG_BUFFER_SIZE, "%s", VALUE); \
+      mqttPublishValue(st, MQTT_TOPIC_PREFIX TOPIC, 0, true); }
 
 
 // process MQTT input/output (subcriber/publisher)
 void processWifiMqttClient()
 {
+  LATENCY_SCOPE(LAT_MQTT);
   if (!ENABLE_MQTT) return; 
+  #ifdef __linux__
+    if (mqttConnState == MQTT_CONN_CONNECTING){
+      mqttConnect();
+      return;
+    }
+  #endif
+  if (!mqttClient.connected()){
+    mqttConnect();
+    return;
+  }
+  mqttFlush();
   if (millis() >= nextMQTTPublishTime){
-    nextMQTTPublishTime = millis() + 20000;
-    if (mqttClient.connected()) {
-      updateStateOpText();
-      // operational state
-      //CONSOLE.println("MQTT: publishing " MQTT_TOPIC_PREFIX "/status");      
-      MQTT_PUBLISH(stateOpText.c_str(), "%s", "/op")
-      MQTT_PUBLISH(maps.percentCompleted, "%d", "/progress")
-
-      // GPS related information
+    nextMQTTPublishTime = millis() + MQTT_PUBLISH_INTERVAL;
+    mqttRefresh = (millis() >= nextMQTTRefreshTime);
+    if (mqttRefresh) nextMQTTRefreshTime = millis() + MQTT_REFRESH_INTERVAL;
+    #ifdef MQTT_JSON_STATE
+      mqttJson = "{";
+      mqttJsonChanged = false;
+    #endif
+    updateStateOpText();
+    // operational state
+    //CONSOLE.println("MQTT: publishing " MQTT_TOPIC_PREFIX "/status");      
+    MQTT_PUBLISH_TEXT(stateOpText.c_str(), "/op")
+    MQTT_PUBLISH(maps.percentCompleted, "%d", "/progress", 0)
+    MQTT_PUBLISH(coverage.percentCovered(), "%d", "/coverage", 0)
+
+    // GPS related information
+    {
+      static MqttTopicState st;
       snprintf (mqttMsg, MSG_BUFFER_SIZE, "%.2f, %.2f", gps.relPosN, gps.relPosE);          
-      mqttClient.publish(MQTT_TOPIC_PREFIX "/gps/pos", mqttMsg);
-      MQTT_PUBLISH(gpsSolText.c_str(), "%s", "/gps/sol")
-      MQTT_PUBLISH(gps.iTOW, "%lu", "/gps/tow")
-      
-      MQTT_PUBLISH(gps.lon, "%.8f", "/gps/lon")
-      MQTT_PUBLISH(gps.lat, "%.8f", "/gps/lat")
-      MQTT_PUBLISH(gps.height, "%.1f", "/gps/height")
-      MQTT_PUBLISH(gps.relPosN, "%.4f", "/gps/relNorth")
-      MQTT_PUBLISH(gps.relPosE, "%.4f", "/gps/relEast")
-      MQTT_PUBLISH(gps.relPosD, "%.2f", "/gps/relDist")
-      MQTT_PUBLISH((millis()-gps.dgpsAge)/1000.0, "%.2f","/gps/ageDGPS")
-      MQTT_PUBLISH(gps.accuracy, "%.2f", "/gps/accuracy")
-      MQTT_PUBLISH(gps.groundSpeed, "%.4f", "/gps/groundSpeed")
-      
-      // power related information      
-      MQTT_PUBLISH(battery.batteryVoltage, "%.2f", "/power/battery/voltage")
-      MQTT_PUBLISH(motor.motorsSenseLP, "%.2f", "/power/motor/current")
-      MQTT_PUBLISH(battery.chargingVoltage, "%.2f", "/power/battery/charging/voltage")
-      MQTT_PUBLISH(battery.chargingCurrent, "%.2f", "/power/battery/charging/current")
-
-      // map related information
-      MQTT_PUBLISH(maps.targetPoint.x(), "%.2f", "/map/targetPoint/X")
-      MQTT_PUBLISH(maps.targetPoint.y(), "%.2f", "/map/targetPoint/Y")
-      MQTT_PUBLISH(stateX, "%.2f", "/map/pos/X")
-      MQTT_PUBLISH(stateY, "%.2f", "/map/pos/Y")
-      MQTT_PUBLISH(stateDelta, "%.2f", "/map/pos/Dir")
-
-      // statistics
-      MQTT_PUBLISH((int)statIdleDuration, "%d", "/stats/idleDuration")
-      MQTT_PUBLISH((int)statChargeDuration, "%d", "/stats/chargeDuration")
-      MQTT_PUBLISH((int)statMowDuration, "%d", "/stats/mow/totalDuration")
-      MQTT_PUBLISH((int)statMowDurationInvalid, "%d", "/stats/mow/invalidDuration")
-      MQTT_PUBLISH((int)statMowDurationFloat, "%d", "/stats/mow/floatDuration")
-      MQTT_PUBLISH((int)statMowDurationFix, "%d", "/stats/mow/fixDuration")
-      MQTT_PUBLISH((int)statMowFloatToFixRecoveries, "%d", "/stats/mow/floatToFixRecoveries")
-      MQTT_PUBLISH((int)statMowObstacles, "%d", "/stats/mow/obstacles")
-      MQTT_PUBLISH((int)statMowGPSMotionTimeoutCounter, "%d", "/stats/mow/gpsMotionTimeouts")
-      MQTT_PUBLISH((int)statMowBumperCounter, "%d", "/stats/mow/bumperEvents")
-      MQTT_PUBLISH((int)statMowSonarCounter, "%d", "/stats/mow/sonarEvents")
-      MQTT_PUBLISH((int)statMowLiftCounter, "%d", "/stats/mow/liftEvents")
-      MQTT_PUBLISH(statMowMaxDgpsAge, "%.2f", "/stats/mow/maxDgpsAge")
-      MQTT_PUBLISH(statMowDistanceTraveled, "%.1f", "/stats/mow/distanceTraveled")
-      MQTT_PUBLISH((int)statMowInvalidRecoveries, "%d", "/stats/mow/invalidRecoveries")
-      MQTT_PUBLISH((int)statImuRecoveries, "%d", "/stats/imuRecoveries")
-      MQTT_PUBLISH((int)statGPSJumps, "%d", "/stats/gpsJumps")      
-      MQTT_PUBLISH(statTempMin, "%.1f", "/stats/tempMin")
-      MQTT_PUBLISH(statTempMax, "%.1f", "/stats/tempMax")
-      MQTT_PUBLISH(stateTemp, "%.1f", "/stats/curTemp")
+      mqttPublishValue(st, MQTT_TOPIC_PREFIX "/gps/pos", 0, true);
+    }
+    MQTT_PUBLISH_TEXT(gpsSolText.c_str(), "/gps/sol")
+    MQTT_PUBLISH(gps.iTOW, "%lu", "/gps/tow", 0)
+    
+    MQTT_PUBLISH(gps.lon, "%.8f", "/gps/lon", 0.0000002)
+    MQTT_PUBLISH(gps.lat, "%.8f", "/gps/lat", 0.0000002)
+    MQTT_PUBLISH(gps.height, "%.1f", "/gps/height", 0.2)
+    MQTT_PUBLISH(gps.relPosN, "%.4f", "/gps/relNorth", 0.02)
+    MQTT_PUBLISH(gps.relPosE, "%.4f", "/gps/relEast", 0.02)
+    MQTT_PUBLISH(gps.relPosD, "%.2f", "/gps/relDist", 0.05)
+    MQTT_PUBLISH((millis()-gps.dgpsAge)/1000.0, "%.2f","/gps/ageDGPS", 5.0)
+    MQTT_PUBLISH(gps.accuracy, "%.2f", "/gps/accuracy", 0.02)
+    MQTT_PUBLISH(gps.groundSpeed, "%.4f", "/gps/groundSpeed", 0.05)
+    
+    // power related information      
+    MQTT_PUBLISH(battery.batteryVoltage, "%.2f", "/power/battery/voltage", 0.1)
+    MQTT_PUBLISH(motor.motorsSenseLP, "%.2f", "/power/motor/current", 0.1)
+    MQTT_PUBLISH(battery.chargingVoltage, "%.2f", "/power/battery/charging/voltage", 0.1)
+    MQTT_PUBLISH(battery.chargingCurrent, "%.2f", "/power/battery/charging/current", 0.05)
 
-    } else {
-      mqttReconnect();  
+    // map related information
+    MQTT_PUBLISH(maps.targetPoint.x(), "%.2f", "/map/targetPoint/X", 0)
+    MQTT_PUBLISH(maps.targetPoint.y(), "%.2f", "/map/targetPoint/Y", 0)
+    MQTT_PUBLISH(stateX, "%.2f", "/map/pos/X", 0.05)
+    MQTT_PUBLISH(stateY, "%.2f", "/map/pos/Y", 0.05)
+    MQTT_PUBLISH(stateDelta, "%.2f", "/map/pos/Dir", 0.05)
+
+    // statistics (durations in s)
+    MQTT_PUBLISH((int)statIdleDuration, "%d", "/stats/idleDuration", 60)
+    MQTT_PUBLISH((int)statChargeDuration, "%d", "/stats/chargeDuration", 60)
+    MQTT_PUBLISH((int)statMowDuration, "%d", "/stats/mow/totalDuration", 60)
+    MQTT_PUBLISH((int)statMowDurationInvalid, "%d", "/stats/mow/invalidDuration", 60)
+    MQTT_PUBLISH((int)statMowDurationFloat, "%d", "/stats/mow/floatDuration", 60)
+    MQTT_PUBLISH((int)statMowDurationFix, "%d", "/stats/mow/fixDuration", 60)
+    MQTT_PUBLISH((int)statMowFloatToFixRecoveries, "%d", "/stats/mow/floatToFixRecoveries", 0)
+    MQTT_PUBLISH((int)statMowObstacles, "%d", "/stats/mow/obstacles", 0)
+    MQTT_PUBLISH((int)statMowGPSMotionTimeoutCounter, "%d", "/stats/mow/gpsMotionTimeouts", 0)
+    MQTT_PUBLISH((int)statMowBumperCounter, "%d", "/stats/mow/bumperEvents", 0)
+    MQTT_PUBLISH((int)statMowSonarCounter, "%d", "/stats/mow/sonarEvents", 0)
+    MQTT_PUBLISH((int)statMowLiftCounter, "%d", "/stats/mow/liftEvents", 0)
+    MQTT_PUBLISH(statMowMaxDgpsAge, "%.2f", "/stats/mow/maxDgpsAge", 0)
+    MQTT_PUBLISH(statMowDistanceTraveled, "%.1f", "/stats/mow/distanceTraveled", 1.0)
+    MQTT_PUBLISH((int)statMowInvalidRecoveries, "%d", "/stats/mow/invalidRecoveries", 0)
+    MQTT_PUBLISH((int)statImuRecoveries, "%d", "/stats/imuRecoveries", 0)
+    MQTT_PUBLISH((int)statGPSJumps, "%d", "/stats/gpsJumps", 0)      
+    MQTT_PUBLISH(statTempMin, "%.1f", "/stats/tempMin", 0)
+    MQTT_PUBLISH(statTempMax, "%.1f", "/stats/tempMax", 0)
+    MQTT_PUBLISH(stateTemp, "%.1f", "/stats/curTemp", 0.5)
+    // ranging (cm, ms)
+    MQTT_PUBLISH(sonar.distanceLeft, "%u", "/stats/range/sonarLeft", 5)
+    MQTT_PUBLISH(sonar.distanceCenter, "%u", "/stats/range/sonarCenter", 5)
+    MQTT_PUBLISH(sonar.distanceRight, "%u", "/stats/range/sonarRight", 5)
+    MQTT_PUBLISH(sonar.distanceToF, "%u", "/stats/range/tof", 5)
+    MQTT_PUBLISH(sonar.obstacleLatency, "%u", "/stats/range/obstacleLatency", 0)
+    MQTT_PUBLISH(sonar.maxObstacleLatency, "%u", "/stats/range/maxObstacleLatency", 0)
+    // MQTT link (ms, us)
+    MQTT_PUBLISH(mqttConnectTime, "%lu", "/stats/mqtt/connectTime", 0)
+    MQTT_PUBLISH(mqttMaxConnectTime, "%lu", "/stats/mqtt/maxConnectTime", 0)
+    MQTT_PUBLISH(mqttAvgPublishLatency, "%lu", "/stats/mqtt/avgPublishLatency", 1000)
+    MQTT_PUBLISH(mqttMaxPublishLatency, "%lu", "/stats/mqtt/maxPublishLatency", 1000)
+    MQTT_PUBLISH(mqttDropped, "%lu", "/stats/mqtt/dropped", 0)
+    // latency histograms (us)
+    static MqttTopicState latP99[LAT_COUNT];
+    static MqttTopicState latMax[LAT_COUNT];
+    for (int i=0; i < LAT_COUNT; i++){
+      char topic[64];
+      snprintf(topic, sizeof(topic), MQTT_TOPIC_PREFIX "/latency/%s/p99", latencyNames[i]);
+      snprintf(mqttMsg, MSG_BUFFER_SIZE, "%lu", latencies[i].percentile(99));
+      mqttPublishValue(latP99[i], topic, 0, false);
+      snprintf(topic, sizeof(topic), MQTT_TOPIC_PREFIX "/latency/%s/max", latencyNames[i]);
+      snprintf(mqttMsg, MSG_BUFFER_SIZE, "%lu", latencies[i].maxTime);
+      mqttPublishValue(latMax[i], topic, 0, false);
     }
+    #ifdef MQTT_JSON_STATE
+      mqttJson += "}";
+      if (mqttJsonChanged || mqttRefresh) mqttEnqueue(MQTT_TOPIC_PREFIX "/state", mqttJson.c_str(), mqttJson.length());
+    #endif
+    mqttFlush();
   }
   if (millis() > nextMQTTLoopTime){
     nextMQTTLoopTime = millis() + 20000;
@@ -140,4 +491,3 @@ void processWifiMqttClient()
   }
 }
 
-
@@ -3,9 +3,22 @@
 
 #include <Arduino.h>
 
+// MQTT link statistics
+extern unsigned long mqttConnects;
+extern unsigned long mqttConnectFailures;
+extern unsigned long mqttConnectTime;       // last connect (TCP + CONNACK) duration (ms)
+extern unsigned long mqttMaxConnectTime;    // ms
+extern unsigned long mqttPublished;         // packets sent
+extern unsigned long mqttSkipped;           // values not sent (unchanged or within deadband)
+extern unsigned long mqttDropped;           // packets dropped (outbound queue full)
+extern unsigned long mqttTxBytes;
+extern unsigned long mqttAvgPublishLatency; // enqueue to socket (us)
+extern unsigned long mqttMaxPublishLatency; // us
+
 void mqttReconnect();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 void processWifiMqttClient();
+void mqttClearStats();
 
 
 #endif
@@ -2,7 +2,7 @@
    How to find out P,I,D:
     1. Increase P until system starts to oscillate
     2. Set I =0.6 * P and D = 0.125 * P 
-   
+   (for motor speed control, use the motor auto-tune instead)
 */
 
 #include "pid.h"
@@ -12,24 +12,30 @@ PID::PID()
 {
   consoleWarnTimeout = 0;
   lastControlTime = 0;
+  ff = 0;
+  Kb = 0;
 }
     
 PID::PID(float Kp, float Ki, float Kd){
   this->Kp = Kp;
   this->Ki = Ki;
   this->Kd = Kd;
+  consoleWarnTimeout = 0;
+  lastControlTime = 0;
+  ff = 0;
+  Kb = 0;
 }
 
 
 void PID::reset(void) {
   this->eold = 0;
   this->esum = 0;
-  lastControlTime = millis();
+  lastControlTime = micros();
 }
 
 float PID::compute() {
-  unsigned long now = millis();
-  Ta = ((float)(now - lastControlTime)) / 1000.0;
+  unsigned long now = micros();
+  Ta = ((float)(now - lastControlTime)) / 1000000.0;
   //printf("%.3f\n", Ta);
   lastControlTime = now;
   if (Ta > TaMax) {
@@ -45,18 +51,28 @@ float PID::compute() {
 
   // compute error
   float e = (w - x);
-  // integrate error
-  esum += e;
-  // anti wind-up
-  if (esum < -max_output)  esum = -max_output;
-  if (esum > max_output)  esum = max_output;
-  y = Kp * e
-      + Ki * Ta * esum
-      + Kd/Ta * (e - eold);
+  float yff = ff;
+  if (yff > y_max) yff = y_max;
+  if (yff < y_min) yff = y_min;
+  float u = yff
+      + Kp * e
+      + esum
+      + ((Ta > 0) ? Kd/Ta * (e - eold) : 0);
   eold = e;
   // restrict output to min/max
+  y = u;
   if (y > y_max) y = y_max;
   if (y < y_min) y = y_min;
+  // integrate error (scaled by sample time)
+  esum += Ta * Ki * e;
+  // back-calculation anti wind-up: pull integral part back towards zero while output is saturated
+  float back = Ta * Kb * (y - u);
+  if (((esum > 0) && (back < 0)) || ((esum < 0) && (back > 0))){
+    if (fabs(back) > fabs(esum)) esum = 0;
+      else esum += back;
+  }
+  if (esum < -max_output)  esum = -max_output;
+  if (esum > max_output)  esum = max_output;
 
   return y;
 }
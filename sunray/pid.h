@@ -5,7 +5,9 @@
 
 
 /*
-  digital PID controller
+  digital PID controller (positional form, measured sample time)
+  y = ff + Kp * e + integral(Ki * e) + Kd * de/dt
+  anti wind-up: back-calculation (integral is pulled back by Kb * (saturated output - unsaturated output))
 */
 
 class PID
@@ -19,7 +21,8 @@ class PID
     double Ta; // sampling time	
     float w; // set value
     float x; // current value
-    float esum; // error sum
+    float ff; // feed-forward control output
+    float esum; // integral part of control output
     float eold; // last error
     float y;   // control output
     float y_min; // minimum control output
@@ -28,6 +31,7 @@ class PID
     float Kp;   // proportional control
     float Ki;   // integral control
     float Kd;   // differential control
+    float Kb;   // back-calculation anti wind-up (1/s)
     unsigned long lastControlTime;
     unsigned long consoleWarnTimeout;
 };
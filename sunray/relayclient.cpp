@@ -0,0 +1,318 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "relayclient.h"
+#include "config.h"
+
+#ifdef __linux__
+  #include <netdb.h>
+  #include <arpa/inet.h>
+  #include <sys/socket.h>
+#endif
+
+
+RelayClient relayClient;
+
+
+RelayClient::RelayClient(){
+  state = RELAY_IDLE;
+  nextConnectTime = 0;
+  connectTimeout = 0;
+  lastRxTime = 0;
+  rxLen = 0;
+  txHead = 0;
+  txLen = 0;
+  cmdCount = 0;
+  backoff = RELAY_BACKOFF_MIN;
+  #ifdef __linux__
+    resolveState = 0;
+    hostIp = 0;
+  #endif
+  clearStats();
+}
+
+void RelayClient::clearStats(){
+  connects = 0;
+  failures = 0;
+  disconnects = 0;
+  idleReconnects = 0;
+  requests = 0;
+  rxOverflows = 0;
+  txDropped = 0;
+  health = 0;
+}
+
+#ifdef __linux__
+// resolves RELAY_HOST (getaddrinfo may block for seconds)
+void *RelayClient::resolveThread(void *arg){
+  RelayClient *relay = (RelayClient*)arg;
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if ((getaddrinfo(RELAY_HOST, NULL, &hints, &res) == 0) && (res != NULL)){
+    relay->hostIp = ((struct sockaddr_in*)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    relay->resolveState = 2;
+  } else {
+    relay->resolveState = 3;
+  }
+  return NULL;
+}
+#endif
+
+void RelayClient::startConnect(){
+  rxLen = 0;
+  txHead = 0;
+  txLen = 0;
+  cmdCount = 0;
+  #ifdef __linux__
+    if (resolveState != 2){
+      if (resolveState == 1) return;  // still running
+      CONSOLE.println("WIF: resolving..." RELAY_HOST);
+      resolveState = 1;
+      pthread_t t = thread_create(resolveThread, this);
+      if (t == 0){
+        resolveState = 0;
+        failed("no thread");
+        return;
+      }
+      state = RELAY_RESOLVING;
+      connectTimeout = millis() + RELAY_CONNECT_TIMEOUT;
+      return;
+    }
+    CONSOLE.println("WIF: connecting..." RELAY_HOST);
+    if (!client.connectAsync(IPAddress((uint32_t)hostIp), RELAY_PORT)){
+      failed("connect");
+      return;
+    }
+    state = RELAY_CONNECTING;
+    connectTimeout = millis() + RELAY_CONNECT_TIMEOUT;
+  #else
+    // WiFiEsp (AT firmware) has no non-blocking connect
+    CONSOLE.println("WIF: connecting..." RELAY_HOST);
+    if (!client.connect(RELAY_HOST, RELAY_PORT)){
+      failed("connect");
+      return;
+    }
+    connected();
+  #endif
+}
+
+void RelayClient::connected(){
+  CONSOLE.println("WIF: connected!");
+  state = RELAY_CONNECTED;
+  connects++;
+  health = 0;
+  backoff = RELAY_BACKOFF_MIN;
+  lastRxTime = millis();
+  String s = "GET / HTTP/1.1\r\n";
+  s += "Host: " RELAY_USER "." RELAY_MACHINE "." RELAY_HOST ":";
+  s += String(RELAY_PORT) + "\r\n";
+  s += "Content-Length: 0\r\n";
+  s += "\r\n\r\n";
+  queue(s.c_str(), s.length());
+}
+
+void RelayClient::failed(const char *reason){
+  client.stop();
+  failures++;
+  health++;
+  #ifdef __linux__
+    if (resolveState != 1) resolveState = 0;  // resolve again (address may have changed)
+  #endif
+  CONSOLE.print("WIF: connection failed (");
+  CONSOLE.print(reason);
+  CONSOLE.print(") - retry in ");
+  CONSOLE.print(backoff);
+  CONSOLE.println(" ms");
+  state = RELAY_IDLE;
+  nextConnectTime = millis() + backoff;
+  backoff *= 2;
+  if (backoff > RELAY_BACKOFF_MAX) backoff = RELAY_BACKOFF_MAX;
+}
+
+void RelayClient::disconnect(){
+  client.stop();
+  state = RELAY_IDLE;
+  nextConnectTime = millis() + RELAY_BACKOFF_MIN;
+}
+
+// appends data to outbound ring (all or nothing)
+bool RelayClient::queue(const char *data, int len){
+  if (len > RELAY_TX_SIZE - txLen) return false;
+  int pos = (txHead + txLen) % RELAY_TX_SIZE;
+  for (int i=0; i < len; i++){
+    tx[pos] = data[i];
+    pos++;
+    if (pos == RELAY_TX_SIZE) pos = 0;
+  }
+  txLen += len;
+  return true;
+}
+
+void RelayClient::sendData(){
+  while (txLen > 0){
+    int len = txLen;
+    if (txHead + len > RELAY_TX_SIZE) len = RELAY_TX_SIZE - txHead;  // contiguous part
+    #ifdef __linux__
+      int space = client.availableForWrite();
+      if (space <= 0) return;
+      if (len > space) len = space;
+    #endif
+    int res = client.write((const uint8_t*)tx + txHead, len);
+    if (res <= 0) return;
+    txHead = (txHead + res) % RELAY_TX_SIZE;
+    txLen -= res;
+  }
+}
+
+// returns true if a complete request was moved into command queue
+bool RelayClient::parseRequest(){
+  int headerLen = -1;
+  for (int i=3; i < rxLen; i++){
+    if ((rx[i-3] == '\r') && (rx[i-2] == '\n') && (rx[i-1] == '\r') && (rx[i] == '\n')){
+      headerLen = i + 1;
+      break;
+    }
+  }
+  if (headerLen < 0) return false;
+  // Content-Length (case insensitive)
+  int contentLen = -1;
+  const char *key = "content-length:";
+  int keyLen = strlen(key);
+  for (int i=0; i + keyLen <= headerLen; i++){
+    int j = 0;
+    while ((j < keyLen) && (tolower(rx[i+j]) == key[j])) j++;
+    if (j < keyLen) continue;
+    contentLen = 0;
+    for (int k=i+keyLen; k < headerLen; k++){
+      if (rx[k] == ' ') continue;
+      if ((rx[k] < '0') || (rx[k] > '9')) break;
+      contentLen = contentLen * 10 + (rx[k] - '0');
+    }
+    break;
+  }
+  int bodyLen;
+  if (contentLen >= 0){
+    if (headerLen + contentLen > RELAY_RX_SIZE){
+      rxOverflows++;
+      rxLen = 0;
+      return false;
+    }
+    if (rxLen < headerLen + contentLen) return false;
+    bodyLen = contentLen;
+  } else {
+    // no Content-Length: body ends when no more data arrives
+    if (millis() - lastRxTime < RELAY_BODY_TIMEOUT) return false;
+    bodyLen = rxLen - headerLen;
+  }
+  String &cmd = cmds[cmdCount++];
+  cmd = "";
+  cmd.reserve(bodyLen);
+  for (int i=0; i < bodyLen; i++) cmd += rx[headerLen + i];
+  int used = headerLen + bodyLen;
+  memmove(rx, rx + used, rxLen - used);
+  rxLen -= used;
+  requests++;
+  return true;
+}
+
+void RelayClient::receiveData(){
+  while (cmdCount < RELAY_CMD_QUEUE){
+    int avail = client.available();
+    if (avail > 0){
+      if (rxLen == RELAY_RX_SIZE){
+        // request does not fit
+        rxOverflows++;
+        rxLen = 0;
+      }
+      int len = RELAY_RX_SIZE - rxLen;
+      if (len > avail) len = avail;
+      int res = client.read((uint8_t*)rx + rxLen, len);
+      if (res <= 0) return;
+      rxLen += res;
+      lastRxTime = millis();
+    }
+    if (!parseRequest()) return;
+  }
+}
+
+// relay server closed connection (all data read)
+bool RelayClient::peerClosed(){
+  #ifdef __linux__
+    if (client.available() > 0) return false;
+    char c;
+    return (recv(client.fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0);
+  #else
+    return false;
+  #endif
+}
+
+void RelayClient::run(){
+  switch (state){
+    case RELAY_IDLE:
+      if ((long)(millis() - nextConnectTime) >= 0) startConnect();
+      break;
+    #ifdef __linux__
+      case RELAY_RESOLVING:
+        if (resolveState == 2) startConnect();
+          else if (resolveState == 3) failed("resolve");
+          else if ((long)(millis() - connectTimeout) >= 0) failed("resolve timeout");  // thread result is picked up later
+        break;
+      case RELAY_CONNECTING:
+        {
+          int res = client.connectPoll();
+          if (res > 0) connected();
+            else if (res < 0) failed("connect");
+            else if ((long)(millis() - connectTimeout) >= 0) failed("connect timeout");
+        }
+        break;
+    #endif
+    case RELAY_CONNECTED:
+      if (!client.connected() || peerClosed()){
+        CONSOLE.println("WIF: relay disconnected");
+        disconnects++;
+        disconnect();
+        break;
+      }
+      receiveData();
+      sendData();
+      if ((millis() - lastRxTime > RELAY_IDLE_TIMEOUT) && (txLen == 0) && (cmdCount == 0)){
+        idleReconnects++;
+        client.stop();
+        state = RELAY_IDLE;
+        nextConnectTime = millis();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+bool RelayClient::receive(String &cmd){
+  if (cmdCount == 0) return false;
+  cmd = cmds[0];
+  cmdCount--;
+  for (int i=0; i < cmdCount; i++) cmds[i] = cmds[i+1];
+  return true;
+}
+
+void RelayClient::respond(const String &response){
+  if (state != RELAY_CONNECTED) return;
+  String s = "HTTP/1.1 200 OK\r\n";
+  s += "Host: " RELAY_USER "." RELAY_MACHINE "." RELAY_HOST ":";
+  s += String(RELAY_PORT) + "\r\n";
+  s += "Access-Control-Allow-Origin: *\r\n";
+  s += "Content-Type: text/html\r\n";
+  s += "Connection: close\r\n";  // the connection will be closed after completion of the response
+  s += "Content-length: ";
+  s += String(response.length());
+  s += "\r\n\r\n";
+  s += response;
+  if (!queue(s.c_str(), s.length())) txDropped++;
+  sendData();
+}
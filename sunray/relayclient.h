@@ -0,0 +1,99 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  relay server client (see ENABLE_RELAY)
+
+  client (app) --->  relay server  <--- client (robot)
+
+  connection state machine that never blocks the control loop: host name resolution (background thread) and
+  connect are non-blocking (Linux), requests are parsed incrementally into a bounded command queue and
+  responses are sent from a bounded outbound queue as far as the socket accepts them.
+  failed connects are retried with exponential backoff (RELAY_BACKOFF_MIN...RELAY_BACKOFF_MAX).
+  the control loop only exchanges parsed commands and responses (receive/respond).
+*/
+
+#ifndef RELAY_CLIENT_H
+#define RELAY_CLIENT_H
+
+#include <Arduino.h>
+#ifdef __linux__
+  #include <BridgeClient.h>
+#else
+  #include "src/esp/WiFiEsp.h"
+#endif
+
+#define RELAY_BACKOFF_MIN      1000    // ms
+#define RELAY_BACKOFF_MAX      60000   // ms
+#define RELAY_CONNECT_TIMEOUT  5000    // ms
+#define RELAY_IDLE_TIMEOUT     10000   // reconnect if no request within this time (ms)
+#define RELAY_BODY_TIMEOUT     200     // request body complete if no data within this time (no Content-Length)
+#define RELAY_RX_SIZE          1024    // max. request size (header + body)
+#define RELAY_TX_SIZE          4096    // outbound queue (bytes)
+#define RELAY_CMD_QUEUE        2       // parsed commands
+
+
+enum RelayState {
+  RELAY_IDLE,          // waiting for next connect attempt
+  RELAY_RESOLVING,     // host name resolution (Linux)
+  RELAY_CONNECTING,    // non-blocking connect in progress (Linux)
+  RELAY_CONNECTED,     // registered at relay server, exchanging requests/responses
+};
+
+
+class RelayClient
+{
+  public:
+    RelayState state;
+    // statistics
+    unsigned long connects;         // successful connects
+    unsigned long failures;         // failed connect attempts (resolve, connect, timeout)
+    unsigned long disconnects;      // connection lost
+    unsigned long idleReconnects;   // reconnects due to RELAY_IDLE_TIMEOUT
+    unsigned long requests;         // parsed requests
+    unsigned long rxOverflows;      // requests dropped (larger than RELAY_RX_SIZE)
+    unsigned long txDropped;        // responses dropped (outbound queue full)
+    unsigned long health;           // consecutive failed connect attempts (0: healthy)
+    unsigned long backoff;          // current reconnect delay (ms)
+    RelayClient();
+    // network I/O, never blocks
+    void run();
+    // next parsed command (request body)
+    bool receive(String &cmd);
+    // queues HTTP response for last received command
+    void respond(const String &response);
+    int txQueued(){ return txLen; }
+    void clearStats();
+  protected:
+    WiFiEspClient client;
+    unsigned long nextConnectTime;
+    unsigned long connectTimeout;
+    unsigned long lastRxTime;
+    char rx[RELAY_RX_SIZE];
+    int rxLen;
+    char tx[RELAY_TX_SIZE];  // ring
+    int txHead;
+    int txLen;
+    String cmds[RELAY_CMD_QUEUE];
+    int cmdCount;
+    #ifdef __linux__
+      volatile int resolveState;  // 0: none, 1: running, 2: resolved, 3: failed
+      volatile uint32_t hostIp;
+      static void *resolveThread(void *arg);
+    #endif
+    void startConnect();
+    void connected();
+    void failed(const char *reason);
+    void disconnect();
+    bool peerClosed();
+    bool queue(const char *data, int len);
+    void receiveData();
+    bool parseRequest();
+    void sendData();
+};
+
+extern RelayClient relayClient;
+
+#endif
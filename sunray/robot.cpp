@@ -11,6 +11,7 @@
 
 #include "robot.h"
 #include "StateEstimator.h"
+#include "i2cworker.h"
 #include "Storage.h"
 #include "Stats.h"
 #include "LineTracker.h"
@@ -22,7 +23,6 @@
   #include "src/esp/WiFiEsp.h"
 #endif
 #include "PubSubClient.h"
-#include "RunningMedian.h"
 #include "pinman.h"
 #include "ble.h"
 #include "motor.h"
@@ -47,6 +47,9 @@
 #include "src/test/test.h"
 #include "bumper.h"
 #include "mqtt.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "logger.h"
 
 // #define I2C_SPEED  10000
 #define _BV(x) (1 << (x))
@@ -121,6 +124,7 @@ VL53L0X tof(VL53L0X_ADDRESS_DEFAULT);
 Map maps;
 RCModel rcmodel;
 TimeTable timetable;
+CoverageMap coverage;
 
 int stateButton = 0;  
 int stateButtonTemp = 0;
@@ -150,19 +154,12 @@ unsigned long nextGPSMotionCheckTime = 0;
 bool finishAndRestart = false;
 
 unsigned long nextBadChargingContactCheck = 0;
-unsigned long nextToFTime = 0;
 unsigned long linearMotionStartTime = 0;
 unsigned long angularMotionStartTime = 0;
 unsigned long overallMotionTimeout = 0;
-unsigned long nextControlTime = 0;
 unsigned long lastComputeTime = 0;
 
-unsigned long nextLedTime = 0;
-unsigned long nextImuTime = 0;
-unsigned long nextTempTime = 0;
 unsigned long imuDataTimeout = 0;
-unsigned long nextSaveTime = 0;
-unsigned long nextTimetableTime = 0;
 
 //##################################################################################
 unsigned long loopTime = millis();
@@ -193,8 +190,6 @@ PubSubClient mqttClient(espClient);
 int motorErrorCounter = 0;
 
 
-RunningMedian<unsigned int,3> tofMeasurements;
-
 
 // must be defined to override default behavior
 void watchdogSetup (void){} 
@@ -247,10 +242,7 @@ void sensorTest(){
       }
       if (TOF_ENABLE){   
         CONSOLE.print("ToF (dist): ");
-        int v = tof.readRangeContinuousMillimeters();        
-        if (!tof.timeoutOccurred()) {     
-          CONSOLE.print(v/10);
-        }
+        CONSOLE.print(sonar.distanceToF);
         CONSOLE.print("\t");
       }    
       if (BUMPER_ENABLE){
@@ -464,6 +456,10 @@ void outputConfig(){
   CONSOLE.println(ENABLE_FAULT_DETECTION);
   CONSOLE.print("ENABLE_FAULT_OBSTACLE_AVOIDANCE: ");
   CONSOLE.println(ENABLE_FAULT_OBSTACLE_AVOIDANCE);
+  CONSOLE.print("LEARN_OBSTACLES: ");
+  CONSOLE.println(LEARN_OBSTACLES);
+  CONSOLE.print("COVERAGE_MAP: ");
+  CONSOLE.println(COVERAGE_MAP);
   CONSOLE.print("ENABLE_RPM_FAULT_DETECTION: ");
   CONSOLE.println(ENABLE_RPM_FAULT_DETECTION);
   #ifdef SONAR_INSTALLED
@@ -543,6 +539,10 @@ void outputConfig(){
   CONSOLE.println(STANLEY_CONTROL_P_SLOW);
   CONSOLE.print("STANLEY_CONTROL_K_SLOW: ");
   CONSOLE.println(STANLEY_CONTROL_K_SLOW);
+  CONSOLE.print("SPEED_PROFILE: ");
+  CONSOLE.println(SPEED_PROFILE);
+  CONSOLE.print("MOTOR_MAX_SPEED: ");
+  CONSOLE.println(MOTOR_MAX_SPEED);
   CONSOLE.print("BUTTON_CONTROL: ");
   CONSOLE.println(BUTTON_CONTROL);
   CONSOLE.print("USE_TEMP_SENSOR: ");
@@ -561,6 +561,7 @@ void start(){
   CONSOLE.begin(CONSOLE_BAUDRATE);    
   delay(2000);
   CONSOLE.println("First sign of life");
+  logger.begin();
   buzzerDriver.begin();
   buzzer.begin();
   Wire.begin();      
@@ -623,19 +624,23 @@ void start(){
     
   rcmodel.begin();  
   motor.begin();
+  loadMotorTuning();
   sonar.begin();
   bumper.begin();
 
   outputConfig();
 
   if (TOF_ENABLE){
+    i2cWorker.lock();  // I2C worker already started by robot driver
     tof.setTimeout(500);
-    if (!tof.init())
+    bool tofFound = tof.init();
+    tof.startContinuous(100);
+    i2cWorker.unlock();
+    if (!tofFound)
     {
       CONSOLE.println("Failed to detect and initialize tof sensor");
       delay(1000);
     }
-    tof.startContinuous(100);
   }        
   
   CONSOLE.print("SERIAL_BUFFER_SIZE=");
@@ -656,6 +661,7 @@ void start(){
   #endif
 
   maps.begin();      
+  coverage.begin();
   //maps.clipperTest();
     
   // initialize ESP module
@@ -760,23 +766,10 @@ bool detectLift(){
 // returns true, if obstacle detected, otherwise false
 bool detectObstacle(){   
   if (! ((robotShouldMoveForward()) || (robotShouldRotate())) ) return false;      
-  if (TOF_ENABLE){
-    if (millis() >= nextToFTime){
-      nextToFTime = millis() + 200;
-      int v = tof.readRangeContinuousMillimeters();        
-      if (!tof.timeoutOccurred()) {     
-        tofMeasurements.add(v);        
-        float avg = 0;
-        if (tofMeasurements.getAverage(avg) == tofMeasurements.OK){
-          //CONSOLE.println(avg);
-          if (avg < TOF_OBSTACLE_CM * 10){
-            CONSOLE.println("ToF obstacle!");    
-            triggerObstacle();                
-            return true; 
-          }
-        }      
-      } 
-    }    
+  if (sonar.tofObstacle()){
+    CONSOLE.println("ToF obstacle!");    
+    triggerObstacle();                
+    return true; 
   }   
   
   #ifdef ENABLE_LIFT_DETECTION
@@ -875,11 +868,11 @@ bool detectObstacleRotation(){
 
 
 
-// robot main loop
-void run(){  
-  #ifdef ENABLE_NTRIP
-    ntrip.run();
-  #endif
+// ----- scheduler tasks -----------------------------------------------------
+
+// drivers and sensors (each loop)
+void runSensors(){
+  LATENCY_SCOPE(LAT_SENSORS);
   #ifdef DRV_SIM_ROBOT
     tester.run();
   #endif
@@ -897,180 +890,229 @@ void run(){
   bumper.run();
   maps.run();  
   rcmodel.run();
-  
-  // state saving
-  if (millis() >= nextSaveTime){  
-    nextSaveTime = millis() + 5000;
-    saveState();
-  }
-  
-  // temp
-  if (millis() > nextTempTime){
-    nextTempTime = millis() + 60000;    
-    float batTemp = batteryDriver.getBatteryTemperature();
-    float cpuTemp = robotDriver.getCpuTemperature();    
-    CONSOLE.print("batTemp=");
-    CONSOLE.print(batTemp,0);
-    CONSOLE.print("  cpuTemp=");
-    CONSOLE.print(cpuTemp,0);    
-    //logCPUHealth();
-    CONSOLE.println();    
-    if (batTemp < -999){
-      stateTemp = cpuTemp;
-    } else {
-      stateTemp = batTemp;    
-    }
-    statTempMin = min(statTempMin, stateTemp);
-    statTempMax = max(statTempMax, stateTemp);    
-  }
-  
-  // IMU
-  if (millis() > nextImuTime){
-    int ims = 750 / IMU_FIFO_RATE;
-    nextImuTime = millis() + ims;        
-    //imu.resetFifo();    
-    if (imuIsCalibrating) {
-      activeOp->onImuCalibration();             
-    } else {
-      readIMU();    
-    }
+}
+
+void runNtrip(){
+  LATENCY_SCOPE(LAT_NTRIP);
+  #ifdef ENABLE_NTRIP
+    ntrip.run();
+  #endif
+}
+
+// state saving
+void runSaveState(){
+  saveState();
+}
+
+// temp
+void runTemp(){
+  float batTemp = batteryDriver.getBatteryTemperature();
+  float cpuTemp = robotDriver.getCpuTemperature();    
+  CONSOLE.print("batTemp=");
+  CONSOLE.print(batTemp,0);
+  CONSOLE.print("  cpuTemp=");
+  CONSOLE.print(cpuTemp,0);    
+  //logCPUHealth();
+  CONSOLE.println();    
+  if (batTemp < -999){
+    stateTemp = cpuTemp;
+  } else {
+    stateTemp = batTemp;    
   }
+  statTempMin = min(statTempMin, stateTemp);
+  statTempMax = max(statTempMax, stateTemp);    
+}
 
-  // LED states
-  if (millis() > nextLedTime){
-    nextLedTime = millis() + 1000;
-    robotDriver.ledStateGpsFloat = (gps.solution == SOL_FLOAT);
-    robotDriver.ledStateGpsFix = (gps.solution == SOL_FIXED);
-    robotDriver.ledStateError = (stateOp == OP_ERROR);     
+// IMU
+void runImu(){
+  LATENCY_SCOPE(LAT_IMU);
+  //imu.resetFifo();    
+  if (imuIsCalibrating) {
+    activeOp->onImuCalibration();             
+  } else {
+    readIMU();    
   }
+}
+
+// LED states
+void runLeds(){
+  robotDriver.ledStateGpsFloat = (gps.solution == SOL_FLOAT);
+  robotDriver.ledStateGpsFix = (gps.solution == SOL_FIXED);
+  robotDriver.ledStateError = (stateOp == OP_ERROR);     
+}
 
+void runGps(){
+  LATENCY_SCOPE(LAT_GPS);
   gps.run();
+}
 
-  if (millis() > nextTimetableTime){
-    nextTimetableTime = millis() + 30000;
-    gps.decodeTOW();
-    timetable.setCurrentTime(gps.hour, gps.mins, gps.dayOfWeek);
-    timetable.run();
-  }
+void runTimetable(){
+  gps.decodeTOW();
+  timetable.setCurrentTime(gps.hour, gps.mins, gps.dayOfWeek);
+  timetable.run();
+}
 
+void runStats(){
   calcStats();  
+}
+
+// robot state, sensor triggers and operation (50 Hz)
+void runControl(){
+  LATENCY_SCOPE(LAT_CONTROL);
+  controlLoops++;    
   
+  computeRobotState();
+  if (!robotShouldMove()){
+    resetLinearMotionMeasurement();
+    updateGPSMotionCheckTime();  
+  }
+  if (!robotShouldRotate()){
+    resetAngularMotionMeasurement();
+  }
+  if (!robotShouldBeInMotion()){
+    resetOverallMotionTimeout();
+    lastGPSMotionX = 0;
+    lastGPSMotionY = 0;
+  }
+
+  // mowed area coverage (GPS fix only)
+  if ((stateOp == OP_MOW) && (motor.mowMotorOn()) && (gps.solution == SOL_FIXED)){
+    coverage.update(stateX, stateY);
+  } else {
+    coverage.resetTrack();
+  }
+
+  /*if (gpsJump) {
+    // gps jump: restart current operation from new position (restart path planning)
+    CONSOLE.println("restarting operation (gps jump)");
+    gpsJump = false;
+    motor.stopImmediately(true);
+    setOperation(stateOp, true);    // restart current operation
+  }*/
   
-  if (millis() >= nextControlTime){        
-    nextControlTime = millis() + 20; 
-    controlLoops++;    
-    
-    computeRobotState();
-    if (!robotShouldMove()){
-      resetLinearMotionMeasurement();
-      updateGPSMotionCheckTime();  
-    }
-    if (!robotShouldRotate()){
-      resetAngularMotionMeasurement();
-    }
-    if (!robotShouldBeInMotion()){
-      resetOverallMotionTimeout();
-      lastGPSMotionX = 0;
-      lastGPSMotionY = 0;
+  if (battery.chargerConnected() != stateChargerConnected) {    
+    stateChargerConnected = battery.chargerConnected(); 
+    if (stateChargerConnected){      
+      // charger connected event        
+      activeOp->onChargerConnected();                
+    } else {
+      activeOp->onChargerDisconnected();
+    }            
+  }
+  if (millis() > nextBadChargingContactCheck) {
+    if (battery.badChargerContact()){
+      nextBadChargingContactCheck = millis() + 60000; // 1 min.
+      activeOp->onBadChargingContactDetected();
     }
+  } 
 
-    /*if (gpsJump) {
-      // gps jump: restart current operation from new position (restart path planning)
-      CONSOLE.println("restarting operation (gps jump)");
-      gpsJump = false;
-      motor.stopImmediately(true);
-      setOperation(stateOp, true);    // restart current operation
-    }*/
-    
-    if (battery.chargerConnected() != stateChargerConnected) {    
-      stateChargerConnected = battery.chargerConnected(); 
-      if (stateChargerConnected){      
-        // charger connected event        
-        activeOp->onChargerConnected();                
-      } else {
-        activeOp->onChargerDisconnected();
-      }            
+  if (battery.underVoltage()){
+    activeOp->onBatteryUndervoltage();
+  } 
+  else {      
+    if (USE_TEMP_SENSOR){
+      if (stateTemp > DOCK_OVERHEAT_TEMP){
+        activeOp->onTempOutOfRangeTriggered();
+      } 
+      else if (stateTemp < DOCK_TOO_COLD_TEMP){
+        activeOp->onTempOutOfRangeTriggered();
+      }
     }
-    if (millis() > nextBadChargingContactCheck) {
-      if (battery.badChargerContact()){
-        nextBadChargingContactCheck = millis() + 60000; // 1 min.
-        activeOp->onBadChargingContactDetected();
+    if (RAIN_ENABLE){
+      // rain sensor should trigger serveral times to robustly detect rain (robust rain detection)
+      // it should not trigger if one rain drop or wet tree leaves touches the sensor  
+      if (rainDriver.triggered()){  
+        //CONSOLE.print("RAIN TRIGGERED ");
+        activeOp->onRainTriggered();                                                                              
+      }                           
+    }    
+    if (battery.shouldGoHome()){
+      if (DOCKING_STATION){
+         activeOp->onBatteryLowShouldDock();
       }
-    } 
-
-    if (battery.underVoltage()){
-      activeOp->onBatteryUndervoltage();
-    } 
-    else {      
-      if (USE_TEMP_SENSOR){
-        if (stateTemp > DOCK_OVERHEAT_TEMP){
-          activeOp->onTempOutOfRangeTriggered();
-        } 
-        else if (stateTemp < DOCK_TOO_COLD_TEMP){
-          activeOp->onTempOutOfRangeTriggered();
-        }
+    }   
+     
+    if (battery.chargerConnected()){
+      if (battery.chargingHasCompleted()){
+        activeOp->onChargingCompleted();
       }
-      if (RAIN_ENABLE){
-        // rain sensor should trigger serveral times to robustly detect rain (robust rain detection)
-        // it should not trigger if one rain drop or wet tree leaves touches the sensor  
-        if (rainDriver.triggered()){  
-          //CONSOLE.print("RAIN TRIGGERED ");
-          activeOp->onRainTriggered();                                                                              
-        }                           
-      }    
-      if (battery.shouldGoHome()){
-        if (DOCKING_STATION){
-           activeOp->onBatteryLowShouldDock();
-        }
-      }   
-       
-      if (battery.chargerConnected()){
-        if (battery.chargingHasCompleted()){
-          activeOp->onChargingCompleted();
-        }
-      }        
-    } 
-
-    //CONSOLE.print("active:");
-    //CONSOLE.println(activeOp->name());
-    activeOp->checkStop();
-    activeOp->run();     
-      
-    // process button state
-    if (stateButton == 5){
-      stateButton = 0; // reset button state
-      stateSensor = SENS_STOP_BUTTON;
-      setOperation(OP_DOCK, false);
-    } else if (stateButton == 6){ 
-      stateButton = 0; // reset button state        
-      stateSensor = SENS_STOP_BUTTON;
-      setOperation(OP_MOW, false);
-    } 
-    //else if (stateButton > 0){  // stateButton 1 (or unknown button state)        
-    else if (stateButton == 1){  // stateButton 1                   
-      stateButton = 0;  // reset button state
-      stateSensor = SENS_STOP_BUTTON;
-      setOperation(OP_IDLE, false);                             
-    } else if (stateButton == 9){
-      stateButton = 0;  // reset button state
-      stateSensor = SENS_STOP_BUTTON;
-      cmdSwitchOffRobot();
-    } else if (stateButton == 12){
-      stateButton = 0; // reset button state
-      stateSensor = SENS_STOP_BUTTON;
-      #ifdef __linux__
-        WiFi.startWifiProtectedSetup();
-      #endif
-    }
+    }        
+  } 
 
-    // update operation type      
-    stateOp = activeOp->getGoalOperationType();  
-            
-  }   // if (millis() >= nextControlTime)
+  //CONSOLE.print("active:");
+  //CONSOLE.println(activeOp->name());
+  activeOp->checkStop();
+  activeOp->run();     
     
-  // ----- read serial input (BT/console) -------------
+  // process button state
+  if (stateButton == 5){
+    stateButton = 0; // reset button state
+    stateSensor = SENS_STOP_BUTTON;
+    setOperation(OP_DOCK, false);
+  } else if (stateButton == 6){ 
+    stateButton = 0; // reset button state        
+    stateSensor = SENS_STOP_BUTTON;
+    setOperation(OP_MOW, false);
+  } 
+  //else if (stateButton > 0){  // stateButton 1 (or unknown button state)        
+  else if (stateButton == 1){  // stateButton 1                   
+    stateButton = 0;  // reset button state
+    stateSensor = SENS_STOP_BUTTON;
+    setOperation(OP_IDLE, false);                             
+  } else if (stateButton == 9){
+    stateButton = 0;  // reset button state
+    stateSensor = SENS_STOP_BUTTON;
+    cmdSwitchOffRobot();
+  } else if (stateButton == 12){
+    stateButton = 0; // reset button state
+    stateSensor = SENS_STOP_BUTTON;
+    #ifdef __linux__
+      WiFi.startWifiProtectedSetup();
+    #endif
+  }
+
+  // update operation type      
+  stateOp = activeOp->getGoalOperationType();
+}
+
+// ----- read serial input (BT/console) -------------
+void runComm(){
   processComm();
   outputConsole();    
+}
+
+// telemetry stream (latest state of control loop)
+void runTelemetry(){
+  #ifdef __linux__
+    telemetry.run();
+  #endif
+}
+
+// task table - tasks run in this order (if due), control deadline is protected
+SchedulerTask tasks[] = {
+  // name, function, period (ms), phase (ms), priority, budget (us)
+  { "sensors",   runSensors,   0,                   0,  TASK_PRIO_HIGH,    3000 },
+  { "imu",       runImu,       750 / IMU_FIFO_RATE, 0,  TASK_PRIO_HIGH,    2000 },
+  { "gps",       runGps,       0,                   0,  TASK_PRIO_HIGH,    2000 },
+  { "control",   runControl,   20,                  0,  TASK_PRIO_CONTROL, 5000 },
+  { "ntrip",     runNtrip,     0,                   0,  TASK_PRIO_NORMAL,  2000 },
+  { "comm",      runComm,      0,                   0,  TASK_PRIO_NORMAL,  10000 },
+  { "telemetry", runTelemetry, 20,                  1,  TASK_PRIO_NORMAL,  1000 },
+  { "stats",     runStats,     0,                   0,  TASK_PRIO_LOW,     500 },
+  { "leds",      runLeds,      1000,                3,  TASK_PRIO_LOW,     500 },
+  { "timetable", runTimetable, 30000,               7,  TASK_PRIO_LOW,     1000 },
+  { "temp",      runTemp,      60000,               11, TASK_PRIO_LOW,     5000 },
+  { "save",      runSaveState, 5000,                13, TASK_PRIO_LOW,     50000 },
+};
+
+Scheduler scheduler;
+
+
+// robot main loop
+void run(){  
+  LATENCY_SCOPE(LAT_LOOP);
+  if (scheduler.tasks == NULL) scheduler.begin(tasks, sizeof(tasks) / sizeof(tasks[0]));
+  scheduler.run();
 
   //##############################################################################
 
@@ -36,6 +36,8 @@
 #endif
 #include "PubSubClient.h"
 #include "timetable.h"
+#include "coverage.h"
+#include "scheduler.h"
 
 
 #define VER "Sunray,1.0.319"
@@ -98,6 +100,7 @@ extern unsigned long lastFixTime;
 
 extern WiFiEspClient client;
 extern WiFiEspServer server;
+extern WiFiEspClient espClient;
 extern PubSubClient mqttClient;
 extern bool hasClient;
 
@@ -164,6 +167,11 @@ extern VL53L0X tof;
 extern PinManager pinMan;
 extern Map maps;
 extern TimeTable timetable;
+extern CoverageMap coverage;
+extern Scheduler scheduler;
+#ifdef ENABLE_NTRIP
+  extern NTRIPClient ntrip;
+#endif
 #ifdef DRV_SIM_ROBOT
   extern SimGpsDriver gps;
 #elif GPS_SKYTRAQ
@@ -0,0 +1,89 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "scheduler.h"
+#include "config.h"
+
+
+Scheduler::Scheduler(){
+  tasks = NULL;
+  tasksCount = 0;
+}
+
+void Scheduler::begin(SchedulerTask *taskTable, int count){
+  tasks = taskTable;
+  tasksCount = count;
+  unsigned long now = millis();
+  for (int i=0; i < tasksCount; i++){
+    tasks[i].nextTime = now + tasks[i].phase;
+  }
+  clearStats();
+}
+
+void Scheduler::clearStats(){
+  for (int i=0; i < tasksCount; i++){
+    SchedulerTask &task = tasks[i];
+    task.runs = 0;
+    task.avgTime = 0;
+    task.maxTime = 0;
+    task.overruns = 0;
+    task.deferrals = 0;
+    task.maxLate = 0;
+  }
+}
+
+// next deadline of CONTROL priority tasks
+unsigned long Scheduler::controlDeadline(unsigned long now){
+  unsigned long deadline = now + 1000;
+  for (int i=0; i < tasksCount; i++){
+    if (tasks[i].priority != TASK_PRIO_CONTROL) continue;
+    if ((long)(tasks[i].nextTime - deadline) < 0) deadline = tasks[i].nextTime;
+  }
+  return deadline;
+}
+
+void Scheduler::runTask(SchedulerTask &task, unsigned long now){
+  if (task.period > 0){
+    unsigned long late = now - task.nextTime;
+    if (late > task.maxLate) task.maxLate = late;
+    task.nextTime += task.period;
+    // missed more than one period: restart schedule from now
+    if ((long)(task.nextTime - now) <= 0) task.nextTime = now + task.period;
+  }
+  unsigned long startTime = micros();
+  task.function();
+  unsigned long duration = micros() - startTime;
+  if (task.runs == 0) task.avgTime = duration;
+    else task.avgTime = 0.95 * task.avgTime + 0.05 * duration;
+  task.runs++;
+  if (duration > task.maxTime) task.maxTime = duration;
+  if (duration > task.budget) task.overruns++;
+}
+
+void Scheduler::run(){
+  for (int i=0; i < tasksCount; i++){
+    SchedulerTask &task = tasks[i];
+    unsigned long now = millis();
+    if ((task.period > 0) && ((long)(now - task.nextTime) < 0)) continue;  // not due yet
+    if (task.priority >= TASK_PRIO_NORMAL){
+      // defer if task (average execution time - first run is not deferred) does not fit before next control deadline
+      long slack = (long)(controlDeadline(now) - now) * 1000L;
+      float expected = task.avgTime;
+      unsigned long maxDefer = (task.priority == TASK_PRIO_NORMAL) ? SCHEDULER_MAX_DEFER_NORMAL : SCHEDULER_MAX_DEFER_LOW;
+      if (task.period == 0){
+        // each-loop task: nextTime is the time of its last run
+        if ((expected > slack) && (now - task.nextTime < maxDefer)){
+          task.deferrals++;
+          continue;
+        }
+        task.nextTime = now;
+      } else if ((expected > slack) && (now - task.nextTime < maxDefer)){
+        task.deferrals++;
+        continue;
+      }
+    }
+    runTask(task, now);
+  }
+}
@@ -0,0 +1,70 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  deadline-driven multi-rate task scheduler (cooperative)
+
+  static task table with period, phase offset, priority and execution-time budget per task.
+  periodic tasks are scheduled on fixed deadlines (next = last deadline + period) so they do not drift.
+  NORMAL and LOW priority tasks are deferred while their measured execution time does not fit into the time
+  left until the next CONTROL task deadline (at most SCHEDULER_MAX_DEFER_NORMAL/LOW ms).
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_DEFER_NORMAL  100   // max. time (ms) a NORMAL priority task is deferred
+#define SCHEDULER_MAX_DEFER_LOW     1000  // max. time (ms) a LOW priority task is deferred
+
+
+enum TaskPriority {
+  TASK_PRIO_CONTROL,   // deadline is protected (never deferred)
+  TASK_PRIO_HIGH,      // never deferred
+  TASK_PRIO_NORMAL,    // deferred if it does not fit before next CONTROL deadline
+  TASK_PRIO_LOW,       // deferred if it does not fit before next CONTROL deadline
+};
+
+typedef void (*TaskFunction)();
+
+
+class SchedulerTask
+{
+  public:
+    const char *name;
+    TaskFunction function;
+    unsigned long period;   // ms (0 = each loop)
+    unsigned long phase;    // ms offset of first run (spreads tasks with same period)
+    TaskPriority priority;
+    unsigned long budget;   // allowed execution time (us)
+    // statistics
+    unsigned long nextTime;   // deadline (millis)
+    unsigned long runs;
+    float avgTime;            // average execution time (us)
+    unsigned long maxTime;    // worst-case execution time (us)
+    unsigned long overruns;   // execution time > budget
+    unsigned long deferrals;  // deferred to keep CONTROL deadline
+    unsigned long maxLate;    // worst-case start time after deadline (ms)
+};
+
+
+class Scheduler
+{
+  public:
+    SchedulerTask *tasks;
+    int tasksCount;
+    Scheduler();
+    void begin(SchedulerTask *taskTable, int count);
+    // run all due tasks (call from loop)
+    void run();
+    void clearStats();
+  protected:
+    unsigned long controlDeadline(unsigned long now);
+    void runTask(SchedulerTask &task, unsigned long now);
+};
+
+
+#endif
@@ -4,6 +4,7 @@
 // or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
 
 #include "sdserial.h"
+#include "logger.h"
 #include <SD.h>
 
 
@@ -65,27 +66,51 @@ void SDSerial::beginSD(){
   }
 }
 
-size_t SDSerial::write(uint8_t data){
+void SDSerial::writeBlock(const uint8_t *buffer, size_t size){
   if ((sdStarted) && (!sdActive)) {
     sdActive = true;
-    packetBuffer[packetIdx] = char(data);
-    packetIdx++;
-    if (packetIdx == 99){
-      packetBuffer[packetIdx] = '\0';            
-      logFile = SD.open(logFileName, FILE_WRITE);
-      if (logFile){        
-        logFile.write(packetBuffer);              
-        logFile.flush();
-        logFile.close();            
-      } else {
-        CONSOLE.println("ERROR opening file for writing");
+    for (size_t i=0; i < size; i++){
+      packetBuffer[packetIdx] = char(buffer[i]);
+      packetIdx++;
+      if (packetIdx == 99){
+        packetBuffer[packetIdx] = '\0';            
+        logFile = SD.open(logFileName, FILE_WRITE);
+        if (logFile){        
+          logFile.write(packetBuffer);              
+          logFile.flush();
+          logFile.close();            
+        } else {
+          CONSOLE.println("ERROR opening file for writing");
+        }
+        packetIdx = 0;            
       }
-      packetIdx = 0;            
     }
     sdActive = false;
   }  
-  CONSOLE.write(data);
-  return 1; 
+  CONSOLE.write(buffer, size);
+}
+
+// writes are locked (Linux): CONSOLE is written by control loop and logger thread
+size_t SDSerial::write(uint8_t data){
+  #ifdef __linux__
+    thread_lock(CONSOLE_LOCK);
+  #endif
+  writeBlock(&data, 1);
+  #ifdef __linux__
+    thread_unlock(CONSOLE_LOCK);
+  #endif
+  return 1;
+}
+
+size_t SDSerial::write(const uint8_t *buffer, size_t size){
+  #ifdef __linux__
+    thread_lock(CONSOLE_LOCK);
+  #endif
+  writeBlock(buffer, size);
+  #ifdef __linux__
+    thread_unlock(CONSOLE_LOCK);
+  #endif
+  return size;
 }
   
   
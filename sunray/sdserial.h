@@ -27,10 +27,13 @@ class SDSerial: public Stream{
     virtual void begin(unsigned long baud);
     void beginSD();
     virtual size_t write(uint8_t);    
+    virtual size_t write(const uint8_t *buffer, size_t size);
     virtual int available();
     virtual int read();
     virtual int peek();    
     virtual void flush();
+  protected:
+    void writeBlock(const uint8_t *buffer, size_t size);
 };
 
 extern SDSerial sdSerial; // Making it available as sdSerial
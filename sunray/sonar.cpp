@@ -7,43 +7,40 @@
 #include "config.h"
 #include "sonar.h"
 #include "robot.h"
-#include "RunningMedian.h"
+#include "SlidingMedian.h"
+#include "i2cworker.h"
 #include <Arduino.h>
 
 
 #define MAX_DURATION 4000
 #define ROUNDING_ENABLED false
 #define US_ROUNDTRIP_CM 57      // Microseconds (uS) it takes sound to travel round-trip 1cm (2cm total), uses integer to save compiled code space. Default=57
+#define PING_TIMEOUT 30         // ms until next sensor is fired if there was no echo 
+#define ECHO_FADE_TIME 10       // ms until next sensor is fired after an echo (let reflections fade)
+#define TOF_POLL_INTERVAL 20    // ms
 
 // Conversion from uS to distance (round result to nearest cm or inch).
 #define NewPingConvert(echoTime, conversionFactor) (max(((unsigned int)echoTime + conversionFactor / 2) / conversionFactor, (echoTime ? 1 : 0)))
 
-RunningMedian<unsigned int, 9> sonarLeftMeasurements;
-RunningMedian<unsigned int, 9> sonarRightMeasurements;
-RunningMedian<unsigned int, 9> sonarCenterMeasurements;
+SlidingMedian<unsigned int, 9> sonarMeasurements[3]; // left, center, right
+SlidingMedian<unsigned int, 3> tofMeasurements;
+
+// staggered firing order (neighbouring sensors are not fired one after another)
+const byte sonarOrder[3] = {0, 2, 1}; // left, right, center
 
 volatile unsigned long startTime = 0;
 volatile unsigned long echoTime = 0;
 volatile unsigned long echoDuration = 0;
 volatile byte sonarIdx = 0;
-bool added = false;
-unsigned long timeoutTime = 0;
-unsigned long nextEvalTime = 0;
 
 
 #ifdef SONAR_INSTALLED
 
 // HC-SR04 ultrasonic sensor driver (2cm - 400cm)
-void startHCSR04(int triggerPin, int echoPin) {
-  unsigned int uS;
+void startHCSR04(int triggerPin) {
   digitalWrite(triggerPin, HIGH);
   delayMicroseconds(10);
   digitalWrite(triggerPin, LOW);
-  /*// if there is no reflection, we will get 0  (NO_ECHO)
-  uS = pulseIn(echoPin, HIGH, MAX_ECHO_TIME);
-  //if (uS == MAX_ECHO_TIME) uS = NO_ECHO;
-  //if (uS < MIN_ECHO_TIME) uS = NO_ECHO;
-  return uS;*/
 }
 
 void echoHandler(unsigned char pin) {
@@ -75,53 +72,120 @@ void echoRight() {
 
 
 void Sonar::run() {
+  if (TOF_ENABLE) runToF();
 #ifdef SONAR_INSTALLED  
   if (!enabled) {
     distanceRight = distanceLeft = distanceCenter = 0;
     return;
   }
+  unsigned long now = millis();
   if (echoDuration != 0) {
-    added = true;
+    // echo completed - use ISR timestamp as measurement time
     unsigned long raw = echoDuration;
-    if (raw > MAX_DURATION) raw = MAX_DURATION;
-    if (sonarIdx == 0) sonarLeftMeasurements.add(raw);
-    else if (sonarIdx == 1) sonarCenterMeasurements.add(raw);
-    else sonarRightMeasurements.add(raw);
+    unsigned long age = micros() - echoTime;
     echoDuration = 0;
+    addEcho(sonarIdx, raw, now - age / 1000);
+    added = true;
+    timeoutTime = now + ECHO_FADE_TIME;
   }
-  if (millis() > timeoutTime) {
+  if ((long)(now - timeoutTime) >= 0) {
     if (!added) {
-      if (sonarIdx == 0) sonarLeftMeasurements.add(MAX_DURATION);
-      else if (sonarIdx == 1) sonarCenterMeasurements.add(MAX_DURATION);
-      else sonarRightMeasurements.add(MAX_DURATION);
+      addEcho(sonarIdx, MAX_DURATION, now);
+      echoTimeouts++;
     }
-    sonarIdx = (sonarIdx + 1) % 3;
+    pingSlot = (pingSlot + 1) % 3;
+    sonarIdx = sonarOrder[pingSlot];
     echoDuration = 0;
-    if (sonarIdx == 0) startHCSR04(pinSonarLeftTrigger, pinSonarLeftEcho);
-    else if (sonarIdx == 1) startHCSR04(pinSonarCenterTrigger, pinSonarCenterEcho);
-    else startHCSR04(pinSonarRightTrigger, pinSonarRightEcho);
-    timeoutTime = millis() + 50;           // 10
+    if (sonarIdx == 0) startHCSR04(pinSonarLeftTrigger);
+    else if (sonarIdx == 1) startHCSR04(pinSonarCenterTrigger);
+    else startHCSR04(pinSonarRightTrigger);
+    pings++;
+    timeoutTime = now + PING_TIMEOUT;
     added = false;
   }
-  if (millis() > nextEvalTime) {
-    nextEvalTime = millis() + 200;
-    sonarLeftMeasurements.getMedian(distanceLeft);
-    distanceLeft = convertCm(distanceLeft);
-    sonarRightMeasurements.getMedian(distanceRight);
-    distanceRight = convertCm(distanceRight);
-    sonarCenterMeasurements.getMedian(distanceCenter);
-    distanceCenter = convertCm(distanceCenter);
-  }
 #endif
 }
 
+// add measurement to median filter and update distance immediately
+void Sonar::addEcho(byte idx, unsigned int duration, unsigned long time) {
+  if (duration > MAX_DURATION) duration = MAX_DURATION;
+  unsigned int median = MAX_DURATION;
+  sonarMeasurements[idx].add(duration);
+  sonarMeasurements[idx].getMedian(median);
+  unsigned int raw = convertCm(duration);
+  if (idx == 0) {
+    distanceLeft = convertCm(median);
+    updateObstacleTime(idx, raw < triggerLeftBelow, distanceLeft < triggerLeftBelow, time);
+  } else if (idx == 1) {
+    distanceCenter = convertCm(median);
+    updateObstacleTime(idx, raw < triggerCenterBelow, distanceCenter < triggerCenterBelow, time);
+  } else {
+    distanceRight = convertCm(median);
+    updateObstacleTime(idx, raw < triggerRightBelow, distanceRight < triggerRightBelow, time);
+  }
+}
+
+// poll ToF sensor (continuous mode) - never waits for a measurement
+void Sonar::runToF() {
+  if (millis() < nextToFTime) return;
+  nextToFTime = millis() + TOF_POLL_INTERVAL;
+  uint16_t range;
+  i2cWorker.lock();  // shares the bus with the I2C worker
+  bool avail = tof.readRangeAvailable(range);
+  i2cWorker.unlock();
+  if (!avail) return;
+  tofReadings++;
+  tofMeasurements.add(range);
+  unsigned int median = range;
+  tofMeasurements.getMedian(median);
+  distanceToF = median / 10;
+  updateObstacleTime(3, range < TOF_OBSTACLE_CM * 10, distanceToF < TOF_OBSTACLE_CM, millis());
+}
+
+// remember time of first measurement below trigger distance (reset if raw value and median are above again)
+void Sonar::updateObstacleTime(byte idx, bool below, bool medianBelow, unsigned long time) {
+  if (below || medianBelow) {
+    if (obstacleTime[idx] == 0) obstacleTime[idx] = time;
+  } else {
+    obstacleTime[idx] = 0;
+    obstacleReported[idx] = false;
+  }
+}
+
+// obstacle detected: compute latency (once per obstacle)
+void Sonar::reportObstacle(byte idx) {
+  if ((obstacleTime[idx] == 0) || (obstacleReported[idx])) return;
+  obstacleReported[idx] = true;
+  obstacleLatency = millis() - obstacleTime[idx];
+  if (obstacleLatency > maxObstacleLatency) maxObstacleLatency = obstacleLatency;
+}
+
+void Sonar::clearStats() {
+  pings = 0;
+  echoTimeouts = 0;
+  tofReadings = 0;
+  obstacleLatency = 0;
+  maxObstacleLatency = 0;
+}
+
 void Sonar::begin()
 {
+  clearStats();
+  distanceToF = 0;
+  nextToFTime = 0;
+  for (int i=0; i < 4; i++) {
+    obstacleTime[i] = 0;
+    obstacleReported[i] = false;
+  }
 #ifdef SONAR_INSTALLED
   enabled = SONAR_ENABLE;
   triggerLeftBelow = SONAR_LEFT_OBSTACLE_CM;
   triggerCenterBelow = SONAR_CENTER_OBSTACLE_CM;
   triggerRightBelow = SONAR_RIGHT_OBSTACLE_CM;
+  distanceLeft = distanceCenter = distanceRight = convertCm(MAX_DURATION);
+  timeoutTime = 0;
+  pingSlot = 0;
+  added = true;
   pinMode(pinSonarLeftTrigger, OUTPUT);
   pinMode(pinSonarCenterTrigger, OUTPUT);
   pinMode(pinSonarRightTrigger, OUTPUT);
@@ -150,12 +214,15 @@ bool Sonar::obstacle()
   if (res) {
     CONSOLE.print("Sonar::obstacle() sensor true  ");
     if (distanceLeft < triggerLeftBelow) {
+      reportObstacle(0);
       CONSOLE.print("  distanceLeft= "); CONSOLE.print(distanceLeft);
     }
     if (distanceCenter < triggerCenterBelow) {
+      reportObstacle(1);
       CONSOLE.print("  distanceCenter= "); CONSOLE.print(distanceCenter);
     }
     if (distanceRight < triggerRightBelow) {
+      reportObstacle(2);
       CONSOLE.print("  distanceRight= "); CONSOLE.print(distanceRight);
     }
     CONSOLE.println("");
@@ -197,6 +264,15 @@ bool Sonar::nearObstacle()
 #endif
 }
 
+bool Sonar::tofObstacle()
+{
+  if (!TOF_ENABLE) return false;
+  if (tofMeasurements.getCount() == 0) return false;
+  if (distanceToF >= TOF_OBSTACLE_CM) return false;
+  reportObstacle(3);
+  return true;
+}
+
 unsigned int Sonar::convertCm(unsigned int echoTime) {
 #if ROUNDING_ENABLED == false
   return (echoTime / US_ROUNDTRIP_CM);              // Convert uS to centimeters (no rounding).
@@ -6,21 +6,34 @@
 // HC-SR04 ultrasonic sensor driver (2cm - 400cm)
 // for 3 sensors, optimized for speed: based on hardware interrupts (no polling)
 // up to 100 Hz measurements tested
+// sensors are fired in staggered order (left, right, center), the next sensor is fired as soon as
+// the echo has completed (or timed out); ToF sensor (continuous mode) is polled without waiting
 
 #ifndef SONAR_H
 #define SONAR_H
 
+#include <Arduino.h>
+
 class Sonar {
     public:
         unsigned int distanceLeft; // cm
         unsigned int distanceRight;
         unsigned int distanceCenter;
+        unsigned int distanceToF;
         bool enabled;
+        // statistics
+        unsigned long pings;              // sonar pings triggered
+        unsigned long echoTimeouts;       // sonar pings without echo
+        unsigned long tofReadings;
+        unsigned int obstacleLatency;     // ms from first measurement below trigger distance to obstacle detection
+        unsigned int maxObstacleLatency;  // ms
 
         void begin();
         void run();
         bool obstacle();
         bool nearObstacle();
+        bool tofObstacle();
+        void clearStats();
 
     protected:
 
@@ -29,8 +42,19 @@ class Sonar {
         unsigned int triggerCenterBelow;
         unsigned int triggerRightBelow;
         unsigned long nearObstacleTimeout;
+        unsigned long timeoutTime;
+        unsigned long nextToFTime;
+        byte pingSlot;
+        bool added;
+        // per sensor (left, center, right, ToF): time of first measurement below trigger distance (0: none)
+        unsigned long obstacleTime[4];
+        bool obstacleReported[4];
 
         unsigned int convertCm(unsigned int echoTime);
+        void addEcho(byte idx, unsigned int duration, unsigned long time);
+        void runToF();
+        void updateObstacleTime(byte idx, bool below, bool medianBelow, unsigned long time);
+        void reportObstacle(byte idx);
 };
 
 #endif
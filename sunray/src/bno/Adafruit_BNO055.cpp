@@ -351,6 +351,39 @@ imu::Quaternion Adafruit_BNO055::getQuat(void)
   return quat;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Gets euler angles (degrees) and quaternion in one burst read
+            (registers are contiguous, so both belong to the same sample)
+*/
+/**************************************************************************/
+bool Adafruit_BNO055::getEulerQuat(imu::Vector<3> &euler, imu::Quaternion &quat)
+{
+  uint8_t buffer[14];
+  memset (buffer, 0, 14);
+
+  /* Read euler (6 bytes) and quat (8 bytes) data */
+  if (!readLen(BNO055_EULER_H_LSB_ADDR, buffer, 14)) return false;
+
+  int16_t h, r, p, w, x, y, z;
+  h = (((uint16_t)buffer[1]) << 8) | ((uint16_t)buffer[0]);
+  r = (((uint16_t)buffer[3]) << 8) | ((uint16_t)buffer[2]);
+  p = (((uint16_t)buffer[5]) << 8) | ((uint16_t)buffer[4]);
+  w = (((uint16_t)buffer[7]) << 8) | ((uint16_t)buffer[6]);
+  x = (((uint16_t)buffer[9]) << 8) | ((uint16_t)buffer[8]);
+  y = (((uint16_t)buffer[11]) << 8) | ((uint16_t)buffer[10]);
+  z = (((uint16_t)buffer[13]) << 8) | ((uint16_t)buffer[12]);
+
+  /* 1 degree = 16 LSB (same order as getEvent orientation x, y, z) */
+  euler[0] = ((double)h)/16.0;
+  euler[1] = ((double)r)/16.0;
+  euler[2] = ((double)p)/16.0;
+
+  const double scale = (1.0 / (1<<14));
+  quat = imu::Quaternion(scale * w, scale * x, scale * y, scale * z);
+  return true;
+}
+
 /**************************************************************************/
 /*!
     @brief  Provides the sensor_t data for this sensor
@@ -294,6 +294,7 @@ class Adafruit_BNO055 : public Adafruit_Sensor
 
     imu::Vector<3>  getVector ( adafruit_vector_type_t vector_type );
     imu::Quaternion getQuat   ( void );
+    bool            getEulerQuat ( imu::Vector<3> &euler, imu::Quaternion &quat );
     int8_t          getTemp   ( void );
 
     /* Adafruit_Sensor implementation */
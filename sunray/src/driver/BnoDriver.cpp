@@ -272,21 +272,23 @@ void BnoDriver::run(){
 
 
 bool BnoDriver::isDataAvail(){
+    sampleCount = 0;
     if (millis() < nextUpdateTime) return false;
     nextUpdateTime = millis() + IMU_FIFO_RATE; // 5 Hz
-    sensors_event_t event; 
-    
+    // no FIFO: read euler angles and quaternion of latest sample in one burst
+    imu::Vector<3> euler;
+    imu::Quaternion quat;
     selectChip();
-    bno.getEvent(&event);              
+    if (!bno.getEulerQuat(euler, quat)) return false;
     //bno.getCalibration(&msgTele.calSystem, &msgTele.calGyro, &msgTele.calAccel, &msgTele.calMag);            
-    imu::Quaternion quat = bno.getQuat();           // Request quaternion data from BNO055
     quatW = quat.w();
     quatX = quat.x();
     quatY = quat.y();
     quatZ = quat.z();
-    roll = event.orientation.z / 180.0 * PI;
-    pitch = event.orientation.y / 180.0 * PI;
-    yaw = -event.orientation.x / 180.0 * PI;
+    roll = euler.z() / 180.0 * PI;
+    pitch = euler.y() / 180.0 * PI;
+    yaw = -euler.x() / 180.0 * PI;
+    addSample(millis());
     return true;
 }         
     
@@ -7,6 +7,7 @@
 #include "CanRobotDriver.h"
 #include "../../config.h"
 #include "../../ioboard.h"
+#include "../../logger.h"
 
 //#define COMM  ROBOT
 
@@ -260,18 +261,8 @@ void CanRobotDriver::run(){
       consoleCounter = 0;
     }
     if (printConsole){
-      CONSOLE.print("CAN: tx=");
-      CONSOLE.print(can.frameCounterTx);
-      CONSOLE.print(" rx=");
-      CONSOLE.print(can.frameCounterRx);    
-      CONSOLE.print(" ticks=");
-      CONSOLE.print(encoderTicksLeft);
-      CONSOLE.print(","); 
-      CONSOLE.print(encoderTicksRight);
-      CONSOLE.print(" pwm=");
-      CONSOLE.print(requestLeftPwm);
-      CONSOLE.print(","); 
-      CONSOLE.println(requestRightPwm);  
+      LOG(LOG_INFO, "CAN: tx=%lu rx=%lu ticks=%lu,%lu pwm=%d,%d", can.frameCounterTx, can.frameCounterRx,
+        encoderTicksLeft, encoderTicksRight, requestLeftPwm, requestRightPwm);
     }
 
     if (!mcuCommunicationLost){
@@ -280,19 +271,13 @@ void CanRobotDriver::run(){
       }
     }    
     if ((cmdMotorCounter > 0) && (cmdMotorResponseCounter == 0)){
-      CONSOLE.println("WARN: resetting motor ticks");
+      LOG(LOG_WARN, "WARN: resetting motor ticks");
       resetMotorTicks = true;
       mcuCommunicationLost = true;
     }    
     if ( (cmdMotorResponseCounter < 30) ) { // || (cmdSummaryResponseCounter == 0) ){
-      CONSOLE.print("WARN: CanRobot unmet communication frequency: motorFreq=");
-      CONSOLE.print(cmdMotorCounter);
-      CONSOLE.print("/");
-      CONSOLE.print(cmdMotorResponseCounter);
-      CONSOLE.print("  summaryFreq=");
-      CONSOLE.print(cmdSummaryCounter);
-      CONSOLE.print("/");
-      CONSOLE.println(cmdSummaryResponseCounter);
+      LOG(LOG_WARN, "WARN: CanRobot unmet communication frequency: motorFreq=%d/%d  summaryFreq=%d/%d",
+        cmdMotorCounter, cmdMotorResponseCounter, cmdSummaryCounter, cmdSummaryResponseCounter);
       if (cmdMotorResponseCounter == 0){
         // FIXME: maybe reset motor PID controls here?
       }
@@ -60,12 +60,15 @@ void IcmDriver::run(){
 
 
 bool IcmDriver::isDataAvail(){
-
-    icm_20948_DMP_data_t data;
-    icm.readDMPdataFromFIFO(&data);
-
-    if ((icm.status == ICM_20948_Stat_Ok) || (icm.status == ICM_20948_Stat_FIFOMoreDataAvail))
-    {
+    sampleCount = 0;
+    // drain all available DMP packets, sample times derived from FIFO rate (newest sample is now)
+    int packetNo[IMU_MAX_SAMPLES];  // packet number of each sample
+    int packets = 0;
+    while (packets < IMU_MAX_SAMPLES){
+        icm_20948_DMP_data_t data;
+        icm.readDMPdataFromFIFO(&data);
+        if ((icm.status != ICM_20948_Stat_Ok) && (icm.status != ICM_20948_Stat_FIFOMoreDataAvail)) break;
+        packets++;
         if ((data.header & DMP_header_bitmap_Quat6) > 0)
         //if ((data.header & DMP_header_bitmap_Quat9) > 0)
         {
@@ -98,10 +101,15 @@ bool IcmDriver::isDataAvail(){
             quatX = q0;
             quatY = q1;
             quatZ = q2;
+            packetNo[sampleCount] = packets;
+            addSample(0);
         }
-        return true;
+        if (icm.status != ICM_20948_Stat_FIFOMoreDataAvail) break;
     }
-    return false;
+    unsigned long now = millis();
+    unsigned long period = 1000 / IMU_FIFO_RATE;
+    for (int i=0; i < sampleCount; i++) samples[i].time = now - (packets - packetNo[i]) * period;
+    return (packets > 0);
 }         
     
 void IcmDriver::resetData(){
@@ -75,28 +75,30 @@ void MpuDriver::run(){
 
 bool MpuDriver::isDataAvail(){
     //selectChip();
-    bool avail = (mpu.fifoAvailable() > 0);    
-    if (!avail) return false;
-    //CONSOLE.println("fifoAvailable");
-    // Use dmpUpdateFifo to update the ax, gx, mx, etc. values
-    if ( mpu.dmpUpdateFifo() != INV_SUCCESS) return false;
-    // computeEulerAngles can be used -- after updating the
-    // quaternion values -- to estimate roll, pitch, and yaw
-    //  toEulerianAngle(imu.calcQuat(imu.qw), imu.calcQuat(imu.qx), imu.calcQuat(imu.qy), imu.calcQuat(imu.qz), imu.roll, imu.pitch, imu.yaw);
-    quatW = mpu.qw;
-    quatX = mpu.qx;
-    quatY = mpu.qy;
-    quatZ = mpu.qz;
-    mpu.computeEulerAngles(false);      
-    //CONSOLE.print(imu.ax);
-    //CONSOLE.print(",");
-    //CONSOLE.print(imu.ay);
-    //CONSOLE.print(",");
-    //CONSOLE.println(imu.az);
-    roll = mpu.roll;
-    pitch = mpu.pitch;
-    yaw = mpu.yaw;    
-    return true;
+    sampleCount = 0;
+    // drain all complete DMP packets in one burst
+    unsigned char data[IMU_MAX_SAMPLES * DMP_MAX_PACKET_LENGTH];
+    unsigned char packets = 0;
+    unsigned short more = 0;
+    if (mpu.dmpReadFifoBurst(data, IMU_MAX_SAMPLES, packets, more) != INV_SUCCESS) return false;
+    if (packets == 0) return false;
+    // sample times: newest sample in FIFO is now, samples are one FIFO period apart
+    unsigned long now = millis();
+    unsigned long period = 1000 / IMU_FIFO_RATE;
+    for (int i=0; i < packets; i++){
+      // corrupted packet: FIFO has been reset, keep samples parsed so far
+      if (mpu.dmpParseFifoPacket(data, i) != INV_SUCCESS) break;
+      quatW = mpu.qw;
+      quatX = mpu.qx;
+      quatY = mpu.qy;
+      quatZ = mpu.qz;
+      mpu.computeEulerAngles(false);      
+      roll = mpu.roll;
+      pitch = mpu.pitch;
+      yaw = mpu.yaw;    
+      addSample(now - (packets - 1 - i + more) * period);
+    }
+    return (sampleCount > 0);
 }         
     
 void MpuDriver::resetData(){
@@ -98,8 +98,21 @@ class RainSensorDriver {
     virtual bool triggered() = 0;  	  		    
 };
 
+#define IMU_MAX_SAMPLES 16  // max. samples per FIFO burst
+
+class ImuSample {
+  public:
+    float roll;  // euler radiant
+    float pitch; // euler radiant
+    float yaw;   // euler radiant
+    unsigned long time; // millis when sample was taken (derived from FIFO rate)
+};
+
 class ImuDriver {
   public:
+    // samples read by last isDataAvail call (oldest first, newest equals roll, pitch, yaw)
+    ImuSample samples[IMU_MAX_SAMPLES];
+    int sampleCount;
     float quatW; // quaternion
     float quatX; // quaternion
     float quatY; // quaternion
@@ -113,10 +126,19 @@ class ImuDriver {
     // try starting module with update rate 5 Hz (should return true on success)
     virtual bool begin() = 0;    
     virtual void run() = 0;
-    // check if data has been updated (should update members roll, pitch, yaw)
+    // check if data has been updated (should update members roll, pitch, yaw and add all samples read)
     virtual bool isDataAvail() = 0;
     // reset module data queue (should reset module FIFO etc.)         
     virtual void resetData() = 0;        
+    // add current roll, pitch, yaw as sample
+    void addSample(unsigned long time){
+      if (sampleCount >= IMU_MAX_SAMPLES) return;
+      ImuSample &sample = samples[sampleCount++];
+      sample.roll = roll;
+      sample.pitch = pitch;
+      sample.yaw = yaw;
+      sample.time = time;
+    }
 };
 
 class BuzzerDriver {
@@ -145,6 +167,8 @@ class GpsDriver {
     float vAccuracy;   // m
     SolType solution;    
     bool solutionAvail; // should bet set true if received new solution 
+    unsigned long solutionTime; // millis when new solution was received
+    unsigned long solutionTOW;  // receiver time (ms) of new solution (iTOW or time of day), 0 if unknown
     unsigned long dgpsAge;
     unsigned long chksumErrorCounter;
     unsigned long dgpsChecksumErrorCounter;
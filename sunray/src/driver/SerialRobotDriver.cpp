@@ -7,6 +7,8 @@
 #include "SerialRobotDriver.h"
 #include "../../config.h"
 #include "../../ioboard.h"
+#include "../../i2cworker.h"
+#include "../../logger.h"
 
 #define COMM  ROBOT
 
@@ -46,6 +48,15 @@ void SerialRobotDriver::begin(){
   cmdMotorCounter = 0;
   cmdSummaryCounter = 0;
   requestLeftPwm = requestRightPwm = requestMowPwm = 0;
+  #ifdef ROBOT_BINARY_LINK
+    binaryLink = true;
+  #else
+    binaryLink = false;
+  #endif
+  motorLink.begin();
+  summaryLink.begin();
+  versionLink.begin();
+  linkCrcErrors = 0;
   robotID = "XX";
   ledStateWifiInactive = false;
   ledStateWifiConnected = false;
@@ -105,10 +116,7 @@ void SerialRobotDriver::begin(){
     // ADC test    
     if (true){    
       for (int idx=1; idx < 9; idx++){
-        ioAdcMux(idx);            
-        ioAdcTrigger(ADC_I2C_ADDR);
-        delay(5);
-        float v = ioAdc(ADC_I2C_ADDR);
+        float v = i2cWorker.adcMeasure(idx);
         CONSOLE.print("ADC S");
         CONSOLE.print(idx);
         CONSOLE.print("=");
@@ -126,27 +134,30 @@ void SerialRobotDriver::begin(){
       CONSOLE.println(v);
     }
 
+    // from now on, expanders and ADC are accessed by the I2C worker (mcuAna: MCU PCB power detection)
+    i2cWorker.adcSchedule(ADC_MCU_ANA, 1000);
+    i2cWorker.begin();
   #endif
 }
 
 bool SerialRobotDriver::setLedState(int ledNumber, bool greenState, bool redState){
   if (!ledPanelInstalled) return false;
   if (ledNumber == 1){
-    ledPanelInstalled = ioExpanderOut(EX3_I2C_ADDR, EX3_LED1_GREEN_PORT, EX3_LED1_GREEN_PIN, greenState);
+    ledPanelInstalled = i2cWorker.expanderOut(EX3_I2C_ADDR, EX3_LED1_GREEN_PORT, EX3_LED1_GREEN_PIN, greenState, I2C_PRIO_LED);
     if (!ledPanelInstalled) return false;
-    ledPanelInstalled = ioExpanderOut(EX3_I2C_ADDR, EX3_LED1_RED_PORT, EX3_LED1_RED_PIN, redState);        
+    ledPanelInstalled = i2cWorker.expanderOut(EX3_I2C_ADDR, EX3_LED1_RED_PORT, EX3_LED1_RED_PIN, redState, I2C_PRIO_LED);        
     if (!ledPanelInstalled) return false;  
   }
   else if (ledNumber == 2){
-    ledPanelInstalled = ioExpanderOut(EX3_I2C_ADDR, EX3_LED2_GREEN_PORT, EX3_LED2_GREEN_PIN, greenState);
+    ledPanelInstalled = i2cWorker.expanderOut(EX3_I2C_ADDR, EX3_LED2_GREEN_PORT, EX3_LED2_GREEN_PIN, greenState, I2C_PRIO_LED);
     if (!ledPanelInstalled) return false;    
-    ledPanelInstalled = ioExpanderOut(EX3_I2C_ADDR, EX3_LED2_RED_PORT, EX3_LED2_RED_PIN, redState);        
+    ledPanelInstalled = i2cWorker.expanderOut(EX3_I2C_ADDR, EX3_LED2_RED_PORT, EX3_LED2_RED_PIN, redState, I2C_PRIO_LED);        
     if (!ledPanelInstalled) return false;    
   }
   else if (ledNumber == 3){
-    ledPanelInstalled = ioExpanderOut(EX3_I2C_ADDR, EX3_LED3_GREEN_PORT, EX3_LED3_GREEN_PIN, greenState);
+    ledPanelInstalled = i2cWorker.expanderOut(EX3_I2C_ADDR, EX3_LED3_GREEN_PORT, EX3_LED3_GREEN_PIN, greenState, I2C_PRIO_LED);
     if (!ledPanelInstalled) return false;    
-    ledPanelInstalled = ioExpanderOut(EX3_I2C_ADDR, EX3_LED3_RED_PORT, EX3_LED3_RED_PIN, redState);        
+    ledPanelInstalled = i2cWorker.expanderOut(EX3_I2C_ADDR, EX3_LED3_RED_PORT, EX3_LED3_RED_PIN, redState, I2C_PRIO_LED);        
     if (!ledPanelInstalled) return false;    
   }
   return true;
@@ -155,13 +166,13 @@ bool SerialRobotDriver::setLedState(int ledNumber, bool greenState, bool redStat
 bool SerialRobotDriver::setFanPowerState(bool state){
   CONSOLE.print("FAN POWER STATE ");
   CONSOLE.println(state);
-  return ioExpanderOut(EX1_I2C_ADDR, EX1_FAN_POWER_PORT, EX1_FAN_POWER_PIN, state);
+  return i2cWorker.expanderOut(EX1_I2C_ADDR, EX1_FAN_POWER_PORT, EX1_FAN_POWER_PIN, state, I2C_PRIO_POWER);
 }
 
 bool SerialRobotDriver::setImuPowerState(bool state){
   CONSOLE.print("IMU POWER STATE ");
   CONSOLE.println(state);  
-  return ioExpanderOut(EX1_I2C_ADDR, EX1_IMU_POWER_PORT, EX1_IMU_POWER_PIN, state);
+  return i2cWorker.expanderOut(EX1_I2C_ADDR, EX1_IMU_POWER_PORT, EX1_IMU_POWER_PIN, state, I2C_PRIO_POWER);
 }  
 
 bool SerialRobotDriver::getRobotID(String &id){
@@ -237,9 +248,30 @@ void SerialRobotDriver::sendRequest(String s){
   COMM.print(s);  
 }
 
+// send binary frame to MCU
+void SerialRobotDriver::sendFrame(LinkWriter &w){
+  uint8_t frame[LINK_MAX_FRAME];
+  int len = w.finish(frame);
+  if (len == 0) return;
+  COMM.write(frame, len);
+}
+
+void SerialRobotDriver::clearLinkStats(){
+  motorLink.clear();
+  summaryLink.clear();
+  versionLink.clear();
+  linkCrcErrors = 0;
+}
+
 
 // request MCU SW version
 void SerialRobotDriver::requestVersion(){
+  if (binaryLink){
+    LinkWriter w;
+    w.begin('V', versionLink.request());
+    sendFrame(w);
+    return;
+  }
   String req;
   req += "AT+V";  
   sendRequest(req);
@@ -248,15 +280,32 @@ void SerialRobotDriver::requestVersion(){
 
 // request MCU summary
 void SerialRobotDriver::requestSummary(){
+  cmdSummaryCounter++;
+  if (binaryLink){
+    LinkWriter w;
+    w.begin('S', summaryLink.request());
+    sendFrame(w);
+    return;
+  }
   String req;
   req += "AT+S";  
   sendRequest(req);
-  cmdSummaryCounter++;
 }
 
 
 // request MCU motor PWM
 void SerialRobotDriver::requestMotorPwm(int leftPwm, int rightPwm, int mowPwm){
+  if (binaryLink){
+    // MCU left/right are swapped (same as AT+M)
+    LinkWriter w;
+    w.begin('M', motorLink.request());
+    w.i16(rightPwm);
+    w.i16(leftPwm);
+    w.i16(mowPwm);
+    sendFrame(w);
+    cmdMotorCounter++;
+    return;
+  }
   String req;
   req += "AT+M,";
   req += rightPwm;      
@@ -426,6 +475,73 @@ void SerialRobotDriver::processResponse(bool checkCrc){
 }
 
 
+// process binary response frame
+void SerialRobotDriver::processFrame(){
+  uint8_t payload[LINK_MAX_FRAME];
+  LinkReader r;
+  if ((linkRx.frameLen > LINK_MAX_FRAME) || (!r.begin(linkRx.frame, linkRx.frameLen, payload))){
+    linkCrcErrors++;
+    CONSOLE.println("SerialRobot: frame CRC ERROR");
+    return;
+  }
+  char type = r.u8();
+  uint16_t seq = r.u16();
+  unsigned long mcuTime = r.u32();
+  if (type == 'M'){
+    int32_t ticksLeft = r.i32();
+    int32_t ticksRight = r.i32();
+    int32_t ticksMow = r.i32();
+    float chgVoltage = r.f32();
+    uint8_t flags = r.u8();
+    if (r.underflow) return;
+    motorLink.response(seq, mcuTime);
+    encoderTicksRight = ticksLeft;  // ag
+    encoderTicksLeft = ticksRight;  // ag
+    encoderTicksMow = ticksMow;
+    chargeVoltage = chgVoltage;
+    triggeredLeftBumper = (flags & 1);
+    triggeredLift = (flags & 2);
+    triggeredStopButton = (flags & 4);
+    cmdMotorResponseCounter++;
+    mcuCommunicationLost=false;
+  } else if (type == 'S'){
+    float batV = r.f32();
+    float chgV = r.f32();
+    float chgI = r.f32();
+    uint8_t flags = r.u8();
+    float mowI = r.f32();
+    float leftI = r.f32();
+    float rightI = r.f32();
+    float batTemp = r.f32();
+    if (r.underflow) return;
+    summaryLink.response(seq, mcuTime);
+    batteryVoltage = batV;
+    chargeVoltage = chgV;
+    chargeCurrent = chgI;
+    triggeredLift = (flags & 1);
+    triggeredLeftBumper = (flags & 2);
+    triggeredRain = (flags & 4);
+    motorFault = (flags & 8);
+    mowCurr = mowI;
+    motorLeftCurr = leftI;
+    motorRightCurr = rightI;
+    batteryTemp = batTemp;
+    cmdSummaryResponseCounter++;
+  } else if (type == 'V'){
+    versionLink.response(seq, mcuTime);
+    String s = r.text();
+    int idx = s.indexOf(',');
+    if (idx < 0) return;
+    mcuFirmwareName = s.substring(0, idx);
+    mcuFirmwareVersion = s.substring(idx+1);
+    CONSOLE.print("MCU FIRMWARE: ");
+    CONSOLE.print(mcuFirmwareName);
+    CONSOLE.print(",");
+    CONSOLE.println(mcuFirmwareVersion);
+  }
+}
+
+
 // process console input
 void SerialRobotDriver::processComm(){
   char ch;      
@@ -433,6 +549,10 @@ void SerialRobotDriver::processComm(){
     //battery.resetIdle();  
     while ( COMM.available() ){               
       ch = COMM.read();          
+      // binary frames (start marker ... 0x00) and ASCII lines share the UART
+      LinkRxResult res = linkRx.receive(ch);
+      if (res == LINK_RX_FRAME) processFrame();
+      if (res != LINK_RX_ASCII) continue;
       if ((ch == '\r') || (ch == '\n')) {        
         //CONSOLE.println(cmd);
         processResponse(true);              
@@ -481,7 +601,8 @@ void SerialRobotDriver::updatePanelLEDs(){
 void SerialRobotDriver::run(){  
   processComm();
   if (millis() > nextMotorTime){
-    nextMotorTime = millis() + 20; // 50 hz
+    // binary link: 100 hz (if UART bandwidth allows), otherwise 50 hz
+    nextMotorTime = millis() + ( (binaryLink && (ROBOT_BAUDRATE >= 57600)) ? 10 : 20 );
     requestMotorPwm(requestLeftPwm, requestRightPwm, requestMowPwm);
   }
   if (millis() > nextSummaryTime){
@@ -496,19 +617,17 @@ void SerialRobotDriver::run(){
       }
     }    
     if ((cmdMotorCounter > 0) && (cmdMotorResponseCounter == 0)){
-      CONSOLE.println("WARN: resetting motor ticks");
+      LOG(LOG_WARN, "WARN: resetting motor ticks");
       resetMotorTicks = true;
       mcuCommunicationLost = true;
     }    
-    if ( (cmdMotorResponseCounter < 30) ) { // || (cmdSummaryResponseCounter == 0) ){
-      CONSOLE.print("WARN: SerialRobot unmet communication frequency: motorFreq=");
-      CONSOLE.print(cmdMotorCounter);
-      CONSOLE.print("/");
-      CONSOLE.print(cmdMotorResponseCounter);
-      CONSOLE.print("  summaryFreq=");
-      CONSOLE.print(cmdSummaryCounter);
-      CONSOLE.print("/");
-      CONSOLE.println(cmdSummaryResponseCounter);
+    if ( (cmdMotorResponseCounter < cmdMotorCounter * 3 / 5) ) { // || (cmdSummaryResponseCounter == 0) ){
+      LOG(LOG_WARN, "WARN: SerialRobot unmet communication frequency: motorFreq=%d/%d  summaryFreq=%d/%d",
+        cmdMotorCounter, cmdMotorResponseCounter, cmdSummaryCounter, cmdSummaryResponseCounter);
+      if (binaryLink){
+        LOG(LOG_WARN, "WARN: SerialRobot link: lost=%lu reordered=%lu crcErrors=%lu rtt(us)=%lu/%lu",
+          motorLink.lost, motorLink.reordered, linkCrcErrors, motorLink.avgRtt, motorLink.maxRtt);
+      }
       if (cmdMotorResponseCounter == 0){
         // FIXME: maybe reset motor PID controls here?
       }
@@ -624,10 +743,9 @@ void SerialMotorDriver::getMotorEncoderTicks(int &leftTicks, int &rightTicks, in
 
 SerialBatteryDriver::SerialBatteryDriver(SerialRobotDriver &sr) : serialRobot(sr){
   mcuBoardPoweredOn = true;
-  nextADCTime = 0;
+  adcVersion = 0;
   nextTempTime = 0;
   batteryTemp = 0;
-  adcTriggered = false;
   linuxShutdownTime = 0;
 }
 
@@ -669,31 +787,21 @@ float SerialBatteryDriver::getBatteryTemperature(){
 
 float SerialBatteryDriver::getBatteryVoltage(){
   #ifdef __linux__
-    // detect if MCU PCB is switched-off
-    if (millis() > nextADCTime){
-      if (!adcTriggered){
-        // trigger ADC measurement (mcuAna)
-        ioAdcMux(ADC_MCU_ANA);
-        ioAdcTrigger(ADC_I2C_ADDR);   
-        adcTriggered = true; 
-        nextADCTime = millis() + 5;    
-      } else {           
-        nextADCTime = millis() + 1000;
-        adcTriggered = false;
-        float v = ioAdc(ADC_I2C_ADDR);
-        mcuBoardPoweredOn = true;
-        if (v < 0){
-          CONSOLE.println("ERROR reading ADC channel mcuAna!");
-          // reset ADC
-          ioAdcStart(ADC_I2C_ADDR, false, true);
-        } else {
-          if ((v >0) && (v < 0.8)){
-            // no mcuAna, MCU PCB is probably switched off
-            CONSOLE.print("mcuAna=");
-            CONSOLE.println(v);      
-            CONSOLE.println("MCU PCB powered OFF!");
-            mcuBoardPoweredOn = false;        
-          }
+    // detect if MCU PCB is switched-off (mcuAna is measured by I2C worker)
+    I2cValue adc;
+    if ((i2cWorker.adcValue(ADC_MCU_ANA, adc)) && (adc.version != adcVersion)){
+      adcVersion = adc.version;
+      float v = adc.value;
+      mcuBoardPoweredOn = true;
+      if (v < 0){
+        CONSOLE.println("ERROR reading ADC channel mcuAna!");  // ADC is reset by I2C worker
+      } else {
+        if ((v >0) && (v < 0.8)){
+          // no mcuAna, MCU PCB is probably switched off
+          CONSOLE.print("mcuAna=");
+          CONSOLE.println(v);      
+          CONSOLE.println("MCU PCB powered OFF!");
+          mcuBoardPoweredOn = false;        
         }
       }
     }    
@@ -841,11 +949,11 @@ void SerialBuzzerDriver::run(){
 }
 
 void SerialBuzzerDriver::noTone(){
-  ioExpanderOut(EX2_I2C_ADDR, EX2_BUZZER_PORT, EX2_BUZZER_PIN, false);
+  i2cWorker.expanderOut(EX2_I2C_ADDR, EX2_BUZZER_PORT, EX2_BUZZER_PIN, false, I2C_PRIO_BUZZER);
 }
 
 void SerialBuzzerDriver::tone(int freq){
-  ioExpanderOut(EX2_I2C_ADDR, EX2_BUZZER_PORT, EX2_BUZZER_PIN, true);
+  i2cWorker.expanderOut(EX2_I2C_ADDR, EX2_BUZZER_PORT, EX2_BUZZER_PIN, true, I2C_PRIO_BUZZER);
 }
 
 
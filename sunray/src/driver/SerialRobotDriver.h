@@ -10,6 +10,7 @@
 
 #include <Arduino.h>
 #include "RobotDriver.h"
+#include "SerialRobotLink.h"
 #ifdef __linux__
   #include <Process.h>
 #endif
@@ -42,6 +43,12 @@ class SerialRobotDriver: public RobotDriver {
     bool triggeredLift;
     bool triggeredRain;
     bool triggeredStopButton;
+    // binary link (ROBOT_BINARY_LINK)
+    bool binaryLink;
+    LinkStats motorLink;
+    LinkStats summaryLink;
+    LinkStats versionLink;
+    unsigned long linkCrcErrors;
     void begin() override;
     void run() override;
     bool getRobotID(String &id) override;
@@ -56,6 +63,7 @@ class SerialRobotDriver: public RobotDriver {
     bool setLedState(int ledNumber, bool greenState, bool redState);
     bool setFanPowerState(bool state);
     bool setImuPowerState(bool state);
+    void clearLinkStats();
   protected:    
     bool ledPanelInstalled;
     #ifdef __linux__
@@ -64,6 +72,7 @@ class SerialRobotDriver: public RobotDriver {
     #endif
     String cmd;
     String cmdResponse;
+    LinkReceiver linkRx;
     unsigned long nextMotorTime;    
     unsigned long nextSummaryTime;
     unsigned long nextConsoleTime;
@@ -75,6 +84,8 @@ class SerialRobotDriver: public RobotDriver {
     int cmdMotorResponseCounter;
     int cmdSummaryResponseCounter;
     void sendRequest(String s);
+    void sendFrame(LinkWriter &w);
+    void processFrame();
     void processComm();
     void processResponse(bool checkCrc);
     void motorResponse();
@@ -103,8 +114,7 @@ class SerialBatteryDriver : public BatteryDriver {
     float batteryTemp;
     bool mcuBoardPoweredOn;
     unsigned long nextTempTime;
-    unsigned long nextADCTime;
-    bool adcTriggered;
+    unsigned long adcVersion;    // last evaluated mcuAna measurement
     unsigned long linuxShutdownTime;
     #ifdef __linux__
       Process batteryTempProcess;
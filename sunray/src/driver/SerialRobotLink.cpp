@@ -0,0 +1,246 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "SerialRobotLink.h"
+
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t linkCrc16(const uint8_t *data, int len){
+  uint16_t crc = 0xFFFF;
+  for (int i=0; i < len; i++){
+    crc ^= ((uint16_t)data[i]) << 8;
+    for (int j=0; j < 8; j++){
+      if (crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+        else crc <<= 1;
+    }
+  }
+  return crc;
+}
+
+int cobsEncode(const uint8_t *src, int len, uint8_t *dst){
+  int codeIdx = 0;
+  int out = 1;
+  uint8_t code = 1;
+  for (int i=0; i < len; i++){
+    if (src[i] == 0){
+      dst[codeIdx] = code;
+      codeIdx = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      code++;
+      if (code == 0xFF){
+        dst[codeIdx] = code;
+        codeIdx = out++;
+        code = 1;
+      }
+    }
+  }
+  dst[codeIdx] = code;
+  return out;
+}
+
+int cobsDecode(const uint8_t *src, int len, uint8_t *dst){
+  int in = 0;
+  int out = 0;
+  while (in < len){
+    uint8_t code = src[in++];
+    if (code == 0) return -1;
+    for (int i=1; i < code; i++){
+      if (in >= len) return -1;
+      dst[out++] = src[in++];
+    }
+    if ((code < 0xFF) && (in < len)) dst[out++] = 0;
+  }
+  return out;
+}
+
+
+// ------------------------------------------------------------------------------------
+
+void LinkWriter::begin(char type, uint16_t seq){
+  len = 0;
+  overflow = false;
+  u8(type);
+  u16(seq);
+}
+
+void LinkWriter::u8(uint8_t v){
+  if (len >= LINK_MAX_PAYLOAD - 2){  // keep room for CRC
+    overflow = true;
+    return;
+  }
+  payload[len++] = v;
+}
+
+void LinkWriter::u16(uint16_t v){
+  u8(v & 0xFF);
+  u8(v >> 8);
+}
+
+void LinkWriter::u32(uint32_t v){
+  u16(v & 0xFFFF);
+  u16(v >> 16);
+}
+
+void LinkWriter::f32(float v){
+  uint32_t u;
+  memcpy(&u, &v, 4);
+  u32(u);
+}
+
+void LinkWriter::text(const char *s){
+  while (*s) u8(*s++);
+}
+
+int LinkWriter::finish(uint8_t *frame){
+  if (overflow) return 0;
+  uint16_t crc = linkCrc16(payload, len);
+  payload[len++] = crc & 0xFF;
+  payload[len++] = crc >> 8;
+  frame[0] = LINK_FRAME_START;
+  int n = 1 + cobsEncode(payload, len, frame + 1);
+  frame[n++] = 0;
+  return n;
+}
+
+
+// ------------------------------------------------------------------------------------
+
+LinkReceiver::LinkReceiver(){
+  frameLen = 0;
+  binary = false;
+}
+
+LinkRxResult LinkReceiver::receive(uint8_t ch){
+  if (binary){
+    if (ch == 0){
+      binary = false;
+      return LINK_RX_FRAME;
+    }
+    if (frameLen < LINK_MAX_FRAME) frame[frameLen++] = ch;
+      else frameLen = LINK_MAX_FRAME + 1;  // overflow
+    return LINK_RX_BINARY;
+  }
+  if (ch == LINK_FRAME_START){
+    binary = true;
+    frameLen = 0;
+    return LINK_RX_BINARY;
+  }
+  if (ch == 0) return LINK_RX_BINARY;  // delimiter of a frame with lost start marker
+  return LINK_RX_ASCII;
+}
+
+
+// ------------------------------------------------------------------------------------
+
+bool LinkReader::begin(const uint8_t *frame, int frameLen, uint8_t *buf){
+  payload = buf;
+  pos = 0;
+  underflow = false;
+  len = cobsDecode(frame, frameLen, buf);
+  if (len < 5) return false;   // type, seq, crc
+  uint16_t crc = buf[len-2] | (buf[len-1] << 8);
+  len -= 2;
+  return (linkCrc16(buf, len) == crc);
+}
+
+char LinkReader::type(){
+  return (char)payload[0];
+}
+
+uint8_t LinkReader::u8(){
+  if (pos >= len){
+    underflow = true;
+    return 0;
+  }
+  return payload[pos++];
+}
+
+uint16_t LinkReader::u16(){
+  uint16_t v = u8();
+  return v | (((uint16_t)u8()) << 8);
+}
+
+uint32_t LinkReader::u32(){
+  uint32_t v = u16();
+  return v | (((uint32_t)u16()) << 16);
+}
+
+float LinkReader::f32(){
+  uint32_t u = u32();
+  float v;
+  memcpy(&v, &u, 4);
+  return v;
+}
+
+String LinkReader::text(){
+  String s;
+  while (pos < len) s += (char)payload[pos++];
+  return s;
+}
+
+
+// ------------------------------------------------------------------------------------
+
+void LinkStats::begin(){
+  txSeq = 0;
+  for (int i=0; i < LINK_PENDING; i++){
+    pendingSeq[i] = 0;
+    pendingTime[i] = 0;
+  }
+  clear();
+}
+
+void LinkStats::clear(){
+  requests = 0;
+  responses = 0;
+  lost = 0;
+  reordered = 0;
+  avgRtt = 0;
+  maxRtt = 0;
+  maxMcuGap = 0;
+  lastMcuTime = 0;
+  rxValid = false;
+}
+
+uint16_t LinkStats::request(){
+  uint16_t seq = txSeq++;
+  pendingSeq[seq % LINK_PENDING] = seq;
+  pendingTime[seq % LINK_PENDING] = micros();
+  requests++;
+  return seq;
+}
+
+void LinkStats::response(uint16_t seq, unsigned long mcuTime){
+  responses++;
+  if (!rxValid){
+    rxValid = true;
+    rxSeq = seq + 1;
+  } else {
+    int16_t gap = (int16_t)(seq - rxSeq);
+    if (gap >= 0){
+      lost += gap;
+      rxSeq = seq + 1;
+    } else {
+      // late response (was counted as lost)
+      reordered++;
+      if (lost > 0) lost--;
+    }
+  }
+  int idx = seq % LINK_PENDING;
+  if ((pendingSeq[idx] == seq) && (pendingTime[idx] != 0)){
+    unsigned long rtt = micros() - pendingTime[idx];
+    pendingTime[idx] = 0;
+    if (avgRtt == 0) avgRtt = rtt;
+      else avgRtt = (avgRtt * 15 + rtt) / 16;
+    if (rtt > maxRtt) maxRtt = rtt;
+  }
+  if (lastMcuTime != 0){
+    unsigned long mcuGap = mcuTime - lastMcuTime;
+    if ((mcuGap > maxMcuGap) && (mcuGap < 60000)) maxMcuGap = mcuGap;
+  }
+  lastMcuTime = mcuTime;
+}
@@ -0,0 +1,119 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+// binary framed link between Linux and robot MCU (optional, see ROBOT_BINARY_LINK)
+//
+// frame:    start marker 0x01, COBS encoded payload, terminated by 0x00
+// payload:  type (1 byte), sequence number (uint16), [MCU time in ms (uint32, responses only)], data, CRC-16/CCITT (uint16)
+// all values little endian, floats as IEEE754 32 bit
+// a response carries the sequence number of its request, requests are pipelined (not lock-step)
+// the start marker (SOH) never occurs in ASCII lines ('AT+...', 'M,...'), so lines and frames can share one UART
+//
+// requests (Linux -> MCU):
+//   'M' motor:    int16 left, int16 right, int16 mow         (MCU side left/right)
+//   'S' summary:  -
+//   'V' version:  -
+// responses (MCU -> Linux):
+//   'M' motor:    int32 ticksLeft, int32 ticksRight, int32 ticksMow, float chargeVoltage, uint8 flags (bumper, lift, stopButton)
+//   'S' summary:  float batVoltage, float chgVoltage, float chgCurrent, uint8 flags (lift, bumper, rain, motorOverload),
+//                 float mowCurr, float motorLeftCurr, float motorRightCurr, float batteryTemp
+//   'V' version:  firmware name and version (text 'name,version')
+
+#ifndef SERIAL_ROBOT_LINK_H
+#define SERIAL_ROBOT_LINK_H
+
+#include <Arduino.h>
+
+#define LINK_FRAME_START  0x01 // frame start marker
+#define LINK_MAX_PAYLOAD  60
+#define LINK_MAX_FRAME    (LINK_MAX_PAYLOAD + 3)  // start marker, COBS overhead, 0x00 delimiter
+#define LINK_PENDING      16   // outstanding requests tracked per message type (round-trip time)
+
+uint16_t linkCrc16(const uint8_t *data, int len);
+// returns encoded length (without 0x00 delimiter)
+int cobsEncode(const uint8_t *src, int len, uint8_t *dst);
+// returns decoded length or -1 on error
+int cobsDecode(const uint8_t *src, int len, uint8_t *dst);
+
+
+// builds a frame payload
+class LinkWriter {
+  public:
+    uint8_t payload[LINK_MAX_PAYLOAD];
+    int len;
+    bool overflow;
+    void begin(char type, uint16_t seq);
+    void u8(uint8_t v);
+    void u16(uint16_t v);
+    void u32(uint32_t v);
+    void i16(int16_t v){ u16((uint16_t)v); }
+    void i32(int32_t v){ u32((uint32_t)v); }
+    void f32(float v);
+    void text(const char *s);
+    // appends CRC and COBS encodes payload into frame (incl. start marker and 0x00 delimiter), returns frame length (0: overflow)
+    int finish(uint8_t *frame);
+};
+
+// reads a (decoded and CRC checked) frame payload
+class LinkReader {
+  public:
+    const uint8_t *payload;
+    int len;
+    int pos;
+    bool underflow;
+    // decodes frame (without 0x00 delimiter) into buf and checks CRC
+    bool begin(const uint8_t *frame, int frameLen, uint8_t *buf);
+    char type();
+    uint8_t u8();
+    uint16_t u16();
+    uint32_t u32();
+    int16_t i16(){ return (int16_t)u16(); }
+    int32_t i32(){ return (int32_t)u32(); }
+    float f32();
+    String text();
+};
+
+enum LinkRxResult {
+  LINK_RX_ASCII,     // byte belongs to an ASCII line
+  LINK_RX_BINARY,    // byte belongs to a frame
+  LINK_RX_FRAME,     // frame complete (see frame, frameLen)
+};
+
+// splits received bytes into ASCII characters and frames
+class LinkReceiver {
+  public:
+    uint8_t frame[LINK_MAX_FRAME];   // COBS encoded frame (without start marker and 0x00 delimiter)
+    int frameLen;                    // > LINK_MAX_FRAME: overflow
+    LinkReceiver();
+    LinkRxResult receive(uint8_t ch);
+  protected:
+    bool binary;
+};
+
+// per message type link statistics
+class LinkStats {
+  public:
+    unsigned long requests;
+    unsigned long responses;
+    unsigned long lost;        // responses missing (sequence gaps)
+    unsigned long reordered;   // responses arriving after a newer one
+    unsigned long avgRtt;      // us
+    unsigned long maxRtt;      // us
+    unsigned long maxMcuGap;   // ms between consecutive responses (MCU time)
+    unsigned long lastMcuTime; // ms
+    void begin();
+    void clear();
+    // returns sequence number for next request
+    uint16_t request();
+    void response(uint16_t seq, unsigned long mcuTime);
+  protected:
+    uint16_t txSeq;
+    uint16_t rxSeq;
+    bool rxValid;
+    uint16_t pendingSeq[LINK_PENDING];
+    unsigned long pendingTime[LINK_PENDING]; // us (0: no request pending)
+};
+
+#endif
@@ -451,6 +451,7 @@ void SimImuDriver::run(){
 
 
 bool SimImuDriver::isDataAvail(){
+  sampleCount = 0;
   if (simNoData) return false;
   if (simDataTimeout) {
     delay(100);    
@@ -461,6 +462,7 @@ bool SimImuDriver::isDataAvail(){
     pitch = 0;
     if (simTilt) pitch = PI/180.0 * 90;
     yaw = simRobot.simDelta;        
+    addSample(millis());
     return true;
   } else {
     return false;
@@ -490,6 +492,8 @@ SimGpsDriver::SimGpsDriver(SimRobotDriver &sr): simRobot(sr){
   floatX = 0;
   floatY = 0;
   solutionAvail = false;
+  solutionTime = 0;
+  solutionTOW = 0;
   simGpsJump = false;
   setSimSolution(SOL_INVALID);
 }
@@ -555,6 +559,8 @@ void SimGpsDriver::run(){
       dgpsAge = millis();              
       groundSpeed = simRobot.linearSpeed;
       solutionAvail = true;
+      solutionTime = millis();
+      solutionTOW = iTOW;
     }
   }
 }    
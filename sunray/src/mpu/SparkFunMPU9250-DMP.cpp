@@ -453,6 +453,50 @@ inv_error_t MPU9250_DMP::dmpUpdateFifo(void)
 	return INV_SUCCESS;
 }
 
+inv_error_t MPU9250_DMP::dmpReadFifoBurst(unsigned char *data, unsigned char maxPackets,
+                                          unsigned char &packets, unsigned short &more)
+{
+	if (dmp_read_fifo_burst(data, maxPackets, &packets, &more) != INV_SUCCESS)
+		return INV_ERROR;
+	return INV_SUCCESS;
+}
+
+inv_error_t MPU9250_DMP::dmpParseFifoPacket(const unsigned char *data, unsigned char index)
+{
+	short gyro[3];
+	short accel[3];
+	long quat[4];
+	short sensors;
+	
+	if (dmp_parse_fifo_packet(data + index * dmp_get_packet_length(), gyro, accel, quat, &sensors)
+		   != INV_SUCCESS)
+	{
+		return INV_ERROR;
+	}
+	
+	if (sensors & INV_XYZ_ACCEL)
+	{
+		ax = accel[X_AXIS];
+		ay = accel[Y_AXIS];
+		az = accel[Z_AXIS];
+	}
+	if (sensors & INV_X_GYRO)
+		gx = gyro[X_AXIS];
+	if (sensors & INV_Y_GYRO)
+		gy = gyro[Y_AXIS];
+	if (sensors & INV_Z_GYRO)
+		gz = gyro[Z_AXIS];
+	if (sensors & INV_WXYZ_QUAT)
+	{
+		qw = quat[0];
+		qx = quat[1];
+		qy = quat[2];
+		qz = quat[3];
+	}
+	
+	return INV_SUCCESS;
+}
+
 inv_error_t MPU9250_DMP::dmpEnableFeatures(unsigned short mask)
 {
 	unsigned short enMask = 0;
@@ -270,6 +270,17 @@ public:
 	// Output: INV_SUCCESS (0) on success, otherwise error
 	inv_error_t dmpUpdateFifo(void); 
 	
+	// dmpReadFifoBurst -- Reads all complete packets (up to maxPackets) from the FIFO
+	// with as few I2C transfers as possible. Use dmpParseFifoPacket to parse them.
+	// Input: buffer for maxPackets * DMP_MAX_PACKET_LENGTH bytes
+	// Output: INV_SUCCESS (0) on success, otherwise error, packets read and remaining in FIFO
+	inv_error_t dmpReadFifoBurst(unsigned char *data, unsigned char maxPackets,
+	                             unsigned char &packets, unsigned short &more);
+	// dmpParseFifoPacket -- Parses packet [index] read by dmpReadFifoBurst and fills
+	// accelerometer, gyroscope and quaternion public variables.
+	// Output: INV_SUCCESS (0) on success, otherwise error (corrupted FIFO has been reset)
+	inv_error_t dmpParseFifoPacket(const unsigned char *data, unsigned char index);
+	
 	// dmpEnableFeatures -- Enable one, or multiple DMP features.
 	// Input: An OR'd list of features (see dmpBegin)
 	// Output: INV_SUCCESS (0) on success, otherwise error
@@ -47,6 +47,7 @@
 #define get_ms    arduino_get_clock_ms
 #define log_i     _MLPrintLog
 #define log_e     _MLPrintLog 
+#define I2C_BURST_LENGTH  32   /* max. bytes per I2C read (Wire buffer) */
 static inline int reg_int_cb(struct int_param_s *int_param)
 {
   return 0;
@@ -1774,6 +1775,62 @@ int mpu_read_fifo_stream(unsigned short length, unsigned char *data,
     return 0;
 }
 
+/**
+ *  @brief      Get all complete unparsed packets from the FIFO (burst read).
+ *  The FIFO count is read once, then up to @e max_packets packets are
+ *  transferred with as few I2C reads as possible (I2C_BURST_LENGTH bytes each).
+ *  @param[in]  length       Length of one FIFO packet.
+ *  @param[out] data         FIFO packets (max_packets * length bytes).
+ *  @param[in]  max_packets  Max. number of packets to read.
+ *  @param[out] packets      Number of packets read.
+ *  @param[out] more         Number of packets remaining in FIFO.
+ *  @return     0 if successful.
+ */
+int mpu_read_fifo_burst(unsigned short length, unsigned char *data,
+    unsigned char max_packets, unsigned char *packets, unsigned short *more)
+{
+    unsigned char tmp[2];
+    unsigned short fifo_count, count, pos, chunk;
+    packets[0] = 0;
+    more[0] = 0;
+    if (!st.chip_cfg.dmp_on)
+        return -1;
+    if (!st.chip_cfg.sensors)
+        return -1;
+    if (!length)
+        return -1;
+
+    if (i2c_read(st.hw->addr, st.reg->fifo_count_h, 2, tmp))
+        return -1;
+    fifo_count = (tmp[0] << 8) | tmp[1];
+    if (fifo_count < length)
+        return 0;
+    if (fifo_count > (st.hw->max_fifo >> 1)) {
+        /* FIFO is 50% full, better check overflow bit. */
+        if (i2c_read(st.hw->addr, st.reg->int_status, 1, tmp))
+            return -1;
+        if (tmp[0] & BIT_FIFO_OVERFLOW) {
+            mpu_reset_fifo();
+            return -2;
+        }
+    }
+
+    count = fifo_count / length;
+    if (count > max_packets)
+        count = max_packets;
+    /* FIFO_R_W pops one byte per read, so packets may span I2C transfers. */
+    for (pos = 0; pos < count * length; pos += chunk) {
+        chunk = count * length - pos;
+        if (chunk > I2C_BURST_LENGTH)
+            chunk = I2C_BURST_LENGTH;
+        if (i2c_read(st.hw->addr, st.reg->fifo_r_w, chunk, data + pos))
+            return -1;
+    }
+    packets[0] = count;
+    more[0] = fifo_count / length - count;
+    return 0;
+}
+
 /**
  *  @brief      Set device to bypass mode.
  *  @param[in]  bypass_on   1 to enable bypass mode.
@@ -1244,7 +1244,6 @@ int dmp_read_fifo(short *gyro, short *accel, long *quat,
     unsigned long *timestamp, short *sensors, unsigned char *more)
 {
     unsigned char fifo_data[MAX_PACKET_LENGTH];
-    unsigned char ii = 0;
 
     /* TODO: sensors[0] only changes when dmp_enable_feature is called. We can
      * cache this value and save some cycles.
@@ -1255,6 +1254,55 @@ int dmp_read_fifo(short *gyro, short *accel, long *quat,
     if (mpu_read_fifo_stream(dmp.packet_length, fifo_data, more))
         return -1;
 
+    if (dmp_parse_fifo_packet(fifo_data, gyro, accel, quat, sensors))
+        return -1;
+
+    get_ms(timestamp);
+    return 0;
+}
+
+/**
+ *  @brief      Get all complete DMP packets from the FIFO (burst read).
+ *  Use dmp_parse_fifo_packet to parse the packets (dmp_get_packet_length bytes
+ *  each, oldest first).
+ *  @param[out] data        FIFO packets (max_packets * MAX_PACKET_LENGTH bytes).
+ *  @param[in]  max_packets Max. number of packets to read.
+ *  @param[out] packets     Number of packets read.
+ *  @param[out] more        Number of packets remaining in FIFO.
+ *  @return     0 if successful.
+ */
+int dmp_read_fifo_burst(unsigned char *data, unsigned char max_packets,
+    unsigned char *packets, unsigned short *more)
+{
+    return mpu_read_fifo_burst(dmp.packet_length, data, max_packets, packets,
+        more);
+}
+
+/**
+ *  @brief      Get length of one DMP FIFO packet.
+ *  @return     Packet length in bytes.
+ */
+unsigned char dmp_get_packet_length(void)
+{
+    return dmp.packet_length;
+}
+
+/**
+ *  @brief      Parse one DMP packet read from the FIFO.
+ *  @param[in]  fifo_data   DMP packet.
+ *  @param[out] gyro        Gyro data in hardware units.
+ *  @param[out] accel       Accel data in hardware units.
+ *  @param[out] quat        3-axis quaternion data in hardware units.
+ *  @param[out] sensors     Mask of sensors read from FIFO.
+ *  @return     0 if successful (-1: corrupted packet, FIFO was reset).
+ */
+int dmp_parse_fifo_packet(const unsigned char *fifo_data, short *gyro,
+    short *accel, long *quat, short *sensors)
+{
+    unsigned char ii = 0;
+
+    sensors[0] = 0;
+
     /* Parse DMP packet. */
     if (dmp.feature_mask & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT)) {
 #ifdef FIFO_CORRUPTION_CHECK
@@ -1322,9 +1370,8 @@ int dmp_read_fifo(short *gyro, short *accel, long *quat,
      * the gesture callbacks (if registered).
      */
     if (dmp.feature_mask & (DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT))
-        decode_gesture(fifo_data + ii);
+        decode_gesture((unsigned char *)fifo_data + ii);
 
-    get_ms(timestamp);
     return 0;
 }
 
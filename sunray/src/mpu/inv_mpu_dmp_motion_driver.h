@@ -90,8 +90,14 @@ int dmp_enable_gyro_cal(unsigned char enable);
 /* Read function. This function should be called whenever the MPU interrupt is
  * detected.
  */
+#define DMP_MAX_PACKET_LENGTH   (32)
 int dmp_read_fifo(short *gyro, short *accel, long *quat,
     unsigned long *timestamp, short *sensors, unsigned char *more);
+int dmp_read_fifo_burst(unsigned char *data, unsigned char max_packets,
+    unsigned char *packets, unsigned short *more);
+unsigned char dmp_get_packet_length(void);
+int dmp_parse_fifo_packet(const unsigned char *fifo_data, short *gyro,
+    short *accel, long *quat, short *sensors);
 
 #endif  /* #ifndef _INV_MPU_DMP_MOTION_DRIVER_H_ */
 
@@ -4,13 +4,61 @@
 #include "ntripclient.h"
 
 
+// CRC-24Q (RTCM3)
+static unsigned long crc24qTable[256];
+
+static void crc24qInit(){
+  for (int i=0; i < 256; i++){
+    unsigned long crc = ((unsigned long)i) << 16;
+    for (int k=0; k < 8; k++){
+      crc <<= 1;
+      if (crc & 0x1000000) crc ^= 0x1864CFB;
+    }
+    crc24qTable[i] = crc & 0xFFFFFF;
+  }
+}
+
+static unsigned long crc24q(const byte *data, int len){
+  unsigned long crc = 0;
+  for (int i=0; i < len; i++){
+    crc = ((crc << 8) & 0xFFFFFF) ^ crc24qTable[(crc >> 16) ^ data[i]];
+  }
+  return crc;
+}
+
+
 void NTRIPClient::begin(){
   CONSOLE.println("using NTRIPClient");  
+  crc24qInit();
+  state = NTRIP_DISCONNECTED;
   reconnectTimeout = 0;
   ggaTimeout = 0;
+  statsTimeout = 0;
+  rxLen = 0;
+  resyncEnd = 0;
+  clearStats();
   NTRIP.begin(115200);
 }
 
+void NTRIPClient::clearStats(){
+  rxBytes = 0;
+  rtcmFrames = 0;
+  rtcmCrcErrors = 0;
+  discardedBytes = 0;
+  gaps = 0;
+  maxGap = 0;
+  reconnects = 0;
+  uartDroppedBytes = 0;
+  maxUartWriteTime = 0;
+  lastFrameTime = 0;
+  typesCount = 0;
+}
+
+unsigned long NTRIPClient::correctionAge(){
+  if (lastFrameTime == 0) return 0;
+  return millis() - lastFrameTime;
+}
+
 void NTRIPClient::connectNTRIP(){
   /*CONSOLE.println("Requesting SourceTable.");
   if(reqSrcTbl(NTRIP_HOST,NTRIP_PORT)){
@@ -28,10 +76,15 @@ void NTRIPClient::connectNTRIP(){
   stop(); //Need to call "stop" function for next request.  
   */
   CONSOLE.println("Requesting MountPoint's Raw data");  
+  reconnects++;
+  rxLen = 0;
+  resyncEnd = 0;
   if(!reqRaw((char*)NTRIP_HOST,NTRIP_PORT,(char*)NTRIP_MOUNT,(char*)NTRIP_USER,(char*)NTRIP_PASS)){
     CONSOLE.println("Error requesting MointPoint");
   } else {
-    CONSOLE.println("Requesting MountPoint is OK");
+    // caster response is checked in run()
+    state = NTRIP_WAIT_RESPONSE;
+    reconnectTimeout = millis() + 20000;
   }
 }
 
@@ -39,6 +92,7 @@ void NTRIPClient::connectNTRIP(){
 void NTRIPClient::run(){
   if (millis() > reconnectTimeout){
     if (connected()) stop();          
+    state = NTRIP_DISCONNECTED;
     reconnectTimeout = millis() + 10000;
     if (millis() < ggaTimeout){
       CONSOLE.println("NTRIP disconnected - reconnecting...");
@@ -47,34 +101,183 @@ void NTRIPClient::run(){
       CONSOLE.println("NTRIP disconnected - waiting for GPS GGA message...");
     }
   }          
-  if (connected()) {
+  if ((state != NTRIP_DISCONNECTED) && (connected())) {
     // transfer NTRIP client data to GPS...
-    int count = 0;    
-    while(available()) {
-      char ch = read();  
-      NTRIP.write(ch);  // send to GPS receiver (GPS receiver NTRIP serial port)
-      count++;            
-      //CONSOLE.print(ch);            
-    }
-    if (count > 0){
-      CONSOLE.print("NTRIP:");
-      CONSOLE.println(count);
-      reconnectTimeout = millis() + 10000;    
-    }
+    receive();
   }
-  // transfer GPS NMEA data (GGA message) to NTRIP client... 
-  String nmea = "";
-  while (NTRIP.available()){
-    char ch = NTRIP.read();
-    if (connected()) write(ch);             // send to NTRIP client
-    nmea += ch;        
+  if ((state == NTRIP_STREAMING) && (millis() > statsTimeout)){
+    statsTimeout = millis() + 10000;
+    printStats();
   }
-  if (nmea != ""){    
+  // transfer GPS NMEA data (GGA message) to NTRIP client... 
+  char nmea[256];
+  bool received = false;
+  while (true){
+    int avail = NTRIP.available();
+    if (avail <= 0) break;
+    int n = NTRIP.read((uint8_t*)nmea, min(avail, (int)sizeof(nmea)-1));   // one system call
+    if (n <= 0) break;
+    if (connected()) write((const uint8_t*)nmea, n);             // send to NTRIP client
+    nmea[n] = '\0';
     CONSOLE.print(nmea);
+    received = true;
+  }
+  if (received){    
     ggaTimeout = millis() + 30000;            
   }  
 }
 
+// read all available caster bytes (in blocks)
+void NTRIPClient::receive(){
+  while (true){
+    int avail = available();
+    if (avail <= 0) break;
+    int n = read(rxBuf + rxLen, min(avail, NTRIP_RX_BUFFER_SIZE - rxLen));
+    if (n <= 0) break;
+    rxBytes += n;
+    rxLen += n;
+    reconnectTimeout = millis() + 10000;    
+    if (state == NTRIP_WAIT_RESPONSE) checkResponse();
+    if (state == NTRIP_STREAMING) scanFrames();
+    if (state == NTRIP_DISCONNECTED) break;
+  }
+}
+
+// first line of caster response must be 'ICY 200 OK'
+void NTRIPClient::checkResponse(){
+  byte *eol = (byte*)memchr(rxBuf, '\n', rxLen);
+  if (eol == NULL){
+    if (rxLen < 64) return;   // wait for complete line
+    eol = rxBuf + rxLen - 1;
+  }
+  int len = eol - rxBuf + 1;
+  if (strncmp((char*)rxBuf, "ICY 200 OK", 10) != 0){
+    char line[65];
+    int n = min(len, 64);
+    memcpy(line, rxBuf, n);
+    line[n] = '\0';
+    CONSOLE.print("NTRIP error response: ");
+    CONSOLE.println(line);
+    stop();
+    state = NTRIP_DISCONNECTED;
+    rxLen = 0;
+    return;
+  }
+  CONSOLE.println("Requesting MountPoint is OK");
+  state = NTRIP_STREAMING;
+  rxLen -= len;
+  if (rxLen > 0) memmove(rxBuf, rxBuf + len, rxLen);
+}
+
+// forward all complete RTCM3 frames in receive buffer to GPS receiver (incomplete frame is kept for next call)
+// frame: 0xD3, 6 bits reserved (0) + 10 bits length, payload (first 12 bits: message type), CRC-24Q (3 bytes)
+void NTRIPClient::scanFrames(){
+  int pos = 0;
+  while (pos < rxLen){
+    byte *preamble = (byte*)memchr(rxBuf + pos, 0xD3, rxLen - pos);
+    if (preamble == NULL){
+      discardedBytes += rxLen - pos;
+      pos = rxLen;
+      break;
+    }
+    discardedBytes += (preamble - rxBuf) - pos;
+    pos = preamble - rxBuf;
+    if (rxLen - pos < 3) break;
+    if ((rxBuf[pos+1] & 0xFC) != 0){
+      // reserved bits set - no frame
+      discardedBytes++;
+      pos++;
+      continue;
+    }
+    int len = ((rxBuf[pos+1] & 0x03) << 8) | rxBuf[pos+2];
+    if (rxLen - pos < len + 6) break;  // wait for remaining frame bytes
+    const byte *crc = rxBuf + pos + 3 + len;
+    unsigned long frameCrc = (((unsigned long)crc[0]) << 16) | (((unsigned long)crc[1]) << 8) | crc[2];
+    if (crc24q(rxBuf + pos, len + 3) != frameCrc){
+      // count bad frame once (not each candidate preamble found while resyncing inside it)
+      if (pos >= resyncEnd) rtcmCrcErrors++;
+      resyncEnd = max(resyncEnd, pos + len + 6);
+      discardedBytes++;
+      pos++;  // resync inside frame
+      continue;
+    }
+    resyncEnd = 0;
+    // forward complete frame in one write
+    unsigned long t = micros();
+    int written = (int)NTRIP.write(rxBuf + pos, len + 6);  // send to GPS receiver (GPS receiver NTRIP serial port)
+    t = micros() - t;
+    maxUartWriteTime = max(maxUartWriteTime, t);
+    if (written < 0) written = 0;
+    if (written < len + 6) uartDroppedBytes += len + 6 - written;
+    if (len >= 2) addFrameStats((rxBuf[pos+3] << 4) | (rxBuf[pos+4] >> 4));
+    pos += len + 6;
+  }
+  // move incomplete frame to buffer start
+  if (pos > 0){
+    resyncEnd = max(0, resyncEnd - pos);
+    rxLen -= pos;
+    if (rxLen > 0) memmove(rxBuf, rxBuf + pos, rxLen);
+  }
+}
+
+void NTRIPClient::addFrameStats(int type){
+  unsigned long now = millis();
+  rtcmFrames++;
+  if (lastFrameTime != 0){
+    unsigned long gap = now - lastFrameTime;
+    maxGap = max(maxGap, gap);
+    if (gap > NTRIP_GAP_TIME) gaps++;
+  }
+  lastFrameTime = now;
+  int idx = 0;
+  while ((idx < typesCount) && (types[idx].type != type)) idx++;
+  if (idx == typesCount){
+    if (typesCount == NTRIP_MAX_TYPES) return;
+    typesCount++;
+    types[idx].type = type;
+    types[idx].count = 0;
+    types[idx].interval = 0;
+  } else {
+    float dt = now - types[idx].lastTime;
+    if (types[idx].count == 1) types[idx].interval = dt;
+      else types[idx].interval = 0.9 * types[idx].interval + 0.1 * dt;
+  }
+  types[idx].count++;
+  types[idx].lastTime = now;
+}
+
+void NTRIPClient::printStats(){
+  CONSOLE.print("NTRIP: bytes=");
+  CONSOLE.print(rxBytes);
+  CONSOLE.print(" frames=");
+  CONSOLE.print(rtcmFrames);
+  CONSOLE.print(" age=");
+  CONSOLE.print(correctionAge());
+  CONSOLE.print(" crcErr=");
+  CONSOLE.print(rtcmCrcErrors);
+  CONSOLE.print(" discarded=");
+  CONSOLE.print(discardedBytes);
+  CONSOLE.print(" gaps=");
+  CONSOLE.print(gaps);
+  CONSOLE.print(" maxGap=");
+  CONSOLE.print(maxGap);
+  CONSOLE.print(" reconnects=");
+  CONSOLE.print(reconnects);
+  CONSOLE.print(" uartDropped=");
+  CONSOLE.print(uartDroppedBytes);
+  CONSOLE.print(" uartMaxUs=");
+  CONSOLE.print(maxUartWriteTime);
+  CONSOLE.print(" types=");
+  for (int i=0; i < typesCount; i++){
+    if (i > 0) CONSOLE.print(",");
+    CONSOLE.print(types[i].type);
+    CONSOLE.print(":");
+    CONSOLE.print(types[i].interval / 1000.0, 1);
+    CONSOLE.print("s");
+  }
+  CONSOLE.println();
+}
+
 
 bool NTRIPClient::reqSrcTbl(char* host,int port)
 {
@@ -139,21 +342,6 @@ bool NTRIPClient::reqRaw(char* host,int port,char* mntpnt,char* user,char* psw)
     #ifdef Debug
     CONSOLE.println(p);
     #endif
-    unsigned long timeout = millis();
-    while (available() == 0) {
-        if (millis() - timeout > 20000) {
-            CONSOLE.println("Client Timeout !");
-            return false;
-        }
-        delay(10);
-    }
-    char buffer[50];
-    readLine(buffer,sizeof(buffer));
-    if(strncmp((char*)buffer,"ICY 200 OK",10))
-    {
-      CONSOLE.print((char*)buffer);
-      return false;
-    }
     return true;
 }
 bool NTRIPClient::reqRaw(char* host,int port,char* mntpnt)
@@ -1,3 +1,14 @@
+/*
+  NTRIP client (linux only)
+
+  relays RTCM3 correction data from the NTRIP caster to the GPS receiver (NTRIP serial port) and
+  GPS NMEA data (GGA message) from the GPS receiver to the caster.
+  caster data is framed into RTCM3 messages (CRC-24Q checked), each valid message is forwarded in a
+  single write - bytes outside of valid messages are dropped.
+  statistics (correction age, gaps, message type rates, UART throughput) help to find out if RTK fix
+  dropouts are caused by the caster (no/missing messages), the network (reconnects) or the UART (dropped bytes).
+*/
+
 #ifndef NTRIP_CLIENT
 #define NTRIP_CLIENT
 
@@ -8,20 +19,69 @@
 #include <Arduino.h>
 #include <base64.h>
 
+#define RTCM_MAX_FRAME        1029   // preamble + 10 bit length (3 bytes), payload (max. 1023 bytes), CRC-24Q (3 bytes)
+#define NTRIP_RX_BUFFER_SIZE  2048   // must hold one complete frame
+#define NTRIP_MAX_TYPES       24     // number of RTCM3 message types in statistics
+#define NTRIP_GAP_TIME        2000   // correction gap (ms)
+
+
+enum NtripState {
+  NTRIP_DISCONNECTED,
+  NTRIP_WAIT_RESPONSE,     // request sent, waiting for caster response
+  NTRIP_STREAMING,         // receiving RTCM3 data
+};
+
+
+// RTCM3 message type statistics
+class RtcmTypeStats
+{
+  public:
+    unsigned short type;
+    unsigned long count;
+    unsigned long lastTime;  // millis
+    float interval;          // average time between messages (ms)
+};
+
+
 // TODO: should not extend WiFiClient to make it reusable
 class NTRIPClient : public WiFiClient{
   protected:
     unsigned long reconnectTimeout;
     unsigned long ggaTimeout;
+    unsigned long statsTimeout;
+    byte rxBuf[NTRIP_RX_BUFFER_SIZE];  // caster bytes not processed yet
+    int rxLen;
+    int resyncEnd;                     // end of last bad frame in rxBuf (resync inside it)
     void connectNTRIP();
-    bool reqSrcTbl(char* host,int port);   //request MountPoints List serviced the NTRIP Caster 
-    bool reqRaw(char* host,int port,char* mntpnt,char* user,char* psw);      //request RAW data from Caster 
+    void receive();
+    void checkResponse();
+    void scanFrames();
+    void addFrameStats(int type);
+    bool reqSrcTbl(char* host,int port);   //request MountPoints List serviced the NTRIP Caster
+    bool reqRaw(char* host,int port,char* mntpnt,char* user,char* psw);      //request RAW data from Caster
     bool reqRaw(char* host,int port,char* mntpnt); //non user
     int readLine(char* buffer,int size);
   public :
-    void begin();    
-    void run();        
-  
+    NtripState state;
+    // statistics
+    unsigned long rxBytes;            // bytes received from caster
+    unsigned long rtcmFrames;         // valid RTCM3 messages forwarded to GPS receiver
+    unsigned long rtcmCrcErrors;      // RTCM3 messages with CRC error
+    unsigned long discardedBytes;     // bytes outside of valid RTCM3 messages
+    unsigned long gaps;               // time between two RTCM3 messages > NTRIP_GAP_TIME
+    unsigned long maxGap;             // longest time between two RTCM3 messages (ms)
+    unsigned long reconnects;
+    unsigned long uartDroppedBytes;   // bytes not accepted by GPS receiver UART
+    unsigned long maxUartWriteTime;   // longest UART write (us)
+    unsigned long lastFrameTime;      // millis of last RTCM3 message (0=none)
+    RtcmTypeStats types[NTRIP_MAX_TYPES];
+    int typesCount;
+    void begin();
+    void run();
+    // time since last RTCM3 message (ms), 0 if no message received yet
+    unsigned long correctionAge();
+    void clearStats();
+    void printStats();
 };
 
 #endif  // __linux__
@@ -100,6 +100,8 @@ void ChargeOp::run(){
             }
             if (timetable.shouldAutostartNow()){
                 CONSOLE.println("DOCK_AUTO_START: will automatically continue mowing now");
+                int slot = timetable.mapSlot();
+                if (slot >= 0) maps.selectMap(slot);  // map selected in timetable
                 changeOp(mowOp); // continue mowing                                                    
             }
         }
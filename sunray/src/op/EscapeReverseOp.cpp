@@ -47,6 +47,7 @@ void EscapeReverseOp::run(){
         } else {
             CONSOLE.println("continue operation with virtual obstacle");
             maps.addObstacle(stateX, stateY);              
+            maps.learnObstacle(stateX, stateY);
             //Point pt;
             //if (!maps.findObstacleSafeMowPoint(pt)){
             //    changeOp(dockOp); // dock if no more (valid) mowing points
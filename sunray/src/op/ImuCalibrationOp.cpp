@@ -8,6 +8,7 @@
 #include "../../robot.h"
 #include "../../map.h"
 #include "../../StateEstimator.h"
+#include "../../i2cworker.h"
 
 
 String ImuCalibrationOp::name(){
@@ -46,7 +47,9 @@ void ImuCalibrationOp::run(){
         //if (imuCalibrationSeconds >= 9){
             imuIsCalibrating = false;
             lastIMUYaw = 0;          
+            i2cWorker.lock();
             imuDriver.resetData();
+            i2cWorker.unlock();
             imuDataTimeout = millis() + 10000;
             Op::changeOp(*nextOp);
         }
@@ -36,6 +36,12 @@ void MowOp::begin(){
 
     dockOp.dockReasonRainTriggered = false;    
 
+    // new mowing session (not continuing after obstacle/GPS/rain etc.)
+    if ((previousOp == &idleOp) || (previousOp == &chargeOp)) {
+        maps.startLearnedObstaclesSession();
+        if (maps.mowPointsIdx == 0) coverage.clear();  // mowing starts from first mowing point
+    }
+
     if (((initiatedByOperator) && (previousOp == &idleOp)) || (lastMapRoutingFailed))  maps.clearObstacles();
 
     if (maps.startMowing(stateX, stateY)){
@@ -268,6 +274,8 @@ void MowOp::onKidnapped(bool state){
 
 void MowOp::onNoFurtherWaypoints(){
     CONSOLE.println("mowing finished!");
+    coverage.findGaps();
+    coverage.dump();
     timetable.setMowingCompletedInCurrentTimeFrame(true);
     if (!finishAndRestart){             
         if (DOCKING_STATION){
@@ -29,6 +29,8 @@ void SKYTRAQ::begin(){
   this->count    = 0;
   this->dgpsAge  = 0;
   this->solutionAvail = false;
+  this->solutionTime = 0;
+  this->solutionTOW = 0;
   this->numSV    = 0;
   this->numSVdgps    = 0;
   this->accuracy  =0;
@@ -36,8 +38,9 @@ void SKYTRAQ::begin(){
   this->dgpsChecksumErrorCounter = 0;
   this->dgpsPacketCounter = 0;
   this->solutionTimeout = 0; 
-  gnssUpdateFlag = 0;
-  parser.SetNotify(this); 
+  this->solution = SOL_INVALID;
+  this->year = 0;
+  this->rxLen = 0;
   
   if (GPS_CONFIG){
     configure();
@@ -228,182 +231,335 @@ void SKYTRAQ::run()
     solutionAvail = true;
   }
   //CONSOLE.println("SKYTRAQ::run");
-  // read a byte from the serial port
+  // read all available bytes into receive buffer (in blocks) and decode complete lines
   Stream *stream; 
   if (useTCP) stream = _client;
     else stream = _bus;
 
-  if (!stream->available()) return;
-  while (!stream->available()) {		
-    byte data = stream->read();        		
-    parser.Encode(data); // NMEA parser
-    //parseBinary(data);  // binary parser
+  while (true) {
+    int avail = stream->available();
+    if (avail <= 0) break;
+#ifdef __linux__
+    int n = stream->read((uint8_t*)rxBuf + rxLen, min(avail, NMEA_RX_BUFFER_SIZE - rxLen));   // one system call
+#else
+    int n = stream->readBytes(rxBuf + rxLen, min(avail, NMEA_RX_BUFFER_SIZE - rxLen));
+#endif
+    if (n <= 0) break;
 #ifdef GPS_DUMP
-    //if (data == 0xA0) CONSOLE.println("\n");
-    //CONSOLE.print(data, HEX);
-    //CONSOLE.print(",");   
-    CONSOLE.print(((char)data)); 
+    CONSOLE.write((const uint8_t*)(rxBuf + rxLen), n);
 #endif
+    rxLen += n;
+    scanLines();
   }
 }
 
-// --------- NMEA parser callback ----------
+void SKYTRAQ::printTimestamp() {
+  if (year > 2019) {
+    CONSOLE.print("GPS Date (UTC) ");
+    CONSOLE.print(year);
+    CONSOLE.print("-");
+    CONSOLE.print(month);
+    CONSOLE.print("-");
+    CONSOLE.print(day);
+    CONSOLE.print("T");
+    CONSOLE.print(hour);
+    CONSOLE.print(":");
+    CONSOLE.print(mins);
+    CONSOLE.print(":");
+    CONSOLE.print(sec);
+    CONSOLE.print("  groundSpeed= "); CONSOLE.println(groundSpeed);
+  }
+}
 
-bool SKYTRAQ::gnssUpdated(U32 f, const char* buf, ParsingType type)
-{
-  gnssUpdateFlag |= f;
-  gdata = parser.GetGnssData();
-  processNmea(f, buf, type);
-  //return true to clear the flag in SkyTraqNmeaParseryTraq
+// --------- NMEA scanner ----------
+
+// NMEA sentences used by the firmware (talker sentences are matched without talker ID, e.g. GPGGA, GNGGA, BDGGA)
+enum NmeaSentence {
+  NMEA_GGA,
+  NMEA_RMC,
+  NMEA_GSA,
+  NMEA_VTG,
+  NMEA_PSTI030,
+  NMEA_PSTI032,
+};
+
+struct NmeaSentenceInfo {
+  const char *id;
+  byte offset;    // id position in line ('$' = 0)
+  byte len;
+  byte minFields; // fields required (incl. sentence id)
+  byte fields;    // fields used
+  NmeaSentence sentence;
+};
+
+static const NmeaSentenceInfo nmeaSentences[] = {
+  { "GGA,",      3, 4, 14, 14, NMEA_GGA },
+  { "RMC,",      3, 4, 10, 13, NMEA_RMC },     // mode indicator (NMEA 2.3+) is optional
+  { "GSA,",      3, 4, 18, 18, NMEA_GSA },
+  { "VTG,",      3, 4, 6,  6,  NMEA_VTG },
+  { "PSTI,030,", 1, 9, 16, 16, NMEA_PSTI030 },
+  { "PSTI,032,", 1, 9, 9,  9,  NMEA_PSTI032 },
+};
+
+static const double pow10Table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12 };
+
+// XOR of all bytes (4 bytes at a time)
+static byte nmeaChecksum(const char *p, int len){
+  uint32_t x = 0;
+  while (len >= 4){
+    uint32_t w;
+    memcpy(&w, p, 4);
+    x ^= w;
+    p += 4;
+    len -= 4;
+  }
+  x ^= x >> 16;
+  x ^= x >> 8;
+  byte chk = x;
+  while (len > 0){
+    chk ^= *p++;
+    len--;
+  }
+  return chk;
+}
+
+static int hexValue(char c){
+  if ((c >= '0') && (c <= '9')) return c - '0';
+  if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+  if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+  return -1;
+}
+
+// parse decimal number as fixed-point value (mantissa * 10^-decimals) - returns false for empty field
+static bool parseFixed(const char *s, long long &mantissa, int &decimals){
+  bool neg = false;
+  if ((*s == '-') || (*s == '+')){
+    neg = (*s == '-');
+    s++;
+  }
+  mantissa = 0;
+  decimals = 0;
+  bool digits = false;
+  bool frac = false;
+  for (; *s != '\0'; s++){
+    if ((*s >= '0') && (*s <= '9')){
+      if (decimals < 12){
+        mantissa = mantissa * 10 + (*s - '0');
+        if (frac) decimals++;
+      }
+      digits = true;
+    } else if ((*s == '.') && (!frac)) frac = true;
+      else break;
+  }
+  if (neg) mantissa = -mantissa;
+  return digits;
+}
+
+static bool parseDouble(const char *s, double &value){
+  long long mantissa;
+  int decimals;
+  if (!parseFixed(s, mantissa, decimals)) return false;
+  value = ((double)mantissa) / pow10Table[decimals];
   return true;
 }
 
-bool SKYTRAQ::processNmea(U32 f, const char* buf, ParsingType type)
-{
-  U32 i = 0;
-  const GnssData& gnss = *gdata;
-
-  for(; i < 32; ++i)
-  {
-    U32 mask = (1 << i);
-    switch((mask & f))
-    {
-    case SkyTraqNmeaParser::NoUpdate:
-      //Do nothing
-      break;
-    case SkyTraqNmeaParser::UpdateDate:
-      //CONSOLE.print("Date:");
-      //CONSOLE.print(gnss.GetYear());
-      //CONSOLE.print('/');
-      //CONSOLE.print(gnss.GetMonth());
-      //CONSOLE.print('/');
-      //CONSOLE.println(gnss.GetDay());
-      break;
-    case SkyTraqNmeaParser::UpdateTime:
-      //CONSOLE.print("Time:");
-      //CONSOLE.print(gnss.GetHour());
-      //CONSOLE.print(':');
-      //CONSOLE.print(gnss.GetMinute());
-      //CONSOLE.print(':');
-      //CONSOLE.println(gnss.GetSecond());      
-      break;
-    case SkyTraqNmeaParser::UpdateLatitude:
-      //CONSOLE.print("Latitude:");
-      //CONSOLE.println(gnss.GetLatitude());
-      lat = gnss.GetLatitude();            
-      break;
-    case SkyTraqNmeaParser::UpdateLongitude:
-      lon = gnss.GetLongitude();
-      //CONSOLE.print("Longitude:");
-      //CONSOLE.print(gnss.GetLongitude(),8);
-      //CONSOLE.print(",");
-      //CONSOLE.println(lon,8);
-      solutionAvail = true;
-      solutionTimeout=millis() + 1000;
-      break;
-    case SkyTraqNmeaParser::UpdateAltitude:
-      //CONSOLE.print("Altitude:");
-      //CONSOLE.println(gnss.GetAltitudeInMeter());
-      height = gnss.GetAltitudeInMeter();
-      break;
-    case SkyTraqNmeaParser::UpdateCourse:
-      //CONSOLE.print("Course:");
-      //CONSOLE.println(gnss.GetCourseInDegree());
-      break;
-    case SkyTraqNmeaParser::UpdateSpeed:
-      //CONSOLE.print("Speed:");
-      //CONSOLE.println(gnss.GetSpeedInKmHr());
-      groundSpeed = gnss.GetSpeedInKmHr() / 1000.0 * 60.0 * 60.0; 
-      break;
-    case SkyTraqNmeaParser::UpdateQualitMode:      
-      //CONSOLE.print("Qualit Mode:");
-      //CONSOLE.println(gnss.GetQualitMode());      
-      switch (gnss.GetQualitMode()){
-        case GnssData::QM_FloatRtk:
-          solution = SOL_FLOAT;
-          break;
-        case GnssData::QM_RealTimeKinematic:
-          solution = SOL_FIXED;
-          break;
-        default:
-          solution = SOL_INVALID;
-      }   
-      break;
-    case SkyTraqNmeaParser::UpdateNumberOfSv:
-      //CONSOLE.print("Number Of Sv:");
-      //CONSOLE.println(gnss.GetNumberOfSv());
-      numSV = gnss.GetNumberOfSv();
-      break;
-    case SkyTraqNmeaParser::UpdateHdop:
-      //CONSOLE.print("HDOP:");
-      //CONSOLE.println(gnss.GetHdop());
-      hAccuracy = gnss.GetHdop();
+// NMEA (d)ddmm.mmmm + hemisphere to degrees
+static bool parseDegrees(const char *s, const char *hemisphere, double &deg){
+  long long mantissa;
+  int decimals;
+  if (!parseFixed(s, mantissa, decimals)) return false;
+  long long scale = 1;
+  for (int i=0; i < decimals; i++) scale *= 10;
+  long long d = mantissa / (100 * scale);
+  long long minutes = mantissa - d * 100 * scale;
+  deg = ((double)d) + ((double)minutes) / (60.0 * ((double)scale));
+  if ((*hemisphere == 'S') || (*hemisphere == 'W')) deg = -deg;
+  return true;
+}
+
+static int parseInt(const char *s){
+  int value = 0;
+  while ((*s >= '0') && (*s <= '9')) value = value * 10 + (*s++ - '0');
+  return value;
+}
+
+// hhmmss.ss
+// hhmmss.sss - returns time of day (ms)
+unsigned long SKYTRAQ::parseTime(const char *s){
+  if (strlen(s) < 6) return 0;
+  hour = (s[0] - '0') * 10 + (s[1] - '0');
+  mins = (s[2] - '0') * 10 + (s[3] - '0');
+  sec = (s[4] - '0') * 10 + (s[5] - '0');
+  unsigned long ms = 0;
+  if (s[6] == '.'){
+    int scale = 100;
+    for (const char *p = s + 7; (*p >= '0') && (*p <= '9') && (scale > 0); p++){
+      ms += (*p - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return ((hour * 60UL + mins) * 60UL + sec) * 1000UL + ms;
+}
+
+// ddmmyy
+void SKYTRAQ::parseDate(const char *s){
+  if (strlen(s) < 6) return;
+  day = (s[0] - '0') * 10 + (s[1] - '0');
+  month = (s[2] - '0') * 10 + (s[3] - '0');
+  year = 2000 + (s[4] - '0') * 10 + (s[5] - '0');
+}
+
+// GGA quality (4=RTK fixed, 5=RTK float) or RMC/PSTI mode indicator (R=RTK fixed, F=RTK float)
+void SKYTRAQ::parseSolution(char mode){
+  switch (mode){
+    case '4':
+    case 'R':
+      solution = SOL_FIXED;
       break;
-    case SkyTraqNmeaParser::UpdatePdop:
-      //CONSOLE.print("PDOP:");
-      //CONSOLE.println(gnss.GetPdop());
+    case '5':
+    case 'F':
+      solution = SOL_FLOAT;
       break;
-    case SkyTraqNmeaParser::UpdateVdop:
-      //CONSOLE.print("VDOP:");
-      //CONSOLE.println(gnss.GetVdop());
-      vAccuracy = gnss.GetVdop();
+    default:
+      solution = SOL_INVALID;
+  }
+}
+
+// append raw receiver data to receive buffer and decode all complete lines
+void SKYTRAQ::parse(const byte *data, int len)
+{
+  while (len > 0){
+    int n = min(len, NMEA_RX_BUFFER_SIZE - rxLen);
+    memcpy(rxBuf + rxLen, data, n);
+    rxLen += n;
+    data += n;
+    len -= n;
+    scanLines();
+  }
+}
+
+// decode all complete lines in receive buffer (incomplete line is kept for next call)
+void SKYTRAQ::scanLines()
+{
+  int pos = 0;
+  while (pos < rxLen){
+    char *eol = (char*)memchr(rxBuf + pos, '\n', rxLen - pos);
+    if (eol == NULL) break;
+    int end = eol - rxBuf;
+    // line start ('$')
+    char *start = (char*)memchr(rxBuf + pos, '$', end - pos);
+    if (start != NULL){
+      int len = end - (start - rxBuf);
+      if ((len > 0) && (start[len-1] == '\r')) len--;
+      processSentence(start, len);
+    }
+    pos = end + 1;
+  }
+  if ((pos == 0) && (rxLen == NMEA_RX_BUFFER_SIZE)){
+    // line too long
+    pos = rxLen;
+  }
+  // move incomplete line to buffer start
+  if (pos > 0){
+    rxLen -= pos;
+    if (rxLen > 0) memmove(rxBuf, rxBuf + pos, rxLen);
+  }
+}
+
+// line: $....*HH (without CR/LF)
+void SKYTRAQ::processSentence(char *line, int len)
+{
+  if ((len < 10) || (line[len-3] != '*')) return;
+  // used sentence?
+  const NmeaSentenceInfo *info = NULL;
+  for (unsigned int i=0; i < sizeof(nmeaSentences) / sizeof(NmeaSentenceInfo); i++){
+    const NmeaSentenceInfo &s = nmeaSentences[i];
+    if ((s.offset + s.len <= len) && (memcmp(line + s.offset, s.id, s.len) == 0)){
+      info = &s;
       break;
-    case SkyTraqNmeaParser::UpdateNavigationMode:
-      //CONSOLE.print("Navigation Mode:");
-      //CONSOLE.println(gnss.GetNavigationMode());
+    }
+  }
+  if (info == NULL) return;
+  int h = hexValue(line[len-2]);
+  int l = hexValue(line[len-1]);
+  if ((h < 0) || (l < 0) || (nmeaChecksum(line + 1, len - 4) != ((h << 4) | l))){
+    CONSOLE.print("skytraq NMEA checksum error: ");
+    CONSOLE.write((const uint8_t*)line, len);
+    CONSOLE.println();
+    chksumErrorCounter++;
+    return;
+  }
+  // split needed fields in place
+  line[len-3] = '\0';
+  char *f[NMEA_MAX_FIELDS];
+  int num = 0;
+  char *p = line;
+  while (num < info->fields){
+    f[num++] = p;
+    p = strchr(p, ',');
+    if (p == NULL) break;
+    *p++ = '\0';
+  }
+  if (num < info->minFields) return;
+  double value;
+  unsigned long tod;
+  switch (info->sentence){
+    case NMEA_GGA:
+      // $GPGGA,time,lat,N,lon,E,quality,numSV,hdop,alt,M,sep,M,age,station
+      tod = parseTime(f[1]);
+      parseSolution(f[6][0]);
+      numSV = parseInt(f[7]);
+      if (parseDouble(f[8], value)) hAccuracy = value;
+      if (parseDouble(f[9], value)){
+        double sep = 0;
+        parseDouble(f[11], sep);
+        height = value + sep;   // HAE (WGS84 height) = MSL altitude + geoid separation (as UBLOX)
+      }
+      if (parseDouble(f[13], value)) dgpsAge = millis() - value * 1000;
+      if ((parseDegrees(f[2], f[3], lat)) && (parseDegrees(f[4], f[5], lon))){
+        solutionAvail = true;
+        solutionTime = millis();
+        solutionTOW = tod;
+        solutionTimeout = millis() + 1000;
+      }
       break;
-    case SkyTraqNmeaParser::UpdateSatelliteInfo:
-#if (_SUPPORT_GPS_SATELLITES_)
-      ShowSatellites(gnss.GetGpsSatellites());
-#endif
-#if (_SUPPORT_GLONASS_SATELLITES_)
-      ShowSatellites(gnss.GetGlonassSatellites());
-#endif
-#if (_SUPPORT_BEIDOU_SATELLITES_)
-      ShowSatellites(gnss.GetBeidouSatellites());
-#endif
+    case NMEA_RMC:
+      // $GPRMC,time,status,lat,N,lon,E,speed(knots),course,date,magvar,E,mode
+      parseTime(f[1]);
+      parseDate(f[9]);
+      if (parseDouble(f[7], value)) groundSpeed = value * 0.514444;
+      if (num > 12) parseSolution(f[12][0]);
       break;
-    case SkyTraqNmeaParser::UpdateEnuVelocity:
-      //CONSOLE.print("E-Velocity:");
-      //CONSOLE.print(gnss.GetEVelocity());
-      //CONSOLE.print("   N-Velocity:");
-      //CONSOLE.print(gnss.GetNVelocity());
-      //CONSOLE.print("   U-Velocity:");
-      //CONSOLE.println(gnss.GetUVelocity());
-     break;
-    case SkyTraqNmeaParser::UpdateRtkAge:
-      //CONSOLE.print("RTK Age:");
-      //CONSOLE.println(gnss.GetRtkAge());
-      dgpsAge = millis() - gnss.GetRtkAge() * 1000;
+    case NMEA_GSA:
+      // $GPGSA,mode,fix,sv1..sv12,pdop,hdop,vdop
+      if (parseDouble(f[16], value)) hAccuracy = value;
+      if (parseDouble(f[17], value)) vAccuracy = value;
       break;
-    case SkyTraqNmeaParser::UpdateRtkRatio:
-      //CONSOLE.print("RTK Ratio:");
-      //CONSOLE.println(gnss.GetRtkRatio());
-      numSVdgps = ((float)gnss.GetRtkRatio()) * 100.0 * numSV;  
-     break;
-    case SkyTraqNmeaParser::UpdateEnuProjection:
-      //CONSOLE.print("E-Projection:");
-      //CONSOLE.print(gnss.GetEProjection());
-      //CONSOLE.print("   N-Projection:");
-      //CONSOLE.print(gnss.GetNProjection());
-      //CONSOLE.print("   U-Projection:");
-      //CONSOLE.println(gnss.GetUProjection());      
-      relPosN = gnss.GetNProjection();
-      relPosE = gnss.GetEProjection();
-      relPosD = gnss.GetUProjection();      
+    case NMEA_VTG:
+      // $GPVTG,course,T,course,M,speed(knots),N,speed(km/h),K,mode
+      if (parseDouble(f[5], value)) groundSpeed = value * 0.514444;
       break;
-    case SkyTraqNmeaParser::UpdateBaselineLength:
-       //CONSOLE.print("RTK Baseline Length:");
-       //CONSOLE.println(gnss.GetBaselineLength());
-       break;
-    case SkyTraqNmeaParser::UpdateBaselineCourse:
-      //CONSOLE.print("RTK Baseline Course:");
-      //CONSOLE.println(gnss.GetBaselineCourse());
+    case NMEA_PSTI030:
+      // $PSTI,030,time,status,lat,N,lon,E,alt,ve,vn,vu,date,mode,rtkAge,rtkRatio
+      tod = parseTime(f[2]);
+      parseDate(f[12]);
+      parseSolution(f[13][0]);
+      if (parseDouble(f[14], value)) dgpsAge = millis() - value * 1000;
+      if (parseDouble(f[15], value)) numSVdgps = value * 100.0 * numSV;
+      if ((parseDegrees(f[4], f[5], lat)) && (parseDegrees(f[6], f[7], lon))){
+        solutionAvail = true;
+        solutionTime = millis();
+        solutionTOW = tod;
+        solutionTimeout = millis() + 1000;
+      }
       break;
-    default:
+    case NMEA_PSTI032:
+      // $PSTI,032,time,date,status,mode,east,north,up,baselineLength,baselineCourse
+      if (f[4][0] == 'V') break;
+      parseSolution(f[5][0]);
+      if (parseDouble(f[6], value)) relPosE = value;
+      if (parseDouble(f[7], value)) relPosN = value;
+      if (parseDouble(f[8], value)) relPosD = value;
       break;
-    }
   }
-  return true;
 }
-
@@ -6,17 +6,23 @@
 
   SkyTraq Phoenix GNSS receiver binary message protocol parser
   
+  NMEA: received bytes are read in blocks, complete lines are scanned in place (table of used sentences,
+  other sentences like GSV are skipped before checksum and field splitting), only used fields are parsed
+  (fixed-point numbers).
 */
 
 #ifndef SKYTRAQ_h
 #define SKYTRAQ_h
 
 #include "Arduino.h"			
-#include "SkyTraqNmeaParser.h"
 #include "../../gps.h"
 #include "../driver/RobotDriver.h"
 
-class SKYTRAQ : public SkyTraqNotifyFun, public GpsDriver {
+#define NMEA_RX_BUFFER_SIZE  512   // must hold one complete line
+#define NMEA_MAX_FIELDS      20
+
+
+class SKYTRAQ : public GpsDriver {
   public:
     typedef enum {
         GOT_NONE,
@@ -36,10 +42,12 @@ class SKYTRAQ : public SkyTraqNotifyFun, public GpsDriver {
     void run() override;
     bool configure() override;  
     void reboot() override;
+    void printTimestamp() override;
+    // reset parser state
+    void begin();
+    // decode raw receiver data (NMEA)
+    void parse(const byte *data, int len);
   private:
-    // The SkyTraqNmeaParser object
-    SkyTraqNmeaParser parser;
-
     uint32_t _baud;  	
     HardwareSerial* _bus;
     Client* _client;
@@ -52,13 +60,10 @@ class SKYTRAQ : public SkyTraqNotifyFun, public GpsDriver {
     bool useTCP;
     bool debug;
     bool verbose;
-    // The SkyTraqNmeaParser result
-    const GnssData* gdata;
-    // Notification of SkyTraqNmeaParser
-    U32 gnssUpdateFlag;
     unsigned long solutionTimeout;
+    char rxBuf[NMEA_RX_BUFFER_SIZE];   // received bytes not decoded yet
+    int rxLen;
     
-    void begin();
     void addchk(int b);
     void dispatchMessage();
     long unpack_int32(int offset);
@@ -67,8 +72,11 @@ class SKYTRAQ : public SkyTraqNotifyFun, public GpsDriver {
     long unpack(int offset, int size);
     void parseBinary(int b);	 
 
-    virtual bool gnssUpdated(U32 f, const char* buf, ParsingType type);
-    bool processNmea(U32 f, const char* buf, ParsingType type); 	    
+    void scanLines();
+    void processSentence(char *line, int len);
+    unsigned long parseTime(const char *s);
+    void parseDate(const char *s);
+    void parseSolution(char mode);
 };
 
 #endif
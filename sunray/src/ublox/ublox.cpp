@@ -11,6 +11,15 @@
 
 SFE_UBLOX_GPS configGPS; // used for f9p module configuration only
 
+static_assert(sizeof(ubx_nav_timeutc_t) == 20, "UBX-NAV-TIMEUTC size");
+static_assert(sizeof(ubx_nav_pvt_t) == 92, "UBX-NAV-PVT size");
+static_assert(sizeof(ubx_nav_velned_t) == 36, "UBX-NAV-VELNED size");
+static_assert(sizeof(ubx_nav_hpposllh_t) == 36, "UBX-NAV-HPPOSLLH size");
+static_assert(sizeof(ubx_nav_sig_t) == 8, "UBX-NAV-SIG size");
+static_assert(sizeof(ubx_nav_sig_block_t) == 16, "UBX-NAV-SIG block size");
+static_assert(sizeof(ubx_nav_relposned_t) == 64, "UBX-NAV-RELPOSNED size");
+static_assert(sizeof(ubx_rxm_rtcm_t) == 8, "UBX-RXM-RTCM size");
+
 
 // used to send .ubx log files via 'sendgps.py' to Arduino (also set GPS to Serial in config for this)
 //#define GPS_DUMP   1    
@@ -29,15 +38,16 @@ UBLOX::UBLOX()
 
 void UBLOX::begin(){
   CONSOLE.println("using gps driver: UBLOX");
-  this->state    = GOT_NONE;
   this->msgclass = -1;
   this->msgid    = -1;
   this->msglen   = -1;
-  this->chka     = -1;
-  this->chkb     = -1;
-  this->count    = 0;
+  this->payload  = NULL;
+  this->rxLen    = 0;
   this->dgpsAge  = 0;
+  this->solution = SOL_INVALID;
   this->solutionAvail = false;
+  this->solutionTime = 0;
+  this->solutionTOW = 0;
   this->numSV    = 0;
   this->numSVdgps    = 0;
   this->accuracy  =0;
@@ -245,120 +255,89 @@ void UBLOX::reboot(){
   configGPS.GNSSRestart();
 }
 
-void UBLOX::parse(int b)
+// append raw receiver data to receive buffer and decode all complete frames
+void UBLOX::parse(const byte *data, int len)
 {
-  if (debug) CONSOLE.print(b, HEX);
-  if (debug) CONSOLE.print(",");
-  if ((b == 0xB5) && (this->state == GOT_NONE)) {
-
-      if (debug) CONSOLE.println("\n");
-      this->state = GOT_SYNC1;
-  }
-
-  else if ((b == 0x62) && (this->state == GOT_SYNC1)) {
-
-      this->state = GOT_SYNC2;
-      this->chka = 0;
-      this->chkb = 0;
-  }
-
-  else if (this->state == GOT_SYNC2) {
-
-      this->state = GOT_CLASS;
-      this->msgclass = b;
-      this->addchk(b);
-  }
-
-  else if (this->state == GOT_CLASS) {
-
-      this->state = GOT_ID;
-      this->msgid = b;
-      this->addchk(b);
-  }
-
-  else if (this->state == GOT_ID) {
-
-      this->state = GOT_LENGTH1;
-      this->msglen = b;
-      this->addchk(b);
-  }
-
-  else if (this->state == GOT_LENGTH1) {
-
-      this->state = GOT_LENGTH2;
-      this->msglen += (b << 8);
-      if (debug) {
-        CONSOLE.print("payload size ");
-        CONSOLE.print(this->msglen, HEX);
-        CONSOLE.print(",");
-      }
-      this->count = 0;
-      this->addchk(b);
-  }
-
-  else if (this->state == GOT_LENGTH2) {
-
-      this->addchk(b);
-      if (this->count < sizeof(this->payload)){
-        this->payload[this->count] = b; 
-      } 
-      this->count += 1;
-
-      if (this->count >= this->msglen) {
-
-          this->state = GOT_PAYLOAD;
-      }
+  while (len > 0){
+    int n = min(len, UBX_RX_BUFFER_SIZE - rxLen);
+    memcpy(rxBuf + rxLen, data, n);
+    rxLen += n;
+    data += n;
+    len -= n;
+    scanFrames();
   }
+}
 
-  else if (this->state == GOT_PAYLOAD) {
 
-      if (b == this->chka){
-        this->state = GOT_CHKA;
-      } else {        
-        CONSOLE.print("ublox chka error, msgclass=");
-        CONSOLE.print(this->msgclass, HEX);
-        CONSOLE.print(", msgid=");
-        CONSOLE.print(this->msgid, HEX);
-        CONSOLE.print(", msglen=");
-        CONSOLE.print(this->msglen, HEX);        
-        CONSOLE.print(": ");
-        CONSOLE.print(b, HEX);
-        CONSOLE.print("!=");
-        CONSOLE.println(this->chka, HEX);
-        this->state = GOT_NONE;                
-        this->chksumErrorCounter++;
-      }
+// decode all complete frames in receive buffer (incomplete frame is kept for next call)
+// frame: 0xB5 0x62 class id length(2) payload chka chkb
+void UBLOX::scanFrames()
+{
+  int pos = 0;
+  while (pos < rxLen){
+    // search sync chars
+    const byte *sync = (const byte*)memchr(rxBuf + pos, 0xB5, rxLen - pos);
+    if (sync == NULL){
+      pos = rxLen;
+      break;
+    }
+    pos = sync - rxBuf;
+    if (rxLen - pos < 2) break;
+    if (rxBuf[pos+1] != 0x62){
+      pos++;
+      continue;
+    }
+    if (rxLen - pos < 6) break;
+    int len = rxBuf[pos+4] | (rxBuf[pos+5] << 8);
+    if (len > UBX_MAX_PAYLOAD){
+      CONSOLE.print("ublox msglen error, msglen=");
+      CONSOLE.println(len, HEX);
+      this->chksumErrorCounter++;
+      pos++;
+      continue;
+    }
+    if (rxLen - pos < len + 8) break;  // wait for remaining frame bytes
+    // Fletcher checksum over class, id, length and payload
+    byte chka = 0;
+    byte chkb = 0;
+    const byte *p = rxBuf + pos + 2;
+    const byte *end = p + 4 + len;
+    while (p < end){
+      chka += *p++;
+      chkb += chka;
+    }
+    if ((p[0] != chka) || (p[1] != chkb)){
+      CONSOLE.print("ublox checksum error, msgclass=");
+      CONSOLE.print(rxBuf[pos+2], HEX);
+      CONSOLE.print(", msgid=");
+      CONSOLE.print(rxBuf[pos+3], HEX);
+      CONSOLE.print(", msglen=");
+      CONSOLE.print(len, HEX);
+      CONSOLE.print(": ");
+      CONSOLE.print(p[0], HEX);
+      CONSOLE.print(",");
+      CONSOLE.print(p[1], HEX);
+      CONSOLE.print("!=");
+      CONSOLE.print(chka, HEX);
+      CONSOLE.print(",");
+      CONSOLE.println(chkb, HEX);
+      this->chksumErrorCounter++;
+      pos++;  // resync inside frame
+      continue;
+    }
+    this->msgclass = rxBuf[pos+2];
+    this->msgid = rxBuf[pos+3];
+    this->msglen = len;
+    this->payload = rxBuf + pos + 6;
+    this->dispatchMessage();
+    pos += len + 8;
   }
-
-  else if (this->state == GOT_CHKA) {
-
-      if (b == this->chkb) {
-          this->dispatchMessage();
-          this->state = GOT_NONE;
-      }
-
-      else {
-          CONSOLE.print("ublox chkb error, msgclass=");
-          CONSOLE.print(this->msgclass, HEX);
-          CONSOLE.print(", msgid=");
-          CONSOLE.print(this->msgid, HEX);
-          CONSOLE.print(", msglen=");
-          CONSOLE.print(this->msglen, HEX);        
-          CONSOLE.print(": ");
-          CONSOLE.print(b, HEX);
-          CONSOLE.print("!=");
-          CONSOLE.println(this->chkb, HEX);
-          this->state = GOT_NONE;
-          this->chksumErrorCounter++;
-      }
+  // move incomplete frame to buffer start
+  if (pos > 0){
+    rxLen -= pos;
+    if (rxLen > 0) memmove(rxBuf, rxBuf + pos, rxLen);
   }
 }
-
-
-void UBLOX::addchk(int b) {
-  this->chka = (this->chka + b) & 0xFF;
-  this->chkb = (this->chkb + this->chka) & 0xFF;
-}
     
 
 void UBLOX::dispatchMessage() {
@@ -368,13 +347,15 @@ void UBLOX::dispatchMessage() {
         switch (this->msgid) {
           case 0x021:
             { // UBX-NAV-TIMEUTC
-              iTOW = (unsigned long)this->unpack_int32(0);
-              year = (unsigned short)this->unpack_int16(12);
-              month = (unsigned char)this->unpack_int8(14);
-              day = (unsigned char)this->unpack_int8(15);
-              hour = (unsigned char)this->unpack_int8(16);
-              mins = (unsigned char)this->unpack_int8(17);
-              sec = (unsigned char)this->unpack_int8(18);              
+              if (msglen < (int)sizeof(ubx_nav_timeutc_t)) break;
+              const ubx_nav_timeutc_t *msg = (const ubx_nav_timeutc_t*)payload;
+              iTOW = msg->iTOW;
+              year = msg->year;
+              month = msg->month;
+              day = msg->day;
+              hour = msg->hour;
+              mins = msg->min;
+              sec = msg->sec;
               if (verbose) {
                 CONSOLE.print("UBX-NAV-TIMEUTC ");
                 CONSOLE.print("year=");
@@ -394,24 +375,28 @@ void UBLOX::dispatchMessage() {
             break;
           case 0x07:
             { // UBX-NAV-PVT
-              iTOW = (unsigned long)this->unpack_int32(0);
-
-              mwYear = (uint16_t)this->unpack_int16(4);
-              mwMonth = (uint8_t)this->unpack_int8(6);
-              mwDay = (uint8_t)this->unpack_int8(7);
-              mwHour = (uint8_t)this->unpack_int8(8);
-              mwMinute = (uint8_t)this->unpack_int8(9);
-              mwSecond = (uint8_t)this->unpack_int8(10);
-
-              //numSV = this->unpack_int8(23);               
+              if (msglen < (int)sizeof(ubx_nav_pvt_t)) break;
+              const ubx_nav_pvt_t *msg = (const ubx_nav_pvt_t*)payload;
+              iTOW = msg->iTOW;
+
+              mwYear = msg->year;
+              mwMonth = msg->month;
+              mwDay = msg->day;
+              mwHour = msg->hour;
+              mwMinute = msg->min;
+              mwSecond = msg->sec;
+
+              //numSV = msg->numSV;
               if (verbose) CONSOLE.println("UBX-NAV-PVT");
             }
             break;
           case 0x12:
             { // UBX-NAV-VELNED
-              iTOW = (unsigned long)this->unpack_int32(0);
-              groundSpeed = ((double)((unsigned long)this->unpack_int32(20))) / 100.0;
-              heading = ((double)this->unpack_int32(24)) * 1e-5 / 180.0 * PI;
+              if (msglen < (int)sizeof(ubx_nav_velned_t)) break;
+              const ubx_nav_velned_t *msg = (const ubx_nav_velned_t*)payload;
+              iTOW = msg->iTOW;
+              groundSpeed = ((double)msg->gSpeed) / 100.0;
+              heading = ((double)msg->heading) * 1e-5 / 180.0 * PI;
               //CONSOLE.print("heading:");
               //CONSOLE.println(heading);
               if (verbose) {
@@ -425,17 +410,16 @@ void UBLOX::dispatchMessage() {
             break;
           case 0x14: 
             { // UBX-NAV-HPPOSLLH
-              iTOW = (unsigned long)this->unpack_int32(4);
-              lon = (1e-7  * (this->unpack_int32(8)   +  (this->unpack_int8(24) * 1e-2)));
-              lat = (1e-7  * (this->unpack_int32(12)  +  (this->unpack_int8(25) * 1e-2)));
-              height = (1e-3 * (this->unpack_int32(16) +  (this->unpack_int8(26) * 1e-2))); // HAE (WGS84 height)
-              //height = (1e-3 * (this->unpack_int32(20) +  (this->unpack_int8(27) * 1e-2))); // MSL height
-              hAccuracy = ((double)((unsigned long)this->unpack_int32(28))) * 0.1 / 1000.0;
-              vAccuracy = ((double)((unsigned long)this->unpack_int32(32))) * 0.1 / 1000.0;
+              if (msglen < (int)sizeof(ubx_nav_hpposllh_t)) break;
+              const ubx_nav_hpposllh_t *msg = (const ubx_nav_hpposllh_t*)payload;
+              iTOW = msg->iTOW;
+              lon = (1e-7  * (msg->lon  +  (msg->lonHp * 1e-2)));
+              lat = (1e-7  * (msg->lat  +  (msg->latHp * 1e-2)));
+              height = (1e-3 * (msg->height +  (msg->heightHp * 1e-2))); // HAE (WGS84 height)
+              //height = (1e-3 * (msg->hMSL +  (msg->hMSLHp * 1e-2))); // MSL height
+              hAccuracy = ((double)msg->hAcc) * 0.1 / 1000.0;
+              vAccuracy = ((double)msg->vAcc) * 0.1 / 1000.0;
               accuracy = sqrt(sq(hAccuracy) + sq(vAccuracy));
-              // long hMSL = this->unpack_int32(16);
-              //unsigned long hAcc = (unsigned long)this->unpack_int32(20);
-              //unsigned long vAcc = (unsigned long)this->unpack_int32(24);                            
               if (verbose) {
                 CONSOLE.print("UBX-NAV-HPPOSLLH ");
                 CONSOLE.print("lon=");
@@ -447,9 +431,12 @@ void UBLOX::dispatchMessage() {
             break;            
           case 0x43:
             { // UBX-NAV-SIG
+              if (msglen < (int)sizeof(ubx_nav_sig_t)) break;
               if (verbose) CONSOLE.print("UBX-NAV-SIG ");
-              iTOW = (unsigned long)this->unpack_int32(0);
-              int numSigs = this->unpack_int8(5);              
+              const ubx_nav_sig_t *msg = (const ubx_nav_sig_t*)payload;
+              const ubx_nav_sig_block_t *sig = (const ubx_nav_sig_block_t*)(payload + sizeof(ubx_nav_sig_t));
+              iTOW = msg->iTOW;
+              int numSigs = min((int)msg->numSigs, (int)((msglen - sizeof(ubx_nav_sig_t)) / sizeof(ubx_nav_sig_block_t)));
               float ravg = 0;
               float rmax = 0;
               float rmin = 9999;
@@ -457,11 +444,11 @@ void UBLOX::dispatchMessage() {
               int crcnt = 0;              
               int healthycnt = 0;              
               for (int i=0; i < numSigs; i++){                
-                float prRes = ((float)((short)this->unpack_int16(12+16*i))) * 0.1;
-                float cno = ((float)this->unpack_int8(14+16*i));
-                int qualityInd = this->unpack_int8(15+16*i);                                                
-                int corrSource = this->unpack_int8(16+16*i);                                                
-                int sigFlags = (unsigned short)this->unpack_int16(18+16*i);                                                
+                float prRes = ((float)sig[i].prRes) * 0.1;
+                float cno = ((float)sig[i].cno);
+                int qualityInd = sig[i].qualityInd;
+                int corrSource = sig[i].corrSource;
+                int sigFlags = sig[i].sigFlags;
                 bool prUsed = ((sigFlags & 8) != 0);                                    
                 bool crUsed = ((sigFlags & 16) != 0);                                    
                 bool doUsed = ((sigFlags & 32) != 0);                                    
@@ -521,12 +508,16 @@ void UBLOX::dispatchMessage() {
             break;
           case 0x3C: 
             { // UBX-NAV-RELPOSNED              
-              iTOW = (unsigned long)this->unpack_int32(4);
-              relPosN = ((float)this->unpack_int32(8))/100.0;
-              relPosE = ((float)this->unpack_int32(12))/100.0;
-              relPosD = ((float)this->unpack_int32(16))/100.0;              
-              solution = (SolType)((this->unpack_int32(60) >> 3) & 3);              
+              if (msglen < (int)sizeof(ubx_nav_relposned_t)) break;
+              const ubx_nav_relposned_t *msg = (const ubx_nav_relposned_t*)payload;
+              iTOW = msg->iTOW;
+              relPosN = ((float)msg->relPosN)/100.0;
+              relPosE = ((float)msg->relPosE)/100.0;
+              relPosD = ((float)msg->relPosD)/100.0;
+              solution = (SolType)((msg->flags >> 3) & 3);
               solutionAvail = true;
+              solutionTime = millis();
+              solutionTOW = msg->iTOW;
               solutionTimeout=millis() + 1000;              
               if (verbose){
                 CONSOLE.print("UBX-NAV-RELPOSNED ");
@@ -566,8 +557,9 @@ void UBLOX::dispatchMessage() {
         switch (this->msgid) {
           case 0x32: 
             { // UBX-RXM-RTCM              
+              if (msglen < (int)sizeof(ubx_rxm_rtcm_t)) break;
               if (verbose) CONSOLE.println("UBX-RXM-RTCM");
-              byte flags = (byte)this->unpack_int8(1);
+              byte flags = ((const ubx_rxm_rtcm_t*)payload)->flags;
               if ((flags & 1) != 0) dgpsChecksumErrorCounter++;
               dgpsPacketCounter++;
               dgpsAge = millis();
@@ -590,33 +582,6 @@ void UBLOX::dispatchMessage() {
 }
 
 
-long UBLOX::unpack_int32(int offset) {
-  return this->unpack(offset, 4);
-}
-
-
-long UBLOX::unpack_int16(int offset) {
-  return this->unpack(offset, 2);
-}
-
-
-long UBLOX::unpack_int8(int offset) {
-  return this->unpack(offset, 1);
-}
-
-
-long UBLOX::unpack(int offset, int size) {
-  long value = 0; // four bytes on most Arduinos
-
-  for (int k=0; k<size; ++k) {
-    value <<= 8;
-    value |= (0xFF & this->payload[offset+size-k-1]);
-  }
-
-  return value;
-}
- 
-
 /* parse the uBlox data */
 void UBLOX::run()
 {
@@ -627,18 +592,28 @@ void UBLOX::run()
     solutionAvail = true;
   }
 
-	// read a byte from the serial port	  
-  if (!_bus->available()) return;
-  while (_bus->available()) {		
-    byte data = _bus->read();        
-		parse(data);
+  // read all available bytes into receive buffer (in blocks) and decode complete frames
+  while (true) {
+    int avail = _bus->available();
+    if (avail <= 0) break;
+#ifdef __linux__
+    int n = _bus->read(rxBuf + rxLen, min(avail, UBX_RX_BUFFER_SIZE - rxLen));   // one system call
+#else
+    int n = _bus->readBytes(rxBuf + rxLen, min(avail, UBX_RX_BUFFER_SIZE - rxLen));
+#endif
+    if (n <= 0) break;
 #ifdef GPS_DUMP_BIN
-    if (data == 0xB5) {
-      CONSOLE.println("\n");
+    for (int i=0; i < n; i++){
+      byte data = rxBuf[rxLen + i];
+      if (data == 0xB5) {
+        CONSOLE.println("\n");
+      }
+      CONSOLE.print(data, HEX);
+      CONSOLE.print(",");
     }
-    CONSOLE.print(data, HEX);
-    CONSOLE.print(",");
 #endif
+    rxLen += n;
+    scanFrames();
   }
 }
 
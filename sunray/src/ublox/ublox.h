@@ -14,6 +14,9 @@
   6) 'UBX-NAV-SIG'        20 (signal information)
   https://www.u-blox.com/sites/default/files/u-blox_ZED-F9P_InterfaceDescription_%28UBX-18010854%29.pdf
 
+  received bytes are read in blocks into a receive buffer, frames are found with memchr (sync chars),
+  checksummed in one pass and decoded in place via packed message views (see alfred/bench/ubxbench.cpp)
+
 */
 
 #ifndef UBLOX_h
@@ -23,20 +26,150 @@
 #include "../../gps.h"
 #include "../driver/RobotDriver.h"
 
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+  #error "UBX message views require a little-endian CPU"
+#endif
+
+#define UBX_MAX_PAYLOAD     2000   // larger frames are dropped
+#define UBX_RX_BUFFER_SIZE  2048   // must hold one complete frame (payload + 8 bytes)
+
+
+// UBX payload views (packed little-endian, decoded in place from the receive buffer)
+
+struct __attribute__((packed)) ubx_nav_timeutc_t {   // UBX-NAV-TIMEUTC
+  uint32_t iTOW;
+  uint32_t tAcc;
+  int32_t nano;
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t min;
+  uint8_t sec;
+  uint8_t valid;
+};
+
+struct __attribute__((packed)) ubx_nav_pvt_t {   // UBX-NAV-PVT
+  uint32_t iTOW;
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t min;
+  uint8_t sec;
+  uint8_t valid;
+  uint32_t tAcc;
+  int32_t nano;
+  uint8_t fixType;
+  uint8_t flags;
+  uint8_t flags2;
+  uint8_t numSV;
+  int32_t lon;
+  int32_t lat;
+  int32_t height;
+  int32_t hMSL;
+  uint32_t hAcc;
+  uint32_t vAcc;
+  int32_t velN;
+  int32_t velE;
+  int32_t velD;
+  int32_t gSpeed;
+  int32_t headMot;
+  uint32_t sAcc;
+  uint32_t headAcc;
+  uint16_t pDOP;
+  uint8_t flags3;
+  uint8_t reserved1[5];
+  int32_t headVeh;
+  int16_t magDec;
+  uint16_t magAcc;
+};
+
+struct __attribute__((packed)) ubx_nav_velned_t {   // UBX-NAV-VELNED
+  uint32_t iTOW;
+  int32_t velN;
+  int32_t velE;
+  int32_t velD;
+  uint32_t speed;
+  uint32_t gSpeed;
+  int32_t heading;
+  uint32_t sAcc;
+  uint32_t cAcc;
+};
+
+struct __attribute__((packed)) ubx_nav_hpposllh_t {   // UBX-NAV-HPPOSLLH
+  uint8_t version;
+  uint8_t reserved1[2];
+  uint8_t flags;
+  uint32_t iTOW;
+  int32_t lon;
+  int32_t lat;
+  int32_t height;
+  int32_t hMSL;
+  int8_t lonHp;
+  int8_t latHp;
+  int8_t heightHp;
+  int8_t hMSLHp;
+  uint32_t hAcc;
+  uint32_t vAcc;
+};
+
+struct __attribute__((packed)) ubx_nav_sig_t {   // UBX-NAV-SIG (followed by numSigs signal blocks)
+  uint32_t iTOW;
+  uint8_t version;
+  uint8_t numSigs;
+  uint8_t reserved0[2];
+};
+
+struct __attribute__((packed)) ubx_nav_sig_block_t {
+  uint8_t gnssId;
+  uint8_t svId;
+  uint8_t sigId;
+  uint8_t freqId;
+  int16_t prRes;
+  uint8_t cno;
+  uint8_t qualityInd;
+  uint8_t corrSource;
+  uint8_t ionoModel;
+  uint16_t sigFlags;
+  uint8_t reserved1[4];
+};
+
+struct __attribute__((packed)) ubx_nav_relposned_t {   // UBX-NAV-RELPOSNED
+  uint8_t version;
+  uint8_t reserved1;
+  uint16_t refStationId;
+  uint32_t iTOW;
+  int32_t relPosN;
+  int32_t relPosE;
+  int32_t relPosD;
+  int32_t relPosLength;
+  int32_t relPosHeading;
+  uint8_t reserved2[4];
+  int8_t relPosHPN;
+  int8_t relPosHPE;
+  int8_t relPosHPD;
+  int8_t relPosHPLength;
+  uint32_t accN;
+  uint32_t accE;
+  uint32_t accD;
+  uint32_t accLength;
+  uint32_t accHeading;
+  uint8_t reserved3[4];
+  uint32_t flags;
+};
+
+struct __attribute__((packed)) ubx_rxm_rtcm_t {   // UBX-RXM-RTCM
+  uint8_t version;
+  uint8_t flags;
+  uint16_t subType;
+  uint16_t refStation;
+  uint16_t msgType;
+};
+
+
 class UBLOX : public GpsDriver {
   public:    
-    typedef enum {
-        GOT_NONE,
-        GOT_SYNC1,
-        GOT_SYNC2,
-        GOT_CLASS,
-        GOT_ID,
-        GOT_LENGTH1,
-        GOT_LENGTH2, 
-        GOT_PAYLOAD,
-        GOT_CHKA 
-
-    } state_t;    
     UBLOX();
     void begin(Client &client, char *host, uint16_t port) override;
     void begin(HardwareSerial& bus,uint32_t baud) override;
@@ -44,19 +177,21 @@ class UBLOX : public GpsDriver {
     bool configure() override;  
     void reboot() override;
     void printTimestamp() override;
+    // reset parser state
+    void begin();
+    // decode raw receiver data (e.g. replayed from a .ubx log file)
+    void parse(const byte *data, int len);
   private:
     bool useTCP;
     Client* _client;    
     uint32_t _baud;  	
     HardwareSerial* _bus;
-    state_t state;
     int msgid;
     int msgclass;
     int msglen;
-    int chka;
-    int chkb;
-    int count;
-    char payload[2000];                                          
+    const byte *payload;                // payload of current message (inside rxBuf)
+    byte rxBuf[UBX_RX_BUFFER_SIZE];     // received bytes not decoded yet
+    int rxLen;
     bool debug;
     bool verbose;
     unsigned long solutionTimeout;    
@@ -69,14 +204,8 @@ class UBLOX : public GpsDriver {
     uint8_t mwSecond;
     uint32_t mwSpeed;
 
-    void begin();
-    void addchk(int b);
+    void scanFrames();
     void dispatchMessage();
-    long unpack_int32(int offset);
-    long unpack_int16(int offset);
-    long unpack_int8(int offset);
-    long unpack(int offset, int size);
-    void parse(int b);	  	    
 };
 
 #endif
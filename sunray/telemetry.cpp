@@ -0,0 +1,148 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+#include "telemetry.h"
+#include "config.h"
+#include "comm.h"
+
+#ifdef __linux__
+
+Telemetry telemetry;
+
+
+Telemetry::Telemetry(){
+  records = 0;
+  dropped = 0;
+  seq = 0;
+  for (int i=0; i < TELEMETRY_MAX_CLIENTS; i++) subs[i].used = false;
+}
+
+bool Telemetry::subscribe(BridgeClient &client, int rate){
+  for (int i=0; i < TELEMETRY_MAX_CLIENTS; i++){
+    TelemetrySubscriber &sub = subs[i];
+    if (sub.used) continue;
+    if (rate < 1) rate = 1;
+    if (rate > 50) rate = 50;
+    sub.client = client;
+    sub.used = true;
+    sub.interval = 1000 / rate;
+    sub.nextTime = millis();
+    sub.queueLen = 0;
+    sub.partialLen = 0;
+    sub.partialPos = 0;
+    sub.dropped = 0;
+    sub.client.print(
+      "HTTP/1.1 200 OK\r\n"
+      "Access-Control-Allow-Origin: *\r\n"
+      "Content-Type: text/event-stream\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Connection: keep-alive\r\n"
+      "\r\n"
+      );
+    CONSOLE.print("telemetry: subscribed rate=");
+    CONSOLE.println(rate);
+    return true;
+  }
+  CONSOLE.println("telemetry: too many subscribers");
+  return false;
+}
+
+int Telemetry::subscribers(){
+  int count = 0;
+  for (int i=0; i < TELEMETRY_MAX_CLIENTS; i++){
+    if (subs[i].used) count++;
+  }
+  return count;
+}
+
+void Telemetry::unsubscribe(TelemetrySubscriber &sub){
+  CONSOLE.print("telemetry: unsubscribed dropped=");
+  CONSOLE.println(sub.dropped);
+  sub.client.stop();
+  sub.used = false;
+}
+
+// encode latest state into ring (once per tick for all subscribers)
+void Telemetry::encode(){
+  String s = "data: ";
+  summaryRecord(s);
+  s += "\n\n";
+  int idx = seq % TELEMETRY_RING;
+  int len = s.length();
+  if (len > TELEMETRY_RECORD_SIZE) len = TELEMETRY_RECORD_SIZE;
+  memcpy(ring[idx], s.c_str(), len);
+  ringLen[idx] = len;
+  seq++;
+  records++;
+}
+
+// send queued records as far as the socket accepts them (never blocks)
+void Telemetry::flush(TelemetrySubscriber &sub){
+  while (true){
+    int space = sub.client.availableForWrite();
+    if (space <= 0) return;
+    if (sub.partialLen > 0){
+      int len = sub.partialLen - sub.partialPos;
+      if (len > space) len = space;
+      int res = sub.client.write((const uint8_t*)sub.partial + sub.partialPos, len);
+      sub.partialPos += res;
+      if (sub.partialPos < sub.partialLen) return;
+      sub.partialLen = 0;
+      continue;
+    }
+    if (sub.queueLen == 0) return;
+    unsigned long recSeq = sub.queue[0];
+    sub.queueLen--;
+    for (int i=0; i < sub.queueLen; i++) sub.queue[i] = sub.queue[i+1];
+    if (seq - recSeq > TELEMETRY_RING){
+      // record already overwritten in ring
+      sub.dropped++;
+      dropped++;
+      continue;
+    }
+    int idx = recSeq % TELEMETRY_RING;
+    int len = (ringLen[idx] < space) ? ringLen[idx] : space;
+    int res = sub.client.write((const uint8_t*)ring[idx], len);
+    if (res < ringLen[idx]){
+      // keep rest, the ring slot may be overwritten before the socket accepts more
+      sub.partialLen = ringLen[idx] - res;
+      sub.partialPos = 0;
+      memcpy(sub.partial, ring[idx] + res, sub.partialLen);
+      return;
+    }
+  }
+}
+
+void Telemetry::run(){
+  unsigned long now = millis();
+  bool encoded = false;
+  for (int i=0; i < TELEMETRY_MAX_CLIENTS; i++){
+    TelemetrySubscriber &sub = subs[i];
+    if (!sub.used) continue;
+    if (!sub.client.connected()){
+      unsubscribe(sub);
+      continue;
+    }
+    if ((long)(now - sub.nextTime) >= 0){
+      sub.nextTime += sub.interval;
+      if ((long)(sub.nextTime - now) <= 0) sub.nextTime = now + sub.interval;
+      if (!encoded){
+        encode();
+        encoded = true;
+      }
+      if (sub.queueLen == TELEMETRY_QUEUE){
+        // drop oldest
+        for (int j=0; j < sub.queueLen-1; j++) sub.queue[j] = sub.queue[j+1];
+        sub.queueLen--;
+        sub.dropped++;
+        dropped++;
+      }
+      sub.queue[sub.queueLen++] = seq - 1;
+    }
+    flush(sub);
+  }
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Ardumower Sunray
+// Copyright (c) 2013-2020 by Alexander Grau, Grau GmbH
+// Licensed GPLv3 for open source use
+// or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
+
+/*
+  push-based telemetry stream (Server-Sent Events, Linux app server only)
+
+  subscribe:  GET /events?rate=10    (records per second, 1..50, default 5)
+  each event: data: S,...  (same record as AT+S summary, without CRC)
+
+  the record is encoded once per tick (if any subscriber is due) into a shared ring, subscribers only queue
+  references to it: a subscriber that cannot keep up (socket send buffer full) drops its oldest queued records
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#ifdef __linux__
+  #include <BridgeClient.h>
+#endif
+
+#define TELEMETRY_MAX_CLIENTS  4
+#define TELEMETRY_RING         8      // encoded records
+#define TELEMETRY_QUEUE        4      // queued records per subscriber
+#define TELEMETRY_RECORD_SIZE  256
+
+
+#ifdef __linux__
+
+class TelemetrySubscriber
+{
+  public:
+    BridgeClient client;
+    bool used;
+    unsigned long interval;  // ms
+    unsigned long nextTime;
+    unsigned long queue[TELEMETRY_QUEUE];  // record sequence numbers (oldest first)
+    int queueLen;
+    char partial[TELEMETRY_RECORD_SIZE];  // unsent rest of a partially sent record
+    int partialLen;
+    int partialPos;
+    unsigned long dropped;
+};
+
+class Telemetry
+{
+  public:
+    unsigned long records;   // encoded records
+    unsigned long dropped;   // records dropped (slow subscribers)
+    Telemetry();
+    // takes over (HTTP) client connection and sends stream header
+    bool subscribe(BridgeClient &client, int rate);
+    int subscribers();
+    void run();
+  protected:
+    TelemetrySubscriber subs[TELEMETRY_MAX_CLIENTS];
+    char ring[TELEMETRY_RING][TELEMETRY_RECORD_SIZE];
+    int ringLen[TELEMETRY_RING];
+    unsigned long seq;       // sequence number of next record
+    void encode();
+    void flush(TelemetrySubscriber &sub);
+    void unsubscribe(TelemetrySubscriber &sub);
+};
+
+extern Telemetry telemetry;
+
+#endif
+
+#endif
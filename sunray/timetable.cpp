@@ -41,6 +41,7 @@ TimeTable::TimeTable()
     timetable.hours[21] = 0;
     timetable.hours[22] = 0;
     timetable.hours[23] = 0;    
+    for (int i=0; i < 24; i++) timetable.mapSlots[i] = -1;
 }
 
 void TimeTable::setMowingCompletedInCurrentTimeFrame(bool completed){
@@ -109,6 +110,17 @@ void TimeTable::dump(){
         CONSOLE.println();
     }
     CONSOLE.println("* means mowing allowed");
+    CONSOLE.print("timetable (UTC times) map");
+    for (int hour=0; hour < 24; hour++){
+        String s = "   ";
+        if (timetable.mapSlots[hour] >= 0) {
+            s = " ";
+            s += timetable.mapSlots[hour];
+            s += " ";
+        }
+        CONSOLE.print(s);
+    }
+    CONSOLE.println();
     CONSOLE.print("current GPS UTC weektime: ");
     dumpWeekTime(currentTime);
     CONSOLE.print("timetable enabled: ");
@@ -130,6 +142,9 @@ int TimeTable::crc(){
         crc += i * timetable.hours[i];
     }
     crc += ((byte)timetable.enable);
+    for (int i=0; i  < 24; i++){
+        crc += (i+1) * 7 * timetable.mapSlots[i];
+    }
     return crc;
 }
 
@@ -144,6 +159,21 @@ bool TimeTable::setDayMask(int hour, daymask_t mask){
     return true;
 }
 
+// set stored map to mow in hour (-1: keep current map)
+bool TimeTable::setMapSlot(int hour, int slot){
+    if ((hour < 0) || (hour > 23)) return false;
+    if ((slot < -1) || (slot >= MAX_STORED_MAPS)) return false;
+    timetable.mapSlots[hour] = slot;
+    return true;
+}
+
+int TimeTable::mapSlot(){
+    if (!timetable.enable) return -1;
+    int hour = currentTime.hour;
+    if ((hour < 0) || (hour > 23)) return -1;
+    return timetable.mapSlots[hour];
+}
+
 void TimeTable::setEnabled(bool flag){
     timetable.enable = flag;
 }
@@ -69,6 +69,7 @@ typedef byte daymask_t;
 typedef struct timetable_t {
     bool enable;    // use timetable?
     daymask_t hours[24];
+    signed char mapSlots[24];  // stored map to mow in that hour (-1: keep current map)
 } timetable_t;
 
 
@@ -107,6 +108,12 @@ class TimeTable
     // set day mask for hour 
     bool setDayMask(int hour, daymask_t mask);
 
+    // set stored map to mow in hour (-1: keep current map)
+    bool setMapSlot(int hour, int slot);
+
+    // stored map to mow for current UTC time (-1: keep current map)
+    int mapSlot();
+
 
     // ------ misc functions -----------------------------------    
     bool findAutostartTime(weektime_t &time);    
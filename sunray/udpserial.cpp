@@ -4,6 +4,7 @@
 // or Grau GmbH Commercial License for commercial use (http://grauonline.de/cms2/?page_id=153)
 
 #include "udpserial.h"
+#include "logger.h"
 #include "config.h"
 #ifdef __linux__
   #include <BridgeUdp.h>
@@ -45,20 +46,44 @@ void UdpSerial::beginUDP(){
   udpStarted = true;  
 }
 
-size_t UdpSerial::write(uint8_t data){
+void UdpSerial::writeBlock(const uint8_t *buffer, size_t size){
   if ((udpStarted) && (!udpActive)) {
     udpActive = true;
-    packetBuffer[packetIdx] = char(data);
-    packetIdx++;
-    if (packetIdx == 99){
-      packetBuffer[packetIdx] = '\0';      
-      Udp.write(packetBuffer);              
-      packetIdx = 0;            
+    for (size_t i=0; i < size; i++){
+      packetBuffer[packetIdx] = char(buffer[i]);
+      packetIdx++;
+      if (packetIdx == 99){
+        packetBuffer[packetIdx] = '\0';      
+        Udp.write(packetBuffer);              
+        packetIdx = 0;            
+      }
     }
     udpActive = false;
   }  
-  CONSOLE.write(data);
-  return 1; 
+  CONSOLE.write(buffer, size);
+}
+
+// writes are locked (Linux): CONSOLE is written by control loop and logger thread
+size_t UdpSerial::write(uint8_t data){
+  #ifdef __linux__
+    thread_lock(CONSOLE_LOCK);
+  #endif
+  writeBlock(&data, 1);
+  #ifdef __linux__
+    thread_unlock(CONSOLE_LOCK);
+  #endif
+  return 1;
+}
+
+size_t UdpSerial::write(const uint8_t *buffer, size_t size){
+  #ifdef __linux__
+    thread_lock(CONSOLE_LOCK);
+  #endif
+  writeBlock(buffer, size);
+  #ifdef __linux__
+    thread_unlock(CONSOLE_LOCK);
+  #endif
+  return size;
 }
   
   
@@ -20,10 +20,13 @@ class UdpSerial: public Stream{
     virtual void begin(unsigned long baud);
     void beginUDP();
     virtual size_t write(uint8_t);    
+    virtual size_t write(const uint8_t *buffer, size_t size);
     virtual int available();
     virtual int read();
     virtual int peek();    
     virtual void flush();
+  protected:
+    void writeBlock(const uint8_t *buffer, size_t size);
 };
 
 extern UdpSerial udpSerial; // Making it available as udpSerial
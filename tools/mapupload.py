@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+#
+# Reference encoder for the binary waypoint upload (AT+WB, see sunray/mapupload.h)
+#
+# usage: mapupload.py points.txt        (one 'x,y' point in meter per line)
+# prints the AT+WB request lines (incl. CRC) that upload the points
+
+from __future__ import print_function
+
+import base64
+import struct
+import sys
+import zlib
+
+FRAME_SIZE = 320   # max. decoded frame size (MAP_FRAME_SIZE)
+
+
+def varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return out
+
+
+def zigzag(v):
+    return varint((v << 1) ^ (v >> 31))
+
+
+def encode_frame(start_idx, points):
+    # points: list of (px, py) in cm
+    body = bytearray()
+    last = (0, 0)
+    for px, py in points:
+        body += zigzag(px - last[0]) + zigzag(py - last[1])
+        last = (px, py)
+    data = varint(start_idx) + varint(len(points)) + body
+    return bytes(data + struct.pack('<I', zlib.crc32(bytes(data)) & 0xFFFFFFFF))
+
+
+def frames(points):
+    # greedy: as many points per frame as fit into FRAME_SIZE
+    idx = 0
+    while idx < len(points):
+        num = 1
+        frame = encode_frame(idx, points[idx:idx + 1])
+        while idx + num < len(points):
+            candidate = encode_frame(idx, points[idx:idx + num + 1])
+            if len(candidate) > FRAME_SIZE:
+                break
+            frame = candidate
+            num += 1
+        yield idx, num, frame
+        idx += num
+
+
+def request(s):
+    crc = sum(bytearray(s.encode('ascii'))) & 0xFF
+    return '%s,0x%02x' % (s, crc)
+
+
+def main():
+    points = []
+    with open(sys.argv[1]) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            x, y = line.split(',')[:2]
+            points.append((int(round(float(x) * 100)), int(round(float(y) * 100))))
+    print(request('AT+WB,0,%d' % len(points)))
+    size = 0
+    for idx, num, frame in frames(points):
+        line = request('AT+WB,1,' + base64.b64encode(frame).decode('ascii'))
+        size += len(line) + 2
+        print(line)
+    ascii_size = sum(len(',%.2f,%.2f' % (px / 100.0, py / 100.0)) for px, py in points)
+    print('# %d points, %d bytes (ASCII point data alone: %d bytes)' % (len(points), size, ascii_size), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()